@@ -0,0 +1,101 @@
+/**
+ \file annotate_benchmark.cpp
+ \brief Compares calling raspicamcontrol_set_annotate from a control loop with handing requests to RaspiAnnotator.
+
+ Usage: libraspivid_annotate_benchmark [seconds]
+
+ Starts a camera at 30 fps and, from a control loop running every 10 ms, requests an annotation with the time and a
+ user text that changes every 500 ms, as a status line would. Once each request goes straight to the camera with
+ raspicamcontrol_set_annotate, and once it goes to RaspiCamera::annotator, added as a callback to the video port.
+ Reports the requests, the annotations sent to the camera and the mean, 99th percentile and maximum time a request held
+ up the control loop. Defaults to 3 seconds per mode.
+ */
+
+#include "raspivid/RaspiVid.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <atomic>
+#include <thread>
+
+using namespace std;
+using namespace raspivid;
+
+#define     LOOP_MS     10
+
+// Remembers the camera's control port, to send annotations to the camera directly
+class ControlPort : public RaspiCameraCallback {
+    public:
+        ControlPort() : port(nullptr) { }
+
+        void callback(MMAL_PORT_T *port_, MMAL_BUFFER_HEADER_T *buffer) {
+            port.store(port_);
+        }
+
+        atomic< MMAL_PORT_T * > port;
+};
+
+int main(int argc, char** argv) {
+    int seconds = argc > 1 ? atoi(argv[1]) : 3;
+    if (seconds <= 0) {
+        fprintf(stderr, "Usage: %s [seconds]\n", argv[0]);
+        return -1;
+    }
+
+    shared_ptr< ControlPort > control_port = make_shared< ControlPort >();
+    RASPICAMERA_OPTION_S options = RaspiCamera::createDefaultCameraOptions();
+    options.framerate = 30;
+    options.settings_callback = control_port;
+    options.annotator = true;
+    shared_ptr< RaspiCamera > camera = RaspiCamera::create(options);
+    if (!camera || camera->video->add_callback(camera->annotator) != MMAL_SUCCESS || camera->start() != MMAL_SUCCESS) {
+        fprintf(stderr, "unable to start the camera\n");
+        return -1;
+    }
+    while (!control_port->port.load()) {
+        this_thread::sleep_for(chrono::milliseconds(1));
+    }
+    MMAL_COMPONENT_T *component = control_port->port.load()->component;
+
+    const char *names[] = { "direct", "annotator" };
+    const int settings = ANNOTATE_USER_TEXT | ANNOTATE_TIME_TEXT | ANNOTATE_BLACK_BACKGROUND;
+    printf("%-10s%10s%10s%14s%14s%14s   (us, %d s per mode)\n", "", "requests", "sent", "request mean", "request p99",
+        "request max", seconds);
+    for (int mode = 0; mode < 2; mode++) {
+        RASPIANNOTATOR_STATS_S before = camera->annotator->get_stats();
+        RaspiPortMetrics::Histogram duration;
+        uint64_t requests = 0, sent = 0;
+        int64_t begin = RaspiPortMetrics::now_us(), end = begin + seconds * 1000000LL, longest = 0;
+        while (RaspiPortMetrics::now_us() < end) {
+            char text[32];
+            snprintf(text, sizeof(text), "zone %lld", (long long)((RaspiPortMetrics::now_us() - begin) / 500000));
+            int64_t start = RaspiPortMetrics::now_us();
+            if (mode == 0) {
+                raspicamcontrol_set_annotate(component, settings, text, 0, -1, -1);
+                sent++;
+            } else {
+                camera->annotator->set(settings, text);
+            }
+            int64_t spent = RaspiPortMetrics::now_us() - start;
+            duration.record(spent);
+            longest = vcos_max(longest, spent);
+            requests++;
+            this_thread::sleep_for(chrono::milliseconds(LOOP_MS));
+        }
+        if (mode == 1) {
+            // Let the last request through before counting
+            this_thread::sleep_for(chrono::milliseconds(200));
+            sent = camera->annotator->get_stats().updates - before.updates;
+        }
+        RASPIPORT_HISTOGRAM_S histogram;
+        duration.read(histogram);
+        printf("%-10s%10llu%10llu%14.2f%14llu%14lld\n", names[mode], (unsigned long long)requests, (unsigned long long)sent,
+            (double)histogram.sum_us / histogram.count, (unsigned long long)RaspiPortMetrics::percentile(histogram, 99),
+            (long long)longest);
+    }
+
+    RASPIANNOTATOR_STATS_S stats = camera->annotator->get_stats();
+    printf("\nannotator: %llu renders, %llu unchanged, %llu coalesced, %llu sent without a frame, %llu failed\n",
+        (unsigned long long)stats.renders, (unsigned long long)stats.unchanged, (unsigned long long)stats.coalesced,
+        (unsigned long long)stats.unsynchronised, (unsigned long long)stats.failed);
+    return 0;
+}
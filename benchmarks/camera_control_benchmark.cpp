@@ -0,0 +1,61 @@
+/**
+ \file camera_control_benchmark.cpp
+ \brief Compares sending every camera parameter on each adjustment with sending only the ones that changed.
+
+ Usage: libraspivid_camera_control_benchmark [adjustments]
+
+ Creates a camera and adjusts exposure compensation and AWB gains the way an exposure loop does, once sending the whole
+ parameter set each time, as raspicamcontrol_set_all_parameters does, and once through RaspiCameraControl::apply. Reports
+ parameters sent per adjustment and the mean and 99th percentile time of an adjustment and of a single parameter round
+ trip. Defaults to 1000 adjustments per mode.
+ */
+
+#include "raspivid/RaspiVid.h"
+#include <stdio.h>
+#include <stdlib.h>
+
+using namespace std;
+using namespace raspivid;
+
+int main(int argc, char** argv) {
+    int adjustments = argc > 1 ? atoi(argv[1]) : 1000;
+    if (adjustments <= 0) {
+        fprintf(stderr, "Usage: %s [adjustments]\n", argv[0]);
+        return -1;
+    }
+
+    RASPICAMERA_OPTION_S options = RaspiCamera::createDefaultCameraOptions();
+    options.camera_parameters.awbMode = MMAL_PARAM_AWBMODE_OFF;
+    options.camera_parameters.awb_gains_r = 1.5f;
+    options.camera_parameters.awb_gains_b = 1.5f;
+    shared_ptr< RaspiCamera > camera = RaspiCamera::create(options);
+    if (!camera) {
+        fprintf(stderr, "unable to create the camera\n");
+        return -1;
+    }
+
+    const char *names[] = { "all", "changed" };
+    printf("%-10s%12s%14s%14s%14s%14s   (us, %d adjustments)\n", "", "sent/call", "call mean", "call p99", "param mean", "param p99", adjustments);
+    for (int mode = 0; mode < 2; mode++) {
+        RASPICAM_CAMERA_PARAMETERS params = options.camera_parameters;
+        camera->control->reset_stats();
+        for (int i = 0; i < adjustments; i++) {
+            params.exposureCompensation = i % 21 - 10;
+            if (i % 4 == 0) {
+                params.awb_gains_r = 1.0f + (i % 100) / 100.0f;
+                params.awb_gains_b = 2.0f - (i % 100) / 100.0f;
+            }
+            if (mode == 0) {
+                camera->control->invalidate();
+            }
+            camera->control->apply(params);
+        }
+        RASPICAMERACONTROL_STATS_S stats = camera->control->get_stats();
+        printf("%-10s%12.2f%14.2f%14llu%14.2f%14llu\n", names[mode], (double)stats.sent / stats.applies,
+            (double)stats.apply_duration.sum_us / stats.apply_duration.count,
+            (unsigned long long)RaspiPortMetrics::percentile(stats.apply_duration, 99),
+            (double)stats.set_duration.sum_us / stats.set_duration.count,
+            (unsigned long long)RaspiPortMetrics::percentile(stats.set_duration, 99));
+    }
+    return 0;
+}
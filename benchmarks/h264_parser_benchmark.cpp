@@ -0,0 +1,163 @@
+/**
+ \file h264_parser_benchmark.cpp
+ \brief Measures RaspiH264Parser throughput over a recorded H.264 stream.
+
+ Usage: libraspivid_h264_parser_benchmark [seconds|file.h264] [passes]
+
+ Given a number of seconds, the encoder output of a camera -> encoder pipeline with the default encoder options
+ (17 Mbit/s) is recorded into memory first, keeping the encoder's buffer boundaries and flags. Given an Annex B file,
+ the file is cut into 64 KiB buffers instead. The recording is then parsed the given number of times.
+
+ Note that the host-side MMAL stand-in (LIBRASPIVID_MMAL_EMU) produces payload without zero bytes, so on the host this is
+ close to a best case for the start code scan. Recorded files from a real encoder give representative numbers.
+ */
+
+#include "raspivid/RaspiVid.h"
+#include <chrono>
+#include <memory>
+#include <mutex>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <vector>
+
+using namespace std;
+using namespace raspivid;
+
+#define     FILE_CHUNK_SIZE     65536
+
+typedef struct {
+    vector< uint8_t > data;
+    uint32_t flags;
+    int64_t pts;
+} RECORDED_BUFFER_S;
+
+class RecordCallback : public RaspiCallback {
+    public:
+        void callback(MMAL_PORT_T *port, MMAL_BUFFER_HEADER_T *buffer) {
+            if (!port->is_enabled || !buffer->length) {
+                return;
+            }
+            lock_guard< mutex > guard(lock);
+            RECORDED_BUFFER_S recorded;
+            recorded.data.assign(buffer->data + buffer->offset, buffer->data + buffer->offset + buffer->length);
+            recorded.flags = buffer->flags;
+            recorded.pts = buffer->pts;
+            buffers.push_back(std::move(recorded));
+        }
+
+        mutex lock;
+        vector< RECORDED_BUFFER_S > buffers;
+};
+
+bool record_camera(int seconds, vector< RECORDED_BUFFER_S > &buffers) {
+    auto camera = RaspiCamera::create();
+    auto encoder = RaspiEncoder::create();
+    if (!camera || !encoder) {
+        vcos_log_error("Unable to create components");
+        return false;
+    }
+    auto recorder = shared_ptr< RecordCallback >( new RecordCallback() );
+    if (encoder->connect(camera->video) != MMAL_SUCCESS ||
+            encoder->output->add_callback(recorder) != MMAL_SUCCESS ||
+            camera->start() != MMAL_SUCCESS) {
+        vcos_log_error("Unable to start recording");
+        return false;
+    }
+    sleep(seconds);
+    encoder->output->remove_callback(recorder);
+    lock_guard< mutex > guard(recorder->lock);
+    buffers.swap(recorder->buffers);
+    return true;
+}
+
+bool record_file(const char *path, vector< RECORDED_BUFFER_S > &buffers) {
+    FILE *file = fopen(path, "rb");
+    if (!file) {
+        vcos_log_error("Unable to open %s", path);
+        return false;
+    }
+    RECORDED_BUFFER_S recorded;
+    recorded.data.resize(FILE_CHUNK_SIZE);
+    size_t read;
+    while ((read = fread(recorded.data.data(), 1, FILE_CHUNK_SIZE, file)) > 0) {
+        recorded.data.resize(read);
+        recorded.flags = 0;
+        recorded.pts = MMAL_TIME_UNKNOWN;
+        buffers.push_back(recorded);
+        recorded.data.resize(FILE_CHUNK_SIZE);
+    }
+    fclose(file);
+    if (!buffers.empty()) {
+        buffers.back().flags |= MMAL_BUFFER_HEADER_FLAG_FRAME_END;
+    }
+    return true;
+}
+
+int main(int argc, char** argv) {
+    const char *source = argc > 1 ? argv[1] : "5";
+    int passes = argc > 2 ? atoi(argv[2]) : 20;
+    if (passes <= 0) {
+        passes = 20;
+    }
+
+    vector< RECORDED_BUFFER_S > buffers;
+    int seconds = atoi(source);
+    if (seconds > 0 ? !record_camera(seconds, buffers) : !record_file(source, buffers)) {
+        return -1;
+    }
+
+    uint64_t bytes = 0;
+    for (auto &buffer : buffers) {
+        bytes += buffer.data.size();
+    }
+    if (!bytes) {
+        vcos_log_error("Nothing recorded");
+        return -1;
+    }
+
+    auto parser = RaspiH264Parser::create();
+    uint64_t types[32] = { 0 };
+    uint64_t pieces = 0;
+    uint64_t access_units = 0;
+    uint64_t nal_bytes = 0;
+
+    auto start = std::chrono::steady_clock::now();
+    for (int pass = 0; pass < passes; pass++) {
+        parser->reset();
+        for (auto &buffer : buffers) {
+            uint32_t count = parser->parse(buffer.data.data(), buffer.data.size(), buffer.flags, buffer.pts);
+            const RASPIH264_NAL_S *nals = parser->nals();
+            for (uint32_t i = 0; i < count; i++) {
+                nal_bytes += nals[i].length;
+                if (nals[i].flags & RASPIH264_NAL_FLAG_START) {
+                    types[nals[i].type]++;
+                }
+                if (nals[i].flags & RASPIH264_NAL_FLAG_ACCESS_UNIT_END) {
+                    access_units++;
+                }
+            }
+            pieces += count;
+        }
+    }
+    double elapsed = std::chrono::duration< double >(std::chrono::steady_clock::now() - start).count();
+
+    printf("%zu buffers, %.2f MB per pass, %d passes\n", buffers.size(), bytes / (double)(1 << 20), passes);
+    printf("parsed %.2f MB/s  %.0f buffers/s  %.2f ns/byte\n", bytes * passes / elapsed / (1 << 20),
+        buffers.size() * passes / elapsed, elapsed * 1e9 / (bytes * passes));
+    printf("per pass: %llu pieces, %llu access units, %llu NAL bytes, %llu overflowed\n",
+        (unsigned long long)(pieces / passes), (unsigned long long)(access_units / passes),
+        (unsigned long long)(nal_bytes / passes), (unsigned long long)parser->overflowed());
+    uint64_t nals = 0;
+    for (int i = 0; i < 32; i++) {
+        nals += types[i];
+    }
+    uint64_t other = nals - types[RASPIH264_NAL_SPS] - types[RASPIH264_NAL_PPS] - types[RASPIH264_NAL_IDR] -
+        types[RASPIH264_NAL_SLICE] - types[RASPIH264_NAL_SEI];
+    printf("per pass NALs: SPS %llu  PPS %llu  IDR %llu  slice %llu  SEI %llu  other %llu\n",
+        (unsigned long long)(types[RASPIH264_NAL_SPS] / passes), (unsigned long long)(types[RASPIH264_NAL_PPS] / passes),
+        (unsigned long long)(types[RASPIH264_NAL_IDR] / passes), (unsigned long long)(types[RASPIH264_NAL_SLICE] / passes),
+        (unsigned long long)(types[RASPIH264_NAL_SEI] / passes), (unsigned long long)(other / passes));
+    return 0;
+}
@@ -0,0 +1,128 @@
+/**
+ \file i420_benchmark.cpp
+ \brief Compares the RaspiI420Kernels instruction set paths against the scalar reference, for speed and for identical output.
+
+ Usage: libraspivid_i420_benchmark [iterations] [width] [height]
+
+ Fills two padded I420 frames with a gradient plus noise, then runs every kernel on every path available in this build and
+ on this CPU. Each path's output is compared byte for byte with the scalar path, both on the whole frame and on an odd
+ sized, odd offset crop that exercises the edge handling. Defaults to 200 iterations of 1920x1080.
+ */
+
+#include "raspivid/RaspiVid.h"
+#include <chrono>
+#include <functional>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <vector>
+
+using namespace std;
+using namespace raspivid;
+
+typedef struct {
+    const char *name;
+    function< void(RaspiI420Kernels &kernels, const RASPII420_IMAGE_S &a, const RASPII420_IMAGE_S &b, vector< uint8_t > &out) > run;
+} KERNEL_S;
+
+static void fill(vector< uint8_t > &buffer, uint32_t seed) {
+    srand(seed);
+    for (size_t i = 0; i < buffer.size(); i++) {
+        buffer[i] = (uint8_t)((i / 7 + rand() % 32) & 0xff);
+    }
+}
+
+static double time_ms(function< void() > run, int iterations) {
+    auto start = chrono::steady_clock::now();
+    for (int i = 0; i < iterations; i++) {
+        run();
+    }
+    return chrono::duration< double, milli >(chrono::steady_clock::now() - start).count() / iterations;
+}
+
+int main(int argc, char** argv) {
+    int iterations = argc > 1 ? atoi(argv[1]) : 200;
+    uint32_t width = argc > 2 ? atoi(argv[2]) : 1920;
+    uint32_t height = argc > 3 ? atoi(argv[3]) : 1080;
+    if (iterations <= 0 || width < 64 || height < 32) {
+        fprintf(stderr, "Usage: %s [iterations] [width >= 64] [height >= 32]\n", argv[0]);
+        return -1;
+    }
+
+    vector< uint8_t > frame_a(RaspiI420Kernels::image_size(width, height)), frame_b(frame_a.size());
+    fill(frame_a, 1);
+    fill(frame_b, 2);
+    RASPII420_IMAGE_S a = RaspiI420Kernels::image(frame_a.data(), width, height);
+    RASPII420_IMAGE_S b = RaspiI420Kernels::image(frame_b.data(), width, height);
+
+    KERNEL_S kernels[] = {
+        { "extract_y", [](RaspiI420Kernels &k, const RASPII420_IMAGE_S &a, const RASPII420_IMAGE_S &b, vector< uint8_t > &out) {
+            out.assign(a.width * a.height, 0);
+            k.extract_plane(a, 0, out.data(), a.width);
+        } },
+        { "downscale2", [](RaspiI420Kernels &k, const RASPII420_IMAGE_S &a, const RASPII420_IMAGE_S &b, vector< uint8_t > &out) {
+            out.assign(RaspiI420Kernels::image_size(a.width / 2, a.height / 2), 0);
+            k.downscale(a, RaspiI420Kernels::image(out.data(), a.width / 2, a.height / 2), 2);
+        } },
+        { "downscale4", [](RaspiI420Kernels &k, const RASPII420_IMAGE_S &a, const RASPII420_IMAGE_S &b, vector< uint8_t > &out) {
+            out.assign(RaspiI420Kernels::image_size(a.width / 4, a.height / 4), 0);
+            k.downscale(a, RaspiI420Kernels::image(out.data(), a.width / 4, a.height / 4), 4);
+        } },
+        { "histogram", [](RaspiI420Kernels &k, const RASPII420_IMAGE_S &a, const RASPII420_IMAGE_S &b, vector< uint8_t > &out) {
+            out.assign(256 * sizeof(uint32_t), 0);
+            k.histogram(a, (uint32_t *)out.data());
+        } },
+        { "difference", [](RaspiI420Kernels &k, const RASPII420_IMAGE_S &a, const RASPII420_IMAGE_S &b, vector< uint8_t > &out) {
+            out.assign(a.width * a.height + sizeof(uint32_t), 0);
+            uint32_t count = k.difference(a, b, 20, out.data() + sizeof(uint32_t), a.width);
+            memcpy(out.data(), &count, sizeof(count));
+        } },
+        { "to_rgb24", [](RaspiI420Kernels &k, const RASPII420_IMAGE_S &a, const RASPII420_IMAGE_S &b, vector< uint8_t > &out) {
+            out.assign(a.width * a.height * 3, 0);
+            k.to_rgb24(a, out.data(), a.width * 3);
+        } },
+    };
+
+    RASPII420_PATH_T paths[] = { RASPII420_PATH_SCALAR, RASPII420_PATH_SSE2, RASPII420_PATH_AVX2, RASPII420_PATH_NEON };
+    RASPII420_IMAGE_S crop_a = RaspiI420Kernels::crop(a, 35, 17, width - 48, height - 23);
+    RASPII420_IMAGE_S crop_b = RaspiI420Kernels::crop(b, 35, 17, width - 48, height - 23);
+    auto reference = RaspiI420Kernels::create(RASPII420_PATH_SCALAR);
+    int mismatches = 0;
+
+    printf("%ux%u, %d iterations, ms per frame (speedup over scalar)\n%-12s", width, height, iterations, "");
+    for (RASPII420_PATH_T path : paths) {
+        auto k = RaspiI420Kernels::create(path);
+        if (k) {
+            printf("%18s", k->name());
+        }
+    }
+    printf("\n");
+
+    for (KERNEL_S &kernel : kernels) {
+        printf("%-12s", kernel.name);
+        vector< uint8_t > expected, expected_crop, out;
+        kernel.run(*reference, a, b, expected);
+        kernel.run(*reference, crop_a, crop_b, expected_crop);
+        double scalar_ms = 0;
+        for (RASPII420_PATH_T path : paths) {
+            auto k = RaspiI420Kernels::create(path);
+            if (!k) {
+                continue;
+            }
+            double ms = time_ms([&]() { kernel.run(*k, a, b, out); }, iterations);
+            bool same = out == expected;
+            kernel.run(*k, crop_a, crop_b, out);
+            same = same && out == expected_crop;
+            if (path == RASPII420_PATH_SCALAR) {
+                scalar_ms = ms;
+            }
+            printf("%9.3f (%4.1fx)%s", ms, scalar_ms / ms, same ? " " : "!");
+            mismatches += !same;
+        }
+        printf("\n");
+    }
+    if (mismatches) {
+        printf("%d results differ from the scalar reference (marked !)\n", mismatches);
+    }
+    return mismatches ? -1 : 0;
+}
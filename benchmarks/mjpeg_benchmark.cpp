@@ -0,0 +1,184 @@
+/**
+ \file mjpeg_benchmark.cpp
+ \brief A localhost load generator for RaspiMJPEGServer.
+
+ Usage: libraspivid_mjpeg_benchmark [fast clients] [slow clients] [seconds]
+
+ Starts a camera at 30 fps feeding a RaspiEncoder in MMAL_ENCODING_MJPEG mode, serves it with a RaspiMJPEGServer on
+ 127.0.0.1 and connects fast clients, which read as fast as they can, and slow clients, which read 16 KB every 100 ms
+ through a small receive buffer, far less than the stream needs. Every client parses the multipart stream and checks
+ each part is a whole JPEG. Reports the frames each kind of client received per second, the frames the server dropped
+ for backed up clients and copied out of encoder buffers, and any malformed parts. The fast clients should keep up with
+ the encoder whatever the slow ones do. Defaults to 8 fast clients, 2 slow clients and 5 seconds.
+ */
+
+#include "raspivid/RaspiVid.h"
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include <atomic>
+#include <thread>
+#include <vector>
+
+using namespace std;
+using namespace raspivid;
+
+#define     SLOW_READ       16384
+#define     SLOW_PAUSE_MS   100
+
+typedef struct {
+    uint64_t frames;
+    uint64_t malformed;
+    bool connected;
+} CLIENT_RESULT_S;
+
+static void run_client(uint16_t port, bool slow, const atomic< bool > &running, CLIENT_RESULT_S *result) {
+    result->frames = result->malformed = 0;
+    result->connected = false;
+    int fd = socket(AF_INET, SOCK_STREAM, 0);
+    if (slow) {
+        int size = SLOW_READ;
+        setsockopt(fd, SOL_SOCKET, SO_RCVBUF, &size, sizeof(size));
+    }
+    struct timeval timeout = { 0, 200000 };
+    setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+    struct sockaddr_in address;
+    memset(&address, 0, sizeof(address));
+    address.sin_family = AF_INET;
+    address.sin_port = htons(port);
+    address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    const char request[] = "GET /stream.mjpg HTTP/1.0\r\n\r\n";
+    if (connect(fd, (struct sockaddr *)&address, sizeof(address)) != 0 || send(fd, request, sizeof(request) - 1, 0) < 0) {
+        close(fd);
+        return;
+    }
+    result->connected = true;
+
+    string stream;
+    bool head = true;
+    vector< char > buffer(1 << 16);
+    while (running.load()) {
+        ssize_t length = recv(fd, buffer.data(), slow ? SLOW_READ : buffer.size(), 0);
+        if (length == 0) {
+            break;
+        }
+        if (length > 0) {
+            stream.append(buffer.data(), length);
+        }
+        while (true) {
+            size_t end = stream.find("\r\n\r\n");
+            if (end == string::npos) {
+                break;
+            }
+            if (head) {
+                if (stream.compare(0, 15, "HTTP/1.0 200 OK") != 0) {
+                    result->malformed++;
+                }
+                stream.erase(0, end + 4);
+                head = false;
+                continue;
+            }
+            size_t field = stream.find("Content-Length: ");
+            if (stream.compare(0, 2, "--") != 0 || field == string::npos || field > end) {
+                result->malformed++;
+                stream.clear();
+                break;
+            }
+            size_t jpeg = strtoul(stream.c_str() + field + 16, NULL, 10);
+            if (stream.size() < end + 4 + jpeg + 2) {
+                break;
+            }
+            const unsigned char *data = (const unsigned char *)stream.data() + end + 4;
+            if (jpeg < 4 || data[0] != 0xff || data[1] != 0xd8 || data[jpeg - 2] != 0xff || data[jpeg - 1] != 0xd9 ||
+                    stream.compare(end + 4 + jpeg, 2, "\r\n") != 0) {
+                result->malformed++;
+            }
+            result->frames++;
+            stream.erase(0, end + 4 + jpeg + 2);
+        }
+        if (slow) {
+            this_thread::sleep_for(chrono::milliseconds(SLOW_PAUSE_MS));
+        }
+    }
+    close(fd);
+}
+
+int main(int argc, char** argv) {
+    int fast = argc > 1 ? atoi(argv[1]) : 8;
+    int slow = argc > 2 ? atoi(argv[2]) : 2;
+    int seconds = argc > 3 ? atoi(argv[3]) : 5;
+    if (fast < 0 || slow < 0 || seconds <= 0) {
+        fprintf(stderr, "Usage: %s [fast clients] [slow clients] [seconds]\n", argv[0]);
+        return -1;
+    }
+
+    RASPICAMERA_OPTION_S camera_options = RaspiCamera::createDefaultCameraOptions();
+    camera_options.framerate = 30;
+    RASPIENCODER_OPTION_S encoder_options = RaspiEncoder::createDefaultEncoderOptions();
+    encoder_options.encoding = MMAL_ENCODING_MJPEG;
+    encoder_options.bitrate = 25000000;
+    RASPIMJPEGSERVER_OPTION_S server_options = RaspiMJPEGServer::createDefaultServerOptions();
+    server_options.address = "127.0.0.1";
+    server_options.port = 0;
+    server_options.max_clients = fast + slow;
+    server_options.send_buffer = 65536;
+
+    shared_ptr< RaspiCamera > camera = RaspiCamera::create(camera_options);
+    shared_ptr< RaspiEncoder > encoder = RaspiEncoder::create(encoder_options);
+    shared_ptr< RaspiMJPEGServer > server = RaspiMJPEGServer::create(server_options);
+    if (!camera || !encoder || !server) {
+        fprintf(stderr, "unable to create the pipeline\n");
+        return -1;
+    }
+    RASPIPORT_FORMAT_S format = camera->video->get_format();
+    format.encoding = MMAL_ENCODING_I420;
+    if (camera->video->set_format(format) != MMAL_SUCCESS || encoder->connect(camera) != MMAL_SUCCESS ||
+            encoder->output->add_callback(server) != MMAL_SUCCESS || camera->start() != MMAL_SUCCESS) {
+        fprintf(stderr, "unable to start the pipeline\n");
+        return -1;
+    }
+
+    atomic< bool > running(true);
+    vector< CLIENT_RESULT_S > results(fast + slow);
+    vector< thread > clients;
+    for (int i = 0; i < fast + slow; i++) {
+        clients.push_back(thread(run_client, server->get_port(), i >= fast, cref(running), &results[i]));
+    }
+    RASPIMJPEGSERVER_STATS_S before = server->get_stats();
+    this_thread::sleep_for(chrono::seconds(seconds));
+    RASPIMJPEGSERVER_STATS_S after = server->get_stats();
+    running.store(false);
+    for (thread &client : clients) {
+        client.join();
+    }
+    encoder->output->remove_callback(server);
+    server->stop();
+
+    printf("%d s on port %u, encoder %.1f fps\n\n", seconds, server->get_port(), (double)(after.frames - before.frames) / seconds);
+    printf("%-8s%10s%12s%12s%12s\n", "", "clients", "mean fps", "min fps", "malformed");
+    for (int kind = 0; kind < 2; kind++) {
+        int first = kind ? fast : 0, last = kind ? fast + slow : fast, connected = 0;
+        uint64_t total = 0, lowest = UINT64_MAX, malformed = 0;
+        for (int i = first; i < last; i++) {
+            if (!results[i].connected) {
+                continue;
+            }
+            connected++;
+            total += results[i].frames;
+            lowest = vcos_min(lowest, results[i].frames);
+            malformed += results[i].malformed;
+        }
+        printf("%-8s%10d%12.1f%12.1f%12llu\n", kind ? "slow" : "fast", connected, connected ? (double)total / connected / seconds : 0.0,
+            connected ? (double)lowest / seconds : 0.0, (unsigned long long)malformed);
+    }
+
+    RASPIMJPEGSERVER_STATS_S stats = server->get_stats();
+    printf("\nserver: %llu frames sent, %llu dropped for backed up clients, %llu copied, %llu skipped, %llu timeouts, %.1f MB sent\n",
+        (unsigned long long)stats.frames_sent, (unsigned long long)stats.frames_dropped, (unsigned long long)stats.copied,
+        (unsigned long long)stats.skipped, (unsigned long long)stats.timeouts, stats.bytes_sent / 1e6);
+    return 0;
+}
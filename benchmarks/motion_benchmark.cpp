@@ -0,0 +1,132 @@
+/**
+ \file motion_benchmark.cpp
+ \brief Measures RaspiMotionAnalyzer throughput on synthetic motion vectors, and checks it against live encoder vectors.
+
+ Usage: libraspivid_motion_benchmark [frames] [width] [height] [live width] [live height]
+
+ Generates a sequence of motion vector frames in the encoder's inline vector format, with background noise and a block of
+ motion moving across the frame, and analyzes them back to back. Reports frames and macroblocks per second, and how many
+ times faster than real time at 30 fps that is. Defaults to 3000 frames of 1920x1080.
+
+ Then runs a camera and encoder for 2 seconds at the live size and analyzes the encoder's own vectors through the callback,
+ checking that every vector buffer is analyzed. The live size defaults to 1640x1232, whose width is not a multiple of 32,
+ so the encoder input is padded and the vector rows must follow the crop width.
+ */
+
+#include "raspivid/RaspiVid.h"
+#include <atomic>
+#include <chrono>
+#include <stdio.h>
+#include <stdlib.h>
+#include <thread>
+#include <vector>
+
+using namespace std;
+using namespace raspivid;
+
+#define     SEQUENCE_FRAMES     32
+
+class EventCounter : public RaspiMotionAnalyzer {
+    public:
+        EventCounter() : RaspiMotionAnalyzer(RaspiMotionAnalyzer::createDefaultMotionAnalyzerOptions()), starts(0), stops(0) { }
+
+        void motion_event(const RASPIMOTIONANALYZER_EVENT_S &event) {
+            if (event.start) {
+                starts++;
+            } else {
+                stops++;
+            }
+        }
+
+        uint64_t starts;
+        uint64_t stops;
+};
+
+class VectorCounter : public RaspiCallback {
+    public:
+        VectorCounter() : buffers(0) { }
+
+        void callback(MMAL_PORT_T *port, MMAL_BUFFER_HEADER_T *buffer) {
+            if ((buffer->flags & MMAL_BUFFER_HEADER_FLAG_CODECSIDEINFO) && buffer->length) {
+                buffers++;
+            }
+        }
+
+        atomic< uint64_t > buffers;
+};
+
+static int run_live(uint32_t width, uint32_t height) {
+    RASPICAMERA_OPTION_S camera_options = RaspiCamera::createDefaultCameraOptions();
+    camera_options.width = width;
+    camera_options.height = height;
+    RASPIENCODER_OPTION_S encoder_options = RaspiEncoder::createDefaultEncoderOptions();
+    encoder_options.inlineMotionVectors = 1;
+    shared_ptr< RaspiCamera > camera = RaspiCamera::create(camera_options);
+    shared_ptr< RaspiEncoder > encoder = RaspiEncoder::create(encoder_options);
+    shared_ptr< EventCounter > analyzer = make_shared< EventCounter >();
+    shared_ptr< VectorCounter > counter = make_shared< VectorCounter >();
+    if (!camera || !encoder || encoder->connect(camera) != MMAL_SUCCESS || encoder->output->add_callback(counter) != MMAL_SUCCESS ||
+            encoder->output->add_callback(analyzer) != MMAL_SUCCESS || camera->start() != MMAL_SUCCESS) {
+        fprintf(stderr, "unable to start the live pipeline\n");
+        return -1;
+    }
+    this_thread::sleep_for(chrono::seconds(2));
+    encoder->output->remove_callback(analyzer);
+    encoder->output->remove_callback(counter);
+    this_thread::sleep_for(chrono::milliseconds(100));
+
+    RASPIPORT_FORMAT_S format = encoder->output->get_format();
+    printf("live %ux%u, padded to %ux%u: %llu of %llu vector buffers analyzed, %llu motion starts\n", format.crop.width,
+        format.crop.height, format.width, format.height, (unsigned long long)analyzer->frames(),
+        (unsigned long long)counter->buffers.load(), (unsigned long long)analyzer->starts);
+    return analyzer->frames() && analyzer->frames() == counter->buffers.load() ? 0 : -1;
+}
+
+int main(int argc, char** argv) {
+    int frames = argc > 1 ? atoi(argv[1]) : 3000;
+    uint32_t width = argc > 2 ? atoi(argv[2]) : 1920;
+    uint32_t height = argc > 3 ? atoi(argv[3]) : 1080;
+    uint32_t live_width = argc > 4 ? atoi(argv[4]) : 1640;
+    uint32_t live_height = argc > 5 ? atoi(argv[5]) : 1232;
+    if (frames <= 0 || !width || !height || !live_width || !live_height) {
+        fprintf(stderr, "Usage: %s [frames] [width] [height] [live width] [live height]\n", argv[0]);
+        return -1;
+    }
+    uint32_t mb_width = VCOS_ALIGN_UP(width, 16) >> 4;
+    uint32_t mb_height = VCOS_ALIGN_UP(height, 16) >> 4;
+    uint32_t stride = mb_width + 1;
+
+    vector< vector< uint8_t > > sequence(SEQUENCE_FRAMES);
+    srand(1);
+    for (int f = 0; f < SEQUENCE_FRAMES; f++) {
+        vector< uint8_t > &records = sequence[f];
+        records.assign(stride * mb_height * 4, 0);
+        uint32_t block_x = f * mb_width / SEQUENCE_FRAMES;
+        for (uint32_t y = 0; y < mb_height; y++) {
+            for (uint32_t x = 0; x < mb_width; x++) {
+                uint8_t *record = &records[(y * stride + x) * 4];
+                bool moving = x >= block_x && x < block_x + mb_width / 8 && y >= mb_height / 3 && y < 2 * mb_height / 3;
+                record[0] = (uint8_t)(moving ? 8 : rand() % 3 - 1);
+                record[1] = (uint8_t)(moving ? -2 : rand() % 3 - 1);
+                uint16_t sad = rand() % 2048;
+                record[2] = sad & 0xff;
+                record[3] = sad >> 8;
+            }
+        }
+    }
+
+    EventCounter analyzer;
+    auto start = chrono::steady_clock::now();
+    for (int i = 0; i < frames; i++) {
+        const vector< uint8_t > &records = sequence[(i / 8) % SEQUENCE_FRAMES];
+        analyzer.analyze(records.data(), records.size(), width, i * 33333LL);
+        analyzer.post_process();
+    }
+    double seconds = chrono::duration< double >(chrono::steady_clock::now() - start).count();
+
+    double fps = frames / seconds;
+    printf("%ux%u: %d frames in %.3f s, %.0f frames/s, %.1f M macroblocks/s, %.1fx real time at 30 fps\n", width, height, frames,
+        seconds, fps, fps * mb_width * mb_height / 1e6, fps / 30);
+    printf("%llu motion starts, %llu motion stops\n", (unsigned long long)analyzer.starts, (unsigned long long)analyzer.stops);
+    return run_live(live_width, live_height);
+}
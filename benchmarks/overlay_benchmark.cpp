@@ -0,0 +1,103 @@
+/**
+ \file overlay_benchmark.cpp
+ \brief Compares repainting whole overlay buffers with sending only the changed rectangles through RaspiOverlaySurface.
+
+ Usage: libraspivid_overlay_benchmark [seconds]
+
+ Updates a 320x48 timestamp box on a 1920x1080 overlay at 1, 10 and 100 updates per second, in three ways: repainting and
+ sending the whole RGB24 buffer from RaspiOverlayRenderer::get_buffer each time, drawing into an RGB24 RaspiOverlaySurface,
+ and drawing into a palette RaspiOverlaySurface over an RGBA overlay. Reports the updates sent, the megabytes written into
+ overlay buffers per second and the CPU time the drawing thread spent per second. Runs each rate and mode for 2 seconds by
+ default.
+ */
+
+#include "raspivid/RaspiVid.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <thread>
+
+using namespace std;
+using namespace raspivid;
+
+static const MMAL_RECT_T BOX = { 64, 64, 320, 48 };
+
+static int64_t thread_cpu_us() {
+    struct timespec ts;
+    clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+    return (int64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+static shared_ptr< RaspiOverlayRenderer > create_overlay(uint32_t encoding) {
+    RASPIOVERLAYRENDERER_FORMAT_S format = RaspiOverlayRenderer::createDefaultOverlayFormat();
+    format.encoding = encoding;
+    format.width = 1920;
+    format.height = 1080;
+    return RaspiOverlayRenderer::create(format);
+}
+
+int main(int argc, char** argv) {
+    int seconds = argc > 1 ? atoi(argv[1]) : 2;
+    if (seconds <= 0) {
+        fprintf(stderr, "Usage: %s [seconds]\n", argv[0]);
+        return -1;
+    }
+
+    const int rates[] = { 1, 10, 100 };
+    const char *names[] = { "full RGB24", "dirty RGB24", "palette RGBA" };
+    printf("%-6s%-14s%10s%12s%14s\n", "rate", "", "updates", "MB/s", "CPU ms/s");
+    for (int rate : rates) {
+        for (int mode = 0; mode < 3; mode++) {
+            shared_ptr< RaspiOverlayRenderer > overlay = create_overlay(mode == 2 ? MMAL_ENCODING_RGBA : MMAL_ENCODING_RGB24);
+            shared_ptr< RaspiOverlaySurface > surface;
+            if (!overlay) {
+                fprintf(stderr, "unable to create the overlay\n");
+                return -1;
+            }
+            if (mode > 0) {
+                surface = RaspiOverlaySurface::create(overlay, mode == 2 ? RASPIOVERLAYSURFACE_PALETTE8 : RASPIOVERLAYSURFACE_DIRECT);
+                for (unsigned int i = 1; i < 256; i++) {
+                    surface->set_palette(i, 0xff000000 | (i * 0x010101));
+                }
+                // Every pool buffer is filled once in full, which is not what this measures
+                for (int i = 0; i < 8; i++) {
+                    surface->update(true);
+                }
+            }
+
+            uint64_t updates = 0, bytes = 0, primed = surface ? surface->get_stats().bytes : 0;
+            int64_t period = 1000000 / rate;
+            int64_t start = RaspiPortMetrics::now_us(), cpu = 0;
+            for (int64_t next = start; next < start + seconds * 1000000LL; next += period) {
+                int64_t now = RaspiPortMetrics::now_us();
+                if (next > now) {
+                    this_thread::sleep_for(chrono::microseconds(next - now));
+                }
+                int64_t cpu_start = thread_cpu_us();
+                uint32_t shade = 1 + updates % 255;
+                if (mode == 0) {
+                    MMAL_BUFFER_HEADER_T *buffer = overlay->get_buffer();
+                    uint32_t stride = mmal_encoding_width_to_stride(MMAL_ENCODING_RGB24, VCOS_ALIGN_UP(1920, 32));
+                    memset(buffer->data, 0, buffer->alloc_size);
+                    for (int32_t y = BOX.y; y < BOX.y + BOX.height; y++) {
+                        memset(buffer->data + y * stride + BOX.x * 3, shade, BOX.width * 3);
+                    }
+                    overlay->send_buffer(buffer);
+                    bytes += buffer->alloc_size;
+                } else {
+                    surface->fill(BOX, mode == 2 ? shade : 0xff000000 | (shade * 0x010101));
+                    surface->update();
+                }
+                cpu += thread_cpu_us() - cpu_start;
+                updates++;
+            }
+            if (surface) {
+                bytes = surface->get_stats().bytes - primed;
+            }
+            printf("%-6d%-14s%10llu%12.2f%14.2f\n", rate, names[mode], (unsigned long long)updates,
+                bytes / 1e6 / seconds, cpu / 1000.0 / seconds);
+        }
+    }
+    return 0;
+}
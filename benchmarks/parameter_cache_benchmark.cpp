@@ -0,0 +1,94 @@
+/**
+ \file parameter_cache_benchmark.cpp
+ \brief Compares reading the camera's settings from the camera with reading them from the RaspiCameraControl cache.
+
+ Usage: libraspivid_parameter_cache_benchmark [reads]
+
+ Starts a camera with a preview renderer and reads the exposure and gains the way a control loop does, once with
+ mmal_port_parameter_get for MMAL_PARAMETER_CAMERA_SETTINGS, a round trip to the camera for each read, and once by polling
+ RaspiCameraControl::get_version and taking RaspiCameraControl::get_snapshot when it moved. Reports the mean and 99th
+ percentile time of a read, then the settings reports the cache received while the camera ran. Defaults to 100000 reads per
+ mode.
+ */
+
+#include "raspivid/RaspiVid.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <atomic>
+#include <thread>
+
+using namespace std;
+using namespace raspivid;
+
+#define     SETTINGS_TIMEOUT_MS     5000
+
+// Remembers the camera's control port, the only way to read the settings from the camera
+class ControlPort : public RaspiCameraCallback {
+    public:
+        ControlPort() : port(nullptr) { }
+
+        void callback(MMAL_PORT_T *port_, MMAL_BUFFER_HEADER_T *buffer) {
+            port.store(port_);
+        }
+
+        atomic< MMAL_PORT_T * > port;
+};
+
+int main(int argc, char** argv) {
+    int reads = argc > 1 ? atoi(argv[1]) : 100000;
+    if (reads <= 0) {
+        fprintf(stderr, "Usage: %s [reads]\n", argv[0]);
+        return -1;
+    }
+
+    shared_ptr< ControlPort > control_port = make_shared< ControlPort >();
+    RASPICAMERA_OPTION_S options = RaspiCamera::createDefaultCameraOptions();
+    options.settings_callback = control_port;
+    shared_ptr< RaspiCamera > camera = RaspiCamera::create(options);
+    shared_ptr< RaspiRenderer > preview = RaspiRenderer::create();
+    if (!camera || !preview || preview->connect(camera->preview) != MMAL_SUCCESS || camera->start() != MMAL_SUCCESS) {
+        fprintf(stderr, "unable to start the camera\n");
+        return -1;
+    }
+    for (int waited = 0; !control_port->port.load() && waited < SETTINGS_TIMEOUT_MS; waited++) {
+        this_thread::sleep_for(chrono::milliseconds(1));
+    }
+    MMAL_PORT_T *port = control_port->port.load();
+    if (!port) {
+        fprintf(stderr, "the camera reported no settings\n");
+        return -1;
+    }
+
+    const char *names[] = { "camera", "cache" };
+    printf("%-10s%14s%14s%14s   (us, %d reads)\n", "", "read mean", "read p99", "exposure", reads);
+    for (int mode = 0; mode < 2; mode++) {
+        RaspiPortMetrics::Histogram duration;
+        uint64_t seen = 0;
+        uint32_t exposure = 0;
+        for (int i = 0; i < reads; i++) {
+            int64_t start = RaspiPortMetrics::now_us();
+            if (mode == 0) {
+                MMAL_PARAMETER_CAMERA_SETTINGS_T settings = {{MMAL_PARAMETER_CAMERA_SETTINGS, sizeof(settings)}};
+                if (mmal_port_parameter_get(port, &settings.hdr) != MMAL_SUCCESS) {
+                    fprintf(stderr, "unable to read the camera settings\n");
+                    return -1;
+                }
+                exposure = settings.exposure;
+            } else if (camera->control->get_version() != seen) {
+                shared_ptr< const RASPICAMERACONTROL_SNAPSHOT_S > snapshot = camera->control->get_snapshot();
+                seen = snapshot->version;
+                exposure = snapshot->settings.exposure;
+            }
+            duration.record(RaspiPortMetrics::now_us() - start);
+        }
+        RASPIPORT_HISTOGRAM_S histogram;
+        duration.read(histogram);
+        printf("%-10s%14.3f%14llu%14u\n", names[mode], (double)histogram.sum_us / histogram.count,
+            (unsigned long long)RaspiPortMetrics::percentile(histogram, 99), exposure);
+    }
+
+    shared_ptr< const RASPICAMERACONTROL_SNAPSHOT_S > snapshot = camera->control->get_snapshot();
+    printf("\ncache version %llu, %llu settings reports\n", (unsigned long long)snapshot->version,
+        (unsigned long long)snapshot->settings_reports);
+    return 0;
+}
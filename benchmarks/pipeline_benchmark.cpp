@@ -0,0 +1,139 @@
+/**
+ \file pipeline_benchmark.cpp
+ \brief Measures throughput and capture-to-callback latency of a camera -> splitter -> { encoder, resizer } pipeline.
+
+ Usage: libraspivid_pipeline_benchmark [seconds] [framerate] [unthrottled]
+
+ Each port's own metrics (frame interval jitter, callback duration percentiles and pool starvation) are printed
+ below the summary. When built against the host-side MMAL stand-in (LIBRASPIVID_MMAL_EMU), frame pts values share a clock with
+ mmal_emu_time_us(), so latency and per-port starvation are reported as well. Passing "unthrottled" lets the
+ synthetic camera run as fast as the pipeline can consume frames.
+ */
+
+#include "raspivid/RaspiVid.h"
+#include <atomic>
+#include <memory>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#ifdef LIBRASPIVID_MMAL_EMU
+#include "interface/mmal/mmal_emu.h"
+#endif
+
+using namespace std;
+using namespace raspivid;
+
+#define     RESIZE_WIDTH    640
+#define     RESIZE_HEIGHT   480
+
+class StatsCallback : public RaspiCallback {
+    public:
+        StatsCallback() : port(NULL), frames(0), bytes(0), latency_sum(0), latency_max(0) {}
+
+        void callback(MMAL_PORT_T *port_, MMAL_BUFFER_HEADER_T *buffer) {
+            port = port_;
+            bytes += buffer->length;
+            if (buffer->flags & (MMAL_BUFFER_HEADER_FLAG_CONFIG | MMAL_BUFFER_HEADER_FLAG_CODECSIDEINFO)) {
+                return;
+            }
+            if (!(buffer->flags & MMAL_BUFFER_HEADER_FLAG_FRAME_END)) {
+                return;
+            }
+            frames++;
+#ifdef LIBRASPIVID_MMAL_EMU
+            if (buffer->pts != MMAL_TIME_UNKNOWN) {
+                int64_t latency = mmal_emu_time_us() - buffer->pts;
+                latency_sum += latency;
+                if (latency > latency_max) {
+                    latency_max = latency;
+                }
+            }
+#endif
+        }
+
+        void report(const char *name, double seconds) {
+            uint64_t count = frames;
+            printf("%-8s %8.2f fps %10.2f MB/s", name, count / seconds, bytes / seconds / (1 << 20));
+#ifdef LIBRASPIVID_MMAL_EMU
+            printf("  latency avg %6lld us max %6lld us  starved %llu",
+                count ? (long long)(latency_sum / (int64_t)count) : 0LL, (long long)latency_max.load(),
+                (unsigned long long)mmal_emu_port_starved_count(port));
+#endif
+            printf("\n");
+        }
+
+        MMAL_PORT_T *port;
+        std::atomic<uint64_t> frames;
+        std::atomic<uint64_t> bytes;
+        std::atomic<int64_t> latency_sum;
+        std::atomic<int64_t> latency_max;
+};
+
+void report_metrics(const char *name, shared_ptr< RaspiPort > port) {
+    RASPIPORT_METRICS_S metrics = port->get_metrics();
+    printf("%-8s %8.2f fps  jitter %7.1f us  callback p50 %5llu us p99 %5llu us max %5llu us  starved %llu\n", name,
+        metrics.fps, metrics.jitter_us,
+        (unsigned long long)RaspiPortMetrics::percentile(metrics.callback_duration, 50),
+        (unsigned long long)RaspiPortMetrics::percentile(metrics.callback_duration, 99),
+        (unsigned long long)metrics.callback_duration.max_us, (unsigned long long)metrics.starved);
+}
+
+int main(int argc, char** argv) {
+    int seconds = argc > 1 ? atoi(argv[1]) : 5;
+    int framerate = argc > 2 ? atoi(argv[2]) : 30;
+    bool unthrottled = argc > 3 && !strcmp(argv[3], "unthrottled");
+    if (seconds <= 0) {
+        seconds = 5;
+    }
+
+#ifdef LIBRASPIVID_MMAL_EMU
+    mmal_emu_set_unthrottled(unthrottled ? MMAL_TRUE : MMAL_FALSE);
+#else
+    if (unthrottled) {
+        fprintf(stderr, "unthrottled is only available with the MMAL stand-in\n");
+    }
+#endif
+
+    RASPICAMERA_OPTION_S camera_options = RaspiCamera::createDefaultCameraOptions();
+    camera_options.framerate = framerate;
+    auto camera = RaspiCamera::create(camera_options);
+    auto splitter = RaspiSplitter::create();
+    auto encoder = RaspiEncoder::create();
+    auto resizer = RaspiResize::create(RESIZE_WIDTH, RESIZE_HEIGHT);
+    if (!camera || !splitter || !encoder || !resizer) {
+        vcos_log_error("Unable to create components");
+        return -1;
+    }
+
+    auto encoded = shared_ptr< StatsCallback >( new StatsCallback() );
+    auto resized = shared_ptr< StatsCallback >( new StatsCallback() );
+
+    RASPIPORT_FORMAT_S format = camera->video->get_format();
+    format.encoding = MMAL_ENCODING_I420;
+    if (camera->video->set_format(format) != MMAL_SUCCESS ||
+            splitter->connect(camera) != MMAL_SUCCESS ||
+            encoder->connect(splitter) != MMAL_SUCCESS ||
+            resizer->connect(splitter->output_1) != MMAL_SUCCESS ||
+            encoder->output->add_callback(encoded) != MMAL_SUCCESS ||
+            resizer->output->add_callback(resized) != MMAL_SUCCESS) {
+        vcos_log_error("Unable to build the pipeline");
+        return -1;
+    }
+
+    if (camera->start() != MMAL_SUCCESS) {
+        vcos_log_error("Camera failed to start");
+        return -1;
+    }
+
+    sleep(seconds);
+
+    printf("%d s at %d fps%s\n", seconds, framerate, unthrottled ? " (unthrottled)" : "");
+    encoded->report("encoder", seconds);
+    resized->report("resizer", seconds);
+    printf("port metrics\n");
+    report_metrics("encoder", encoder->output);
+    report_metrics("resizer", resizer->output);
+    return 0;
+}
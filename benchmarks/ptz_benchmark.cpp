@@ -0,0 +1,89 @@
+/**
+ \file ptz_benchmark.cpp
+ \brief Compares sending a crop for every PTZ command with letting RaspiPTZ send at most one per frame.
+
+ Usage: libraspivid_ptz_benchmark [seconds]
+
+ Starts a camera at 30 fps and sends a PTZ command every millisecond, the way a joystick or a tracker does, alternating
+ between two regions. Once each command goes straight to the camera with raspicamcontrol_set_ROI, and once it goes to
+ RaspiCamera::ptz, added as a callback to the video port, which moves there over 200 ms. Reports the commands, the crops
+ sent to the camera and the mean and 99th percentile time a command held up its caller. Defaults to 2 seconds per mode.
+ */
+
+#include "raspivid/RaspiVid.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <atomic>
+#include <thread>
+
+using namespace std;
+using namespace raspivid;
+
+#define     MOVE_MS     200
+
+// Remembers the camera's control port, to send crops to the camera directly
+class ControlPort : public RaspiCameraCallback {
+    public:
+        ControlPort() : port(nullptr) { }
+
+        void callback(MMAL_PORT_T *port_, MMAL_BUFFER_HEADER_T *buffer) {
+            port.store(port_);
+        }
+
+        atomic< MMAL_PORT_T * > port;
+};
+
+int main(int argc, char** argv) {
+    int seconds = argc > 1 ? atoi(argv[1]) : 2;
+    if (seconds <= 0) {
+        fprintf(stderr, "Usage: %s [seconds]\n", argv[0]);
+        return -1;
+    }
+
+    shared_ptr< ControlPort > control_port = make_shared< ControlPort >();
+    RASPICAMERA_OPTION_S options = RaspiCamera::createDefaultCameraOptions();
+    options.framerate = 30;
+    options.settings_callback = control_port;
+    shared_ptr< RaspiCamera > camera = RaspiCamera::create(options);
+    if (!camera || camera->video->add_callback(camera->ptz) != MMAL_SUCCESS || camera->start() != MMAL_SUCCESS) {
+        fprintf(stderr, "unable to start the camera\n");
+        return -1;
+    }
+    while (!control_port->port.load()) {
+        this_thread::sleep_for(chrono::milliseconds(1));
+    }
+    MMAL_COMPONENT_T *component = control_port->port.load()->component;
+
+    const PARAM_FLOAT_RECT_T targets[] = { { 0.0, 0.0, 0.5, 0.5 }, { 0.4, 0.4, 0.6, 0.6 } };
+    const char *names[] = { "direct", "ptz" };
+    printf("%-8s%10s%10s%10s%14s%14s   (us, %d s per mode)\n", "", "commands", "frames", "crops", "command mean", "command p99", seconds);
+    for (int mode = 0; mode < 2; mode++) {
+        RASPIPTZ_STATS_S before = camera->ptz->get_stats();
+        RaspiPortMetrics::Histogram duration;
+        uint64_t commands = 0, crops = 0;
+        int64_t end = RaspiPortMetrics::now_us() + seconds * 1000000LL;
+        while (RaspiPortMetrics::now_us() < end) {
+            const PARAM_FLOAT_RECT_T &target = targets[(commands / 100) % 2];
+            int64_t start = RaspiPortMetrics::now_us();
+            if (mode == 0) {
+                raspicamcontrol_set_ROI(component, target);
+                crops++;
+            } else {
+                camera->ptz->move_to(target, MOVE_MS, RASPIPTZ_EASE_IN_OUT);
+            }
+            duration.record(RaspiPortMetrics::now_us() - start);
+            commands++;
+            this_thread::sleep_for(chrono::milliseconds(1));
+        }
+        RASPIPTZ_STATS_S after = camera->ptz->get_stats();
+        if (mode == 1) {
+            crops = after.updates - before.updates;
+        }
+        RASPIPORT_HISTOGRAM_S histogram;
+        duration.read(histogram);
+        printf("%-8s%10llu%10llu%10llu%14.2f%14llu\n", names[mode], (unsigned long long)commands,
+            (unsigned long long)(after.frames - before.frames), (unsigned long long)crops,
+            (double)histogram.sum_us / histogram.count, (unsigned long long)RaspiPortMetrics::percentile(histogram, 99));
+    }
+    return 0;
+}
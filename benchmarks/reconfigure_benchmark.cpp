@@ -0,0 +1,130 @@
+/**
+ \file reconfigure_benchmark.cpp
+ \brief Measures how long switching between a day and a night camera profile interrupts the frames reaching the application.
+
+ Usage: libraspivid_reconfigure_benchmark [switches]
+
+ Runs the camera, splitter, encoder and resizer pipeline of the example with RaspiPipelineGraph and alternates the camera
+ between 1920x1080 at 30 fps and 1280x720 at 15 fps, once with RaspiPipelineGraph::reconfigure and once by destroying and
+ building the whole graph again. For each mode, reports the mean time the switch call took and the mean and worst gap
+ between two resized frames around the switch. Defaults to 10 switches per mode.
+ */
+
+#include "raspivid/RaspiVid.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <atomic>
+#include <thread>
+
+using namespace std;
+using namespace raspivid;
+
+#define     SETTLE_MS       300
+
+typedef struct {
+    uint32_t width;
+    uint32_t height;
+    uint32_t framerate;
+} PROFILE_S;
+
+static const PROFILE_S PROFILES[] = { { 1920, 1080, 30 }, { 1280, 720, 15 } };
+
+class GapSink : public RaspiCallback {
+    public:
+        GapSink() : last_us(0), max_gap_us(0) { }
+
+        void callback(MMAL_PORT_T *port, MMAL_BUFFER_HEADER_T *buffer) {
+            // Buffers flushed while the port is stopped carry no frame
+            if (!buffer->length) {
+                return;
+            }
+            int64_t now = RaspiPortMetrics::now_us();
+            int64_t last = last_us.exchange(now);
+            if (last && now - last > max_gap_us.load()) {
+                max_gap_us.store(now - last);
+            }
+        }
+
+        void reset() {
+            max_gap_us.store(0);
+        }
+
+        atomic< int64_t > last_us;
+        atomic< int64_t > max_gap_us;
+};
+
+static shared_ptr< RaspiPipelineGraph > create_graph(const PROFILE_S &profile, shared_ptr< GapSink > sink) {
+    RASPICAMERA_OPTION_S options = RaspiCamera::createDefaultCameraOptions();
+    options.width = profile.width;
+    options.height = profile.height;
+    options.framerate = profile.framerate;
+
+    auto graph = RaspiPipelineGraph::create();
+    graph->add_camera("camera", options);
+    graph->add_renderer("preview");
+    graph->add_nullsink("nullsink");
+    graph->add_splitter("splitter");
+    graph->add_encoder("encoder");
+    graph->add_resize("resizer", 640, 480);
+    graph->add_application("frames", MMAL_ENCODING_I420);
+    graph->connect("camera", MMAL_CAMERA_PREVIEW_PORT, "preview");
+    graph->connect("camera", MMAL_CAMERA_CAPTURE_PORT, "nullsink");
+    graph->connect("camera", MMAL_CAMERA_VIDEO_PORT, "splitter");
+    graph->connect("splitter", 0, "encoder");
+    graph->connect("splitter", 1, "resizer");
+    graph->connect("resizer", 0, "frames");
+    if (graph->build() != MMAL_SUCCESS || graph->get_endpoint("frames")->add_callback(sink) != MMAL_SUCCESS || graph->start() != MMAL_SUCCESS) {
+        return nullptr;
+    }
+    return graph;
+}
+
+int main(int argc, char** argv) {
+    int switches = argc > 1 ? atoi(argv[1]) : 10;
+    if (switches <= 0) {
+        fprintf(stderr, "Usage: %s [switches]\n", argv[0]);
+        return -1;
+    }
+
+    const char *names[] = { "reconfigure", "rebuild" };
+    printf("%-14s%12s%12s%12s   (ms, %d switches)\n", "", "call", "mean gap", "worst gap", switches);
+    for (int mode = 0; mode < 2; mode++) {
+        shared_ptr< GapSink > sink = make_shared< GapSink >();
+        shared_ptr< RaspiPipelineGraph > graph = create_graph(PROFILES[0], sink);
+        if (!graph) {
+            fprintf(stderr, "unable to build the pipeline\n");
+            return -1;
+        }
+        double call = 0, gap = 0, worst = 0;
+        for (int i = 1; i <= switches; i++) {
+            this_thread::sleep_for(chrono::milliseconds(SETTLE_MS));
+            const PROFILE_S &profile = PROFILES[i % 2];
+            sink->reset();
+            int64_t start = RaspiPortMetrics::now_us();
+            if (mode == 0) {
+                if (graph->reconfigure("camera", profile.width, profile.height, profile.framerate) != MMAL_SUCCESS) {
+                    fprintf(stderr, "switch %d failed\n", i);
+                    return -1;
+                }
+            } else {
+                graph.reset();
+                if (!(graph = create_graph(profile, sink))) {
+                    fprintf(stderr, "rebuild %d failed\n", i);
+                    return -1;
+                }
+            }
+            call += (RaspiPortMetrics::now_us() - start) / 1000.0;
+            this_thread::sleep_for(chrono::milliseconds(SETTLE_MS));
+            double max_gap = sink->max_gap_us.load() / 1000.0;
+            gap += max_gap;
+            worst = vcos_max(worst, max_gap);
+        }
+        printf("%-14s%12.2f%12.2f%12.2f\n", names[mode], call / switches, gap / switches, worst);
+        if (mode == 0) {
+            RASPIPIPELINE_RECONFIGURE_S last = graph->get_reconfigure();
+            printf("%-14slast switch stopped %u of its connections and endpoints for %.2f ms, %u ports changed format\n", "",
+                last.stopped, (last.end_us - last.stopped_us) / 1000.0, last.ports);
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,112 @@
+/**
+ \file startup_benchmark.cpp
+ \brief Measures the time from building a pipeline to its first frame, with serial and concurrent component creation.
+
+ Usage: libraspivid_startup_benchmark [runs]
+
+ Builds the camera, splitter, encoder and resizer pipeline of the example with RaspiPipelineGraph, once creating components
+ one after another and once concurrently on a thread pool, starts it and waits for the first resized frame. Reports the mean
+ build time, time from start to first frame and total time for each mode, then the phases of each node of the last
+ concurrent run relative to the start of the build. Defaults to 10 runs per mode.
+ */
+
+#include "raspivid/RaspiVid.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <thread>
+
+using namespace std;
+using namespace raspivid;
+
+#define     FIRST_FRAME_TIMEOUT_MS      5000
+
+class FrameSink : public RaspiCallback {
+    public:
+        void callback(MMAL_PORT_T *port, MMAL_BUFFER_HEADER_T *buffer) { }
+};
+
+static shared_ptr< RaspiPipelineGraph > create_graph() {
+    auto graph = RaspiPipelineGraph::create();
+    graph->add_camera("camera");
+    graph->add_renderer("preview");
+    graph->add_nullsink("nullsink");
+    graph->add_splitter("splitter");
+    graph->add_encoder("encoder");
+    graph->add_resize("resizer", 640, 480);
+    graph->add_application("frames", MMAL_ENCODING_I420);
+    graph->connect("camera", MMAL_CAMERA_PREVIEW_PORT, "preview");
+    graph->connect("camera", MMAL_CAMERA_CAPTURE_PORT, "nullsink");
+    graph->connect("camera", MMAL_CAMERA_VIDEO_PORT, "splitter");
+    graph->connect("splitter", 0, "encoder");
+    graph->connect("splitter", 1, "resizer");
+    graph->connect("resizer", 0, "frames");
+    return graph;
+}
+
+static double ms(int64_t from_us, int64_t to_us) {
+    return from_us && to_us ? (to_us - from_us) / 1000.0 : 0;
+}
+
+static bool run(shared_ptr< RaspiExecutor > executor, RASPIPIPELINE_STARTUP_S &startup) {
+    auto graph = create_graph();
+    if (graph->build(executor) != MMAL_SUCCESS) {
+        return false;
+    }
+    if (graph->get_endpoint("frames")->add_callback(make_shared< FrameSink >()) != MMAL_SUCCESS || graph->start() != MMAL_SUCCESS) {
+        return false;
+    }
+    for (int waited = 0; waited < FIRST_FRAME_TIMEOUT_MS; waited++) {
+        startup = graph->get_startup();
+        if (startup.first_frame_us) {
+            return true;
+        }
+        this_thread::sleep_for(chrono::milliseconds(1));
+    }
+    return false;
+}
+
+int main(int argc, char** argv) {
+    int runs = argc > 1 ? atoi(argv[1]) : 10;
+    if (runs <= 0) {
+        fprintf(stderr, "Usage: %s [runs]\n", argv[0]);
+        return -1;
+    }
+
+    const char *names[] = { "serial", "concurrent" };
+    shared_ptr< RaspiExecutor > executors[] = { nullptr, RaspiThreadPoolExecutor::create(4) };
+    RASPIPIPELINE_STARTUP_S startup;
+
+    printf("%-12s%12s%18s%12s   (ms, mean of %d runs)\n", "", "build", "start to frame", "total", runs);
+    for (int mode = 0; mode < 2; mode++) {
+        double build = 0, first_frame = 0, total = 0;
+        for (int i = 0; i < runs; i++) {
+            if (!run(executors[mode], startup)) {
+                fprintf(stderr, "%s build %d did not deliver a frame\n", names[mode], i);
+                return -1;
+            }
+            build += ms(startup.build_us, startup.built_us);
+            first_frame += ms(startup.start_us, startup.first_frame_us);
+            total += ms(startup.build_us, startup.first_frame_us);
+        }
+        printf("%-12s%12.2f%18.2f%12.2f\n", names[mode], build / runs, first_frame / runs, total / runs);
+    }
+
+    printf("\nLast concurrent run, ms from the start of the build (begin-end), %u format commits\n", startup.commits);
+    printf("%-12s%18s%18s%18s%18s\n", "", "create", "enable", "connect", "commit");
+    for (const RASPIPIPELINE_TIMING_S &node : startup.nodes) {
+        printf("%-12s", node.name.c_str());
+        const RASPIPIPELINE_SPAN_S *spans[] = { &node.create, &node.enable, &node.connect, &node.commit };
+        for (const RASPIPIPELINE_SPAN_S *span : spans) {
+            if (span->start_us) {
+                printf("%8.2f-%-9.2f", ms(startup.build_us, span->start_us), ms(startup.build_us, span->end_us));
+            } else {
+                printf("%18s", "-");
+            }
+        }
+        if (node.first_frame_us) {
+            printf("  first frame %.2f", ms(startup.build_us, node.first_frame_us));
+        }
+        printf("\n");
+    }
+    return 0;
+}
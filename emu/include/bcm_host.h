@@ -0,0 +1,23 @@
+/**
+ \file bcm_host.h
+ \brief Host-side stand-in for the Broadcom host initialisation API.
+ */
+
+#ifndef __BCM_HOST_H__
+#define __BCM_HOST_H__
+
+#include <stdint.h>
+#include "interface/vcos/vcos.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+void bcm_host_init(void);
+void bcm_host_deinit(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __BCM_HOST_H__ */
@@ -0,0 +1,25 @@
+/**
+ \file interface/mmal/mmal.h
+ \brief Multi-Media Abstraction Layer, host-side stand-in.
+
+ A subset of the Raspberry Pi userland MMAL API that runs on ordinary Linux hosts. Components are emulated
+ by synthetic implementations so that libraspivid pipelines can be built, exercised and benchmarked without
+ a VideoCore GPU. See interface/mmal/mmal_emu.h for the extensions that only exist in the stand-in.
+ */
+
+#ifndef __MMAL_H__
+#define __MMAL_H__
+
+#include "interface/mmal/mmal_common.h"
+#include "interface/mmal/mmal_types.h"
+#include "interface/mmal/mmal_encodings.h"
+#include "interface/mmal/mmal_format.h"
+#include "interface/mmal/mmal_buffer.h"
+#include "interface/mmal/mmal_queue.h"
+#include "interface/mmal/mmal_pool.h"
+#include "interface/mmal/mmal_parameters.h"
+#include "interface/mmal/mmal_events.h"
+#include "interface/mmal/mmal_port.h"
+#include "interface/mmal/mmal_component.h"
+
+#endif /* __MMAL_H__ */
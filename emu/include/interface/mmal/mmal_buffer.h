@@ -0,0 +1,77 @@
+/**
+ \file interface/mmal/mmal_buffer.h
+ \brief Reference counted buffer headers (host-side stand-in).
+ */
+
+#ifndef __MMAL_BUFFER_H__
+#define __MMAL_BUFFER_H__
+
+#include "interface/mmal/mmal_types.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct MMAL_BUFFER_HEADER_PRIVATE_T MMAL_BUFFER_HEADER_PRIVATE_T;
+
+typedef struct MMAL_BUFFER_HEADER_T {
+    struct MMAL_BUFFER_HEADER_T *next;      /**< Used to link several buffer headers together */
+    MMAL_BUFFER_HEADER_PRIVATE_T *priv;     /**< Data private to the framework */
+    uint32_t cmd;                           /**< Defines what the buffer header contains. 0 for data, otherwise an event FourCC */
+    uint8_t *data;                          /**< Pointer to the start of the payload buffer */
+    uint32_t alloc_size;                    /**< Allocated size in bytes of payload buffer */
+    uint32_t length;                        /**< Number of bytes currently used in the payload buffer */
+    uint32_t offset;                        /**< Offset in bytes to the start of valid data */
+    uint32_t flags;                         /**< MMAL_BUFFER_HEADER_FLAG_* */
+    int64_t pts;                            /**< Presentation timestamp in microseconds */
+    int64_t dts;                            /**< Decode timestamp in microseconds */
+    void *user_data;                        /**< Field reserved for use by the client */
+} MMAL_BUFFER_HEADER_T;
+
+#define MMAL_BUFFER_HEADER_FLAG_EOS                    (1<<0)
+#define MMAL_BUFFER_HEADER_FLAG_FRAME_START            (1<<1)
+#define MMAL_BUFFER_HEADER_FLAG_FRAME_END              (1<<2)
+#define MMAL_BUFFER_HEADER_FLAG_FRAME                  (MMAL_BUFFER_HEADER_FLAG_FRAME_START|MMAL_BUFFER_HEADER_FLAG_FRAME_END)
+#define MMAL_BUFFER_HEADER_FLAG_KEYFRAME               (1<<3)
+#define MMAL_BUFFER_HEADER_FLAG_DISCONTINUITY          (1<<4)
+#define MMAL_BUFFER_HEADER_FLAG_CONFIG                 (1<<5)
+#define MMAL_BUFFER_HEADER_FLAG_ENCRYPTED              (1<<6)
+#define MMAL_BUFFER_HEADER_FLAG_CODECSIDEINFO          (1<<7)
+#define MMAL_BUFFER_HEADER_FLAGS_SNAPSHOT              (1<<8)
+#define MMAL_BUFFER_HEADER_FLAG_CORRUPTED              (1<<9)
+#define MMAL_BUFFER_HEADER_FLAG_TRANSMISSION_FAILED    (1<<10)
+#define MMAL_BUFFER_HEADER_FLAG_DECODEONLY             (1<<11)
+#define MMAL_BUFFER_HEADER_FLAG_NAL_END                (1<<12)
+
+/** Acquire a reference on a buffer header. */
+void mmal_buffer_header_acquire(MMAL_BUFFER_HEADER_T *header);
+
+/** Reset the payload related fields of a buffer header. */
+void mmal_buffer_header_reset(MMAL_BUFFER_HEADER_T *header);
+
+/** Release a reference on a buffer header. The header goes back to its owner once the last reference is released. */
+void mmal_buffer_header_release(MMAL_BUFFER_HEADER_T *header);
+
+/** Finish a release that was deferred by a pre-release callback. */
+void mmal_buffer_header_release_continue(MMAL_BUFFER_HEADER_T *header);
+
+/**
+ \brief Called when the last reference on a buffer is released.
+ \return MMAL_TRUE if the release is deferred, in which case mmal_buffer_header_release_continue must be called later.
+ */
+typedef MMAL_BOOL_T (*MMAL_BH_PRE_RELEASE_CB_T)(MMAL_BUFFER_HEADER_T *header, void *userdata);
+
+void mmal_buffer_header_pre_release_cb_set(MMAL_BUFFER_HEADER_T *header, MMAL_BH_PRE_RELEASE_CB_T cb, void *userdata);
+
+/** Make dest share the payload of src. src stays referenced until dest is released. */
+MMAL_STATUS_T mmal_buffer_header_replicate(MMAL_BUFFER_HEADER_T *dest, MMAL_BUFFER_HEADER_T *src);
+
+/** Payloads are always mapped on the host, so locking never fails. */
+MMAL_STATUS_T mmal_buffer_header_mem_lock(MMAL_BUFFER_HEADER_T *header);
+void mmal_buffer_header_mem_unlock(MMAL_BUFFER_HEADER_T *header);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __MMAL_BUFFER_H__ */
@@ -0,0 +1,24 @@
+/**
+ \file interface/mmal/mmal_common.h
+ \brief Common MMAL definitions (host-side stand-in).
+ */
+
+#ifndef __MMAL_COMMON_H__
+#define __MMAL_COMMON_H__
+
+#include <stdint.h>
+#include <string.h>
+
+#define MMAL_FOURCC(a,b,c,d) ((uint32_t)(a) | ((uint32_t)(b) << 8) | ((uint32_t)(c) << 16) | ((uint32_t)(d) << 24))
+#define MMAL_MAGIC MMAL_FOURCC('m','m','a','l')
+
+/** Special value signalling that time is not known */
+#define MMAL_TIME_UNKNOWN ((int64_t)((uint64_t)1 << 63))
+
+typedef uint32_t MMAL_FOURCC_T;
+typedef int32_t MMAL_BOOL_T;
+
+#define MMAL_FALSE 0
+#define MMAL_TRUE  1
+
+#endif /* __MMAL_COMMON_H__ */
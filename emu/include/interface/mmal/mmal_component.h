@@ -0,0 +1,51 @@
+/**
+ \file interface/mmal/mmal_component.h
+ \brief Components (host-side stand-in).
+ */
+
+#ifndef __MMAL_COMPONENT_H__
+#define __MMAL_COMPONENT_H__
+
+#include "interface/mmal/mmal_port.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct MMAL_COMPONENT_PRIVATE_T MMAL_COMPONENT_PRIVATE_T;
+typedef struct MMAL_COMPONENT_USERDATA_T MMAL_COMPONENT_USERDATA_T;
+
+typedef struct MMAL_COMPONENT_T {
+    MMAL_COMPONENT_PRIVATE_T *priv;             /**< Pointer to the private data of the module in use */
+    struct MMAL_COMPONENT_USERDATA_T *userdata; /**< Pointer to private data of the client */
+    const char *name;                           /**< Component name */
+    uint32_t is_enabled;                        /**< Specifies whether the component is enabled or not */
+    MMAL_PORT_T *control;                       /**< Control port */
+    uint32_t input_num;                         /**< Number of input ports */
+    MMAL_PORT_T **input;                        /**< Array of input ports */
+    uint32_t output_num;                        /**< Number of output ports */
+    MMAL_PORT_T **output;                       /**< Array of output ports */
+    uint32_t clock_num;                         /**< Number of clock ports */
+    MMAL_PORT_T **clock;                        /**< Array of clock ports */
+    uint32_t port_num;                          /**< Total number of ports */
+    MMAL_PORT_T **port;                         /**< Array of all the ports (control/input/output/clock) */
+    uint32_t id;                                /**< Unique identifier for the component */
+} MMAL_COMPONENT_T;
+
+/**
+ \brief Create an instance of a component. The stand-in provides vc.ril.camera, vc.ril.video_encode,
+ vc.ril.video_splitter, vc.ril.resize, vc.ril.isp, vc.ril.video_render and vc.null_sink.
+ */
+MMAL_STATUS_T mmal_component_create(const char *name, MMAL_COMPONENT_T **component);
+void mmal_component_acquire(MMAL_COMPONENT_T *component);
+MMAL_STATUS_T mmal_component_release(MMAL_COMPONENT_T *component);
+MMAL_STATUS_T mmal_component_destroy(MMAL_COMPONENT_T *component);
+/** Enable a component. Only the camera depends on it: other stand-in components process data as soon as their ports are enabled. */
+MMAL_STATUS_T mmal_component_enable(MMAL_COMPONENT_T *component);
+MMAL_STATUS_T mmal_component_disable(MMAL_COMPONENT_T *component);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __MMAL_COMPONENT_H__ */
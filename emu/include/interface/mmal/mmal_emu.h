@@ -0,0 +1,32 @@
+/**
+ \file interface/mmal/mmal_emu.h
+ \brief Extensions that only exist in the host-side MMAL stand-in (raspivid_mmal_emu).
+
+ The synthetic camera renders a static gradient with a bright square bouncing across it, paced at the
+ committed video frame rate (30 fps when the frame rate is 0). Frame pts values are taken from
+ mmal_emu_time_us(), so callbacks can compute capture-to-callback latency directly.
+ */
+
+#ifndef __MMAL_EMU_H__
+#define __MMAL_EMU_H__
+
+#include "interface/mmal/mmal.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/** Monotonic clock used for every timestamp generated by the stand-in, in microseconds. */
+int64_t mmal_emu_time_us(void);
+
+/** When set, cameras produce frames back to back instead of at the committed frame rate. */
+void mmal_emu_set_unthrottled(MMAL_BOOL_T unthrottled);
+
+/** \return the number of payloads a port had to drop because the client had not sent it a buffer */
+uint64_t mmal_emu_port_starved_count(MMAL_PORT_T *port);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __MMAL_EMU_H__ */
@@ -0,0 +1,55 @@
+/**
+ \file interface/mmal/mmal_encodings.h
+ \brief MMAL encoding FourCCs (host-side stand-in).
+ */
+
+#ifndef __MMAL_ENCODINGS_H__
+#define __MMAL_ENCODINGS_H__
+
+#include "interface/mmal/mmal_common.h"
+
+#define MMAL_ENCODING_UNKNOWN           0
+
+#define MMAL_ENCODING_H264              MMAL_FOURCC('H','2','6','4')
+#define MMAL_ENCODING_MVC               MMAL_FOURCC('M','V','C',' ')
+#define MMAL_ENCODING_H263              MMAL_FOURCC('H','2','6','3')
+#define MMAL_ENCODING_MP4V              MMAL_FOURCC('M','P','4','V')
+#define MMAL_ENCODING_MP2V              MMAL_FOURCC('M','P','2','V')
+#define MMAL_ENCODING_MP1V              MMAL_FOURCC('M','P','1','V')
+#define MMAL_ENCODING_MJPEG             MMAL_FOURCC('M','J','P','G')
+#define MMAL_ENCODING_JPEG              MMAL_FOURCC('J','P','E','G')
+#define MMAL_ENCODING_GIF               MMAL_FOURCC('G','I','F',' ')
+#define MMAL_ENCODING_PNG               MMAL_FOURCC('P','N','G',' ')
+#define MMAL_ENCODING_BMP               MMAL_FOURCC('B','M','P',' ')
+
+#define MMAL_ENCODING_I420              MMAL_FOURCC('I','4','2','0')
+#define MMAL_ENCODING_I420_SLICE        MMAL_FOURCC('S','4','2','0')
+#define MMAL_ENCODING_YV12              MMAL_FOURCC('Y','V','1','2')
+#define MMAL_ENCODING_I422              MMAL_FOURCC('I','4','2','2')
+#define MMAL_ENCODING_NV12              MMAL_FOURCC('N','V','1','2')
+#define MMAL_ENCODING_NV21              MMAL_FOURCC('N','V','2','1')
+#define MMAL_ENCODING_YUYV              MMAL_FOURCC('Y','U','Y','V')
+#define MMAL_ENCODING_ARGB              MMAL_FOURCC('A','R','G','B')
+#define MMAL_ENCODING_RGBA              MMAL_FOURCC('R','G','B','A')
+#define MMAL_ENCODING_ABGR              MMAL_FOURCC('A','B','G','R')
+#define MMAL_ENCODING_BGRA              MMAL_FOURCC('B','G','R','A')
+#define MMAL_ENCODING_RGB16             MMAL_FOURCC('R','G','B','2')
+#define MMAL_ENCODING_RGB24             MMAL_FOURCC('R','G','B','3')
+#define MMAL_ENCODING_RGB32             MMAL_FOURCC('R','G','B','4')
+#define MMAL_ENCODING_BGR16             MMAL_FOURCC('B','G','R','2')
+#define MMAL_ENCODING_BGR24             MMAL_FOURCC('B','G','R','3')
+#define MMAL_ENCODING_BGR32             MMAL_FOURCC('B','G','R','4')
+
+/** Opaque GPU side handles. The stand-in carries I420 data through opaque tunnels. */
+#define MMAL_ENCODING_OPAQUE            MMAL_FOURCC('O','P','Q','V')
+
+#define MMAL_ENCODING_VARIANT_DEFAULT   0
+#define MMAL_ENCODING_VARIANT_H264_DEFAULT 0
+#define MMAL_ENCODING_VARIANT_H264_AVC1 MMAL_FOURCC('A','V','C','1')
+#define MMAL_ENCODING_VARIANT_H264_RAW  MMAL_FOURCC('R','A','W',' ')
+
+#define MMAL_COLOR_SPACE_UNKNOWN        0
+#define MMAL_COLOR_SPACE_ITUR_BT601     MMAL_FOURCC('Y','6','0','1')
+#define MMAL_COLOR_SPACE_ITUR_BT709     MMAL_FOURCC('Y','7','0','9')
+
+#endif /* __MMAL_ENCODINGS_H__ */
@@ -0,0 +1,22 @@
+/**
+ \file interface/mmal/mmal_events.h
+ \brief Events delivered on control ports (host-side stand-in).
+ */
+
+#ifndef __MMAL_EVENTS_H__
+#define __MMAL_EVENTS_H__
+
+#include "interface/mmal/mmal_common.h"
+#include "interface/mmal/mmal_parameters_common.h"
+
+#define MMAL_EVENT_ERROR                MMAL_FOURCC('E','R','R','O')
+#define MMAL_EVENT_EOS                  MMAL_FOURCC('E','E','O','S')
+#define MMAL_EVENT_FORMAT_CHANGED       MMAL_FOURCC('E','F','C','H')
+#define MMAL_EVENT_PARAMETER_CHANGED    MMAL_FOURCC('E','P','C','H')
+
+/** Parameter changed event. The parameter that changed follows this header. */
+typedef struct MMAL_EVENT_PARAMETER_CHANGED_T {
+    MMAL_PARAMETER_HEADER_T hdr;
+} MMAL_EVENT_PARAMETER_CHANGED_T;
+
+#endif /* __MMAL_EVENTS_H__ */
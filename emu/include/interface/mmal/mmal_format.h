@@ -0,0 +1,76 @@
+/**
+ \file interface/mmal/mmal_format.h
+ \brief Elementary stream formats (host-side stand-in). Only video formats are modelled.
+ */
+
+#ifndef __MMAL_FORMAT_H__
+#define __MMAL_FORMAT_H__
+
+#include "interface/mmal/mmal_types.h"
+#include "interface/mmal/mmal_encodings.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef enum {
+    MMAL_ES_TYPE_UNKNOWN,
+    MMAL_ES_TYPE_CONTROL,
+    MMAL_ES_TYPE_AUDIO,
+    MMAL_ES_TYPE_VIDEO,
+    MMAL_ES_TYPE_SUBPICTURE
+} MMAL_ES_TYPE_T;
+
+typedef struct {
+    uint32_t width;                 /**< Width of frame in pixels */
+    uint32_t height;                /**< Height of frame in rows of pixels */
+    MMAL_RECT_T crop;               /**< Visible region of the frame */
+    MMAL_RATIONAL_T frame_rate;     /**< Frame rate */
+    MMAL_RATIONAL_T par;            /**< Pixel aspect ratio */
+    MMAL_FOURCC_T color_space;      /**< FourCC specifying the color space */
+} MMAL_VIDEO_FORMAT_T;
+
+typedef union {
+    MMAL_VIDEO_FORMAT_T video;
+} MMAL_ES_SPECIFIC_FORMAT_T;
+
+#define MMAL_ES_FORMAT_FLAG_FRAMED 0x1
+
+typedef struct MMAL_ES_FORMAT_T {
+    MMAL_ES_TYPE_T type;
+    MMAL_FOURCC_T encoding;
+    MMAL_FOURCC_T encoding_variant;
+    MMAL_ES_SPECIFIC_FORMAT_T *es;
+    uint32_t bitrate;
+    uint32_t flags;
+    uint32_t extradata_size;
+    uint8_t *extradata;
+} MMAL_ES_FORMAT_T;
+
+#define MMAL_ES_FORMAT_COMPARE_FLAG_TYPE             0x01
+#define MMAL_ES_FORMAT_COMPARE_FLAG_ENCODING         0x02
+#define MMAL_ES_FORMAT_COMPARE_FLAG_BITRATE          0x04
+#define MMAL_ES_FORMAT_COMPARE_FLAG_FLAGS            0x08
+#define MMAL_ES_FORMAT_COMPARE_FLAG_EXTRADATA        0x10
+#define MMAL_ES_FORMAT_COMPARE_FLAG_VIDEO_RESOLUTION 0x0100
+#define MMAL_ES_FORMAT_COMPARE_FLAG_VIDEO_CROPPING   0x0200
+#define MMAL_ES_FORMAT_COMPARE_FLAG_VIDEO_FRAME_RATE 0x0400
+#define MMAL_ES_FORMAT_COMPARE_FLAG_VIDEO_ASPECT_RATIO 0x0800
+#define MMAL_ES_FORMAT_COMPARE_FLAG_VIDEO_COLOR_SPACE 0x1000
+#define MMAL_ES_FORMAT_COMPARE_FLAG_ES_OTHER         0x10000000
+
+MMAL_ES_FORMAT_T *mmal_format_alloc(void);
+void mmal_format_free(MMAL_ES_FORMAT_T *format);
+
+/** Shallow copy of src into dst. The extradata of dst is left untouched. */
+void mmal_format_copy(MMAL_ES_FORMAT_T *dst, MMAL_ES_FORMAT_T *src);
+MMAL_STATUS_T mmal_format_full_copy(MMAL_ES_FORMAT_T *dst, MMAL_ES_FORMAT_T *src);
+
+/** \return 0 if both formats are identical, otherwise a MMAL_ES_FORMAT_COMPARE_FLAG_* bitmask of differences */
+uint32_t mmal_format_compare(MMAL_ES_FORMAT_T *format_1, MMAL_ES_FORMAT_T *format_2);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __MMAL_FORMAT_H__ */
@@ -0,0 +1,17 @@
+/**
+ \file interface/mmal/mmal_logging.h
+ \brief MMAL logging macros (host-side stand-in).
+ */
+
+#ifndef __MMAL_LOGGING_H__
+#define __MMAL_LOGGING_H__
+
+#include "interface/vcos/vcos.h"
+
+#define LOG_ERROR(...) vcos_log_error(__VA_ARGS__)
+#define LOG_WARN(...)  vcos_log_warn(__VA_ARGS__)
+#define LOG_INFO(...)  vcos_log_info(__VA_ARGS__)
+#define LOG_DEBUG(...) vcos_log_info(__VA_ARGS__)
+#define LOG_TRACE(...) vcos_log_trace(__VA_ARGS__)
+
+#endif /* __MMAL_LOGGING_H__ */
@@ -0,0 +1,13 @@
+/**
+ \file interface/mmal/mmal_parameters.h
+ \brief All port parameters (host-side stand-in).
+ */
+
+#ifndef __MMAL_PARAMETERS_H__
+#define __MMAL_PARAMETERS_H__
+
+#include "interface/mmal/mmal_parameters_common.h"
+#include "interface/mmal/mmal_parameters_camera.h"
+#include "interface/mmal/mmal_parameters_video.h"
+
+#endif /* __MMAL_PARAMETERS_H__ */
@@ -0,0 +1,83 @@
+/**
+ \file interface/mmal/mmal_parameters_common.h
+ \brief Common port parameters (host-side stand-in).
+ */
+
+#ifndef __MMAL_PARAMETERS_COMMON_H__
+#define __MMAL_PARAMETERS_COMMON_H__
+
+#include "interface/mmal/mmal_types.h"
+
+#define MMAL_PARAMETER_GROUP_COMMON     (0<<16)
+#define MMAL_PARAMETER_GROUP_CAMERA     (1<<16)
+#define MMAL_PARAMETER_GROUP_VIDEO      (2<<16)
+#define MMAL_PARAMETER_GROUP_AUDIO      (3<<16)
+#define MMAL_PARAMETER_GROUP_CLOCK      (4<<16)
+#define MMAL_PARAMETER_GROUP_MIRACAST   (5<<16)
+
+enum {
+    MMAL_PARAMETER_UNUSED = MMAL_PARAMETER_GROUP_COMMON,
+    MMAL_PARAMETER_SUPPORTED_ENCODINGS,
+    MMAL_PARAMETER_URI,
+    MMAL_PARAMETER_CHANGE_EVENT_REQUEST,
+    MMAL_PARAMETER_ZERO_COPY,
+    MMAL_PARAMETER_BUFFER_REQUIREMENTS,
+    MMAL_PARAMETER_STATISTICS,
+    MMAL_PARAMETER_CORE_STATISTICS,
+    MMAL_PARAMETER_MEM_USAGE,
+    MMAL_PARAMETER_BUFFER_FLAG_FILTER,
+    MMAL_PARAMETER_SEEK,
+    MMAL_PARAMETER_POWERMON_ENABLE,
+    MMAL_PARAMETER_LOGGING,
+    MMAL_PARAMETER_SYSTEM_TIME,
+    MMAL_PARAMETER_NO_IMAGE_PADDING,
+    MMAL_PARAMETER_LOCKSTEP_ENABLE
+};
+
+typedef struct MMAL_PARAMETER_HEADER_T {
+    uint32_t id;        /**< Parameter ID */
+    uint32_t size;      /**< Size in bytes of the parameter (including the header) */
+} MMAL_PARAMETER_HEADER_T;
+
+typedef struct MMAL_PARAMETER_CHANGE_EVENT_REQUEST_T {
+    MMAL_PARAMETER_HEADER_T hdr;
+    uint32_t change_id;     /**< ID of parameter that may change */
+    MMAL_BOOL_T enable;     /**< True if the event is enabled, false if disabled */
+} MMAL_PARAMETER_CHANGE_EVENT_REQUEST_T;
+
+typedef struct MMAL_PARAMETER_BOOLEAN_T {
+    MMAL_PARAMETER_HEADER_T hdr;
+    MMAL_BOOL_T enable;
+} MMAL_PARAMETER_BOOLEAN_T;
+
+typedef struct MMAL_PARAMETER_UINT64_T {
+    MMAL_PARAMETER_HEADER_T hdr;
+    uint64_t value;
+} MMAL_PARAMETER_UINT64_T;
+
+typedef struct MMAL_PARAMETER_INT64_T {
+    MMAL_PARAMETER_HEADER_T hdr;
+    int64_t value;
+} MMAL_PARAMETER_INT64_T;
+
+typedef struct MMAL_PARAMETER_UINT32_T {
+    MMAL_PARAMETER_HEADER_T hdr;
+    uint32_t value;
+} MMAL_PARAMETER_UINT32_T;
+
+typedef struct MMAL_PARAMETER_INT32_T {
+    MMAL_PARAMETER_HEADER_T hdr;
+    int32_t value;
+} MMAL_PARAMETER_INT32_T;
+
+typedef struct MMAL_PARAMETER_RATIONAL_T {
+    MMAL_PARAMETER_HEADER_T hdr;
+    MMAL_RATIONAL_T value;
+} MMAL_PARAMETER_RATIONAL_T;
+
+typedef struct MMAL_PARAMETER_STRING_T {
+    MMAL_PARAMETER_HEADER_T hdr;
+    char str[1];
+} MMAL_PARAMETER_STRING_T;
+
+#endif /* __MMAL_PARAMETERS_COMMON_H__ */
@@ -0,0 +1,171 @@
+/**
+ \file interface/mmal/mmal_parameters_video.h
+ \brief Video parameters (host-side stand-in).
+ */
+
+#ifndef __MMAL_PARAMETERS_VIDEO_H__
+#define __MMAL_PARAMETERS_VIDEO_H__
+
+#include "interface/mmal/mmal_parameters_common.h"
+
+enum {
+    MMAL_PARAMETER_DISPLAYREGION = MMAL_PARAMETER_GROUP_VIDEO,
+    MMAL_PARAMETER_SUPPORTED_PROFILES,
+    MMAL_PARAMETER_PROFILE,
+    MMAL_PARAMETER_INTRAPERIOD,
+    MMAL_PARAMETER_RATECONTROL,
+    MMAL_PARAMETER_NALUNITFORMAT,
+    MMAL_PARAMETER_MINIMISE_FRAGMENTATION,
+    MMAL_PARAMETER_MB_ROWS_PER_SLICE,
+    MMAL_PARAMETER_VIDEO_LEVEL_EXTENSION,
+    MMAL_PARAMETER_VIDEO_EEDE_ENABLE,
+    MMAL_PARAMETER_VIDEO_EEDE_LOSSRATE,
+    MMAL_PARAMETER_VIDEO_REQUEST_I_FRAME,
+    MMAL_PARAMETER_VIDEO_INTRA_REFRESH,
+    MMAL_PARAMETER_VIDEO_IMMUTABLE_INPUT,
+    MMAL_PARAMETER_VIDEO_BIT_RATE,
+    MMAL_PARAMETER_VIDEO_FRAME_RATE,
+    MMAL_PARAMETER_VIDEO_ENCODE_MIN_QUANT,
+    MMAL_PARAMETER_VIDEO_ENCODE_MAX_QUANT,
+    MMAL_PARAMETER_VIDEO_ENCODE_RC_MODEL,
+    MMAL_PARAMETER_EXTRA_BUFFERS,
+    MMAL_PARAMETER_VIDEO_ALIGN_HORIZ,
+    MMAL_PARAMETER_VIDEO_ALIGN_VERT,
+    MMAL_PARAMETER_VIDEO_DROPPABLE_PFRAMES,
+    MMAL_PARAMETER_VIDEO_ENCODE_INITIAL_QUANT,
+    MMAL_PARAMETER_VIDEO_ENCODE_QP_P,
+    MMAL_PARAMETER_VIDEO_ENCODE_RC_SLICE_DQUANT,
+    MMAL_PARAMETER_VIDEO_ENCODE_FRAME_LIMIT_BITS,
+    MMAL_PARAMETER_VIDEO_ENCODE_PEAK_RATE,
+    MMAL_PARAMETER_VIDEO_ENCODE_H264_DISABLE_CABAC,
+    MMAL_PARAMETER_VIDEO_ENCODE_H264_LOW_LATENCY,
+    MMAL_PARAMETER_VIDEO_ENCODE_H264_AU_DELIMITERS,
+    MMAL_PARAMETER_VIDEO_ENCODE_H264_DEBLOCK_IDC,
+    MMAL_PARAMETER_VIDEO_ENCODE_H264_MB_INTRA_MODE,
+    MMAL_PARAMETER_VIDEO_ENCODE_HEADER_ON_OPEN,
+    MMAL_PARAMETER_VIDEO_ENCODE_PRECODE_FOR_QP,
+    MMAL_PARAMETER_VIDEO_DRM_INIT_INFO,
+    MMAL_PARAMETER_VIDEO_TIMESTAMP_FIFO,
+    MMAL_PARAMETER_VIDEO_DECODE_ERROR_CONCEALMENT,
+    MMAL_PARAMETER_VIDEO_DRM_PROTECT_BUFFER,
+    MMAL_PARAMETER_VIDEO_DECODE_CONFIG_VD3,
+    MMAL_PARAMETER_VIDEO_ENCODE_H264_VCL_HRD_PARAMETERS,
+    MMAL_PARAMETER_VIDEO_ENCODE_H264_LOW_DELAY_HRD_FLAG,
+    MMAL_PARAMETER_VIDEO_ENCODE_INLINE_HEADER,
+    MMAL_PARAMETER_VIDEO_ENCODE_SEI_ENABLE,
+    MMAL_PARAMETER_VIDEO_ENCODE_INLINE_VECTORS
+};
+
+typedef enum MMAL_DISPLAYTRANSFORM_T {
+    MMAL_DISPLAY_ROT0 = 0,
+    MMAL_DISPLAY_MIRROR_ROT0 = 1,
+    MMAL_DISPLAY_MIRROR_ROT180 = 2,
+    MMAL_DISPLAY_ROT180 = 3,
+    MMAL_DISPLAY_MIRROR_ROT90 = 4,
+    MMAL_DISPLAY_ROT270 = 5,
+    MMAL_DISPLAY_ROT90 = 6,
+    MMAL_DISPLAY_MIRROR_ROT270 = 7,
+    MMAL_DISPLAY_DUMMY = 0x7FFFFFFF
+} MMAL_DISPLAYTRANSFORM_T;
+
+typedef enum MMAL_DISPLAYMODE_T {
+    MMAL_DISPLAY_MODE_FILL = 0,
+    MMAL_DISPLAY_MODE_LETTERBOX = 1,
+    MMAL_DISPLAY_MODE_DUMMY = 0x7FFFFFFF
+} MMAL_DISPLAYMODE_T;
+
+typedef enum MMAL_DISPLAYSET_T {
+    MMAL_DISPLAY_SET_NONE = 0,
+    MMAL_DISPLAY_SET_NUM = 1,
+    MMAL_DISPLAY_SET_FULLSCREEN = 2,
+    MMAL_DISPLAY_SET_TRANSFORM = 4,
+    MMAL_DISPLAY_SET_DEST_RECT = 8,
+    MMAL_DISPLAY_SET_SRC_RECT = 0x10,
+    MMAL_DISPLAY_SET_MODE = 0x20,
+    MMAL_DISPLAY_SET_PIXEL = 0x40,
+    MMAL_DISPLAY_SET_NOASPECT = 0x80,
+    MMAL_DISPLAY_SET_LAYER = 0x100,
+    MMAL_DISPLAY_SET_COPYPROTECT = 0x200,
+    MMAL_DISPLAY_SET_ALPHA = 0x400,
+    MMAL_DISPLAY_SET_DUMMY = 0x7FFFFFFF
+} MMAL_DISPLAYSET_T;
+
+typedef struct MMAL_DISPLAYREGION_T {
+    MMAL_PARAMETER_HEADER_T hdr;
+    uint32_t set;                       /**< MMAL_DISPLAY_SET_* bitmask of the fields that are in use */
+    uint32_t display_num;
+    MMAL_BOOL_T fullscreen;
+    MMAL_DISPLAYTRANSFORM_T transform;
+    MMAL_RECT_T dest_rect;
+    MMAL_RECT_T src_rect;
+    MMAL_BOOL_T noaspect;
+    MMAL_DISPLAYMODE_T mode;
+    uint32_t pixel_x;
+    uint32_t pixel_y;
+    int32_t layer;
+    MMAL_BOOL_T copyprotect_required;
+    uint32_t alpha;
+} MMAL_DISPLAYREGION_T;
+
+typedef enum MMAL_VIDEO_PROFILE_T {
+    MMAL_VIDEO_PROFILE_H264_BASELINE = 25,
+    MMAL_VIDEO_PROFILE_H264_MAIN,
+    MMAL_VIDEO_PROFILE_H264_EXTENDED,
+    MMAL_VIDEO_PROFILE_H264_HIGH,
+    MMAL_VIDEO_PROFILE_H264_HIGH10,
+    MMAL_VIDEO_PROFILE_H264_HIGH422,
+    MMAL_VIDEO_PROFILE_H264_HIGH444,
+    MMAL_VIDEO_PROFILE_H264_CONSTRAINED_BASELINE,
+    MMAL_VIDEO_PROFILE_DUMMY = 0x7FFFFFFF
+} MMAL_VIDEO_PROFILE_T;
+
+typedef enum MMAL_VIDEO_LEVEL_T {
+    MMAL_VIDEO_LEVEL_H264_1 = 16,
+    MMAL_VIDEO_LEVEL_H264_1b,
+    MMAL_VIDEO_LEVEL_H264_11,
+    MMAL_VIDEO_LEVEL_H264_12,
+    MMAL_VIDEO_LEVEL_H264_13,
+    MMAL_VIDEO_LEVEL_H264_2,
+    MMAL_VIDEO_LEVEL_H264_21,
+    MMAL_VIDEO_LEVEL_H264_22,
+    MMAL_VIDEO_LEVEL_H264_3,
+    MMAL_VIDEO_LEVEL_H264_31,
+    MMAL_VIDEO_LEVEL_H264_32,
+    MMAL_VIDEO_LEVEL_H264_4,
+    MMAL_VIDEO_LEVEL_H264_41,
+    MMAL_VIDEO_LEVEL_H264_42,
+    MMAL_VIDEO_LEVEL_H264_5,
+    MMAL_VIDEO_LEVEL_H264_51,
+    MMAL_VIDEO_LEVEL_DUMMY = 0x7FFFFFFF
+} MMAL_VIDEO_LEVEL_T;
+
+typedef struct MMAL_PARAMETER_VIDEO_PROFILE_T {
+    MMAL_PARAMETER_HEADER_T hdr;
+    struct {
+        MMAL_VIDEO_PROFILE_T profile;
+        MMAL_VIDEO_LEVEL_T level;
+    } profile[1];
+} MMAL_PARAMETER_VIDEO_PROFILE_T;
+
+typedef enum MMAL_VIDEO_INTRA_REFRESH_T {
+    MMAL_VIDEO_INTRA_REFRESH_CYCLIC,
+    MMAL_VIDEO_INTRA_REFRESH_ADAPTIVE,
+    MMAL_VIDEO_INTRA_REFRESH_BOTH,
+    MMAL_VIDEO_INTRA_REFRESH_KHRONOSEXTENSIONS = 0x6F000000,
+    MMAL_VIDEO_INTRA_REFRESH_VENDORSTARTUNUSED = 0x7F000000,
+    MMAL_VIDEO_INTRA_REFRESH_CYCLIC_MROWS,
+    MMAL_VIDEO_INTRA_REFRESH_PSEUDO_RAND,
+    MMAL_VIDEO_INTRA_REFRESH_MAX,
+    MMAL_VIDEO_INTRA_REFRESH_DUMMY = 0x7FFFFFFF
+} MMAL_VIDEO_INTRA_REFRESH_T;
+
+typedef struct MMAL_PARAMETER_VIDEO_INTRA_REFRESH_T {
+    MMAL_PARAMETER_HEADER_T hdr;
+    MMAL_VIDEO_INTRA_REFRESH_T refresh_mode;
+    uint32_t air_mbs;
+    uint32_t air_ref;
+    uint32_t cir_mbs;
+    uint32_t pir_mbs;
+} MMAL_PARAMETER_VIDEO_INTRA_REFRESH_T;
+
+#endif /* __MMAL_PARAMETERS_VIDEO_H__ */
@@ -0,0 +1,42 @@
+/**
+ \file interface/mmal/mmal_pool.h
+ \brief Pools of buffer headers and payloads (host-side stand-in).
+ */
+
+#ifndef __MMAL_POOL_H__
+#define __MMAL_POOL_H__
+
+#include "interface/mmal/mmal_queue.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct {
+    MMAL_QUEUE_T *queue;                /**< Queue used by the pool */
+    uint32_t headers_num;               /**< Number of buffer headers in the pool */
+    MMAL_BUFFER_HEADER_T **header;      /**< Array of buffer headers belonging to the pool */
+} MMAL_POOL_T;
+
+MMAL_POOL_T *mmal_pool_create(unsigned int headers, uint32_t payload_size);
+void mmal_pool_destroy(MMAL_POOL_T *pool);
+
+/** Resize a pool. Every header must have been returned to the pool queue. */
+MMAL_STATUS_T mmal_pool_resize(MMAL_POOL_T *pool, unsigned int headers, uint32_t payload_size);
+
+/**
+ \brief Called when a buffer header is released back to the pool.
+ \return MMAL_TRUE if the header should be put back on the pool queue.
+ */
+typedef MMAL_BOOL_T (*MMAL_POOL_BH_CB_T)(MMAL_POOL_T *pool, MMAL_BUFFER_HEADER_T *buffer, void *userdata);
+
+void mmal_pool_callback_set(MMAL_POOL_T *pool, MMAL_POOL_BH_CB_T cb, void *userdata);
+
+/** Set a pre-release callback on every header of the pool. */
+void mmal_pool_pre_release_callback_set(MMAL_POOL_T *pool, MMAL_BH_PRE_RELEASE_CB_T cb, void *userdata);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __MMAL_POOL_H__ */
@@ -0,0 +1,82 @@
+/**
+ \file interface/mmal/mmal_port.h
+ \brief Component ports (host-side stand-in).
+ */
+
+#ifndef __MMAL_PORT_H__
+#define __MMAL_PORT_H__
+
+#include "interface/mmal/mmal_types.h"
+#include "interface/mmal/mmal_format.h"
+#include "interface/mmal/mmal_buffer.h"
+#include "interface/mmal/mmal_parameters_common.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef enum {
+    MMAL_PORT_TYPE_UNKNOWN = 0,
+    MMAL_PORT_TYPE_CONTROL,
+    MMAL_PORT_TYPE_INPUT,
+    MMAL_PORT_TYPE_OUTPUT,
+    MMAL_PORT_TYPE_CLOCK,
+    MMAL_PORT_TYPE_INVALID = 0xffffffff
+} MMAL_PORT_TYPE_T;
+
+#define MMAL_PORT_CAPABILITY_PASSTHROUGH                0x01
+#define MMAL_PORT_CAPABILITY_ALLOCATION                 0x02
+#define MMAL_PORT_CAPABILITY_SUPPORTS_EVENT_FORMAT_CHANGE 0x04
+
+typedef struct MMAL_PORT_PRIVATE_T MMAL_PORT_PRIVATE_T;
+typedef struct MMAL_PORT_USERDATA_T MMAL_PORT_USERDATA_T;
+
+typedef struct MMAL_PORT_T {
+    MMAL_PORT_PRIVATE_T *priv;              /**< Private member used by the framework */
+    const char *name;                       /**< Port name. Used for debugging purposes */
+    MMAL_PORT_TYPE_T type;                  /**< Type of the port */
+    uint16_t index;                         /**< Index of the port in its type list */
+    uint16_t index_all;                     /**< Index of the port in the list of all ports */
+    uint32_t is_enabled;                    /**< Indicates whether the port is enabled or not */
+    MMAL_ES_FORMAT_T *format;               /**< Format of the elementary stream */
+    uint32_t buffer_num_min;                /**< Minimum number of buffers the port requires */
+    uint32_t buffer_size_min;               /**< Minimum size of buffers the port requires */
+    uint32_t buffer_alignment_min;          /**< Minimum alignment requirement for the buffers */
+    uint32_t buffer_num_recommended;        /**< Number of buffers the port recommends for optimal performance */
+    uint32_t buffer_size_recommended;       /**< Size of buffers the port recommends for optimal performance */
+    uint32_t buffer_num;                    /**< Actual number of buffers the port will use */
+    uint32_t buffer_size;                   /**< Actual maximum size of the buffers that will be sent to the port */
+    struct MMAL_COMPONENT_T *component;     /**< Component this port belongs to */
+    struct MMAL_PORT_USERDATA_T *userdata;  /**< Field reserved for use by the client */
+    uint32_t capabilities;                  /**< MMAL_PORT_CAPABILITY_* */
+} MMAL_PORT_T;
+
+typedef void (*MMAL_PORT_BH_CB_T)(MMAL_PORT_T *port, MMAL_BUFFER_HEADER_T *buffer);
+
+MMAL_STATUS_T mmal_port_format_commit(MMAL_PORT_T *port);
+
+/** Enable processing on a port. Output and control ports deliver buffers and events to cb. */
+MMAL_STATUS_T mmal_port_enable(MMAL_PORT_T *port, MMAL_PORT_BH_CB_T cb);
+
+/** Disable processing on a port. Buffers still queued on the port are handed back through its callback. */
+MMAL_STATUS_T mmal_port_disable(MMAL_PORT_T *port);
+
+/** Hand back every buffer queued on the port through its callback. */
+MMAL_STATUS_T mmal_port_flush(MMAL_PORT_T *port);
+
+MMAL_STATUS_T mmal_port_parameter_set(MMAL_PORT_T *port, const MMAL_PARAMETER_HEADER_T *param);
+MMAL_STATUS_T mmal_port_parameter_get(MMAL_PORT_T *port, MMAL_PARAMETER_HEADER_T *param);
+
+MMAL_STATUS_T mmal_port_send_buffer(MMAL_PORT_T *port, MMAL_BUFFER_HEADER_T *buffer);
+
+MMAL_STATUS_T mmal_port_connect(MMAL_PORT_T *port, MMAL_PORT_T *other_port);
+MMAL_STATUS_T mmal_port_disconnect(MMAL_PORT_T *port);
+
+uint8_t *mmal_port_payload_alloc(MMAL_PORT_T *port, uint32_t payload_size);
+void mmal_port_payload_free(MMAL_PORT_T *port, uint8_t *payload);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __MMAL_PORT_H__ */
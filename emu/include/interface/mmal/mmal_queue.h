@@ -0,0 +1,37 @@
+/**
+ \file interface/mmal/mmal_queue.h
+ \brief Thread safe FIFO of buffer headers (host-side stand-in).
+ */
+
+#ifndef __MMAL_QUEUE_H__
+#define __MMAL_QUEUE_H__
+
+#include "interface/mmal/mmal_buffer.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct MMAL_QUEUE_T MMAL_QUEUE_T;
+
+MMAL_QUEUE_T *mmal_queue_create(void);
+void mmal_queue_put(MMAL_QUEUE_T *queue, MMAL_BUFFER_HEADER_T *buffer);
+void mmal_queue_put_back(MMAL_QUEUE_T *queue, MMAL_BUFFER_HEADER_T *buffer);
+
+/** \return the head of the queue, or NULL if it is empty */
+MMAL_BUFFER_HEADER_T *mmal_queue_get(MMAL_QUEUE_T *queue);
+
+/** Blocks until a buffer is available. */
+MMAL_BUFFER_HEADER_T *mmal_queue_wait(MMAL_QUEUE_T *queue);
+
+/** Blocks for at most timeout milliseconds. \return NULL on timeout */
+MMAL_BUFFER_HEADER_T *mmal_queue_timedwait(MMAL_QUEUE_T *queue, uint32_t timeout);
+
+unsigned int mmal_queue_length(MMAL_QUEUE_T *queue);
+void mmal_queue_destroy(MMAL_QUEUE_T *queue);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __MMAL_QUEUE_H__ */
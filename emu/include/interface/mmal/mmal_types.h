@@ -0,0 +1,54 @@
+/**
+ \file interface/mmal/mmal_types.h
+ \brief MMAL status codes and basic types (host-side stand-in).
+ */
+
+#ifndef __MMAL_TYPES_H__
+#define __MMAL_TYPES_H__
+
+#include "interface/mmal/mmal_common.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef enum {
+    MMAL_SUCCESS = 0,       /**< Success */
+    MMAL_ENOMEM,            /**< Out of memory */
+    MMAL_ENOSPC,            /**< Out of resources (other than memory) */
+    MMAL_EINVAL,            /**< Argument is invalid */
+    MMAL_ENOSYS,            /**< Function not implemented */
+    MMAL_ENOENT,            /**< No such file or directory */
+    MMAL_ENXIO,             /**< No such device or address */
+    MMAL_EIO,               /**< I/O error */
+    MMAL_ESPIPE,            /**< Illegal seek */
+    MMAL_ECORRUPT,          /**< Data is corrupt */
+    MMAL_ENOTREADY,         /**< Component is not ready */
+    MMAL_ECONFIG,           /**< Component is not configured */
+    MMAL_EISCONN,           /**< Port is already connected */
+    MMAL_ENOTCONN,          /**< Port is disconnected */
+    MMAL_EAGAIN,            /**< Resource temporarily unavailable. Try again later */
+    MMAL_EFAULT,            /**< Bad address */
+    MMAL_STATUS_MAX = 0x7FFFFFFF
+} MMAL_STATUS_T;
+
+typedef struct {
+    int32_t x;
+    int32_t y;
+    int32_t width;
+    int32_t height;
+} MMAL_RECT_T;
+
+typedef struct {
+    int32_t num;
+    int32_t den;
+} MMAL_RATIONAL_T;
+
+/** Timestamp in microseconds */
+typedef int64_t MMAL_PTS_T;
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __MMAL_TYPES_H__ */
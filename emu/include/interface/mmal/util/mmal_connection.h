@@ -0,0 +1,55 @@
+/**
+ \file interface/mmal/util/mmal_connection.h
+ \brief Connections between an output port and an input port (host-side stand-in).
+
+ The stand-in always hands data from the output port directly to the input port's component, whether or not
+ MMAL_CONNECTION_FLAG_TUNNELLING is requested.
+ */
+
+#ifndef __MMAL_CONNECTION_H__
+#define __MMAL_CONNECTION_H__
+
+#include "interface/mmal/mmal.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define MMAL_CONNECTION_FLAG_TUNNELLING                 0x1
+#define MMAL_CONNECTION_FLAG_ALLOCATION_ON_INPUT        0x2
+#define MMAL_CONNECTION_FLAG_ALLOCATION_ON_OUTPUT       0x4
+#define MMAL_CONNECTION_FLAG_KEEP_BUFFER_REQUIREMENTS   0x8
+#define MMAL_CONNECTION_FLAG_DIRECT                     0x10
+#define MMAL_CONNECTION_FLAG_KEEP_PORT_FORMATS          0x20
+
+typedef struct MMAL_CONNECTION_T MMAL_CONNECTION_T;
+
+typedef void (*MMAL_CONNECTION_CALLBACK_T)(MMAL_CONNECTION_T *connection);
+
+struct MMAL_CONNECTION_T {
+    void *user_data;                        /**< Field reserved for use by the client */
+    MMAL_CONNECTION_CALLBACK_T callback;    /**< Callback set by the client */
+    uint32_t is_enabled;                    /**< Specifies whether the connection is enabled or not */
+    uint32_t flags;                         /**< MMAL_CONNECTION_FLAG_* */
+    MMAL_PORT_T *in;                        /**< Input port used for the connection */
+    MMAL_PORT_T *out;                       /**< Output port used for the connection */
+    MMAL_POOL_T *pool;                      /**< Pool of buffer headers used by the output port. Unused by the stand-in */
+    MMAL_QUEUE_T *queue;                    /**< Queue for the buffer headers sent by the output port. Unused by the stand-in */
+    const char *name;                       /**< Connection name */
+    int64_t time_setup;                     /**< Time in microseconds taken to setup the connection */
+    int64_t time_enable;                    /**< Time in microseconds taken to enable the connection */
+    int64_t time_disable;                   /**< Time in microseconds taken to disable the connection */
+};
+
+MMAL_STATUS_T mmal_connection_create(MMAL_CONNECTION_T **connection, MMAL_PORT_T *out, MMAL_PORT_T *in, uint32_t flags);
+void mmal_connection_acquire(MMAL_CONNECTION_T *connection);
+MMAL_STATUS_T mmal_connection_release(MMAL_CONNECTION_T *connection);
+MMAL_STATUS_T mmal_connection_destroy(MMAL_CONNECTION_T *connection);
+MMAL_STATUS_T mmal_connection_enable(MMAL_CONNECTION_T *connection);
+MMAL_STATUS_T mmal_connection_disable(MMAL_CONNECTION_T *connection);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __MMAL_CONNECTION_H__ */
@@ -0,0 +1,23 @@
+/**
+ \file interface/mmal/util/mmal_default_components.h
+ \brief Default component names (host-side stand-in).
+ */
+
+#ifndef __MMAL_DEFAULT_COMPONENTS_H__
+#define __MMAL_DEFAULT_COMPONENTS_H__
+
+#define MMAL_COMPONENT_DEFAULT_VIDEO_DECODER   "vc.ril.video_decode"
+#define MMAL_COMPONENT_DEFAULT_VIDEO_ENCODER   "vc.ril.video_encode"
+#define MMAL_COMPONENT_DEFAULT_VIDEO_RENDERER  "vc.ril.video_render"
+#define MMAL_COMPONENT_DEFAULT_IMAGE_DECODER   "vc.ril.image_decode"
+#define MMAL_COMPONENT_DEFAULT_IMAGE_ENCODER   "vc.ril.image_encode"
+#define MMAL_COMPONENT_DEFAULT_CAMERA          "vc.ril.camera"
+#define MMAL_COMPONENT_DEFAULT_VIDEO_CONVERTER "vc.video_convert"
+#define MMAL_COMPONENT_DEFAULT_SPLITTER        "vc.splitter"
+#define MMAL_COMPONENT_DEFAULT_SCHEDULER       "vc.scheduler"
+#define MMAL_COMPONENT_DEFAULT_VIDEO_INJECTER  "vc.video_inject"
+#define MMAL_COMPONENT_DEFAULT_VIDEO_SPLITTER  "vc.ril.video_splitter"
+#define MMAL_COMPONENT_DEFAULT_NULL_SINK       "vc.null_sink"
+#define MMAL_COMPONENT_DEFAULT_RESIZER         "vc.ril.resize"
+
+#endif /* __MMAL_DEFAULT_COMPONENTS_H__ */
@@ -0,0 +1,32 @@
+/**
+ \file interface/mmal/util/mmal_util.h
+ \brief MMAL utility functions (host-side stand-in).
+ */
+
+#ifndef __MMAL_UTIL_H__
+#define __MMAL_UTIL_H__
+
+#include "interface/mmal/mmal.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+const char *mmal_status_to_string(MMAL_STATUS_T status);
+const char *mmal_port_type_to_string(MMAL_PORT_TYPE_T type);
+
+/** Write a FourCC into buf as a printable string. \return buf */
+char *mmal_4cc_to_string(char *buf, size_t len, uint32_t fourcc);
+
+uint32_t mmal_encoding_stride_to_width(uint32_t encoding, uint32_t stride);
+uint32_t mmal_encoding_width_to_stride(uint32_t encoding, uint32_t width);
+
+/** Create a pool of buffer headers with payloads suitable for port. */
+MMAL_POOL_T *mmal_port_pool_create(MMAL_PORT_T *port, unsigned int headers, uint32_t payload_size);
+void mmal_port_pool_destroy(MMAL_PORT_T *port, MMAL_POOL_T *pool);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __MMAL_UTIL_H__ */
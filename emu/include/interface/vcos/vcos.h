@@ -0,0 +1,67 @@
+/**
+ \file interface/vcos/vcos.h
+ \brief Host-side stand-in for the subset of VideoCore OS abstraction (VCOS) used by libraspivid.
+ */
+
+#ifndef __VCOS_H__
+#define __VCOS_H__
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <assert.h>
+#include <time.h>
+#include <errno.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <signal.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef enum {
+    VCOS_LOG_UNINITIALIZED = 0,
+    VCOS_LOG_NEVER,
+    VCOS_LOG_ERROR,
+    VCOS_LOG_WARN,
+    VCOS_LOG_INFO,
+    VCOS_LOG_TRACE
+} VCOS_LOG_LEVEL_T;
+
+typedef int32_t VCOS_STATUS_T;
+#define VCOS_SUCCESS 0
+
+/**
+ \brief Writes a log line to stderr if level is enabled. The default level is VCOS_LOG_WARN and may be
+ changed with vcos_log_set_level or the VCOS_LOG_LEVEL environment variable (0-5).
+ */
+void vcos_log_impl(VCOS_LOG_LEVEL_T level, const char *fmt, ...);
+void vcos_log_set_level(VCOS_LOG_LEVEL_T level);
+
+#define vcos_log_error(...) vcos_log_impl(VCOS_LOG_ERROR, __VA_ARGS__)
+#define vcos_log_warn(...)  vcos_log_impl(VCOS_LOG_WARN, __VA_ARGS__)
+#define vcos_log_info(...)  vcos_log_impl(VCOS_LOG_INFO, __VA_ARGS__)
+#define vcos_log_trace(...) vcos_log_impl(VCOS_LOG_TRACE, __VA_ARGS__)
+
+#define vcos_assert(cond) assert(cond)
+#define vcos_demand(cond) do { if (!(cond)) abort(); } while (0)
+#define vcos_verify(cond) (cond)
+
+#define VCOS_ALIGN_UP(value, round_to) (((value) + (round_to) - 1) & ~((round_to) - 1))
+#define VCOS_ALIGN_DOWN(value, round_to) ((value) - ((value) & ((round_to) - 1)))
+#define vcos_min(x, y) ((x) < (y) ? (x) : (y))
+#define vcos_max(x, y) ((x) > (y) ? (x) : (y))
+#define vcos_countof(x) (sizeof((x)) / sizeof((x)[0]))
+#define VCOS_FUNCTION __func__
+
+void vcos_sleep(uint32_t ms);
+uint32_t vcos_getmicrosecs(void);
+uint64_t vcos_getmicrosecs64(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __VCOS_H__ */
@@ -0,0 +1,21 @@
+/**
+ \file interface/vmcs_host/vc_vchi_gencmd.h
+ \brief Host-side stand-in for the VideoCore general command service. There is no GPU to query, so every
+ command fails.
+ */
+
+#ifndef __VC_VCHI_GENCMD_H__
+#define __VC_VCHI_GENCMD_H__
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+int vc_gencmd(char *response, int maxlen, const char *format, ...);
+int vc_gencmd_number_property(char *text, const char *property, int *number);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __VC_VCHI_GENCMD_H__ */
@@ -0,0 +1,23 @@
+#include "bcm_host.h"
+#include "interface/vmcs_host/vc_vchi_gencmd.h"
+
+extern "C" {
+
+void bcm_host_init(void) {
+}
+
+void bcm_host_deinit(void) {
+}
+
+int vc_gencmd(char *response, int maxlen, const char *format, ...) {
+    if (response && maxlen > 0) {
+        response[0] = '\0';
+    }
+    return -1;
+}
+
+int vc_gencmd_number_property(char *text, const char *property, int *number) {
+    return 0;
+}
+
+}
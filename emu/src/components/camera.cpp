@@ -0,0 +1,226 @@
+#include <chrono>
+#include <thread>
+
+#include "mmal_emu_private.h"
+
+namespace mmal_emu {
+
+    /**
+     \brief Synthetic vc.ril.camera. A producer thread renders a static gradient with a bright 64x64 square
+     bouncing across it, at the frame rate committed on the video port. Preview frames are produced whenever
+     the preview port is enabled, video frames only while MMAL_PARAMETER_CAPTURE is set on the video port.
+     */
+    class Camera : public Module {
+        public:
+            explicit Camera(MMAL_COMPONENT_T *component_) : Module(component_), running(false), frame_count(0), period_us(1000000 / 30) {}
+
+            ~Camera() {
+                disable();
+            }
+
+            MMAL_STATUS_T enable() {
+                if (running.exchange(true)) {
+                    return MMAL_SUCCESS;
+                }
+                frame_count = 0;
+                thread = std::thread(&Camera::run, this);
+                return MMAL_SUCCESS;
+            }
+
+            void disable() {
+                running.store(false);
+                if (thread.joinable()) {
+                    if (thread.get_id() == std::this_thread::get_id()) {
+                        thread.detach();
+                    } else {
+                        thread.join();
+                    }
+                }
+            }
+
+            MMAL_STATUS_T commit(MMAL_PORT_T *port) {
+                MMAL_FOURCC_T encoding = port->format->encoding;
+                std::vector< uint8_t > probe;
+                if (encoding != MMAL_ENCODING_OPAQUE && encoding != MMAL_ENCODING_I420 &&
+                        !convert_i420(NULL, 0, 0, encoding, probe)) {
+                    LOG_ERROR("camera: unsupported encoding on %s", port->name);
+                    return MMAL_EINVAL;
+                }
+                // The producer thread paces itself from this rather than from the format, which clients may write at any time
+                if (port == component->output[1]) {
+                    const MMAL_RATIONAL_T &rate = port->format->es->video.frame_rate;
+                    period_us.store(rate.num > 0 && rate.den > 0 ? (int64_t)1000000 * rate.den / rate.num : 1000000 / 30);
+                }
+                return Module::commit(port);
+            }
+
+            MMAL_STATUS_T parameter_get(MMAL_PORT_T *port, MMAL_PARAMETER_HEADER_T *param) {
+                if (port != component->control) {
+                    return MMAL_ENOSYS;
+                }
+                if (param->id == MMAL_PARAMETER_CAMERA_SETTINGS && param->size >= sizeof(MMAL_PARAMETER_CAMERA_SETTINGS_T)) {
+                    *reinterpret_cast< MMAL_PARAMETER_CAMERA_SETTINGS_T * >(param) = settings(frame_count);
+                    return MMAL_SUCCESS;
+                }
+                if (param->id == MMAL_PARAMETER_INPUT_CROP && param->size >= sizeof(MMAL_PARAMETER_INPUT_CROP_T)) {
+                    MMAL_PARAMETER_INPUT_CROP_T *crop = reinterpret_cast< MMAL_PARAMETER_INPUT_CROP_T * >(param);
+                    if (!port_parameter(port, MMAL_PARAMETER_INPUT_CROP, crop, sizeof(*crop))) {
+                        crop->hdr.size = sizeof(*crop);
+                        crop->rect.x = crop->rect.y = 0;
+                        crop->rect.width = crop->rect.height = 65536;
+                    }
+                    return MMAL_SUCCESS;
+                }
+                return MMAL_ENOSYS;
+            }
+
+        private:
+            struct Scene {
+                Scene() : width(0), height(0), square_x(0), square_y(0) {}
+                uint32_t width;
+                uint32_t height;
+                std::vector< uint8_t > background;
+                std::vector< uint8_t > frame;
+                std::vector< uint8_t > converted;
+                uint32_t square_x;
+                uint32_t square_y;
+            };
+
+            static const uint32_t SQUARE_SIZE = 64;
+
+            std::thread thread;
+            std::atomic<bool> running;
+            std::atomic<uint64_t> frame_count;
+            std::atomic<int64_t> period_us;
+            Scene scenes[2];
+
+            int64_t frame_period_us() {
+                return period_us.load();
+            }
+
+            void run() {
+                int64_t next = mmal_emu_time_us();
+                while (running.load()) {
+                    int64_t period = frame_period_us();
+                    if (!unthrottled()) {
+                        int64_t now = mmal_emu_time_us();
+                        if (next > now) {
+                            std::this_thread::sleep_for(std::chrono::microseconds(next - now));
+                        } else if (now - next > period) {
+                            next = now;
+                        }
+                        next += period;
+                    }
+
+                    std::lock_guard< std::recursive_mutex > guard(graph_lock());
+                    if (!running.load() || !component->is_enabled) {
+                        continue;
+                    }
+                    int64_t pts = mmal_emu_time_us();
+                    uint64_t frame = frame_count.load();
+                    emit(component->output[0], scenes[0], frame, pts);
+                    if (port_parameter_boolean(component->output[1], MMAL_PARAMETER_CAPTURE, MMAL_FALSE)) {
+                        emit(component->output[1], scenes[1], frame, pts);
+                    }
+                    if (port_change_event_requested(component->control, MMAL_PARAMETER_CAMERA_SETTINGS)) {
+                        MMAL_PARAMETER_CAMERA_SETTINGS_T event = settings(frame);
+                        // Stamped with the frame the settings were used for
+                        port_send_event(component->control, MMAL_EVENT_PARAMETER_CHANGED, &event, sizeof(event), pts);
+                    }
+                    frame_count.store(frame + 1);
+                }
+            }
+
+            MMAL_PARAMETER_CAMERA_SETTINGS_T settings(uint64_t frame) {
+                MMAL_PARAMETER_CAMERA_SETTINGS_T result;
+                memset(&result, 0, sizeof(result));
+                result.hdr.id = MMAL_PARAMETER_CAMERA_SETTINGS;
+                result.hdr.size = sizeof(result);
+                result.exposure = (uint32_t)vcos_min(frame_period_us(), (int64_t)33000) - (uint32_t)(frame % 16) * 100;
+                result.analog_gain.num = 256 + (int32_t)(frame % 64);
+                result.analog_gain.den = 256;
+                result.digital_gain.num = 256;
+                result.digital_gain.den = 256;
+                result.awb_red_gain.num = 384 + (int32_t)(frame % 8);
+                result.awb_red_gain.den = 256;
+                result.awb_blue_gain.num = 448 - (int32_t)(frame % 8);
+                result.awb_blue_gain.den = 256;
+                return result;
+            }
+
+            static uint32_t bounce(uint64_t position, uint32_t range) {
+                if (range == 0) {
+                    return 0;
+                }
+                uint64_t p = position % (2 * (uint64_t)range);
+                return (uint32_t)(p < range ? p : 2 * range - p);
+            }
+
+            void prepare(Scene &scene, uint32_t width, uint32_t height) {
+                if (scene.width == width && scene.height == height && !scene.frame.empty()) {
+                    return;
+                }
+                scene.width = width;
+                scene.height = height;
+                scene.background.assign(width * height * 3 / 2, 128);
+                for (uint32_t y = 0; y < height; y++) {
+                    uint8_t *row = &scene.background[y * width];
+                    for (uint32_t x = 0; x < width; x++) {
+                        row[x] = (uint8_t)(16 + x * 160 / width + y * 48 / height);
+                    }
+                }
+                scene.frame = scene.background;
+                scene.square_x = scene.square_y = 0;
+            }
+
+            void draw_square(Scene &scene, uint32_t sx, uint32_t sy, bool erase) {
+                uint32_t w = vcos_min(SQUARE_SIZE, scene.width - sx);
+                uint32_t h = vcos_min(SQUARE_SIZE, scene.height - sy);
+                for (uint32_t y = sy; y < sy + h; y++) {
+                    uint8_t *row = &scene.frame[y * scene.width + sx];
+                    if (erase) {
+                        memcpy(row, &scene.background[y * scene.width + sx], w);
+                    } else {
+                        memset(row, 235, w);
+                    }
+                }
+            }
+
+            void emit(MMAL_PORT_T *port, Scene &scene, uint64_t frame, int64_t pts) {
+                if (!port->is_enabled) {
+                    return;
+                }
+                uint32_t width = VCOS_ALIGN_UP(port->format->es->video.width, 32);
+                uint32_t height = VCOS_ALIGN_UP(port->format->es->video.height, 16);
+                if (width < SQUARE_SIZE || height < SQUARE_SIZE) {
+                    return;
+                }
+                prepare(scene, width, height);
+                draw_square(scene, scene.square_x, scene.square_y, true);
+                scene.square_x = bounce(frame * 4, width - SQUARE_SIZE);
+                scene.square_y = bounce(frame * 3, height - SQUARE_SIZE);
+                draw_square(scene, scene.square_x, scene.square_y, false);
+
+                Payload payload;
+                payload.data = scene.frame.data();
+                payload.length = scene.frame.size();
+                payload.flags = MMAL_BUFFER_HEADER_FLAG_FRAME_END;
+                payload.pts = pts;
+                payload.dts = MMAL_TIME_UNKNOWN;
+                payload.cmd = 0;
+                payload.format = port->format;
+                MMAL_FOURCC_T encoding = port->format->encoding;
+                if (encoding != MMAL_ENCODING_I420 && encoding != MMAL_ENCODING_OPAQUE) {
+                    convert_i420(scene.frame.data(), width, height, encoding, scene.converted);
+                    payload.data = scene.converted.data();
+                    payload.length = scene.converted.size();
+                }
+                port_emit(port, payload);
+            }
+    };
+
+    Module *create_camera(MMAL_COMPONENT_T *component) {
+        return new Camera(component);
+    }
+
+}
@@ -0,0 +1,126 @@
+#include "mmal_emu_private.h"
+
+namespace mmal_emu {
+
+    bool convert_i420(const uint8_t *i420, uint32_t width, uint32_t height, MMAL_FOURCC_T encoding, std::vector< uint8_t > &out) {
+        uint32_t bytes_per_pixel;
+        bool alpha_first = false;
+        switch (encoding) {
+            case MMAL_ENCODING_RGB24:
+            case MMAL_ENCODING_BGR24:
+                bytes_per_pixel = 3;
+                break;
+            case MMAL_ENCODING_ARGB:
+            case MMAL_ENCODING_ABGR:
+                alpha_first = true;
+                bytes_per_pixel = 4;
+                break;
+            case MMAL_ENCODING_RGBA:
+            case MMAL_ENCODING_BGRA:
+            case MMAL_ENCODING_RGB32:
+            case MMAL_ENCODING_BGR32:
+                bytes_per_pixel = 4;
+                break;
+            default:
+                return false;
+        }
+        if (!i420) {
+            return true;
+        }
+        out.resize(width * height * bytes_per_pixel);
+        uint8_t *pixel = out.data();
+        for (uint32_t i = 0; i < width * height; i++) {
+            uint8_t y = i420[i];
+            if (bytes_per_pixel == 4 && alpha_first) {
+                *pixel++ = 0xff;
+            }
+            *pixel++ = y;
+            *pixel++ = y;
+            *pixel++ = y;
+            if (bytes_per_pixel == 4 && !alpha_first) {
+                *pixel++ = 0xff;
+            }
+        }
+        return true;
+    }
+
+    /** vc.ril.resize and vc.ril.isp: nearest neighbour scaling of I420 frames to the output port format. */
+    class Resize : public Module {
+        public:
+            explicit Resize(MMAL_COMPONENT_T *component_) : Module(component_) {}
+
+            MMAL_STATUS_T commit(MMAL_PORT_T *port) {
+                if (port->type == MMAL_PORT_TYPE_OUTPUT) {
+                    MMAL_FOURCC_T encoding = port->format->encoding;
+                    std::vector< uint8_t > probe;
+                    if (encoding != MMAL_ENCODING_I420 && !convert_i420(NULL, 0, 0, encoding, probe)) {
+                        LOG_ERROR("resize: unsupported encoding on %s", port->name);
+                        return MMAL_EINVAL;
+                    }
+                }
+                return Module::commit(port);
+            }
+
+            void process(MMAL_PORT_T *input, const Payload &payload) {
+                MMAL_PORT_T *output = component->output[0];
+                if (payload.cmd || !output->is_enabled) {
+                    return;
+                }
+                uint32_t src_width = VCOS_ALIGN_UP(payload.format->es->video.width, 32);
+                uint32_t src_height = VCOS_ALIGN_UP(payload.format->es->video.height, 16);
+                uint32_t dst_width = VCOS_ALIGN_UP(output->format->es->video.width, 32);
+                uint32_t dst_height = VCOS_ALIGN_UP(output->format->es->video.height, 16);
+                if (payload.length < src_width * src_height * 3 / 2 || !dst_width || !dst_height) {
+                    return;
+                }
+
+                scaled.resize(dst_width * dst_height * 3 / 2);
+                scale_plane(payload.data, src_width, src_height, scaled.data(), dst_width, dst_height);
+                const uint8_t *src_u = payload.data + src_width * src_height;
+                const uint8_t *src_v = src_u + src_width * src_height / 4;
+                uint8_t *dst_u = scaled.data() + dst_width * dst_height;
+                uint8_t *dst_v = dst_u + dst_width * dst_height / 4;
+                scale_plane(src_u, src_width / 2, src_height / 2, dst_u, dst_width / 2, dst_height / 2);
+                scale_plane(src_v, src_width / 2, src_height / 2, dst_v, dst_width / 2, dst_height / 2);
+
+                Payload result = payload;
+                result.format = output->format;
+                result.data = scaled.data();
+                result.length = scaled.size();
+                if (output->format->encoding != MMAL_ENCODING_I420) {
+                    convert_i420(scaled.data(), dst_width, dst_height, output->format->encoding, converted);
+                    result.data = converted.data();
+                    result.length = converted.size();
+                }
+                port_emit(output, result);
+            }
+
+        private:
+            std::vector< uint8_t > scaled;
+            std::vector< uint8_t > converted;
+            std::vector< uint32_t > columns;
+
+            void scale_plane(const uint8_t *src, uint32_t src_width, uint32_t src_height, uint8_t *dst, uint32_t dst_width, uint32_t dst_height) {
+                if (src_width == dst_width && src_height == dst_height) {
+                    memcpy(dst, src, src_width * src_height);
+                    return;
+                }
+                columns.resize(dst_width);
+                for (uint32_t x = 0; x < dst_width; x++) {
+                    columns[x] = x * src_width / dst_width;
+                }
+                for (uint32_t y = 0; y < dst_height; y++) {
+                    const uint8_t *src_row = src + (y * src_height / dst_height) * src_width;
+                    uint8_t *dst_row = dst + y * dst_width;
+                    for (uint32_t x = 0; x < dst_width; x++) {
+                        dst_row[x] = src_row[columns[x]];
+                    }
+                }
+            }
+    };
+
+    Module *create_resize(MMAL_COMPONENT_T *component) {
+        return new Resize(component);
+    }
+
+}
@@ -0,0 +1,15 @@
+#include "mmal_emu_private.h"
+
+namespace mmal_emu {
+
+    /** vc.ril.video_render and vc.null_sink: frames are accepted and dropped. */
+    class Sink : public Module {
+        public:
+            explicit Sink(MMAL_COMPONENT_T *component_) : Module(component_) {}
+    };
+
+    Module *create_sink(MMAL_COMPONENT_T *component) {
+        return new Sink(component);
+    }
+
+}
@@ -0,0 +1,21 @@
+#include "mmal_emu_private.h"
+
+namespace mmal_emu {
+
+    /** vc.ril.video_splitter: every frame received on the input is delivered to each enabled output. */
+    class Splitter : public Module {
+        public:
+            explicit Splitter(MMAL_COMPONENT_T *component_) : Module(component_) {}
+
+            void process(MMAL_PORT_T *input, const Payload &payload) {
+                for (uint32_t i = 0; i < component->output_num; i++) {
+                    port_emit(component->output[i], payload);
+                }
+            }
+    };
+
+    Module *create_splitter(MMAL_COMPONENT_T *component) {
+        return new Splitter(component);
+    }
+
+}
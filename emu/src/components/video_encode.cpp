@@ -0,0 +1,213 @@
+#include "mmal_emu_private.h"
+
+namespace mmal_emu {
+
+    /**
+     \brief Pass-through vc.ril.video_encode. Nothing is compressed: each frame becomes an Annex B access unit
+     (or a JPEG-framed picture for MJPEG) whose size follows the configured bit rate, with an IDR frame every
+     MMAL_PARAMETER_INTRAPERIOD frames. Payload bytes are derived from luma so content changes are visible
+     downstream, and never contain a start code or a JPEG marker.
+
+     When MMAL_PARAMETER_VIDEO_ENCODE_INLINE_VECTORS is set, every frame is followed by a
+     MMAL_BUFFER_HEADER_FLAG_CODECSIDEINFO buffer of (mb_width + 1) * mb_height motion vector records found by
+     a coarse block search against the previous frame. As with the firmware, mb_width and mb_height count the
+     macroblocks of the crop rectangle, not of the padded frame.
+     */
+    class VideoEncode : public Module {
+        public:
+            explicit VideoEncode(MMAL_COMPONENT_T *component_) : Module(component_), frames(0), force_idr(false), headers_sent(false) {
+                MMAL_PORT_T *output = component->output[0];
+                output->format->encoding = MMAL_ENCODING_H264;
+                output->format->bitrate = DEFAULT_BITRATE;
+                default_requirements(output);
+            }
+
+            MMAL_STATUS_T enable() {
+                frames = 0;
+                headers_sent = false;
+                previous_luma.clear();
+                return MMAL_SUCCESS;
+            }
+
+            MMAL_STATUS_T commit(MMAL_PORT_T *port) {
+                if (port->type == MMAL_PORT_TYPE_INPUT) {
+                    MMAL_VIDEO_FORMAT_T &in = port->format->es->video;
+                    MMAL_VIDEO_FORMAT_T &out = component->output[0]->format->es->video;
+                    out.width = in.width;
+                    out.height = in.height;
+                    out.crop = in.crop;
+                    out.frame_rate = in.frame_rate;
+                } else if (!is_compressed(port->format->encoding)) {
+                    LOG_ERROR("video_encode: %s must use a compressed encoding", port->name);
+                    return MMAL_EINVAL;
+                }
+                return Module::commit(port);
+            }
+
+            MMAL_STATUS_T parameter_set(MMAL_PORT_T *port, const MMAL_PARAMETER_HEADER_T *param) {
+                if (param->id == MMAL_PARAMETER_VIDEO_REQUEST_I_FRAME) {
+                    force_idr.store(true);
+                }
+                return MMAL_SUCCESS;
+            }
+
+            void process(MMAL_PORT_T *input, const Payload &payload) {
+                MMAL_PORT_T *output = component->output[0];
+                if (payload.cmd || !output->is_enabled) {
+                    return;
+                }
+                uint32_t width = VCOS_ALIGN_UP(payload.format->es->video.width, 32);
+                uint32_t height = VCOS_ALIGN_UP(payload.format->es->video.height, 16);
+                const uint8_t *luma = payload.length >= width * height ? payload.data : NULL;
+
+                const MMAL_RATIONAL_T &rate = payload.format->es->video.frame_rate;
+                uint32_t fps = rate.num > 0 && rate.den > 0 ? vcos_max(1, rate.num / rate.den) : 30;
+                uint32_t bitrate = output->format->bitrate ? output->format->bitrate : DEFAULT_BITRATE;
+                uint32_t budget = vcos_max(bitrate / 8 / fps, (uint32_t)64);
+
+                if (output->format->encoding == MMAL_ENCODING_H264) {
+                    encode_h264(output, luma, width * height, budget, payload.pts);
+                    if (luma && port_parameter_boolean(output, MMAL_PARAMETER_VIDEO_ENCODE_INLINE_VECTORS, MMAL_FALSE)) {
+                        const MMAL_RECT_T &crop = payload.format->es->video.crop;
+                        uint32_t crop_width = crop.width ? vcos_min(crop.width, width) : width;
+                        uint32_t crop_height = crop.height ? vcos_min(crop.height, height) : height;
+                        emit_vectors(output, luma, width, height, crop_width, crop_height, payload.pts);
+                    }
+                } else {
+                    encode_jpeg(output, luma, width * height, budget, payload.pts);
+                }
+                frames++;
+            }
+
+        private:
+            static const uint32_t DEFAULT_BITRATE = 17000000;
+            static const uint32_t DEFAULT_INTRAPERIOD = 60;
+
+            uint64_t frames;
+            std::atomic<bool> force_idr;
+            bool headers_sent;
+            std::vector< uint8_t > bitstream;
+            std::vector< uint8_t > previous_luma;
+            std::vector< uint8_t > vectors;
+
+            void fill(uint8_t *data, uint32_t length, const uint8_t *luma, uint32_t luma_size) {
+                for (uint32_t i = 0; i < length; i++) {
+                    uint8_t sample = luma ? luma[(uint64_t)i * 7919 % luma_size] : (uint8_t)i;
+                    data[i] = 0x80 | (sample >> 2);
+                }
+            }
+
+            void emit(MMAL_PORT_T *output, const uint8_t *data, uint32_t length, uint32_t flags, int64_t pts, int64_t dts) {
+                Payload payload;
+                payload.data = data;
+                payload.length = length;
+                payload.flags = flags;
+                payload.pts = pts;
+                payload.dts = dts;
+                payload.cmd = 0;
+                payload.format = output->format;
+                port_emit(output, payload);
+            }
+
+            void encode_h264(MMAL_PORT_T *output, const uint8_t *luma, uint32_t luma_size, uint32_t budget, int64_t pts) {
+                uint32_t intraperiod = port_parameter_uint32(output, MMAL_PARAMETER_INTRAPERIOD, DEFAULT_INTRAPERIOD);
+                if (intraperiod == 0 || intraperiod > 1000) {
+                    intraperiod = DEFAULT_INTRAPERIOD;
+                }
+                bool idr = frames % intraperiod == 0;
+                if (force_idr.exchange(false)) {
+                    idr = true;
+                }
+
+                if (idr && (!headers_sent || port_parameter_boolean(output, MMAL_PARAMETER_VIDEO_ENCODE_INLINE_HEADER, MMAL_FALSE))) {
+                    static const uint8_t headers[] = {
+                        0x00, 0x00, 0x00, 0x01, 0x67, 0x64, 0x00, 0x28, 0xac, 0x2b, 0x40, 0x3c, 0x01, 0x13, 0xf2, 0xc0, 0x3c, 0x48, 0x9a, 0x80,
+                        0x00, 0x00, 0x00, 0x01, 0x68, 0xee, 0x06, 0xf2, 0xc0
+                    };
+                    emit(output, headers, sizeof(headers), MMAL_BUFFER_HEADER_FLAG_CONFIG, MMAL_TIME_UNKNOWN, MMAL_TIME_UNKNOWN);
+                    headers_sent = true;
+                }
+
+                uint32_t p_size = (uint32_t)((uint64_t)intraperiod * budget / (intraperiod + 3));
+                uint32_t size = idr ? 4 * p_size : p_size;
+                bitstream.resize(size + 5);
+                uint8_t *data = bitstream.data();
+                data[0] = data[1] = data[2] = 0x00;
+                data[3] = 0x01;
+                data[4] = idr ? 0x65 : 0x41;
+                fill(data + 5, size, luma, luma_size);
+                uint32_t flags = MMAL_BUFFER_HEADER_FLAG_FRAME_END | (idr ? MMAL_BUFFER_HEADER_FLAG_KEYFRAME : 0);
+                emit(output, data, bitstream.size(), flags, pts, pts);
+            }
+
+            void encode_jpeg(MMAL_PORT_T *output, const uint8_t *luma, uint32_t luma_size, uint32_t budget, int64_t pts) {
+                bitstream.resize(budget + 4);
+                uint8_t *data = bitstream.data();
+                data[0] = 0xff;
+                data[1] = 0xd8;
+                fill(data + 2, budget, luma, luma_size);
+                data[budget + 2] = 0xff;
+                data[budget + 3] = 0xd9;
+                emit(output, data, bitstream.size(), MMAL_BUFFER_HEADER_FLAG_FRAME_END | MMAL_BUFFER_HEADER_FLAG_KEYFRAME, pts, pts);
+            }
+
+            static uint32_t block_sad(const uint8_t *current, const uint8_t *previous, uint32_t stride) {
+                uint32_t sad = 0;
+                for (uint32_t y = 0; y < 16; y += 4) {
+                    for (uint32_t x = 0; x < 16; x += 4) {
+                        int diff = (int)current[y * stride + x] - (int)previous[y * stride + x];
+                        sad += diff < 0 ? -diff : diff;
+                    }
+                }
+                return sad;
+            }
+
+            void emit_vectors(MMAL_PORT_T *output, const uint8_t *luma, uint32_t width, uint32_t height, uint32_t crop_width,
+                    uint32_t crop_height, int64_t pts) {
+                struct Vector {
+                    int8_t x;
+                    int8_t y;
+                    int16_t sad;
+                };
+                const int32_t step = 4;
+                // The padded frame is 32 aligned, so the macroblocks covering the crop rectangle stay inside it
+                uint32_t mb_width = VCOS_ALIGN_UP(crop_width, 16) / 16;
+                uint32_t mb_height = VCOS_ALIGN_UP(crop_height, 16) / 16;
+                uint32_t stride = mb_width + 1;
+
+                vectors.assign(stride * mb_height * sizeof(Vector), 0);
+                Vector *records = reinterpret_cast< Vector * >(vectors.data());
+                if (previous_luma.size() == width * height) {
+                    for (uint32_t my = 0; my < mb_height; my++) {
+                        for (uint32_t mx = 0; mx < mb_width; mx++) {
+                            const uint8_t *block = luma + my * 16 * width + mx * 16;
+                            Vector best = { 0, 0, INT16_MAX };
+                            for (int32_t dy = -step; dy <= step; dy += step) {
+                                for (int32_t dx = -step; dx <= step; dx += step) {
+                                    int32_t px = (int32_t)mx * 16 + dx;
+                                    int32_t py = (int32_t)my * 16 + dy;
+                                    if (px < 0 || py < 0 || px + 16 > (int32_t)width || py + 16 > (int32_t)height) {
+                                        continue;
+                                    }
+                                    uint32_t sad = block_sad(block, &previous_luma[py * width + px], width) * 16;
+                                    if (sad < (uint32_t)best.sad) {
+                                        best.x = (int8_t)dx;
+                                        best.y = (int8_t)dy;
+                                        best.sad = (int16_t)vcos_min(sad, (uint32_t)INT16_MAX);
+                                    }
+                                }
+                            }
+                            records[my * stride + mx] = best;
+                        }
+                    }
+                }
+                previous_luma.assign(luma, luma + width * height);
+                emit(output, vectors.data(), vectors.size(), MMAL_BUFFER_HEADER_FLAG_CODECSIDEINFO, pts, pts);
+            }
+    };
+
+    Module *create_video_encode(MMAL_COMPONENT_T *component) {
+        return new VideoEncode(component);
+    }
+
+}
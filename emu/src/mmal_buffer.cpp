@@ -0,0 +1,74 @@
+#include "mmal_emu_private.h"
+
+namespace mmal_emu {
+    void pool_release(MMAL_POOL_T *pool, MMAL_BUFFER_HEADER_T *header);
+}
+
+extern "C" {
+
+void mmal_buffer_header_acquire(MMAL_BUFFER_HEADER_T *header) {
+    header->priv->refcount.fetch_add(1, std::memory_order_relaxed);
+}
+
+void mmal_buffer_header_reset(MMAL_BUFFER_HEADER_T *header) {
+    header->length = 0;
+    header->offset = 0;
+    header->flags = 0;
+    header->pts = MMAL_TIME_UNKNOWN;
+    header->dts = MMAL_TIME_UNKNOWN;
+}
+
+void mmal_buffer_header_release(MMAL_BUFFER_HEADER_T *header) {
+    if (header->priv->refcount.fetch_sub(1, std::memory_order_acq_rel) != 1) {
+        return;
+    }
+    if (header->priv->pf_pre_release && header->priv->pf_pre_release(header, header->priv->pre_release_userdata)) {
+        return;
+    }
+    mmal_buffer_header_release_continue(header);
+}
+
+void mmal_buffer_header_release_continue(MMAL_BUFFER_HEADER_T *header) {
+    mmal_buffer_header_reset(header);
+    header->cmd = 0;
+    if (header->priv->reference) {
+        MMAL_BUFFER_HEADER_T *reference = header->priv->reference;
+        header->priv->reference = NULL;
+        header->data = header->priv->payload;
+        header->alloc_size = header->priv->payload_size;
+        mmal_buffer_header_release(reference);
+    }
+    header->priv->refcount.store(1, std::memory_order_release);
+    mmal_emu::pool_release(header->priv->pool, header);
+}
+
+void mmal_buffer_header_pre_release_cb_set(MMAL_BUFFER_HEADER_T *header, MMAL_BH_PRE_RELEASE_CB_T cb, void *userdata) {
+    header->priv->pf_pre_release = cb;
+    header->priv->pre_release_userdata = userdata;
+}
+
+MMAL_STATUS_T mmal_buffer_header_replicate(MMAL_BUFFER_HEADER_T *dest, MMAL_BUFFER_HEADER_T *src) {
+    if (!dest || !src || dest->priv->reference) {
+        return MMAL_EINVAL;
+    }
+    mmal_buffer_header_acquire(src);
+    dest->priv->reference = src;
+    dest->cmd = src->cmd;
+    dest->data = src->data;
+    dest->alloc_size = src->alloc_size;
+    dest->length = src->length;
+    dest->offset = src->offset;
+    dest->flags = src->flags;
+    dest->pts = src->pts;
+    dest->dts = src->dts;
+    return MMAL_SUCCESS;
+}
+
+MMAL_STATUS_T mmal_buffer_header_mem_lock(MMAL_BUFFER_HEADER_T *header) {
+    return MMAL_SUCCESS;
+}
+
+void mmal_buffer_header_mem_unlock(MMAL_BUFFER_HEADER_T *header) {
+}
+
+}
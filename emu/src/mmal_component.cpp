@@ -0,0 +1,178 @@
+#include "mmal_emu_private.h"
+
+struct MMAL_COMPONENT_PRIVATE_T {
+    mmal_emu::Module *module;
+    std::atomic<int> refcount;
+    bool destroy_requested;
+    std::string name;
+};
+
+namespace mmal_emu {
+
+    static const ModuleInfo modules[] = {
+        { "vc.ril.camera", 0, 3, create_camera },
+        { "vc.ril.video_encode", 1, 1, create_video_encode },
+        { "vc.ril.video_splitter", 1, 4, create_splitter },
+        { "vc.splitter", 1, 4, create_splitter },
+        { "vc.ril.resize", 1, 1, create_resize },
+        { "vc.ril.isp", 1, 1, create_resize },
+        { "vc.ril.video_render", 1, 0, create_sink },
+        { "vc.null_sink", 1, 0, create_sink },
+    };
+
+    static std::atomic<bool> unthrottled_flag(false);
+    static std::atomic<uint32_t> next_component_id(1);
+
+    const ModuleInfo *find_module(const char *name) {
+        for (size_t i = 0; i < vcos_countof(modules); i++) {
+            if (!strcmp(modules[i].name, name)) {
+                return &modules[i];
+            }
+        }
+        return NULL;
+    }
+
+    Module *component_module(MMAL_COMPONENT_T *component) {
+        return component->priv->module;
+    }
+
+    bool unthrottled() {
+        return unthrottled_flag.load(std::memory_order_relaxed);
+    }
+
+    static void component_free(MMAL_COMPONENT_T *component) {
+        for (uint32_t i = 0; i < component->port_num; i++) {
+            MMAL_PORT_T *port = component->port[i];
+            if (port->priv->connected) {
+                mmal_port_disconnect(port);
+            }
+            if (port->is_enabled) {
+                mmal_port_disable(port);
+            }
+        }
+        delete component->priv->module;
+        for (uint32_t i = 0; i < component->port_num; i++) {
+            port_destroy(component->port[i]);
+        }
+        delete[] component->port;
+        delete[] component->input;
+        delete[] component->output;
+        delete component->priv;
+        delete component;
+    }
+
+}
+
+using namespace mmal_emu;
+
+extern "C" {
+
+MMAL_STATUS_T mmal_component_create(const char *name, MMAL_COMPONENT_T **component) {
+    if (!name || !component) {
+        return MMAL_EINVAL;
+    }
+    const ModuleInfo *info = find_module(name);
+    if (!info) {
+        LOG_ERROR("mmal_component_create: no component named %s", name);
+        return MMAL_ENOENT;
+    }
+
+    MMAL_COMPONENT_T *result = new MMAL_COMPONENT_T();
+    result->priv = new MMAL_COMPONENT_PRIVATE_T();
+    result->priv->refcount.store(1);
+    result->priv->destroy_requested = false;
+    result->priv->name = name;
+    result->name = result->priv->name.c_str();
+    result->id = next_component_id.fetch_add(1);
+
+    result->input_num = info->inputs;
+    result->output_num = info->outputs;
+    result->port_num = 1 + info->inputs + info->outputs;
+    result->port = new MMAL_PORT_T*[result->port_num];
+    result->input = new MMAL_PORT_T*[info->inputs ? info->inputs : 1];
+    result->output = new MMAL_PORT_T*[info->outputs ? info->outputs : 1];
+
+    uint16_t index_all = 0;
+    result->control = port_create(result, MMAL_PORT_TYPE_CONTROL, 0, index_all);
+    result->port[index_all++] = result->control;
+    for (uint32_t i = 0; i < info->inputs; i++) {
+        result->input[i] = port_create(result, MMAL_PORT_TYPE_INPUT, i, index_all);
+        result->port[index_all++] = result->input[i];
+    }
+    for (uint32_t i = 0; i < info->outputs; i++) {
+        result->output[i] = port_create(result, MMAL_PORT_TYPE_OUTPUT, i, index_all);
+        result->port[index_all++] = result->output[i];
+    }
+
+    result->priv->module = info->factory(result);
+    *component = result;
+    return MMAL_SUCCESS;
+}
+
+void mmal_component_acquire(MMAL_COMPONENT_T *component) {
+    component->priv->refcount.fetch_add(1);
+}
+
+MMAL_STATUS_T mmal_component_release(MMAL_COMPONENT_T *component) {
+    if (!component) {
+        return MMAL_EINVAL;
+    }
+    if (component->priv->refcount.fetch_sub(1) == 1) {
+        mmal_component_disable(component);
+        std::lock_guard< std::recursive_mutex > guard(graph_lock());
+        component_free(component);
+    }
+    return MMAL_SUCCESS;
+}
+
+MMAL_STATUS_T mmal_component_destroy(MMAL_COMPONENT_T *component) {
+    if (!component) {
+        return MMAL_EINVAL;
+    }
+    if (component->priv->destroy_requested) {
+        return MMAL_EINVAL;
+    }
+    component->priv->destroy_requested = true;
+    return mmal_component_release(component);
+}
+
+MMAL_STATUS_T mmal_component_enable(MMAL_COMPONENT_T *component) {
+    if (!component) {
+        return MMAL_EINVAL;
+    }
+    std::lock_guard< std::recursive_mutex > guard(graph_lock());
+    if (component->is_enabled) {
+        return MMAL_SUCCESS;
+    }
+    component->is_enabled = 1;
+    MMAL_STATUS_T status = component->priv->module->enable();
+    if (status != MMAL_SUCCESS) {
+        component->is_enabled = 0;
+    }
+    return status;
+}
+
+MMAL_STATUS_T mmal_component_disable(MMAL_COMPONENT_T *component) {
+    if (!component) {
+        return MMAL_EINVAL;
+    }
+    {
+        std::lock_guard< std::recursive_mutex > guard(graph_lock());
+        if (!component->is_enabled) {
+            return MMAL_SUCCESS;
+        }
+        component->is_enabled = 0;
+    }
+    component->priv->module->disable();
+    return MMAL_SUCCESS;
+}
+
+int64_t mmal_emu_time_us(void) {
+    return (int64_t)vcos_getmicrosecs64();
+}
+
+void mmal_emu_set_unthrottled(MMAL_BOOL_T value) {
+    unthrottled_flag.store(value != MMAL_FALSE, std::memory_order_relaxed);
+}
+
+}
@@ -0,0 +1,134 @@
+/**
+ \file mmal_emu_private.h
+ \brief Internals shared by the translation units of the host-side MMAL stand-in.
+ */
+
+#ifndef __MMAL_EMU_PRIVATE_H__
+#define __MMAL_EMU_PRIVATE_H__
+
+#include <atomic>
+#include <map>
+#include <mutex>
+#include <set>
+#include <string>
+#include <vector>
+
+#include "interface/mmal/mmal.h"
+#include "interface/mmal/mmal_emu.h"
+#include "interface/mmal/mmal_logging.h"
+
+struct MMAL_BUFFER_HEADER_PRIVATE_T {
+    std::atomic<int> refcount;
+    MMAL_POOL_T *pool;                          /**< Pool the header is returned to once released */
+    MMAL_BH_PRE_RELEASE_CB_T pf_pre_release;
+    void *pre_release_userdata;
+    MMAL_BUFFER_HEADER_T *reference;            /**< Header whose payload is shared after mmal_buffer_header_replicate */
+    uint8_t *payload;                           /**< Payload owned by the header */
+    uint32_t payload_size;
+};
+
+struct MMAL_PORT_PRIVATE_T {
+    std::string name;
+    MMAL_PORT_BH_CB_T callback;
+    MMAL_QUEUE_T *queue;                        /**< Buffers sent to an output port by the client */
+    MMAL_PORT_T *connected;                     /**< Peer port when tunnelled */
+    std::mutex lock;                            /**< Protects parameters and change_events */
+    std::map< uint32_t, std::vector< uint8_t > > parameters;
+    std::set< uint32_t > change_events;
+    std::atomic<uint64_t> starved;
+    MMAL_POOL_T *event_pool;                    /**< Event buffers for control ports */
+    MMAL_ES_FORMAT_T *format_storage;
+};
+
+namespace mmal_emu {
+
+    class Module;
+
+    /** A payload produced by a module, before it is copied into a client buffer or handed to a peer module. */
+    struct Payload {
+        const uint8_t *data;
+        uint32_t length;
+        uint32_t flags;
+        int64_t pts;
+        int64_t dts;
+        uint32_t cmd;
+        const MMAL_ES_FORMAT_T *format;     /**< Format of the port that produced the payload */
+    };
+
+    /**
+     \brief Behaviour of an emulated component. The framework owns ports, buffers and connections; modules only
+     produce and consume payloads.
+     */
+    class Module {
+        public:
+            explicit Module(MMAL_COMPONENT_T *component_) : component(component_) {}
+            virtual ~Module() {}
+            virtual MMAL_STATUS_T enable() { return MMAL_SUCCESS; }
+            /** Called without the graph lock held so that producer threads can be joined. */
+            virtual void disable() {}
+            virtual MMAL_STATUS_T commit(MMAL_PORT_T *port);
+            /** Called after a parameter has been stored on port. */
+            virtual MMAL_STATUS_T parameter_set(MMAL_PORT_T *port, const MMAL_PARAMETER_HEADER_T *param) { return MMAL_SUCCESS; }
+            /** \return MMAL_SUCCESS if the module filled param, MMAL_ENOSYS to fall back to the stored value */
+            virtual MMAL_STATUS_T parameter_get(MMAL_PORT_T *port, MMAL_PARAMETER_HEADER_T *param) { return MMAL_ENOSYS; }
+            /** Consume a payload delivered to one of the component's input ports. Called with the graph lock held. */
+            virtual void process(MMAL_PORT_T *input, const Payload &payload) {}
+        protected:
+            MMAL_COMPONENT_T *component;
+    };
+
+    struct ModuleInfo {
+        const char *name;
+        uint32_t inputs;
+        uint32_t outputs;
+        Module *(*factory)(MMAL_COMPONENT_T *component);
+    };
+
+    const ModuleInfo *find_module(const char *name);
+
+    Module *create_camera(MMAL_COMPONENT_T *component);
+    Module *create_video_encode(MMAL_COMPONENT_T *component);
+    Module *create_splitter(MMAL_COMPONENT_T *component);
+    Module *create_resize(MMAL_COMPONENT_T *component);
+    Module *create_sink(MMAL_COMPONENT_T *component);
+
+    /** Serialises data flow and graph changes (enable, commit, connect, destroy). Recursive so callbacks may reconfigure. */
+    std::recursive_mutex &graph_lock();
+
+    Module *component_module(MMAL_COMPONENT_T *component);
+
+    /** Fill in the buffer requirements of a port from its committed format. */
+    void default_requirements(MMAL_PORT_T *port);
+    uint32_t frame_size(const MMAL_ES_FORMAT_T *format);
+    bool is_compressed(MMAL_FOURCC_T encoding);
+
+    /**
+     \brief Convert a width x height I420 frame to the raw layout of encoding. Packed RGB layouts get a grey
+     image built from luma. \return false if encoding is not a raw video layout the stand-in can produce
+     */
+    bool convert_i420(const uint8_t *i420, uint32_t width, uint32_t height, MMAL_FOURCC_T encoding, std::vector< uint8_t > &out);
+
+    /**
+     \brief Deliver a payload from an output port, either to the connected component or to a buffer the client
+     sent to the port. Compressed payloads are split across as many buffers as needed.
+     */
+    void port_emit(MMAL_PORT_T *output, const Payload &payload);
+
+    /** Deliver an event on a control port, stamped with pts. Dropped if the port is disabled or out of event buffers. */
+    void port_send_event(MMAL_PORT_T *control, uint32_t cmd, const void *data, uint32_t length, int64_t pts = MMAL_TIME_UNKNOWN);
+
+    /** \return true if the client asked for MMAL_EVENT_PARAMETER_CHANGED events about id */
+    bool port_change_event_requested(MMAL_PORT_T *control, uint32_t id);
+
+    /** Copy a stored parameter. \return false if it was never set */
+    bool port_parameter(MMAL_PORT_T *port, uint32_t id, void *value, uint32_t size);
+    MMAL_BOOL_T port_parameter_boolean(MMAL_PORT_T *port, uint32_t id, MMAL_BOOL_T fallback);
+    uint32_t port_parameter_uint32(MMAL_PORT_T *port, uint32_t id, uint32_t fallback);
+
+    MMAL_PORT_T *port_create(MMAL_COMPONENT_T *component, MMAL_PORT_TYPE_T type, uint16_t index, uint16_t index_all);
+    void port_destroy(MMAL_PORT_T *port);
+
+    bool unthrottled();
+}
+
+#endif /* __MMAL_EMU_PRIVATE_H__ */
@@ -0,0 +1,98 @@
+#include "mmal_emu_private.h"
+
+namespace {
+
+    /** A format and its video specific part are allocated together, as in MMAL. */
+    struct FormatStorage {
+        MMAL_ES_FORMAT_T format;
+        MMAL_ES_SPECIFIC_FORMAT_T es;
+    };
+
+    bool same_rational(const MMAL_RATIONAL_T &a, const MMAL_RATIONAL_T &b) {
+        return a.num == b.num && a.den == b.den;
+    }
+
+}
+
+extern "C" {
+
+MMAL_ES_FORMAT_T *mmal_format_alloc(void) {
+    FormatStorage *storage = new FormatStorage();
+    storage->format.es = &storage->es;
+    return &storage->format;
+}
+
+void mmal_format_free(MMAL_ES_FORMAT_T *format) {
+    if (!format) {
+        return;
+    }
+    free(format->extradata);
+    delete reinterpret_cast< FormatStorage * >(format);
+}
+
+void mmal_format_copy(MMAL_ES_FORMAT_T *dst, MMAL_ES_FORMAT_T *src) {
+    MMAL_ES_SPECIFIC_FORMAT_T *es = dst->es;
+    uint32_t extradata_size = dst->extradata_size;
+    uint8_t *extradata = dst->extradata;
+    *dst = *src;
+    dst->es = es;
+    *dst->es = *src->es;
+    dst->extradata_size = extradata_size;
+    dst->extradata = extradata;
+}
+
+MMAL_STATUS_T mmal_format_full_copy(MMAL_ES_FORMAT_T *dst, MMAL_ES_FORMAT_T *src) {
+    mmal_format_copy(dst, src);
+    free(dst->extradata);
+    dst->extradata = NULL;
+    dst->extradata_size = 0;
+    if (src->extradata_size) {
+        dst->extradata = (uint8_t *)malloc(src->extradata_size);
+        if (!dst->extradata) {
+            return MMAL_ENOMEM;
+        }
+        memcpy(dst->extradata, src->extradata, src->extradata_size);
+        dst->extradata_size = src->extradata_size;
+    }
+    return MMAL_SUCCESS;
+}
+
+uint32_t mmal_format_compare(MMAL_ES_FORMAT_T *format_1, MMAL_ES_FORMAT_T *format_2) {
+    uint32_t result = 0;
+    if (format_1->type != format_2->type) {
+        result |= MMAL_ES_FORMAT_COMPARE_FLAG_TYPE;
+    }
+    if (format_1->encoding != format_2->encoding || format_1->encoding_variant != format_2->encoding_variant) {
+        result |= MMAL_ES_FORMAT_COMPARE_FLAG_ENCODING;
+    }
+    if (format_1->bitrate != format_2->bitrate) {
+        result |= MMAL_ES_FORMAT_COMPARE_FLAG_BITRATE;
+    }
+    if (format_1->flags != format_2->flags) {
+        result |= MMAL_ES_FORMAT_COMPARE_FLAG_FLAGS;
+    }
+    if (format_1->extradata_size != format_2->extradata_size ||
+            (format_1->extradata_size && memcmp(format_1->extradata, format_2->extradata, format_1->extradata_size))) {
+        result |= MMAL_ES_FORMAT_COMPARE_FLAG_EXTRADATA;
+    }
+    const MMAL_VIDEO_FORMAT_T &v1 = format_1->es->video;
+    const MMAL_VIDEO_FORMAT_T &v2 = format_2->es->video;
+    if (v1.width != v2.width || v1.height != v2.height) {
+        result |= MMAL_ES_FORMAT_COMPARE_FLAG_VIDEO_RESOLUTION;
+    }
+    if (memcmp(&v1.crop, &v2.crop, sizeof(v1.crop))) {
+        result |= MMAL_ES_FORMAT_COMPARE_FLAG_VIDEO_CROPPING;
+    }
+    if (!same_rational(v1.frame_rate, v2.frame_rate)) {
+        result |= MMAL_ES_FORMAT_COMPARE_FLAG_VIDEO_FRAME_RATE;
+    }
+    if (!same_rational(v1.par, v2.par)) {
+        result |= MMAL_ES_FORMAT_COMPARE_FLAG_VIDEO_ASPECT_RATIO;
+    }
+    if (v1.color_space != v2.color_space) {
+        result |= MMAL_ES_FORMAT_COMPARE_FLAG_VIDEO_COLOR_SPACE;
+    }
+    return result;
+}
+
+}
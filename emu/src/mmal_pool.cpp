@@ -0,0 +1,125 @@
+#include "mmal_emu_private.h"
+
+namespace {
+
+    /** The public MMAL_POOL_T is the first member so pool pointers can be converted back. */
+    struct PoolPrivate {
+        MMAL_POOL_T pool;
+        MMAL_POOL_BH_CB_T cb;
+        void *cb_userdata;
+        MMAL_BH_PRE_RELEASE_CB_T pre_release_cb;
+        void *pre_release_userdata;
+    };
+
+    PoolPrivate *pool_private(MMAL_POOL_T *pool) {
+        return reinterpret_cast< PoolPrivate * >(pool);
+    }
+
+    void free_headers(MMAL_POOL_T *pool) {
+        for (uint32_t i = 0; i < pool->headers_num; i++) {
+            MMAL_BUFFER_HEADER_T *header = pool->header[i];
+            free(header->priv->payload);
+            delete header->priv;
+            delete header;
+        }
+        delete[] pool->header;
+        pool->header = NULL;
+        pool->headers_num = 0;
+    }
+
+    bool alloc_headers(MMAL_POOL_T *pool, unsigned int headers, uint32_t payload_size) {
+        PoolPrivate *priv = pool_private(pool);
+        pool->header = new MMAL_BUFFER_HEADER_T*[headers ? headers : 1];
+        pool->headers_num = 0;
+        for (unsigned int i = 0; i < headers; i++) {
+            uint8_t *payload = NULL;
+            if (payload_size) {
+                void *memory = NULL;
+                if (posix_memalign(&memory, 64, payload_size) != 0) {
+                    return false;
+                }
+                payload = (uint8_t *)memory;
+            }
+            MMAL_BUFFER_HEADER_T *header = new MMAL_BUFFER_HEADER_T();
+            header->priv = new MMAL_BUFFER_HEADER_PRIVATE_T();
+            header->priv->refcount.store(1);
+            header->priv->pool = pool;
+            header->priv->pf_pre_release = priv->pre_release_cb;
+            header->priv->pre_release_userdata = priv->pre_release_userdata;
+            header->priv->reference = NULL;
+            header->priv->payload = payload;
+            header->priv->payload_size = payload_size;
+            header->data = payload;
+            header->alloc_size = payload_size;
+            mmal_buffer_header_reset(header);
+            pool->header[pool->headers_num++] = header;
+            mmal_queue_put(pool->queue, header);
+        }
+        return true;
+    }
+
+}
+
+namespace mmal_emu {
+
+    void pool_release(MMAL_POOL_T *pool, MMAL_BUFFER_HEADER_T *header) {
+        PoolPrivate *priv = pool_private(pool);
+        if (!priv->cb || priv->cb(pool, header, priv->cb_userdata)) {
+            mmal_queue_put(pool->queue, header);
+        }
+    }
+
+}
+
+extern "C" {
+
+MMAL_POOL_T *mmal_pool_create(unsigned int headers, uint32_t payload_size) {
+    PoolPrivate *priv = new PoolPrivate();
+    MMAL_POOL_T *pool = &priv->pool;
+    pool->queue = mmal_queue_create();
+    if (!alloc_headers(pool, headers, payload_size)) {
+        LOG_ERROR("mmal_pool_create: could not allocate %u payloads of %u bytes", headers, payload_size);
+        mmal_pool_destroy(pool);
+        return NULL;
+    }
+    return pool;
+}
+
+void mmal_pool_destroy(MMAL_POOL_T *pool) {
+    if (!pool) {
+        return;
+    }
+    free_headers(pool);
+    mmal_queue_destroy(pool->queue);
+    delete pool_private(pool);
+}
+
+MMAL_STATUS_T mmal_pool_resize(MMAL_POOL_T *pool, unsigned int headers, uint32_t payload_size) {
+    if (!pool || mmal_queue_length(pool->queue) != pool->headers_num) {
+        return MMAL_EINVAL;
+    }
+    while (mmal_queue_get(pool->queue)) {
+    }
+    free_headers(pool);
+    if (!alloc_headers(pool, headers, payload_size)) {
+        return MMAL_ENOMEM;
+    }
+    return MMAL_SUCCESS;
+}
+
+void mmal_pool_callback_set(MMAL_POOL_T *pool, MMAL_POOL_BH_CB_T cb, void *userdata) {
+    PoolPrivate *priv = pool_private(pool);
+    priv->cb = cb;
+    priv->cb_userdata = userdata;
+}
+
+void mmal_pool_pre_release_callback_set(MMAL_POOL_T *pool, MMAL_BH_PRE_RELEASE_CB_T cb, void *userdata) {
+    PoolPrivate *priv = pool_private(pool);
+    priv->pre_release_cb = cb;
+    priv->pre_release_userdata = userdata;
+    for (uint32_t i = 0; i < pool->headers_num; i++) {
+        mmal_buffer_header_pre_release_cb_set(pool->header[i], cb, userdata);
+    }
+}
+
+}
@@ -0,0 +1,450 @@
+#include <stdio.h>
+
+#include "mmal_emu_private.h"
+
+namespace mmal_emu {
+
+    static const uint32_t EVENT_BUFFERS_NUM = 4;
+    static const uint32_t EVENT_BUFFER_SIZE = 256;
+    static const uint32_t COMPRESSED_BUFFER_SIZE_MIN = 2048;
+    static const uint32_t COMPRESSED_BUFFER_SIZE_RECOMMENDED = 65536;
+    static const uint32_t OPAQUE_BUFFER_SIZE = 128;
+
+    std::recursive_mutex &graph_lock() {
+        static std::recursive_mutex lock;
+        return lock;
+    }
+
+    bool is_compressed(MMAL_FOURCC_T encoding) {
+        switch (encoding) {
+            case MMAL_ENCODING_H264:
+            case MMAL_ENCODING_MVC:
+            case MMAL_ENCODING_H263:
+            case MMAL_ENCODING_MP4V:
+            case MMAL_ENCODING_MP2V:
+            case MMAL_ENCODING_MP1V:
+            case MMAL_ENCODING_MJPEG:
+            case MMAL_ENCODING_JPEG:
+            case MMAL_ENCODING_GIF:
+            case MMAL_ENCODING_PNG:
+            case MMAL_ENCODING_BMP:
+                return true;
+            default:
+                return false;
+        }
+    }
+
+    uint32_t frame_size(const MMAL_ES_FORMAT_T *format) {
+        uint32_t width = VCOS_ALIGN_UP(format->es->video.width, 32);
+        uint32_t height = VCOS_ALIGN_UP(format->es->video.height, 16);
+        switch (format->encoding) {
+            case MMAL_ENCODING_I420:
+            case MMAL_ENCODING_I420_SLICE:
+            case MMAL_ENCODING_YV12:
+            case MMAL_ENCODING_NV12:
+            case MMAL_ENCODING_NV21:
+                return width * height * 3 / 2;
+            case MMAL_ENCODING_I422:
+            case MMAL_ENCODING_YUYV:
+            case MMAL_ENCODING_RGB16:
+            case MMAL_ENCODING_BGR16:
+                return width * height * 2;
+            case MMAL_ENCODING_RGB24:
+            case MMAL_ENCODING_BGR24:
+                return width * height * 3;
+            case MMAL_ENCODING_ARGB:
+            case MMAL_ENCODING_RGBA:
+            case MMAL_ENCODING_ABGR:
+            case MMAL_ENCODING_BGRA:
+            case MMAL_ENCODING_RGB32:
+            case MMAL_ENCODING_BGR32:
+                return width * height * 4;
+            case MMAL_ENCODING_OPAQUE:
+                return OPAQUE_BUFFER_SIZE;
+            default:
+                return COMPRESSED_BUFFER_SIZE_RECOMMENDED;
+        }
+    }
+
+    void default_requirements(MMAL_PORT_T *port) {
+        if (port->type == MMAL_PORT_TYPE_CONTROL) {
+            return;
+        }
+        if (is_compressed(port->format->encoding)) {
+            port->buffer_size_min = COMPRESSED_BUFFER_SIZE_MIN;
+            port->buffer_size_recommended = COMPRESSED_BUFFER_SIZE_RECOMMENDED;
+        } else {
+            port->buffer_size_min = port->buffer_size_recommended = frame_size(port->format);
+        }
+        port->buffer_num_min = 1;
+        port->buffer_num_recommended = 3;
+        if (port->buffer_num < port->buffer_num_min) {
+            port->buffer_num = port->buffer_num_recommended;
+        }
+        if (port->buffer_size < port->buffer_size_min) {
+            port->buffer_size = port->buffer_size_recommended;
+        }
+    }
+
+    MMAL_STATUS_T Module::commit(MMAL_PORT_T *port) {
+        default_requirements(port);
+        return MMAL_SUCCESS;
+    }
+
+    MMAL_PORT_T *port_create(MMAL_COMPONENT_T *component, MMAL_PORT_TYPE_T type, uint16_t index, uint16_t index_all) {
+        MMAL_PORT_T *port = new MMAL_PORT_T();
+        port->priv = new MMAL_PORT_PRIVATE_T();
+        port->priv->callback = NULL;
+        port->priv->queue = mmal_queue_create();
+        port->priv->connected = NULL;
+        port->priv->starved.store(0);
+        port->priv->event_pool = NULL;
+        port->priv->format_storage = mmal_format_alloc();
+
+        const char *kind = type == MMAL_PORT_TYPE_CONTROL ? "ctr" : type == MMAL_PORT_TYPE_INPUT ? "in" : "out";
+        char name[128];
+        snprintf(name, sizeof(name), "%s:%s:%u", component->name, kind, (unsigned)index);
+        port->priv->name = name;
+
+        port->name = port->priv->name.c_str();
+        port->type = type;
+        port->index = index;
+        port->index_all = index_all;
+        port->component = component;
+        port->format = port->priv->format_storage;
+        port->capabilities = MMAL_PORT_CAPABILITY_SUPPORTS_EVENT_FORMAT_CHANGE;
+
+        MMAL_ES_FORMAT_T *format = port->format;
+        if (type == MMAL_PORT_TYPE_CONTROL) {
+            format->type = MMAL_ES_TYPE_CONTROL;
+        } else {
+            format->type = MMAL_ES_TYPE_VIDEO;
+            format->encoding = MMAL_ENCODING_I420;
+            format->es->video.width = 1920;
+            format->es->video.height = 1088;
+            format->es->video.crop.width = 1920;
+            format->es->video.crop.height = 1080;
+            format->es->video.frame_rate.num = 0;
+            format->es->video.frame_rate.den = 1;
+            format->es->video.par.num = 1;
+            format->es->video.par.den = 1;
+            default_requirements(port);
+        }
+        return port;
+    }
+
+    void port_destroy(MMAL_PORT_T *port) {
+        if (!port) {
+            return;
+        }
+        if (port->priv->event_pool) {
+            mmal_pool_destroy(port->priv->event_pool);
+        }
+        mmal_queue_destroy(port->priv->queue);
+        mmal_format_free(port->priv->format_storage);
+        delete port->priv;
+        delete port;
+    }
+
+    bool port_parameter(MMAL_PORT_T *port, uint32_t id, void *value, uint32_t size) {
+        std::lock_guard< std::mutex > guard(port->priv->lock);
+        std::map< uint32_t, std::vector< uint8_t > >::const_iterator it = port->priv->parameters.find(id);
+        if (it == port->priv->parameters.end()) {
+            return false;
+        }
+        memset(value, 0, size);
+        memcpy(value, it->second.data(), vcos_min((size_t)size, it->second.size()));
+        return true;
+    }
+
+    MMAL_BOOL_T port_parameter_boolean(MMAL_PORT_T *port, uint32_t id, MMAL_BOOL_T fallback) {
+        MMAL_PARAMETER_BOOLEAN_T param;
+        return port_parameter(port, id, &param, sizeof(param)) ? param.enable : fallback;
+    }
+
+    uint32_t port_parameter_uint32(MMAL_PORT_T *port, uint32_t id, uint32_t fallback) {
+        MMAL_PARAMETER_UINT32_T param;
+        return port_parameter(port, id, &param, sizeof(param)) ? param.value : fallback;
+    }
+
+    bool port_change_event_requested(MMAL_PORT_T *control, uint32_t id) {
+        std::lock_guard< std::mutex > guard(control->priv->lock);
+        return control->priv->change_events.count(id) != 0;
+    }
+
+    void port_emit(MMAL_PORT_T *output, const Payload &payload) {
+        if (!output->is_enabled) {
+            return;
+        }
+        MMAL_PORT_T *peer = output->priv->connected;
+        if (peer) {
+            if (peer->is_enabled) {
+                component_module(peer->component)->process(peer, payload);
+            }
+            return;
+        }
+        MMAL_PORT_BH_CB_T callback = output->priv->callback;
+        if (!callback) {
+            return;
+        }
+
+        const bool fragment = payload.cmd == 0 && is_compressed(output->format->encoding);
+        uint32_t offset = 0;
+        do {
+            MMAL_BUFFER_HEADER_T *buffer = mmal_queue_get(output->priv->queue);
+            if (!buffer) {
+                output->priv->starved.fetch_add(1, std::memory_order_relaxed);
+                return;
+            }
+            uint32_t chunk = vcos_min(payload.length - offset, buffer->alloc_size);
+            if (chunk) {
+                memcpy(buffer->data, payload.data + offset, chunk);
+            }
+            offset += chunk;
+            buffer->cmd = payload.cmd;
+            buffer->offset = 0;
+            buffer->length = chunk;
+            buffer->pts = payload.pts;
+            buffer->dts = payload.dts;
+            buffer->flags = payload.flags;
+            if (fragment && offset < payload.length) {
+                buffer->flags &= ~MMAL_BUFFER_HEADER_FLAG_FRAME_END;
+            }
+            callback(output, buffer);
+        } while (fragment && offset < payload.length);
+    }
+
+    void port_send_event(MMAL_PORT_T *control, uint32_t cmd, const void *data, uint32_t length, int64_t pts) {
+        if (!control->is_enabled || !control->priv->callback || !control->priv->event_pool) {
+            return;
+        }
+        MMAL_BUFFER_HEADER_T *buffer = mmal_queue_get(control->priv->event_pool->queue);
+        if (!buffer) {
+            control->priv->starved.fetch_add(1, std::memory_order_relaxed);
+            return;
+        }
+        buffer->cmd = cmd;
+        buffer->pts = pts;
+        buffer->length = vcos_min(length, buffer->alloc_size);
+        memcpy(buffer->data, data, buffer->length);
+        control->priv->callback(control, buffer);
+    }
+
+    static void port_return_buffers(MMAL_PORT_T *port) {
+        MMAL_BUFFER_HEADER_T *buffer;
+        while ((buffer = mmal_queue_get(port->priv->queue)) != NULL) {
+            buffer->length = 0;
+            if (port->priv->callback) {
+                port->priv->callback(port, buffer);
+            } else {
+                mmal_buffer_header_release(buffer);
+            }
+        }
+    }
+
+}
+
+using namespace mmal_emu;
+
+extern "C" {
+
+MMAL_STATUS_T mmal_port_format_commit(MMAL_PORT_T *port) {
+    if (!port || port->type == MMAL_PORT_TYPE_CONTROL) {
+        return MMAL_EINVAL;
+    }
+    std::lock_guard< std::recursive_mutex > guard(graph_lock());
+    if (port->is_enabled) {
+        LOG_ERROR("mmal_port_format_commit: port %s is enabled", port->name);
+        return MMAL_EINVAL;
+    }
+    return component_module(port->component)->commit(port);
+}
+
+MMAL_STATUS_T mmal_port_enable(MMAL_PORT_T *port, MMAL_PORT_BH_CB_T cb) {
+    if (!port) {
+        return MMAL_EINVAL;
+    }
+    std::lock_guard< std::recursive_mutex > guard(graph_lock());
+    if (port->is_enabled) {
+        LOG_ERROR("mmal_port_enable: port %s is already enabled", port->name);
+        return MMAL_EINVAL;
+    }
+    if (port->type == MMAL_PORT_TYPE_CONTROL) {
+        if (!cb) {
+            return MMAL_EINVAL;
+        }
+        if (!port->priv->event_pool) {
+            port->priv->event_pool = mmal_pool_create(EVENT_BUFFERS_NUM, EVENT_BUFFER_SIZE);
+        }
+    } else if (!port->priv->connected) {
+        if (!cb) {
+            return MMAL_EINVAL;
+        }
+        if (port->buffer_num < port->buffer_num_min || port->buffer_size < port->buffer_size_min) {
+            LOG_ERROR("mmal_port_enable: buffer requirements of %s not met (%u x %u, need %u x %u)", port->name,
+                port->buffer_num, port->buffer_size, port->buffer_num_min, port->buffer_size_min);
+            return MMAL_EINVAL;
+        }
+    }
+    port->priv->callback = cb;
+    port->is_enabled = 1;
+    return MMAL_SUCCESS;
+}
+
+MMAL_STATUS_T mmal_port_disable(MMAL_PORT_T *port) {
+    if (!port) {
+        return MMAL_EINVAL;
+    }
+    std::lock_guard< std::recursive_mutex > guard(graph_lock());
+    if (!port->is_enabled) {
+        return MMAL_EINVAL;
+    }
+    port->is_enabled = 0;
+    port_return_buffers(port);
+    port->priv->callback = NULL;
+    return MMAL_SUCCESS;
+}
+
+MMAL_STATUS_T mmal_port_flush(MMAL_PORT_T *port) {
+    if (!port) {
+        return MMAL_EINVAL;
+    }
+    std::lock_guard< std::recursive_mutex > guard(graph_lock());
+    port_return_buffers(port);
+    return MMAL_SUCCESS;
+}
+
+MMAL_STATUS_T mmal_port_parameter_set(MMAL_PORT_T *port, const MMAL_PARAMETER_HEADER_T *param) {
+    if (!port || !param || param->size < sizeof(MMAL_PARAMETER_HEADER_T)) {
+        return MMAL_EINVAL;
+    }
+    {
+        std::lock_guard< std::mutex > guard(port->priv->lock);
+        const uint8_t *bytes = reinterpret_cast< const uint8_t * >(param);
+        port->priv->parameters[param->id].assign(bytes, bytes + param->size);
+        if (param->id == MMAL_PARAMETER_CHANGE_EVENT_REQUEST) {
+            if (param->size < sizeof(MMAL_PARAMETER_CHANGE_EVENT_REQUEST_T)) {
+                return MMAL_EINVAL;
+            }
+            const MMAL_PARAMETER_CHANGE_EVENT_REQUEST_T *request = reinterpret_cast< const MMAL_PARAMETER_CHANGE_EVENT_REQUEST_T * >(param);
+            if (request->enable) {
+                port->priv->change_events.insert(request->change_id);
+            } else {
+                port->priv->change_events.erase(request->change_id);
+            }
+        }
+    }
+    return component_module(port->component)->parameter_set(port, param);
+}
+
+MMAL_STATUS_T mmal_port_parameter_get(MMAL_PORT_T *port, MMAL_PARAMETER_HEADER_T *param) {
+    if (!port || !param || param->size < sizeof(MMAL_PARAMETER_HEADER_T)) {
+        return MMAL_EINVAL;
+    }
+    MMAL_STATUS_T status = component_module(port->component)->parameter_get(port, param);
+    if (status != MMAL_ENOSYS) {
+        return status;
+    }
+    std::lock_guard< std::mutex > guard(port->priv->lock);
+    std::map< uint32_t, std::vector< uint8_t > >::const_iterator it = port->priv->parameters.find(param->id);
+    if (it == port->priv->parameters.end()) {
+        return MMAL_ENOSYS;
+    }
+    if (it->second.size() > param->size) {
+        param->size = it->second.size();
+        return MMAL_ENOSPC;
+    }
+    memcpy(param, it->second.data(), it->second.size());
+    return MMAL_SUCCESS;
+}
+
+MMAL_STATUS_T mmal_port_send_buffer(MMAL_PORT_T *port, MMAL_BUFFER_HEADER_T *buffer) {
+    if (!port || !buffer) {
+        return MMAL_EINVAL;
+    }
+    if (!port->is_enabled) {
+        LOG_ERROR("mmal_port_send_buffer: port %s is not enabled", port->name);
+        return MMAL_EINVAL;
+    }
+    if (port->type != MMAL_PORT_TYPE_INPUT) {
+        mmal_queue_put(port->priv->queue, buffer);
+        return MMAL_SUCCESS;
+    }
+
+    std::lock_guard< std::recursive_mutex > guard(graph_lock());
+    {
+        Payload payload;
+        payload.data = buffer->data + buffer->offset;
+        payload.length = buffer->length;
+        payload.flags = buffer->flags;
+        payload.pts = buffer->pts;
+        payload.dts = buffer->dts;
+        payload.cmd = buffer->cmd;
+        payload.format = port->format;
+        component_module(port->component)->process(port, payload);
+    }
+    buffer->length = 0;
+    if (port->priv->callback) {
+        port->priv->callback(port, buffer);
+    } else {
+        mmal_buffer_header_release(buffer);
+    }
+    return MMAL_SUCCESS;
+}
+
+MMAL_STATUS_T mmal_port_connect(MMAL_PORT_T *port, MMAL_PORT_T *other_port) {
+    if (!port || !other_port) {
+        return MMAL_EINVAL;
+    }
+    std::lock_guard< std::recursive_mutex > guard(graph_lock());
+    if (port->priv->connected || other_port->priv->connected) {
+        return MMAL_EISCONN;
+    }
+    MMAL_PORT_T *output = port->type == MMAL_PORT_TYPE_OUTPUT ? port : other_port;
+    MMAL_PORT_T *input = output == port ? other_port : port;
+    if (output->type != MMAL_PORT_TYPE_OUTPUT || input->type != MMAL_PORT_TYPE_INPUT) {
+        LOG_ERROR("mmal_port_connect: %s and %s are not an output/input pair", port->name, other_port->name);
+        return MMAL_EINVAL;
+    }
+    output->priv->connected = input;
+    input->priv->connected = output;
+    return MMAL_SUCCESS;
+}
+
+MMAL_STATUS_T mmal_port_disconnect(MMAL_PORT_T *port) {
+    if (!port) {
+        return MMAL_EINVAL;
+    }
+    std::lock_guard< std::recursive_mutex > guard(graph_lock());
+    MMAL_PORT_T *peer = port->priv->connected;
+    if (!peer) {
+        return MMAL_ENOTCONN;
+    }
+    if (port->is_enabled) {
+        mmal_port_disable(port);
+    }
+    if (peer->is_enabled) {
+        mmal_port_disable(peer);
+    }
+    port->priv->connected = NULL;
+    peer->priv->connected = NULL;
+    return MMAL_SUCCESS;
+}
+
+uint8_t *mmal_port_payload_alloc(MMAL_PORT_T *port, uint32_t payload_size) {
+    void *memory = NULL;
+    if (posix_memalign(&memory, 64, payload_size ? payload_size : 1) != 0) {
+        return NULL;
+    }
+    return (uint8_t *)memory;
+}
+
+void mmal_port_payload_free(MMAL_PORT_T *port, uint8_t *payload) {
+    free(payload);
+}
+
+uint64_t mmal_emu_port_starved_count(MMAL_PORT_T *port) {
+    return port ? port->priv->starved.load(std::memory_order_relaxed) : 0;
+}
+
+}
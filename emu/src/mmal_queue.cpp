@@ -0,0 +1,107 @@
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+
+#include "mmal_emu_private.h"
+
+struct MMAL_QUEUE_T {
+    std::mutex lock;
+    std::condition_variable available;
+    MMAL_BUFFER_HEADER_T *first;
+    MMAL_BUFFER_HEADER_T **last;
+    unsigned int length;
+};
+
+extern "C" {
+
+MMAL_QUEUE_T *mmal_queue_create(void) {
+    MMAL_QUEUE_T *queue = new MMAL_QUEUE_T;
+    queue->first = NULL;
+    queue->last = &queue->first;
+    queue->length = 0;
+    return queue;
+}
+
+void mmal_queue_put(MMAL_QUEUE_T *queue, MMAL_BUFFER_HEADER_T *buffer) {
+    if (!queue || !buffer) {
+        return;
+    }
+    {
+        std::lock_guard< std::mutex > guard(queue->lock);
+        buffer->next = NULL;
+        *queue->last = buffer;
+        queue->last = &buffer->next;
+        queue->length++;
+    }
+    queue->available.notify_one();
+}
+
+void mmal_queue_put_back(MMAL_QUEUE_T *queue, MMAL_BUFFER_HEADER_T *buffer) {
+    if (!queue || !buffer) {
+        return;
+    }
+    {
+        std::lock_guard< std::mutex > guard(queue->lock);
+        buffer->next = queue->first;
+        queue->first = buffer;
+        if (queue->last == &queue->first) {
+            queue->last = &buffer->next;
+        }
+        queue->length++;
+    }
+    queue->available.notify_one();
+}
+
+static MMAL_BUFFER_HEADER_T *queue_pop(MMAL_QUEUE_T *queue) {
+    MMAL_BUFFER_HEADER_T *buffer = queue->first;
+    if (!buffer) {
+        return NULL;
+    }
+    queue->first = buffer->next;
+    if (!queue->first) {
+        queue->last = &queue->first;
+    }
+    queue->length--;
+    buffer->next = NULL;
+    return buffer;
+}
+
+MMAL_BUFFER_HEADER_T *mmal_queue_get(MMAL_QUEUE_T *queue) {
+    if (!queue) {
+        return NULL;
+    }
+    std::lock_guard< std::mutex > guard(queue->lock);
+    return queue_pop(queue);
+}
+
+MMAL_BUFFER_HEADER_T *mmal_queue_wait(MMAL_QUEUE_T *queue) {
+    if (!queue) {
+        return NULL;
+    }
+    std::unique_lock< std::mutex > guard(queue->lock);
+    queue->available.wait(guard, [queue] { return queue->first != NULL; });
+    return queue_pop(queue);
+}
+
+MMAL_BUFFER_HEADER_T *mmal_queue_timedwait(MMAL_QUEUE_T *queue, uint32_t timeout) {
+    if (!queue) {
+        return NULL;
+    }
+    std::unique_lock< std::mutex > guard(queue->lock);
+    queue->available.wait_for(guard, std::chrono::milliseconds(timeout), [queue] { return queue->first != NULL; });
+    return queue_pop(queue);
+}
+
+unsigned int mmal_queue_length(MMAL_QUEUE_T *queue) {
+    if (!queue) {
+        return 0;
+    }
+    std::lock_guard< std::mutex > guard(queue->lock);
+    return queue->length;
+}
+
+void mmal_queue_destroy(MMAL_QUEUE_T *queue) {
+    delete queue;
+}
+
+}
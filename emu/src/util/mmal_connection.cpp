@@ -0,0 +1,124 @@
+#include "mmal_emu_private.h"
+#include "interface/mmal/util/mmal_connection.h"
+
+namespace {
+
+    struct ConnectionPrivate {
+        MMAL_CONNECTION_T connection;
+        std::atomic<int> refcount;
+        std::string name;
+    };
+
+    ConnectionPrivate *connection_private(MMAL_CONNECTION_T *connection) {
+        return reinterpret_cast< ConnectionPrivate * >(connection);
+    }
+
+}
+
+using namespace mmal_emu;
+
+extern "C" {
+
+MMAL_STATUS_T mmal_connection_create(MMAL_CONNECTION_T **connection, MMAL_PORT_T *out, MMAL_PORT_T *in, uint32_t flags) {
+    if (!connection || !out || !in) {
+        return MMAL_EINVAL;
+    }
+    int64_t start = mmal_emu_time_us();
+    std::lock_guard< std::recursive_mutex > guard(graph_lock());
+    if (out->is_enabled || in->is_enabled) {
+        LOG_ERROR("mmal_connection_create: ports %s and %s must be disabled", out->name, in->name);
+        return MMAL_EINVAL;
+    }
+    MMAL_STATUS_T status = mmal_port_connect(out, in);
+    if (status != MMAL_SUCCESS) {
+        return status;
+    }
+
+    ConnectionPrivate *priv = new ConnectionPrivate();
+    priv->refcount.store(1);
+    priv->name = std::string(out->name) + "/" + in->name;
+    MMAL_CONNECTION_T *result = &priv->connection;
+    result->flags = flags;
+    result->out = out;
+    result->in = in;
+    result->name = priv->name.c_str();
+    mmal_component_acquire(out->component);
+    mmal_component_acquire(in->component);
+    result->time_setup = mmal_emu_time_us() - start;
+    *connection = result;
+    return MMAL_SUCCESS;
+}
+
+void mmal_connection_acquire(MMAL_CONNECTION_T *connection) {
+    connection_private(connection)->refcount.fetch_add(1);
+}
+
+MMAL_STATUS_T mmal_connection_release(MMAL_CONNECTION_T *connection) {
+    if (!connection) {
+        return MMAL_EINVAL;
+    }
+    if (connection_private(connection)->refcount.fetch_sub(1) != 1) {
+        return MMAL_SUCCESS;
+    }
+    MMAL_COMPONENT_T *out_component = connection->out->component;
+    MMAL_COMPONENT_T *in_component = connection->in->component;
+    {
+        std::lock_guard< std::recursive_mutex > guard(graph_lock());
+        if (connection->is_enabled) {
+            mmal_connection_disable(connection);
+        }
+        mmal_port_disconnect(connection->out);
+    }
+    delete connection_private(connection);
+    mmal_component_release(out_component);
+    mmal_component_release(in_component);
+    return MMAL_SUCCESS;
+}
+
+MMAL_STATUS_T mmal_connection_destroy(MMAL_CONNECTION_T *connection) {
+    return mmal_connection_release(connection);
+}
+
+MMAL_STATUS_T mmal_connection_enable(MMAL_CONNECTION_T *connection) {
+    if (!connection) {
+        return MMAL_EINVAL;
+    }
+    int64_t start = mmal_emu_time_us();
+    std::lock_guard< std::recursive_mutex > guard(graph_lock());
+    if (connection->is_enabled) {
+        return MMAL_SUCCESS;
+    }
+    MMAL_STATUS_T status;
+    if ((status = mmal_port_enable(connection->in, NULL)) != MMAL_SUCCESS) {
+        return status;
+    }
+    if ((status = mmal_port_enable(connection->out, NULL)) != MMAL_SUCCESS) {
+        mmal_port_disable(connection->in);
+        return status;
+    }
+    connection->is_enabled = 1;
+    connection->time_enable = mmal_emu_time_us() - start;
+    return MMAL_SUCCESS;
+}
+
+MMAL_STATUS_T mmal_connection_disable(MMAL_CONNECTION_T *connection) {
+    if (!connection) {
+        return MMAL_EINVAL;
+    }
+    int64_t start = mmal_emu_time_us();
+    std::lock_guard< std::recursive_mutex > guard(graph_lock());
+    if (!connection->is_enabled) {
+        return MMAL_SUCCESS;
+    }
+    if (connection->out->is_enabled) {
+        mmal_port_disable(connection->out);
+    }
+    if (connection->in->is_enabled) {
+        mmal_port_disable(connection->in);
+    }
+    connection->is_enabled = 0;
+    connection->time_disable = mmal_emu_time_us() - start;
+    return MMAL_SUCCESS;
+}
+
+}
@@ -0,0 +1,100 @@
+#include <stdio.h>
+
+#include "mmal_emu_private.h"
+#include "interface/mmal/util/mmal_util.h"
+
+extern "C" {
+
+const char *mmal_status_to_string(MMAL_STATUS_T status) {
+    static const char *names[] = {
+        "SUCCESS", "ENOMEM", "ENOSPC", "EINVAL", "ENOSYS", "ENOENT", "ENXIO", "EIO", "ESPIPE",
+        "ECORRUPT", "ENOTREADY", "ECONFIG", "EISCONN", "ENOTCONN", "EAGAIN", "EFAULT"
+    };
+    if ((uint32_t)status < vcos_countof(names)) {
+        return names[status];
+    }
+    return "UNKNOWN";
+}
+
+const char *mmal_port_type_to_string(MMAL_PORT_TYPE_T type) {
+    switch (type) {
+        case MMAL_PORT_TYPE_CONTROL: return "ctr";
+        case MMAL_PORT_TYPE_INPUT: return "in";
+        case MMAL_PORT_TYPE_OUTPUT: return "out";
+        case MMAL_PORT_TYPE_CLOCK: return "clk";
+        default: return "invalid";
+    }
+}
+
+char *mmal_4cc_to_string(char *buf, size_t len, uint32_t fourcc) {
+    if (!buf || len < 5) {
+        return buf;
+    }
+    if (!fourcc) {
+        snprintf(buf, len, "<0>");
+        return buf;
+    }
+    for (int i = 0; i < 4; i++) {
+        buf[i] = (char)(fourcc >> (8 * i));
+    }
+    buf[4] = '\0';
+    return buf;
+}
+
+uint32_t mmal_encoding_stride_to_width(uint32_t encoding, uint32_t stride) {
+    switch (encoding) {
+        case MMAL_ENCODING_RGB24:
+        case MMAL_ENCODING_BGR24:
+            return stride / 3;
+        case MMAL_ENCODING_ARGB:
+        case MMAL_ENCODING_RGBA:
+        case MMAL_ENCODING_ABGR:
+        case MMAL_ENCODING_BGRA:
+        case MMAL_ENCODING_RGB32:
+        case MMAL_ENCODING_BGR32:
+            return stride / 4;
+        case MMAL_ENCODING_RGB16:
+        case MMAL_ENCODING_BGR16:
+        case MMAL_ENCODING_YUYV:
+            return stride / 2;
+        default:
+            return stride;
+    }
+}
+
+uint32_t mmal_encoding_width_to_stride(uint32_t encoding, uint32_t width) {
+    switch (encoding) {
+        case MMAL_ENCODING_RGB24:
+        case MMAL_ENCODING_BGR24:
+            return width * 3;
+        case MMAL_ENCODING_ARGB:
+        case MMAL_ENCODING_RGBA:
+        case MMAL_ENCODING_ABGR:
+        case MMAL_ENCODING_BGRA:
+        case MMAL_ENCODING_RGB32:
+        case MMAL_ENCODING_BGR32:
+            return width * 4;
+        case MMAL_ENCODING_RGB16:
+        case MMAL_ENCODING_BGR16:
+        case MMAL_ENCODING_YUYV:
+            return width * 2;
+        default:
+            return width;
+    }
+}
+
+MMAL_POOL_T *mmal_port_pool_create(MMAL_PORT_T *port, unsigned int headers, uint32_t payload_size) {
+    if (!port) {
+        return NULL;
+    }
+    return mmal_pool_create(headers, payload_size);
+}
+
+void mmal_port_pool_destroy(MMAL_PORT_T *port, MMAL_POOL_T *pool) {
+    if (port && port->is_enabled) {
+        mmal_port_disable(port);
+    }
+    mmal_pool_destroy(pool);
+}
+
+}
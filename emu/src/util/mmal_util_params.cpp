@@ -0,0 +1,87 @@
+#include "mmal_emu_private.h"
+#include "interface/mmal/util/mmal_util_params.h"
+
+namespace {
+
+    template < typename PARAM, typename VALUE >
+    MMAL_STATUS_T parameter_set(MMAL_PORT_T *port, uint32_t id, VALUE value) {
+        PARAM param;
+        memset(&param, 0, sizeof(param));
+        param.hdr.id = id;
+        param.hdr.size = sizeof(param);
+        param.value = value;
+        return mmal_port_parameter_set(port, &param.hdr);
+    }
+
+    template < typename PARAM, typename VALUE >
+    MMAL_STATUS_T parameter_get(MMAL_PORT_T *port, uint32_t id, VALUE *value) {
+        PARAM param;
+        memset(&param, 0, sizeof(param));
+        param.hdr.id = id;
+        param.hdr.size = sizeof(param);
+        MMAL_STATUS_T status = mmal_port_parameter_get(port, &param.hdr);
+        if (status == MMAL_SUCCESS) {
+            *value = param.value;
+        }
+        return status;
+    }
+
+}
+
+extern "C" {
+
+MMAL_STATUS_T mmal_port_parameter_set_boolean(MMAL_PORT_T *port, uint32_t id, MMAL_BOOL_T value) {
+    MMAL_PARAMETER_BOOLEAN_T param = {{ id, sizeof(param) }, value};
+    return mmal_port_parameter_set(port, &param.hdr);
+}
+
+MMAL_STATUS_T mmal_port_parameter_get_boolean(MMAL_PORT_T *port, uint32_t id, MMAL_BOOL_T *value) {
+    MMAL_PARAMETER_BOOLEAN_T param = {{ id, sizeof(param) }, 0};
+    MMAL_STATUS_T status = mmal_port_parameter_get(port, &param.hdr);
+    if (status == MMAL_SUCCESS) {
+        *value = param.enable;
+    }
+    return status;
+}
+
+MMAL_STATUS_T mmal_port_parameter_set_uint64(MMAL_PORT_T *port, uint32_t id, uint64_t value) {
+    return parameter_set< MMAL_PARAMETER_UINT64_T >(port, id, value);
+}
+
+MMAL_STATUS_T mmal_port_parameter_get_uint64(MMAL_PORT_T *port, uint32_t id, uint64_t *value) {
+    return parameter_get< MMAL_PARAMETER_UINT64_T >(port, id, value);
+}
+
+MMAL_STATUS_T mmal_port_parameter_set_int64(MMAL_PORT_T *port, uint32_t id, int64_t value) {
+    return parameter_set< MMAL_PARAMETER_INT64_T >(port, id, value);
+}
+
+MMAL_STATUS_T mmal_port_parameter_get_int64(MMAL_PORT_T *port, uint32_t id, int64_t *value) {
+    return parameter_get< MMAL_PARAMETER_INT64_T >(port, id, value);
+}
+
+MMAL_STATUS_T mmal_port_parameter_set_uint32(MMAL_PORT_T *port, uint32_t id, uint32_t value) {
+    return parameter_set< MMAL_PARAMETER_UINT32_T >(port, id, value);
+}
+
+MMAL_STATUS_T mmal_port_parameter_get_uint32(MMAL_PORT_T *port, uint32_t id, uint32_t *value) {
+    return parameter_get< MMAL_PARAMETER_UINT32_T >(port, id, value);
+}
+
+MMAL_STATUS_T mmal_port_parameter_set_int32(MMAL_PORT_T *port, uint32_t id, int32_t value) {
+    return parameter_set< MMAL_PARAMETER_INT32_T >(port, id, value);
+}
+
+MMAL_STATUS_T mmal_port_parameter_get_int32(MMAL_PORT_T *port, uint32_t id, int32_t *value) {
+    return parameter_get< MMAL_PARAMETER_INT32_T >(port, id, value);
+}
+
+MMAL_STATUS_T mmal_port_parameter_set_rational(MMAL_PORT_T *port, uint32_t id, MMAL_RATIONAL_T value) {
+    return parameter_set< MMAL_PARAMETER_RATIONAL_T >(port, id, value);
+}
+
+MMAL_STATUS_T mmal_port_parameter_get_rational(MMAL_PORT_T *port, uint32_t id, MMAL_RATIONAL_T *value) {
+    return parameter_get< MMAL_PARAMETER_RATIONAL_T >(port, id, value);
+}
+
+}
@@ -0,0 +1,61 @@
+#include <stdarg.h>
+
+#include <atomic>
+
+#include "interface/vcos/vcos.h"
+
+namespace {
+
+    std::atomic<int> log_level(VCOS_LOG_UNINITIALIZED);
+
+    int current_level() {
+        int level = log_level.load(std::memory_order_relaxed);
+        if (level == VCOS_LOG_UNINITIALIZED) {
+            level = VCOS_LOG_WARN;
+            const char *env = getenv("VCOS_LOG_LEVEL");
+            if (env && *env >= '0' && *env <= '5') {
+                level = *env - '0';
+            }
+            log_level.store(level, std::memory_order_relaxed);
+        }
+        return level;
+    }
+
+}
+
+extern "C" {
+
+void vcos_log_impl(VCOS_LOG_LEVEL_T level, const char *fmt, ...) {
+    if (level > current_level()) {
+        return;
+    }
+    va_list args;
+    va_start(args, fmt);
+    vfprintf(stderr, fmt, args);
+    va_end(args);
+    fputc('\n', stderr);
+}
+
+void vcos_log_set_level(VCOS_LOG_LEVEL_T level) {
+    log_level.store(level, std::memory_order_relaxed);
+}
+
+void vcos_sleep(uint32_t ms) {
+    struct timespec ts;
+    ts.tv_sec = ms / 1000;
+    ts.tv_nsec = (long)(ms % 1000) * 1000000L;
+    while (nanosleep(&ts, &ts) == -1 && errno == EINTR) {
+    }
+}
+
+uint64_t vcos_getmicrosecs64(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000ULL + (uint64_t)ts.tv_nsec / 1000ULL;
+}
+
+uint32_t vcos_getmicrosecs(void) {
+    return (uint32_t)vcos_getmicrosecs64();
+}
+
+}
@@ -1,5 +1,6 @@
 #include "raspivid/RaspiVid.h"
 #include <memory>
+#include <thread>
 
 using namespace std;
 using namespace raspivid;
@@ -7,107 +8,125 @@ using namespace raspivid;
 #define     RESIZE_WIDTH    640
 #define     RESIZE_HEIGHT   480
 
-class FrameCallback : public RaspiCallback {
+// Consume resized frames on a worker thread. Frames are read in place, without copying,
+// and handed back to the resizer port once processed.
+class FrameWorker {
     public:
-        char *frame_buffer;
-        int width_, height_, size_;
+        FrameWorker() {
+            queue = RaspiFrameQueue::create(2, RASPIFRAMEQUEUE_DROP_OLDEST);
+        }
 
-        // Initialize a frame buffer to contain a vcos_aligned width and height sized frame
-        FrameCallback(int width, int height) : width_(VCOS_ALIGN_UP(width, 32)), height_(VCOS_ALIGN_UP(height, 16)), size_(width_ * height_) {
-            frame_buffer = (char*)malloc(size_);
+        ~FrameWorker() {
+            stop();
         }
 
-        ~FrameCallback() {
-            free(frame_buffer);
+        void start(shared_ptr< RaspiPort > port_) {
+            port = port_;
+            // Frames are padded to vcos_aligned width and height; the view takes care of the strides
+            format = port->get_format();
+            worker = thread(&FrameWorker::run, this);
         }
 
-        // override callback function
-        void callback(MMAL_PORT_T* port, MMAL_BUFFER_HEADER_T* buffer) {
-            if (buffer->length >= size_) {
-                vcos_log_error("Copying grayscale data to frame buffer");
-                // Copy buffer->data while the buffer is locked
-                // Since the data is YUV, we are only copying the grayscale Y plane 
-                memcpy(frame_buffer, buffer->data, size_);
+        void stop() {
+            queue->close();
+            if (worker.joinable()) {
+                worker.join();
             }
         }
 
-        void post_process() {
-            // Do any post processing to our own copy of the data after we have released the buffer
-            vcos_log_error("Post processing frame buffer");
+        shared_ptr< RaspiFrameQueue > queue;
+
+    private:
+        void run() {
+            while (!queue->is_closed()) {
+                MMAL_BUFFER_HEADER_T *buffer = queue->wait(100);
+                if (!buffer) {
+                    continue;
+                }
+                mmal_buffer_header_mem_lock(buffer);
+                RaspiFrameView frame(format, buffer);
+                if (frame) {
+                    // Average the visible part of the grayscale Y plane, skipping the padding
+                    uint64_t sum = 0;
+                    for (uint8_t *row : frame.rows(0)) {
+                        for (uint32_t x = 0; x < frame.width(); x++) {
+                            sum += row[x];
+                        }
+                    }
+                    vcos_log_error("Processing grayscale frame, mean luma %u", (unsigned int)(sum / ((uint64_t)frame.width() * frame.height())));
+                }
+                mmal_buffer_header_mem_unlock(buffer);
+                port->release_buffer(buffer);
+            }
         }
+
+        shared_ptr< RaspiPort > port;
+        RASPIPORT_FORMAT_S format;
+        thread worker;
 };
 
 class MotionVectorCallback : public RaspiCallback {
     public: 
         void callback(MMAL_PORT_T* port, MMAL_BUFFER_HEADER_T* buffer) {
             if (buffer->flags & MMAL_BUFFER_HEADER_FLAG_CODECSIDEINFO) {
-                vcos_log_error("Got motion vectors");
+                // Keep the motion vectors past the callback without copying them. The previously
+                // kept buffer goes back to the encoder when its reference is replaced.
+                vectors = RaspiFrameRef(buffer);
             }
         }
+
+        void post_process() {
+            if (vectors) {
+                vcos_log_error("Got %u bytes of motion vectors", vectors.length());
+                vectors.reset();
+            }
+        }
+
+    private:
+        RaspiFrameRef vectors;
 };
 
-// Get the default port format's width and height
-auto port_format = RaspiPort::createDefaultPortFormat();
-int width = port_format.width;
-int height = port_format.height;
-
-// Create shared_ptrs for each component
-auto camera = RaspiCamera::create();
-auto preview_renderer = RaspiRenderer::create();
-auto nullsink = RaspiNullsink::create();
-auto splitter = RaspiSplitter::create();
-auto encoder = RaspiEncoder::create();
-auto resizer = RaspiResize::create( RESIZE_WIDTH, RESIZE_HEIGHT );
-
-// Create shared_ptrs for callback instances
-auto frameCallbackPtr = shared_ptr< FrameCallback >( new FrameCallback( RESIZE_WIDTH, RESIZE_HEIGHT ) );
+// Describe the pipeline. The graph works out that the camera video port must be I420 for the
+// resizer, and creates and connects the components in order
+auto graph = RaspiPipelineGraph::create();
+
+// Create the frame worker and shared_ptrs for callback instances
+FrameWorker frameWorker;
 auto motionVectorCallbackPtr = shared_ptr< MotionVectorCallback >( new MotionVectorCallback() );
 
 // connect components
 MMAL_STATUS_T connect_components() {
     MMAL_STATUS_T status;
 
-    // Connect camera preview to preview renderer
-    // In this case, we explicitly connect the camera's preview port since preview
-    // is not the default output port
-    if ((status = preview_renderer->connect(camera->preview)) != MMAL_SUCCESS) {
-        vcos_log_error("Couldn't connect camera preview to preview renderer");
-        return status;
-    }
-
-    if ((status = nullsink->connect(camera->still)) != MMAL_SUCCESS) {
-        vcos_log_error("Couldn't connect camera still to null sink");
-        return status;
-    }
-    // Need camera video encoding to be I420 to be able to resize or get raw output
-    RASPIPORT_FORMAT_S format = camera->video->get_format();
-    format.encoding = MMAL_ENCODING_I420;
-    if ((status = camera->video->set_format(format)) != MMAL_SUCCESS) {
-        vcos_log_error("Couldn't set camera video format to YUV");
-        return status;
-    }
-
-    if ((status = splitter->connect(camera)) != MMAL_SUCCESS) {
-        vcos_log_error("Couldn't connect camera video to splitter");
-        return status;
-    }
-
-    if ((status = encoder->connect(splitter)) != MMAL_SUCCESS) {
-        vcos_log_error("Couldn't connect encoder to resizer");
-        return status;
-    }
-
-    if ((status = resizer->connect(splitter->output_1)) != MMAL_SUCCESS) {
-        vcos_log_error("Couldn't resizer to splitter output_0");
+    graph->add_camera("camera");
+    graph->add_renderer("preview");
+    graph->add_nullsink("nullsink");
+    graph->add_splitter("splitter");
+    graph->add_encoder("encoder");
+    graph->add_resize("resizer", RESIZE_WIDTH, RESIZE_HEIGHT);
+    graph->add_application("frames", MMAL_ENCODING_I420);
+
+    // The camera's preview port is not its default output, so ports are always named explicitly
+    graph->connect("camera", MMAL_CAMERA_PREVIEW_PORT, "preview");
+    graph->connect("camera", MMAL_CAMERA_CAPTURE_PORT, "nullsink");
+    graph->connect("camera", MMAL_CAMERA_VIDEO_PORT, "splitter");
+    graph->connect("splitter", 0, "encoder");
+    graph->connect("splitter", 1, "resizer");
+    graph->connect("resizer", 0, "frames");
+
+    if ((status = graph->build()) != MMAL_SUCCESS) {
+        vcos_log_error("Couldn't build the pipeline");
         return status;
     }
 
-    // Attach callbacks
-    if ((status = resizer->output->add_callback(frameCallbackPtr)) != MMAL_SUCCESS) {
-        vcos_log_error("Couldn't add frame buffer callback to resizer output");
+    // Attach the frame queue and callbacks
+    shared_ptr< RaspiPort > frames = graph->get_endpoint("frames");
+    if ((status = frames->add_queue(frameWorker.queue)) != MMAL_SUCCESS) {
+        vcos_log_error("Couldn't add frame queue to resizer output");
         return status;
     }
-    if ((status = encoder->output->add_callback(motionVectorCallbackPtr)) != MMAL_SUCCESS) {
+    frameWorker.start(frames);
+    if ((status = graph->get< RaspiEncoder >("encoder")->output->add_callback(motionVectorCallbackPtr)) != MMAL_SUCCESS) {
         vcos_log_error("Couldn't add motion vector callback to encoder output");
         return status;
     }
@@ -137,7 +156,7 @@ int main(int argc, char** argv) {
     }
 
     vcos_log_error("Starting processing. Press Ctrl-C to exit...");
-    if (camera->start() != MMAL_SUCCESS) {
+    if (graph->start() != MMAL_SUCCESS) {
         vcos_log_error("Camera failed to start");
         return -1;
     }
@@ -0,0 +1,251 @@
+/**
+ \file mp4_example.cpp
+ \brief Records the camera to a fragmented MP4 file, and checks the structure of fragmented MP4 files.
+
+ Usage:
+   libraspivid_mp4_example record <file.mp4> [seconds] [frame | buffer_num]
+   libraspivid_mp4_example check <file.mp4>
+
+ "frame" writes one fragment per frame instead of one per keyframe interval. A number resizes the encoder output pool to that
+ many buffers, so that fragments spanning a whole keyframe interval can be written without copying. The check walks the boxes, and checks that
+ every trun points at its mdat, that sample sizes add up, that every sample is a sequence of length-prefixed NAL units, that
+ fragments start at tfdt times that follow on from the previous fragment, and that samples flagged as sync samples are IDR frames.
+ */
+
+#include "raspivid/RaspiVid.h"
+#include <fcntl.h>
+#include <memory>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <vector>
+
+using namespace std;
+using namespace raspivid;
+
+static uint32_t get32(const uint8_t *p) {
+    return ((uint32_t)p[0] << 24) | ((uint32_t)p[1] << 16) | ((uint32_t)p[2] << 8) | p[3];
+}
+
+static uint64_t get64(const uint8_t *p) {
+    return ((uint64_t)get32(p) << 32) | get32(p + 4);
+}
+
+// Finds the first child box of a type within [begin, end). Returns NULL if there is none.
+static const uint8_t* find_box(const uint8_t *begin, const uint8_t *end, const char *type, uint32_t *size) {
+    while (begin + 8 <= end) {
+        uint32_t box_size = get32(begin);
+        if (box_size < 8 || begin + box_size > end) {
+            return NULL;
+        }
+        if (!memcmp(begin + 4, type, 4)) {
+            *size = box_size;
+            return begin;
+        }
+        begin += box_size;
+    }
+    return NULL;
+}
+
+static int check(const char *path) {
+    FILE *file = fopen(path, "rb");
+    if (!file) {
+        fprintf(stderr, "Unable to open %s\n", path);
+        return -1;
+    }
+    vector< uint8_t > data;
+    uint8_t chunk[65536];
+    size_t read;
+    while ((read = fread(chunk, 1, sizeof(chunk), file)) > 0) {
+        data.insert(data.end(), chunk, chunk + read);
+    }
+    fclose(file);
+
+    const uint8_t *begin = data.data(), *end = data.data() + data.size();
+    uint32_t size;
+    if (data.size() < 8 || memcmp(begin + 4, "ftyp", 4)) {
+        fprintf(stderr, "No ftyp box at the start\n");
+        return -1;
+    }
+    const uint8_t *moov = find_box(begin, end, "moov", &size);
+    const uint8_t *box = moov;
+    const char *path_to_avcc[] = { "trak", "mdia", "minf", "stbl", "stsd" };
+    for (int i = 0; box && i < 5; i++) {
+        box = find_box(box + 8, box + size, path_to_avcc[i], &size);
+    }
+    // stsd has a full box header and an entry count, avc1 has 78 bytes of fields before its child boxes
+    const uint8_t *avc1 = box ? find_box(box + 16, box + size, "avc1", &size) : NULL;
+    const uint8_t *avcc = avc1 ? find_box(avc1 + 86, avc1 + size, "avcC", &size) : NULL;
+    if (!moov || !avcc) {
+        fprintf(stderr, "No moov box with an avcC sample description\n");
+        return -1;
+    }
+    printf("%s: %ux%u, profile %u level %u\n", path, (avc1[32] << 8) | avc1[33], (avc1[34] << 8) | avc1[35], avcc[9], avcc[11]);
+
+    uint64_t fragments = 0, samples = 0, keyframes = 0, errors = 0;
+    uint64_t expected_time = 0, max_drift = 0, drift_limit = 0;
+    uint32_t last_sequence = 0;
+    const uint8_t *position = begin;
+    while (position + 8 <= end) {
+        uint32_t box_size = get32(position);
+        if (box_size < 8 || position + box_size > end) {
+            fprintf(stderr, "Truncated box at offset %zu\n", (size_t)(position - begin));
+            errors++;
+            break;
+        }
+        if (memcmp(position + 4, "moof", 4)) {
+            position += box_size;
+            continue;
+        }
+        const uint8_t *moof = position;
+        const uint8_t *mdat = moof + box_size;
+        uint32_t mdat_size = mdat + 8 <= end ? get32(mdat) : 0;
+        if (!mdat_size || memcmp(mdat + 4, "mdat", 4) || mdat + mdat_size > end) {
+            fprintf(stderr, "Fragment %llu: no complete mdat after moof\n", (unsigned long long)fragments);
+            errors++;
+            break;
+        }
+        uint32_t mfhd_size, traf_size, tfdt_size, trun_size;
+        const uint8_t *mfhd = find_box(moof + 8, mdat, "mfhd", &mfhd_size);
+        const uint8_t *traf = find_box(moof + 8, mdat, "traf", &traf_size);
+        const uint8_t *tfdt = traf ? find_box(traf + 8, traf + traf_size, "tfdt", &tfdt_size) : NULL;
+        const uint8_t *trun = traf ? find_box(traf + 8, traf + traf_size, "trun", &trun_size) : NULL;
+        if (!mfhd || !tfdt || !trun || get32(trun + 8) != 0x01000f01) {
+            fprintf(stderr, "Fragment %llu: missing or unexpected mfhd, tfdt or trun\n", (unsigned long long)fragments);
+            errors++;
+            break;
+        }
+        uint32_t sequence = get32(mfhd + 12);
+        if (sequence <= last_sequence) {
+            fprintf(stderr, "Fragment %llu: sequence number %u does not increase\n", (unsigned long long)fragments, sequence);
+            errors++;
+        }
+        last_sequence = sequence;
+        uint64_t time = tfdt[8] == 1 ? get64(tfdt + 12) : get32(tfdt + 12);
+        // The last sample duration of a fragment may be an estimate, so tfdt may drift a little from the previous fragment's end
+        if (fragments && time + drift_limit < expected_time) {
+            fprintf(stderr, "Fragment %llu: tfdt %llu goes back before the previous fragment ended at %llu\n", (unsigned long long)fragments,
+                (unsigned long long)time, (unsigned long long)expected_time);
+            errors++;
+        }
+        uint64_t drift = time > expected_time ? time - expected_time : expected_time - time;
+        if (fragments && drift > max_drift) {
+            max_drift = drift;
+        }
+        uint32_t count = get32(trun + 12);
+        uint32_t data_offset = get32(trun + 16);
+        if (data_offset != box_size + 8 || trun_size != 20 + 16 * count) {
+            fprintf(stderr, "Fragment %llu: trun does not point at the mdat payload\n", (unsigned long long)fragments);
+            errors++;
+            break;
+        }
+        const uint8_t *sample = moof + data_offset;
+        for (uint32_t i = 0; i < count; i++) {
+            const uint8_t *entry = trun + 20 + 16 * i;
+            uint32_t duration = get32(entry), sample_size = get32(entry + 4), flags = get32(entry + 8);
+            if (sample + sample_size > mdat + mdat_size) {
+                fprintf(stderr, "Fragment %llu sample %u: runs past the mdat\n", (unsigned long long)fragments, i);
+                errors++;
+                break;
+            }
+            bool sync = !(flags & 0x00010000), idr = false;
+            const uint8_t *nal = sample;
+            while (nal + 4 < sample + sample_size) {
+                uint32_t length = get32(nal);
+                if (!length || nal + 4 + length > sample + sample_size) {
+                    break;
+                }
+                if ((nal[4] & 0x1f) == RASPIH264_NAL_IDR) {
+                    idr = true;
+                }
+                nal += 4 + length;
+            }
+            if (nal != sample + sample_size) {
+                fprintf(stderr, "Fragment %llu sample %u: NAL lengths do not add up to the sample size\n", (unsigned long long)fragments, i);
+                errors++;
+            }
+            if (sync != idr) {
+                fprintf(stderr, "Fragment %llu sample %u: sync flag does not match the NAL units\n", (unsigned long long)fragments, i);
+                errors++;
+            }
+            if (!duration) {
+                fprintf(stderr, "Fragment %llu sample %u: zero duration\n", (unsigned long long)fragments, i);
+                errors++;
+            }
+            if (duration > drift_limit) {
+                drift_limit = duration;
+            }
+            keyframes += sync;
+            time += duration;
+            sample += sample_size;
+        }
+        if (sample != mdat + mdat_size) {
+            fprintf(stderr, "Fragment %llu: sample sizes do not add up to the mdat size\n", (unsigned long long)fragments);
+            errors++;
+        }
+        expected_time = time;
+        samples += count;
+        fragments++;
+        position = mdat + mdat_size;
+    }
+
+    box = find_box(moov + 8, moov + get32(moov), "trak", &size);
+    box = box ? find_box(box + 8, box + size, "mdia", &size) : NULL;
+    const uint8_t *mdhd = box ? find_box(box + 8, box + size, "mdhd", &size) : NULL;
+    uint32_t timescale = mdhd ? get32(mdhd + 20) : 0;
+    printf("%llu fragments, %llu frames, %llu keyframes, %.2f s, max tfdt drift %llu ticks, %llu errors\n",
+        (unsigned long long)fragments, (unsigned long long)samples, (unsigned long long)keyframes,
+        timescale ? (double)expected_time / timescale : 0.0, (unsigned long long)max_drift, (unsigned long long)errors);
+    return errors || !samples ? -1 : 0;
+}
+
+static int record(const char *path, int seconds, bool per_frame, uint32_t buffer_num) {
+    int fd = open(path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0) {
+        fprintf(stderr, "Unable to create %s\n", path);
+        return -1;
+    }
+    RASPIMP4MUXER_OPTION_S options = RaspiMP4Muxer::createDefaultMuxerOptions();
+    if (per_frame) {
+        options.fragment = RASPIMP4MUXER_FRAGMENT_FRAME;
+    }
+    auto camera = RaspiCamera::create();
+    auto encoder = RaspiEncoder::create();
+    auto muxer = RaspiMP4Muxer::create(fd, options);
+    if (!camera || !encoder || !muxer) {
+        vcos_log_error("Unable to create components");
+        close(fd);
+        return -1;
+    }
+    if (encoder->connect(camera->video) != MMAL_SUCCESS ||
+            encoder->output->add_callback(muxer) != MMAL_SUCCESS ||
+            (buffer_num && encoder->output->resize_pool(buffer_num) != MMAL_SUCCESS) ||
+            camera->start() != MMAL_SUCCESS) {
+        vcos_log_error("Unable to start recording");
+        close(fd);
+        return -1;
+    }
+    sleep(seconds);
+    encoder->output->remove_callback(muxer);
+    muxer->flush();
+    close(fd);
+    printf("%s: %llu fragments, %llu frames, %llu bytes written, %llu bytes copied\n", path,
+        (unsigned long long)muxer->fragments(), (unsigned long long)muxer->frames(),
+        (unsigned long long)muxer->bytes_written(), (unsigned long long)muxer->bytes_copied());
+    return muxer->failed() ? -1 : 0;
+}
+
+int main(int argc, char** argv) {
+    if (argc >= 3 && !strcmp(argv[1], "record")) {
+        int seconds = argc > 3 ? atoi(argv[3]) : 5;
+        bool per_frame = argc > 4 && !strcmp(argv[4], "frame");
+        int buffer_num = argc > 4 && !per_frame ? atoi(argv[4]) : 0;
+        return record(argv[2], seconds > 0 ? seconds : 5, per_frame, buffer_num > 0 ? buffer_num : 0);
+    }
+    if (argc >= 3 && !strcmp(argv[1], "check")) {
+        return check(argv[2]);
+    }
+    fprintf(stderr, "Usage: %s record <file.mp4> [seconds] [frame | buffer_num]\n       %s check <file.mp4>\n", argv[0], argv[0]);
+    return -1;
+}
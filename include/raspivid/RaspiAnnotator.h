@@ -0,0 +1,149 @@
+/**
+ \file RaspiAnnotator.h
+ */
+
+#ifndef __RASPIANNOTATOR_H__
+#define __RASPIANNOTATOR_H__
+
+#include <atomic>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <stdint.h>
+#include <time.h>
+
+#include "raspivid/RaspiCallback.h"
+#include "raspivid/RaspiCamControl.h"
+#include "raspivid/RaspiPortMetrics.h"
+
+using namespace std;
+
+namespace raspivid {
+
+    using namespace raspi_cam_control;
+
+    /**
+     \typedef RASPIANNOTATOR_STATS_S
+     \brief What a RaspiAnnotator did with the requests it received.
+     \see RaspiAnnotator::get_stats
+     */
+    typedef struct {
+        uint64_t requests;                      /**< Calls to RaspiAnnotator::set */
+        uint64_t coalesced;                     /**< Requests replaced by a newer one before they were rendered */
+        uint64_t renders;                       /**< Times the annotation was rendered, for a request or a new second */
+        uint64_t unchanged;                     /**< Renders identical to the annotation already on the camera, so not sent */
+        uint64_t updates;                       /**< Annotations sent to the camera */
+        uint64_t unsynchronised;                /**< Updates sent without a frame to follow, because none arrived in time */
+        uint64_t failed;                        /**< Annotations the camera rejected */
+        RASPIPORT_HISTOGRAM_S update_duration;  /**< Time spent sending each annotation, a round trip to the camera */
+    } RASPIANNOTATOR_STATS_S;
+
+    /**
+     \class RaspiAnnotator "RaspiAnnotator.h"
+     \brief Keeps the camera's annotation up to date from its own thread.
+
+     raspicamcontrol_set_annotate renders the date and time with localtime and strftime and then waits for the camera to
+     accept MMAL_PARAMETER_ANNOTATE, on the caller's thread, every time it is called. A RaspiAnnotator takes that off the
+     caller: RaspiAnnotator::set only stores the request and returns, and a thread of its own renders it with
+     raspicamcontrol_build_annotate. Requests that arrive faster than they are rendered are merged, only the latest being
+     rendered, and a rendered annotation identical to the one the camera already shows is not sent. While the annotation
+     shows the date or time, the thread renders it again at every new second by itself, so there is no need to call
+     RaspiAnnotator::set periodically.
+
+     A RaspiAnnotator is also a RaspiCallback. Added to a port carrying the camera's frames, it sends each update right
+     after a frame arrived, leaving the rest of the frame interval for the camera to apply it, and sends at most one
+     update per min_interval_ms. Without frames, updates are sent after frame_timeout_ms.
+
+     The annotation is not read back from the camera, so a RaspiAnnotator should be the only thing changing it: leave
+     RASPICAM_CAMERA_PARAMETERS::enable_annotate at 0 in the parameters applied through RaspiCameraControl. RaspiCamera
+     creates one when RASPICAMERA_OPTION_S::annotator is set.
+     \see RaspiCamera::annotator
+     */
+    class RaspiAnnotator : public RaspiCallback {
+        public:
+            /**
+             \brief Creates an annotator and starts its thread. Nothing is sent until the first request.
+             \param camera A C pointer to the camera's MMAL_COMPONENT_T
+             \param min_interval_ms The shortest time between two updates
+             \param frame_timeout_ms How long an update waits for a frame before it is sent anyway
+             \return A shared pointer to a RaspiAnnotator
+             */
+            static shared_ptr< RaspiAnnotator > create(MMAL_COMPONENT_T *camera, uint32_t min_interval_ms = 0, uint32_t frame_timeout_ms = 200);
+
+            /**
+             \brief Class destructor. Stops the thread.
+             */
+            ~RaspiAnnotator();
+
+            /**
+             \brief Requests a new annotation. Returns without waiting for it to be rendered or sent.
+             \see raspicamcontrol_set_annotate for the parameters
+             */
+            void set(int settings, const char *text, int text_size = 0, int text_colour = -1, int bg_colour = -1);
+
+            /**
+             \brief Requests the annotation described by camera parameters.
+             \param params Parameters using the enable_annotate and annotate_ fields
+             */
+            void set(const RASPICAM_CAMERA_PARAMETERS &params);
+
+            /**
+             \brief Waits for the update in progress, if any, then stops the thread. Later requests are ignored. Called by
+             the destructor, and by RaspiCamera before the camera component is destroyed.
+             */
+            void stop();
+
+            /**
+             \return A snapshot of the statistics
+             */
+            RASPIANNOTATOR_STATS_S get_stats();
+
+            /**
+             \brief Notes that a frame arrived. Buffers flushed while the port stops carry no frame and are ignored.
+             */
+            void callback(MMAL_PORT_T *port, MMAL_BUFFER_HEADER_T *buffer);
+
+        protected:
+            RaspiAnnotator(MMAL_COMPONENT_T *camera, uint32_t min_interval_ms, uint32_t frame_timeout_ms);
+
+        private:
+            typedef struct {
+                int settings;
+                string text;
+                int text_size;
+                int text_colour;
+                int bg_colour;
+            } REQUEST_S;
+
+            void run();
+            bool render(const REQUEST_S &request, MMAL_PARAMETER_CAMERA_ANNOTATE_V3_T &annotate);
+
+            MMAL_COMPONENT_T *camera;
+            int64_t min_interval_us;
+            int64_t frame_timeout_us;
+            std::mutex lock;                                    /**< Guards the request, the frame count and stopping */
+            std::condition_variable wake;
+            REQUEST_S request;
+            uint64_t generation;                                /**< Incremented by every request */
+            uint64_t frames;                                    /**< Frames seen */
+            bool stopping;
+            time_t rendered_second;                             /**< The second tm holds, localtime is called once per second */
+            struct tm tm;
+            MMAL_PARAMETER_CAMERA_ANNOTATE_V3_T sent;           /**< The annotation the camera shows */
+            bool has_sent;
+            std::atomic<uint64_t> requests;
+            std::atomic<uint64_t> coalesced;
+            std::atomic<uint64_t> renders;
+            std::atomic<uint64_t> unchanged;
+            std::atomic<uint64_t> updates;
+            std::atomic<uint64_t> unsynchronised;
+            std::atomic<uint64_t> failed;
+            RaspiPortMetrics::Histogram update_duration;
+            thread worker;
+    };
+
+}
+
+#endif /* __RASPIANNOTATOR_H__ */
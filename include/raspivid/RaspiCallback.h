@@ -27,17 +27,21 @@ namespace raspivid {
         public:
             /**
              \brief Callback function for buffer data. The buffer is automatically locked, released and returned by RaspiPort.
+             To keep the frame after returning, without copying it, take a RaspiFrameRef to the buffer.
              \param port A C pointer to the MMAL_PORT_T where the callback is originating from.
              \param buffer A C pointer to the MMAL_BUFFER_HEADER_T containing buffer data.
              \see RaspiPort::add_callback
+             \see RaspiFrameRef
              */
             virtual void callback(MMAL_PORT_T *port, MMAL_BUFFER_HEADER_T *buffer) =0;
             
             /**
              \brief A callback function, called after the main callback function. This allows implementing classes to perform operations after the
              buffer has been released back to the port. This prevents the port from being starved of buffers due to long post processing operations.
+             Runs on the port's executor if one is set, otherwise on the callback thread.
              \see RaspiPort::add_callback
              \see RaspiCallback::callback
+             \see RaspiPort::set_executor
              */
             virtual void post_process() { };
     };
@@ -32,6 +32,7 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #include <stdio.h>
 #include <memory.h>
 #include <ctype.h>
+#include <time.h>
 
 #include "interface/vcos/vcos.h"
 
@@ -217,6 +218,8 @@ namespace raspi_cam_control {
     int raspicamcontrol_set_stats_pass(MMAL_COMPONENT_T *camera, int stats_pass);
     int raspicamcontrol_set_annotate(MMAL_COMPONENT_T *camera, const int bitmask, const char *string,
                                      const int text_size, const int text_colour, const int bg_colour);
+    void raspicamcontrol_build_annotate(MMAL_PARAMETER_CAMERA_ANNOTATE_V3_T *annotate, const int bitmask, const char *string,
+                                        const int text_size, const int text_colour, const int bg_colour, const struct tm *tm);
     int raspicamcontrol_set_stereo_mode(MMAL_PORT_T *port, MMAL_PARAMETER_STEREOSCOPIC_MODE_T *stereo_mode);
 
     //Individual getting functions
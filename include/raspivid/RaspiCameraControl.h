@@ -0,0 +1,194 @@
+/**
+ \file RaspiCameraControl.h
+ */
+
+#ifndef __RASPICAMERACONTROL_H__
+#define __RASPICAMERACONTROL_H__
+
+#include <atomic>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <stdint.h>
+
+#include "raspivid/RaspiCamControl.h"
+#include "raspivid/RaspiPortMetrics.h"
+
+/**
+ \brief Number of parameters RaspiCameraControl tracks, one per raspicamcontrol_set_* call of raspicamcontrol_set_all_parameters
+ */
+#define RASPICAMERACONTROL_PARAMETERS 21
+
+using namespace std;
+
+namespace raspivid {
+
+    using namespace raspi_cam_control;
+
+    /**
+     \typedef RASPICAMERACONTROL_STATS_S
+     \brief A snapshot of what RaspiCameraControl sent to the camera and how long it took.
+     \see RaspiCameraControl::get_stats
+     */
+    typedef struct {
+        uint64_t applies;                                       /**< Calls to RaspiCameraControl::apply */
+        uint64_t sent;                                          /**< Parameters sent to the camera */
+        uint64_t skipped;                                       /**< Parameters left out because they had not changed */
+        uint64_t failed;                                        /**< Parameters the camera rejected or that were out of range */
+        uint64_t sent_by_parameter[RASPICAMERACONTROL_PARAMETERS];  /**< Parameters sent, by index. \see RaspiCameraControl::parameter_name */
+        RASPIPORT_HISTOGRAM_S apply_duration;                   /**< Time spent in each RaspiCameraControl::apply */
+        RASPIPORT_HISTOGRAM_S set_duration;                     /**< Time spent sending each parameter, a round trip to the camera */
+    } RASPICAMERACONTROL_STATS_S;
+
+    /**
+     \typedef RASPICAMERACONTROL_SNAPSHOT_S
+     \brief What is known about a camera's parameters at one point, without asking the camera.
+     \see RaspiCameraControl::get_snapshot
+     */
+    typedef struct {
+        uint64_t version;                               /**< Increases with every change to the snapshot, starting from 1 */
+        bool applied;                                   /**< true once parameters have been applied. parameters is zero before that */
+        RASPICAM_CAMERA_PARAMETERS parameters;          /**< The parameters last applied through RaspiCameraControl::apply */
+        MMAL_PARAMETER_CAMERA_SETTINGS_T settings;      /**< The exposure, gains and focus the camera last reported, zero until the first report */
+        int64_t settings_us;                            /**< When settings arrived, on the RaspiPortMetrics::now_us clock, or 0 */
+        uint64_t settings_reports;                      /**< Number of settings reports received */
+    } RASPICAMERACONTROL_SNAPSHOT_S;
+
+    /**
+     \class RaspiCameraControl "RaspiCameraControl.h"
+     \brief Applies RASPICAM_CAMERA_PARAMETERS to a camera, sending only the parameters that changed since the last call.
+
+     raspicamcontrol_set_all_parameters sends every parameter, each one a separate round trip to the camera, however little
+     changed. A camera control remembers the last parameter set it applied and compares each new set field by field, so
+     adjusting exposure or white balance several times a second costs one or two round trips. Related parameters go
+     together: a new AWB mode sends the AWB gains again, since the firmware only uses the gains with MMAL_PARAM_AWBMODE_OFF.
+     Annotation text built from the date or time is sent on every call, since it changes without the parameters changing.
+     A parameter the camera rejects is sent again on the next call.
+
+     Calls are serialised, so several threads may share a camera control. Call RaspiCameraControl::invalidate after changing
+     camera parameters by other means, so that the next call sends everything. RaspiPTZ sends its crops through
+     RaspiCameraControl::set_crop, so RASPICAM_CAMERA_PARAMETERS::roi always holds the crop last sent, and an apply with a
+     different roi moves the PTZ there.
+
+     A camera control is also a cache of the camera's state, so reading it never goes to the camera. The parameters come
+     from RaspiCameraControl::apply and the exposure, gains and focus the firmware picks from MMAL_EVENT_PARAMETER_CHANGED
+     events for MMAL_PARAMETER_CAMERA_SETTINGS, which RaspiCamera forwards to RaspiCameraControl::parameter_changed. Every
+     change publishes a new immutable snapshot with a higher version. A control loop can poll RaspiCameraControl::get_version,
+     a single atomic load, as often as it likes and only take the snapshot when the version moved:
+
+     \code
+     uint64_t seen = 0;
+     while (running) {
+         if (camera->control->get_version() != seen) {
+             shared_ptr< const RASPICAMERACONTROL_SNAPSHOT_S > snapshot = camera->control->get_snapshot();
+             seen = snapshot->version;
+             adjust(snapshot->settings.exposure, snapshot->parameters.exposureCompensation);
+         }
+     }
+     \endcode
+     \see RaspiCamera::control
+     */
+    class RaspiCameraControl {
+        public:
+            /**
+             \brief Creates a camera control. Nothing is sent until the first RaspiCameraControl::apply, which sends everything.
+             \param camera A C pointer to the camera's MMAL_COMPONENT_T
+             \return A shared pointer to a RaspiCameraControl
+             */
+            static shared_ptr< RaspiCameraControl > create(MMAL_COMPONENT_T *camera);
+
+            /**
+             \brief Sends the parameters that differ from the last applied set, in the order raspicamcontrol_set_all_parameters
+             uses.
+             \param params The complete parameter set to apply
+             \return MMAL_SUCCESS, or MMAL_EINVAL if any parameter was out of range or rejected by the camera
+             */
+            MMAL_STATUS_T apply(const RASPICAM_CAMERA_PARAMETERS &params);
+
+            /**
+             \brief Sends a crop and records it as the applied RASPICAM_CAMERA_PARAMETERS::roi, without going through a whole
+             parameter set. Used by RaspiPTZ for each step of a move.
+             \param crop The crop in the 16.16 fixed point of MMAL_PARAMETER_INPUT_CROP
+             \return MMAL_SUCCESS, or the camera's error, in which case nothing is recorded
+             */
+            MMAL_STATUS_T set_crop(const MMAL_RECT_T &crop);
+
+            /**
+             \brief Sets the function told about each new roi RaspiCameraControl::apply sends, so that whatever moves the crop
+             can follow it. RaspiPTZ sets itself here. The function is called with the control locked and must not call back
+             into it.
+             \param listener The function, or an empty function for none
+             */
+            void set_roi_listener(function< void(const PARAM_FLOAT_RECT_T &roi) > listener);
+
+            /**
+             \brief Forgets the last applied set, so that the next RaspiCameraControl::apply sends every parameter.
+             */
+            void invalidate();
+
+            /**
+             \param params[out] The last applied parameter set
+             \return true if a set has been applied since creation or the last RaspiCameraControl::invalidate
+             */
+            bool get_applied(RASPICAM_CAMERA_PARAMETERS *params);
+
+            /**
+             \brief Updates the cache from a parameter the camera reported in an MMAL_EVENT_PARAMETER_CHANGED event. Only
+             MMAL_PARAMETER_CAMERA_SETTINGS is cached; other parameters are ignored.
+             \param param The parameter from the event
+             */
+            void parameter_changed(const MMAL_PARAMETER_HEADER_T *param);
+
+            /**
+             \return The version of the latest snapshot. Cheap enough to poll at any rate.
+             */
+            uint64_t get_version();
+
+            /**
+             \return The latest snapshot. It never changes once published, so it may be kept and read from any thread.
+             */
+            shared_ptr< const RASPICAMERACONTROL_SNAPSHOT_S > get_snapshot();
+
+            /**
+             \return A snapshot of the statistics
+             */
+            RASPICAMERACONTROL_STATS_S get_stats();
+
+            /**
+             \brief Clears the statistics.
+             */
+            void reset_stats();
+
+            /**
+             \param parameter A parameter index, below RASPICAMERACONTROL_PARAMETERS
+             \return The parameter's name, for example "saturation", or NULL
+             */
+            static const char* parameter_name(unsigned int parameter);
+
+        protected:
+            RaspiCameraControl(MMAL_COMPONENT_T *camera);
+
+        private:
+            void publish(const RASPICAM_CAMERA_PARAMETERS *parameters, const MMAL_PARAMETER_CAMERA_SETTINGS_T *settings);
+
+            MMAL_COMPONENT_T *camera;
+            std::mutex lock;
+            RASPICAM_CAMERA_PARAMETERS applied;
+            bool valid;
+            uint32_t retry;                                     /**< Parameters to send again because the last attempt failed */
+            function< void(const PARAM_FLOAT_RECT_T &roi) > roi_listener;
+            std::atomic<uint64_t> applies;
+            std::atomic<uint64_t> sent;
+            std::atomic<uint64_t> skipped;
+            std::atomic<uint64_t> failed;
+            std::atomic<uint64_t> sent_by_parameter[RASPICAMERACONTROL_PARAMETERS];
+            RaspiPortMetrics::Histogram apply_duration;
+            RaspiPortMetrics::Histogram set_duration;
+            std::mutex snapshot_lock;                           /**< Serialises publishing, so no update is lost */
+            shared_ptr< const RASPICAMERACONTROL_SNAPSHOT_S > snapshot;
+            std::atomic<uint64_t> version;
+    };
+
+}
+
+#endif /* __RASPICAMERACONTROL_H__ */
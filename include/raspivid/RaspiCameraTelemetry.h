@@ -0,0 +1,111 @@
+/**
+ \file RaspiCameraTelemetry.h
+ */
+
+#ifndef __RASPICAMERATELEMETRY_H__
+#define __RASPICAMERATELEMETRY_H__
+
+#include <atomic>
+#include <memory>
+#include <vector>
+#include <stdint.h>
+
+#include "interface/mmal/mmal.h"
+#include "interface/mmal/mmal_parameters_camera.h"
+
+using namespace std;
+
+namespace raspivid {
+
+    /**
+     \typedef RASPICAMERATELEMETRY_RECORD_S
+     \brief The exposure, gains and focus the camera reported for one frame.
+     */
+    typedef struct {
+        uint64_t sequence;                      /**< Position of the record in the stream, counting from 0 */
+        int64_t timestamp_us;                   /**< When the report arrived, on the RaspiPortMetrics::now_us clock */
+        int64_t pts;                            /**< Presentation timestamp of the frame the report belongs to, or MMAL_TIME_UNKNOWN */
+        uint32_t exposure;                      /**< Exposure time in microseconds */
+        MMAL_RATIONAL_T analog_gain;            /**< Analog gain */
+        MMAL_RATIONAL_T digital_gain;           /**< Digital gain */
+        MMAL_RATIONAL_T awb_red_gain;           /**< AWB red gain */
+        MMAL_RATIONAL_T awb_blue_gain;          /**< AWB blue gain */
+        uint32_t focus_position;                /**< Lens position */
+    } RASPICAMERATELEMETRY_RECORD_S;
+
+    /**
+     \class RaspiCameraTelemetry "RaspiCameraTelemetry.h"
+     \brief A fixed-size ring of the camera settings reports, written by the camera's control port callback and read
+     by any number of threads without locks.
+
+     The control port callback is the only writer. Pushing never waits and never allocates; once the ring is full
+     the oldest record is overwritten. Each slot carries a sequence count that is odd while the slot is being written,
+     so a reader copies a record and keeps it only if the count did not move while it copied. A reader that falls
+     more than the ring's capacity behind skips to the oldest record still held and can tell how many it lost from
+     the sequence numbers.
+     \see RaspiCamera::telemetry
+     */
+    class RaspiCameraTelemetry {
+        public:
+            /**
+             \brief Creates a telemetry ring.
+             \param capacity Number of records kept. Rounded up to a power of two.
+             \return A shared pointer to a RaspiCameraTelemetry
+             */
+            static shared_ptr< RaspiCameraTelemetry > create(unsigned int capacity = 256);
+
+            /**
+             \brief Writer side. Decodes a settings report into a record and adds it to the ring. Only one thread may push.
+             \param settings The MMAL_PARAMETER_CAMERA_SETTINGS the camera reported
+             \param pts The presentation timestamp of the event buffer, or MMAL_TIME_UNKNOWN
+             */
+            void push(const MMAL_PARAMETER_CAMERA_SETTINGS_T &settings, int64_t pts);
+
+            /**
+             \brief Copies the most recent record.
+             \param record[out] The record
+             \return false if nothing has been pushed yet
+             */
+            bool latest(RASPICAMERATELEMETRY_RECORD_S *record);
+
+            /**
+             \brief Copies the records from a reader's cursor onwards, oldest first, and moves the cursor past them. A
+             cursor that points at records already overwritten is moved to the oldest one still held.
+             \param cursor[in,out] Sequence of the next record the reader wants. Start at 0.
+             \param records[out] Where to copy the records
+             \param max Maximum number of records to copy
+             \return The number of records copied
+             */
+            unsigned int read(uint64_t *cursor, RASPICAMERATELEMETRY_RECORD_S *records, unsigned int max);
+
+            /**
+             \return The number of records pushed since creation
+             */
+            uint64_t count();
+
+            /**
+             \return The number of records the ring keeps
+             */
+            unsigned int capacity();
+
+        protected:
+            RaspiCameraTelemetry(unsigned int capacity);
+
+        private:
+            static const unsigned int WORDS = (sizeof(RASPICAMERATELEMETRY_RECORD_S) + sizeof(uint64_t) - 1) / sizeof(uint64_t);
+
+            typedef struct {
+                std::atomic<uint64_t> sequence;     /**< 2 * record sequence + 1 while writing, + 2 once written */
+                std::atomic<uint64_t> words[WORDS]; /**< The record, stored as atomic words so readers may copy it during a write */
+            } SLOT_S;
+
+            bool copy(uint64_t sequence, RASPICAMERATELEMETRY_RECORD_S *record);
+
+            vector< SLOT_S > slots;
+            uint64_t mask;
+            std::atomic<uint64_t> count_;
+    };
+
+}
+
+#endif /* __RASPICAMERATELEMETRY_H__ */
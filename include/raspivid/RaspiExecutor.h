@@ -0,0 +1,160 @@
+/**
+ \file RaspiExecutor.h
+ */
+
+#ifndef __RASPIEXECUTOR_H__
+#define __RASPIEXECUTOR_H__
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <stdint.h>
+#include <thread>
+#include <vector>
+
+using namespace std;
+
+namespace raspivid {
+
+    /**
+     \class RaspiExecutor "RaspiExecutor.h"
+     \brief Runs work handed off by a port callback, such as RaspiCallback::post_process.
+     \see RaspiPort::set_executor
+     */
+    class RaspiExecutor {
+        public:
+            /**
+             \brief Schedules a task.
+             \param task The work to run
+             \return true if the task was accepted, false if it was dropped because the executor is full or stopped
+             */
+            virtual bool execute(function< void() > task) =0;
+
+            /**
+             \return The number of tasks dropped because the executor was full or stopped
+             */
+            virtual uint64_t dropped() { return 0; }
+
+            virtual ~RaspiExecutor() { }
+    };
+
+    /**
+     \class RaspiInlineExecutor "RaspiExecutor.h"
+     \brief Runs each task immediately on the calling thread. This is what a port does when it has no executor.
+     */
+    class RaspiInlineExecutor : public RaspiExecutor {
+        public:
+            /**
+             \return A shared pointer to a RaspiInlineExecutor
+             */
+            static shared_ptr< RaspiInlineExecutor > create();
+
+            bool execute(function< void() > task);
+
+        protected:
+            RaspiInlineExecutor() { }
+    };
+
+    /**
+     \class RaspiThreadExecutor "RaspiExecutor.h"
+     \brief Runs tasks one at a time, in order, on a dedicated thread.
+
+     Use this when post processing must see frames in order, or is not reentrant.
+     */
+    class RaspiThreadExecutor : public RaspiExecutor {
+        public:
+            /**
+             \brief Creates an executor and starts its thread.
+             \param max_pending Maximum number of tasks waiting to run. Further tasks are dropped. 0 means unbounded.
+             \return A shared pointer to a RaspiThreadExecutor
+             */
+            static shared_ptr< RaspiThreadExecutor > create(size_t max_pending = 0);
+
+            bool execute(function< void() > task);
+            uint64_t dropped();
+
+            /**
+             \brief Runs the tasks already accepted, then stops the thread. Called by the destructor.
+             */
+            void stop();
+
+            ~RaspiThreadExecutor();
+
+        protected:
+            RaspiThreadExecutor(size_t max_pending);
+
+        private:
+            void run();
+
+            size_t max_pending_;
+            deque< function< void() > > tasks;
+            mutex lock;
+            condition_variable available;
+            bool stopping;
+            std::atomic<uint64_t> dropped_;
+            thread worker;
+    };
+
+    /**
+     \class RaspiThreadPoolExecutor "RaspiExecutor.h"
+     \brief A work-stealing thread pool that can be shared by several ports.
+
+     Each worker has its own deque. Tasks are spread over the workers round-robin, and a worker whose deque is empty
+     steals from the others before going to sleep, so a burst on one port is spread over all cores. Tasks from the same
+     port may run concurrently and out of order, so post processing run here must be reentrant.
+     */
+    class RaspiThreadPoolExecutor : public RaspiExecutor {
+        public:
+            /**
+             \brief Creates a pool and starts its workers.
+             \param threads Number of worker threads. 0 uses one per core.
+             \param max_pending Maximum number of tasks waiting to run across all workers. Further tasks are dropped. 0 means unbounded.
+             \return A shared pointer to a RaspiThreadPoolExecutor
+             */
+            static shared_ptr< RaspiThreadPoolExecutor > create(unsigned int threads = 0, size_t max_pending = 0);
+
+            bool execute(function< void() > task);
+            uint64_t dropped();
+
+            /**
+             \return The number of tasks a worker took from another worker's deque
+             */
+            uint64_t stolen();
+
+            /**
+             \brief Runs the tasks already accepted, then stops the workers. Called by the destructor.
+             */
+            void stop();
+
+            ~RaspiThreadPoolExecutor();
+
+        protected:
+            RaspiThreadPoolExecutor(unsigned int threads, size_t max_pending);
+
+        private:
+            struct Worker {
+                deque< function< void() > > tasks;
+                mutex lock;
+            };
+
+            void run(unsigned int index);
+            bool take(unsigned int index, function< void() > &task);
+
+            size_t max_pending_;
+            vector< unique_ptr< Worker > > workers;
+            vector< thread > threads_;
+            std::atomic<unsigned int> next;
+            std::atomic<size_t> pending;
+            std::atomic<uint64_t> dropped_;
+            std::atomic<uint64_t> stolen_;
+            mutex sleep_lock;
+            condition_variable available;
+            std::atomic<bool> stopping;
+    };
+
+}
+
+#endif /* __RASPIEXECUTOR_H__ */
@@ -0,0 +1,118 @@
+/**
+ \file RaspiFrameQueue.h
+ */
+
+#ifndef __RASPIFRAMEQUEUE_H__
+#define __RASPIFRAMEQUEUE_H__
+
+#include <atomic>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include "interface/vcos/vcos.h"
+#include "interface/mmal/mmal.h"
+
+using namespace std;
+
+namespace raspivid {
+
+    /**
+     \brief What RaspiFrameQueue::push does when the queue is full.
+     */
+    typedef enum {
+        RASPIFRAMEQUEUE_DROP_OLDEST,    /**< Discard the oldest queued buffer to make room. Consumers always see the most recent frames. */
+        RASPIFRAMEQUEUE_DROP_NEWEST,    /**< Discard the buffer being pushed. Consumers see an uninterrupted run of older frames. */
+        RASPIFRAMEQUEUE_BLOCK           /**< Wait on the callback thread until the consumer makes room. The port may starve while waiting. */
+    } RASPIFRAMEQUEUE_OVERFLOW_T;
+
+    /**
+     \class RaspiFrameQueue "RaspiFrameQueue.h"
+     \brief A single-producer/single-consumer ring of MMAL buffer headers, used to hand frames from a port callback to a
+     worker thread without copying them.
+
+     The producer is the MMAL callback thread (see RaspiPort::add_queue) and the consumer is one worker thread. Pushing and
+     popping are lock-free; the mutex is only taken to put a waiting thread to sleep or wake it up. Buffers stay referenced
+     while they are queued and while the consumer works on them. The consumer hands each one back with
+     RaspiPort::release_buffer so the port can be replenished.
+     */
+    class RaspiFrameQueue {
+        public:
+            /**
+             \brief Creates a frame queue.
+             \param depth Maximum number of queued buffers. Rounded up to a power of two. Should be smaller than the port's buffer_num
+             so that the port keeps some buffers to fill.
+             \param overflow The overflow policy
+             \return A shared pointer to a RaspiFrameQueue
+             */
+            static shared_ptr< RaspiFrameQueue > create(unsigned int depth = 2, RASPIFRAMEQUEUE_OVERFLOW_T overflow = RASPIFRAMEQUEUE_DROP_OLDEST);
+
+            /**
+             \brief Producer side. Queues a buffer, applying the overflow policy if the queue is full.
+             \param buffer The buffer to queue
+             \return NULL if nothing was dropped. Otherwise the dropped buffer, which the caller must release.
+             */
+            MMAL_BUFFER_HEADER_T* push(MMAL_BUFFER_HEADER_T *buffer);
+
+            /**
+             \brief Consumer side. Takes the oldest queued buffer without waiting.
+             \return A buffer, or NULL if the queue is empty
+             */
+            MMAL_BUFFER_HEADER_T* pop();
+
+            /**
+             \brief Consumer side. Takes the oldest queued buffer, waiting for one if the queue is empty.
+             \param timeout_ms Maximum time to wait in milliseconds
+             \return A buffer, or NULL on timeout or once the queue is closed and empty
+             */
+            MMAL_BUFFER_HEADER_T* wait(uint32_t timeout_ms);
+
+            /**
+             \brief Wakes up waiting threads and makes later waits return immediately. A closed queue drops every pushed buffer.
+             */
+            void close();
+
+            /**
+             \return true once close() has been called
+             */
+            bool is_closed();
+
+            /**
+             \return The number of buffers currently queued
+             */
+            unsigned int size();
+
+            /**
+             \return The maximum number of queued buffers
+             */
+            unsigned int depth();
+
+            /**
+             \return The number of buffers dropped because the queue was full or closed
+             */
+            uint64_t dropped();
+
+        protected:
+            RaspiFrameQueue(unsigned int depth, RASPIFRAMEQUEUE_OVERFLOW_T overflow);
+
+        private:
+            void wake(std::atomic<bool> &waiting, std::condition_variable &condition);
+
+            vector< std::atomic< MMAL_BUFFER_HEADER_T* > > slots;
+            uint64_t mask;
+            RASPIFRAMEQUEUE_OVERFLOW_T overflow_;
+            std::atomic<uint64_t> head;             /**< Next slot to pop. Advanced by the consumer, and by the producer when dropping the oldest buffer */
+            std::atomic<uint64_t> tail;             /**< Next slot to push. Only advanced by the producer */
+            std::atomic<uint64_t> dropped_;
+            std::atomic<bool> closed;
+            std::atomic<bool> consumer_waiting;
+            std::atomic<bool> producer_waiting;
+            std::mutex lock;
+            std::condition_variable not_empty;
+            std::condition_variable not_full;
+    };
+
+}
+
+#endif /* __RASPIFRAMEQUEUE_H__ */
@@ -0,0 +1,89 @@
+/**
+ \file RaspiFrameRef.h
+ */
+
+#ifndef __RASPIFRAMEREF_H__
+#define __RASPIFRAMEREF_H__
+
+#include "interface/vcos/vcos.h"
+#include "interface/mmal/mmal.h"
+#include "interface/mmal/mmal_buffer.h"
+
+namespace raspivid {
+
+    /**
+     \class RaspiFrameRef "RaspiFrameRef.h"
+     \brief A reference-counted handle that keeps an MMAL buffer alive, and its data locked, after a port callback returns.
+
+     Creating a RaspiFrameRef from a buffer calls mmal_buffer_header_acquire. Copies acquire the buffer again. Moves
+     transfer the reference. The buffer goes back to its port once the last reference, including the one RaspiPort
+     holds for the duration of the callback, has been released. Frame data can therefore be read in place on another
+     thread without being copied.
+
+     Each pinned buffer is one buffer the port can't fill, so references should be short-lived compared to the
+     port's buffer_num. All references must be dropped before the port is destroyed.
+     \see RaspiCallback::callback
+     */
+    class RaspiFrameRef {
+        public:
+            /**
+             \brief Creates an empty reference.
+             */
+            RaspiFrameRef();
+
+            /**
+             \brief Pins a buffer.
+             \param buffer A C pointer to an MMAL_BUFFER_HEADER_T, typically the one passed to RaspiCallback::callback.
+             */
+            explicit RaspiFrameRef(MMAL_BUFFER_HEADER_T *buffer);
+
+            RaspiFrameRef(const RaspiFrameRef &other);
+            RaspiFrameRef(RaspiFrameRef &&other);
+            RaspiFrameRef& operator=(const RaspiFrameRef &other);
+            RaspiFrameRef& operator=(RaspiFrameRef &&other);
+            ~RaspiFrameRef();
+
+            /**
+             \brief Drops this reference. The reference is empty afterwards.
+             */
+            void reset();
+
+            /**
+             \return The underlying buffer, or NULL if the reference is empty
+             */
+            MMAL_BUFFER_HEADER_T* buffer() const;
+
+            /**
+             \return A pointer to the first byte of frame data, or NULL if the reference is empty
+             */
+            const uint8_t* data() const;
+
+            /**
+             \return The number of bytes of frame data
+             */
+            uint32_t length() const;
+
+            /**
+             \return The MMAL_BUFFER_HEADER_FLAG_* flags of the buffer
+             */
+            uint32_t flags() const;
+
+            /**
+             \return The presentation timestamp of the buffer in microseconds
+             */
+            int64_t pts() const;
+
+            /**
+             \return true if the reference holds a buffer
+             */
+            explicit operator bool() const;
+
+        private:
+            void pin(MMAL_BUFFER_HEADER_T *buffer);
+
+            MMAL_BUFFER_HEADER_T *buffer_;
+    };
+
+}
+
+#endif /* __RASPIFRAMEREF_H__ */
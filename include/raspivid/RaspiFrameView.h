@@ -0,0 +1,211 @@
+/**
+ \file RaspiFrameView.h
+ */
+
+#ifndef __RASPIFRAMEVIEW_H__
+#define __RASPIFRAMEVIEW_H__
+
+#include <stdint.h>
+
+#include "raspivid/RaspiPort.h"
+#include "raspivid/RaspiI420Kernels.h"
+
+namespace raspivid {
+
+    /**
+     \class RaspiFrameView "RaspiFrameView.h"
+     \brief Describes the planes of an uncompressed frame in a buffer: where each plane starts, its stride, and the visible
+     rectangle, without copying anything.
+
+     Frames from MMAL video ports are padded: each plane has VCOS_ALIGN_UP(width, 32) pixels per row and
+     VCOS_ALIGN_UP(height, 16) rows, and the visible picture is the format's crop rectangle. A view applies that layout to
+     a buffer once, so consumers can walk the visible rows, or hand the frame to RaspiI420Kernels, without working out
+     offsets themselves. Supported encodings are MMAL_ENCODING_I420 and the packed 16, 24 and 32 bit RGB and BGR formats.
+
+     A view does not own or pin the buffer. It is valid while the buffer is, so for use beyond a callback, keep a
+     RaspiFrameRef alongside it.
+     */
+    class RaspiFrameView {
+        public:
+            /**
+             \brief Iterates over the visible rows of a plane, yielding a pointer to the first visible pixel of each row.
+             */
+            class RowIterator {
+                public:
+                    RowIterator(uint8_t *row, uint32_t stride) : row_(row), stride_(stride) { }
+                    uint8_t* operator*() const { return row_; }
+                    RowIterator& operator++() { row_ += stride_; return *this; }
+                    bool operator!=(const RowIterator &other) const { return row_ != other.row_; }
+                    bool operator==(const RowIterator &other) const { return row_ == other.row_; }
+
+                private:
+                    uint8_t *row_;
+                    uint32_t stride_;
+            };
+
+            /**
+             \brief The visible rows of a plane, for range based for loops.
+             \see RaspiFrameView::rows
+             */
+            class Rows {
+                public:
+                    Rows(uint8_t *first, uint32_t stride, uint32_t count) : first_(first), stride_(stride), count_(count) { }
+                    RowIterator begin() const { return RowIterator(first_, stride_); }
+                    RowIterator end() const { return RowIterator(first_ + (size_t)stride_ * count_, stride_); }
+                    uint32_t size() const { return count_; }
+
+                private:
+                    uint8_t *first_;
+                    uint32_t stride_;
+                    uint32_t count_;
+            };
+
+            /**
+             \brief Creates an empty, invalid view.
+             */
+            RaspiFrameView();
+
+            /**
+             \brief Creates a view of a buffer from the committed format of the port it came from. The data must be locked,
+             as it is during RaspiCallback::callback.
+             \param port A C pointer to the MMAL_PORT_T, typically the one passed to RaspiCallback::callback
+             \param buffer A C pointer to the MMAL_BUFFER_HEADER_T
+             */
+            RaspiFrameView(MMAL_PORT_T *port, MMAL_BUFFER_HEADER_T *buffer);
+
+            /**
+             \brief Creates a view of a buffer in a given format. The data must be locked.
+             \param format The port format, as returned by RaspiPort::get_format
+             \param buffer A C pointer to the MMAL_BUFFER_HEADER_T
+             */
+            RaspiFrameView(const RASPIPORT_FORMAT_S &format, MMAL_BUFFER_HEADER_T *buffer);
+
+            /**
+             \brief Creates a view of frame data in a given format.
+             \param format The frame format. width and height are padded as RaspiPort::set_format does, and a crop of zero
+             size means the whole width x height is visible. For I420, an odd crop origin is rounded down to even numbers, as
+             RaspiI420Kernels::crop does, and the visible size is kept.
+             \param data Start of the frame data
+             \param length Length of the frame data in bytes. The view is invalid if the frame does not fit.
+             */
+            RaspiFrameView(const RASPIPORT_FORMAT_S &format, uint8_t *data, uint32_t length);
+
+            /**
+             \return true if the view describes a frame
+             */
+            explicit operator bool() const;
+
+            /**
+             \return The encoding of the frame
+             */
+            uint32_t encoding() const;
+
+            /**
+             \return Visible width in pixels
+             */
+            uint32_t width() const;
+
+            /**
+             \return Visible height in pixels
+             */
+            uint32_t height() const;
+
+            /**
+             \return The number of planes: 3 for I420, 1 for packed RGB, 0 for an invalid view
+             */
+            unsigned int planes() const;
+
+            /**
+             \param plane Plane index
+             \return A pointer to the first visible pixel of the plane, or NULL if there is no such plane
+             */
+            uint8_t* plane(unsigned int plane) const;
+
+            /**
+             \param plane Plane index
+             \return Bytes from one row of the plane to the next
+             */
+            uint32_t stride(unsigned int plane) const;
+
+            /**
+             \param plane Plane index
+             \return Visible width of the plane in pixels. I420 chroma planes are half the width, rounded up.
+             */
+            uint32_t plane_width(unsigned int plane) const;
+
+            /**
+             \param plane Plane index
+             \return Visible height of the plane in rows. I420 chroma planes are half the height, rounded up.
+             */
+            uint32_t plane_height(unsigned int plane) const;
+
+            /**
+             \return Bytes per pixel in each plane: 1 for I420, 2, 3 or 4 for packed RGB
+             */
+            uint32_t bytes_per_pixel() const;
+
+            /**
+             \return The luma plane of an I420 frame, or NULL
+             */
+            uint8_t* y() const;
+
+            /**
+             \return The U plane of an I420 frame, or NULL
+             */
+            uint8_t* u() const;
+
+            /**
+             \return The V plane of an I420 frame, or NULL
+             */
+            uint8_t* v() const;
+
+            /**
+             \brief Gets a visible row of a plane.
+             \param plane Plane index
+             \param y Row, counted from the top of the visible rectangle
+             \return A pointer to the first visible pixel of the row
+             */
+            uint8_t* row(unsigned int plane, uint32_t y) const;
+
+            /**
+             \brief Gets a visible row of a plane as pixels of type T, for example uint32_t for 32 bit RGB.
+             */
+            template< typename T > T* row_as(unsigned int plane, uint32_t y) const {
+                return reinterpret_cast< T* >(row(plane, y));
+            }
+
+            /**
+             \param plane Plane index
+             \return The visible rows of the plane
+             */
+            Rows rows(unsigned int plane = 0) const;
+
+            /**
+             \brief Narrows the view to a rectangle within the visible area, without copying. For I420, x and y are rounded
+             down to even numbers and width and height are kept, the same rule as RaspiI420Kernels::crop, so both give the same
+             region. The rectangle is clipped to the visible area.
+             \return The narrower view
+             */
+            RaspiFrameView crop(uint32_t x, uint32_t y, uint32_t width, uint32_t height) const;
+
+            /**
+             \brief Describes an I420 view for RaspiI420Kernels.
+             \return The image. All plane pointers are NULL if the view is not I420.
+             */
+            RASPII420_IMAGE_S i420() const;
+
+        private:
+            void init(const RASPIPORT_FORMAT_S &format, uint8_t *data, uint32_t length);
+
+            uint32_t encoding_;
+            uint32_t width_;
+            uint32_t height_;
+            unsigned int planes_;
+            uint32_t bytes_per_pixel_;
+            uint8_t *plane_[3];
+            uint32_t stride_[3];
+    };
+
+}
+
+#endif /* __RASPIFRAMEVIEW_H__ */
@@ -0,0 +1,134 @@
+/**
+ \file RaspiH264Parser.h
+ */
+
+#ifndef __RASPIH264PARSER_H__
+#define __RASPIH264PARSER_H__
+
+#include <memory>
+#include <stdint.h>
+
+#include "interface/vcos/vcos.h"
+#include "interface/mmal/mmal.h"
+
+using namespace std;
+
+/**
+ \brief Maximum number of NAL pieces RaspiH264Parser reports for a single buffer
+ */
+#define RASPIH264_MAX_NALS 128
+
+namespace raspivid {
+
+    /**
+     \brief H.264 nal_unit_type values of interest.
+     */
+    typedef enum {
+        RASPIH264_NAL_SLICE = 1,            /**< Coded slice of a non-IDR picture */
+        RASPIH264_NAL_IDR = 5,              /**< Coded slice of an IDR picture */
+        RASPIH264_NAL_SEI = 6,              /**< Supplemental enhancement information */
+        RASPIH264_NAL_SPS = 7,              /**< Sequence parameter set */
+        RASPIH264_NAL_PPS = 8,              /**< Picture parameter set */
+        RASPIH264_NAL_AUD = 9               /**< Access unit delimiter */
+    } RASPIH264_NAL_TYPE_T;
+
+    /**
+     \brief Flags of a RASPIH264_NAL_S piece.
+     */
+    typedef enum {
+        RASPIH264_NAL_FLAG_START = 1,               /**< The piece starts with the NAL header byte */
+        RASPIH264_NAL_FLAG_END = 2,                 /**< The piece ends the NAL. May be an empty piece when the end was only found in the next buffer */
+        RASPIH264_NAL_FLAG_ACCESS_UNIT_END = 4      /**< The piece ends the access unit (the buffer carried MMAL_BUFFER_HEADER_FLAG_FRAME_END) */
+    } RASPIH264_NAL_FLAG_T;
+
+    /**
+     \typedef RASPIH264_NAL_S
+     \brief A piece of a NAL unit, viewed in place. A NAL that lies within one buffer is a single piece flagged both
+     RASPIH264_NAL_FLAG_START and RASPIH264_NAL_FLAG_END. A NAL split over several buffers is reported as consecutive pieces,
+     one per buffer, that join up to the whole NAL.
+
+     Start codes are not part of any piece. data points into the parsed buffer, and is only valid as long as that buffer is,
+     so pin the buffer with a RaspiFrameRef to use pieces after the callback returns. The only exception is a run of zero
+     bytes held back at the end of a buffer because it might have been the start of a start code, which points to static memory.
+     */
+    typedef struct {
+        const uint8_t *data;                /**< Piece data */
+        uint32_t length;                    /**< Piece length in bytes */
+        uint8_t type;                       /**< nal_unit_type of the NAL the piece belongs to. \see RASPIH264_NAL_TYPE_T */
+        uint8_t ref_idc;                    /**< nal_ref_idc of the NAL the piece belongs to */
+        uint16_t flags;                     /**< RASPIH264_NAL_FLAG_T flags */
+        int64_t pts;                        /**< Presentation timestamp of the buffer the piece came from */
+    } RASPIH264_NAL_S;
+
+    /**
+     \class RaspiH264Parser "RaspiH264Parser.h"
+     \brief A streaming Annex B NAL unit parser for H.264 encoder output buffers.
+
+     Buffers are parsed in order as they arrive. Start codes split across buffers are found, and NAL pieces are views into the
+     buffers themselves, so parsing never copies payload or allocates memory. Motion vector buffers
+     (MMAL_BUFFER_HEADER_FLAG_CODECSIDEINFO) are skipped. A NAL ends at the next start code, or at the end of a buffer
+     flagged MMAL_BUFFER_HEADER_FLAG_FRAME_END or MMAL_BUFFER_HEADER_FLAG_CONFIG.
+     */
+    class RaspiH264Parser {
+        public:
+            /**
+             \brief Creates a parser.
+             \return A shared pointer to a RaspiH264Parser
+             */
+            static shared_ptr< RaspiH264Parser > create();
+
+            /**
+             \brief Parses an encoder output buffer.
+             \param buffer A C pointer to an MMAL_BUFFER_HEADER_T, typically the one passed to RaspiCallback::callback
+             \return The number of NAL pieces found, which are available through RaspiH264Parser::nals until the next call
+             */
+            uint32_t parse(MMAL_BUFFER_HEADER_T *buffer);
+
+            /**
+             \brief Parses a chunk of an Annex B stream.
+             \param data Chunk data
+             \param length Chunk length in bytes
+             \param flags MMAL_BUFFER_HEADER_FLAG_* flags of the chunk
+             \param pts Presentation timestamp of the chunk
+             \return The number of NAL pieces found, which are available through RaspiH264Parser::nals until the next call
+             */
+            uint32_t parse(const uint8_t *data, uint32_t length, uint32_t flags, int64_t pts);
+
+            /**
+             \return The NAL pieces found by the last call to RaspiH264Parser::parse
+             */
+            const RASPIH264_NAL_S* nals() const;
+
+            /**
+             \brief Forgets any partially parsed NAL, for example after frames were dropped.
+             */
+            void reset();
+
+            /**
+             \return The number of NAL pieces lost because a buffer held more than RASPIH264_MAX_NALS pieces
+             */
+            uint64_t overflowed() const;
+
+        protected:
+            RaspiH264Parser();
+
+        private:
+            void emit(const uint8_t *data, uint32_t length, uint16_t flags);
+            void start_nal(uint8_t header);
+            void end_nal(const uint8_t *data, uint32_t length, uint16_t flags);
+
+            RASPIH264_NAL_S nals_[RASPIH264_MAX_NALS];
+            uint32_t count;
+            uint64_t overflowed_;
+            int64_t pts_;
+            bool in_nal;
+            bool nal_started;
+            bool header_pending;
+            uint32_t held_zeros;
+            uint8_t type;
+            uint8_t ref_idc;
+    };
+
+}
+
+#endif /* __RASPIH264PARSER_H__ */
@@ -0,0 +1,121 @@
+/**
+ \file RaspiH264RingBuffer.h
+ */
+
+#ifndef __RASPIH264RINGBUFFER_H__
+#define __RASPIH264RINGBUFFER_H__
+
+#include <atomic>
+#include <memory>
+#include <stdint.h>
+#include <vector>
+
+#include "raspivid/RaspiCallback.h"
+#include "raspivid/RaspiH264Parser.h"
+
+using namespace std;
+
+namespace raspivid {
+
+    /**
+     \typedef RASPIH264RINGBUFFER_RECORD_S
+     \brief One encoder output buffer in a RaspiH264RingBuffer snapshot
+     */
+    typedef struct {
+        uint32_t offset;                    /**< Offset of the buffer data in the snapshot stream */
+        uint32_t length;                    /**< Length of the buffer data in bytes */
+        uint32_t flags;                     /**< MMAL_BUFFER_HEADER_FLAG_* flags of the buffer */
+        int64_t pts;                        /**< Presentation timestamp of the buffer */
+    } RASPIH264RINGBUFFER_RECORD_S;
+
+    /**
+     \class RaspiH264RingBuffer "RaspiH264RingBuffer.h"
+     \brief Keeps the most recent H.264 encoder output in a fixed-size in-memory ring, for pre-event recording.
+
+     Add it to an encoder output port with RaspiPort::add_callback. Every buffer is appended to a byte arena allocated once
+     at creation, overwriting the oldest data when the arena is full, and every IDR access unit is recorded in a keyframe
+     index together with its pts. Access units that do not carry their own SPS and PPS get a copy of the most recent
+     MMAL_BUFFER_HEADER_FLAG_CONFIG buffer in front, so a stream taken from any indexed keyframe can be decoded on its own.
+
+     The callback never locks or allocates. RaspiH264RingBuffer::snapshot copies out the stream without blocking the
+     callback: it checks after copying whether the callback overwrote any of it, and retries if so.
+
+     Size the arena for the wanted pre-event time plus one intra period, at the encoder bitrate. For example, 10 s at
+     17 Mbit/s with one IDR every 60 frames at 30 fps needs about 12 s, or 26 MB.
+     */
+    class RaspiH264RingBuffer : public RaspiCallback {
+        public:
+            /**
+             \brief Creates a ring buffer.
+             \param capacity Arena size in bytes, rounded up to a power of two
+             \param keyframes Number of keyframes to index, rounded up to a power of two
+             \return A shared pointer to a RaspiH264RingBuffer
+             */
+            static shared_ptr< RaspiH264RingBuffer > create(size_t capacity, unsigned int keyframes = 64);
+
+            void callback(MMAL_PORT_T *port, MMAL_BUFFER_HEADER_T *buffer);
+
+            /**
+             \brief Copies out the buffered stream, starting at a keyframe and ending with the last complete access unit.
+             \param data Receives the Annex B stream
+             \param records Receives the encoder buffers that make up the stream, in order
+             \param from_pts Start at the newest keyframe at or before this pts. If there is none, or for MMAL_TIME_UNKNOWN,
+             start at the oldest keyframe still in the ring.
+             \return MMAL_SUCCESS, MMAL_ENOENT if there is no keyframe in the ring yet, or MMAL_EAGAIN if the callback kept
+             overwriting the data being copied
+             */
+            MMAL_STATUS_T snapshot(vector< uint8_t > &data, vector< RASPIH264RINGBUFFER_RECORD_S > &records, int64_t from_pts = MMAL_TIME_UNKNOWN);
+
+            /**
+             \return The pts of the oldest keyframe still in the ring, or MMAL_TIME_UNKNOWN
+             */
+            int64_t oldest_keyframe_pts();
+
+            /**
+             \return The number of buffers dropped because they did not fit the arena
+             */
+            uint64_t dropped();
+
+            /**
+             \brief Forgets the buffered stream. Must not be called while the callback may run, but snapshots may be taken concurrently.
+             */
+            void clear();
+
+        protected:
+            RaspiH264RingBuffer(size_t capacity, unsigned int keyframes);
+
+        private:
+            typedef struct {
+                std::atomic<uint64_t> sequence;
+                std::atomic<uint64_t> position;
+                std::atomic<int64_t> pts;
+            } KEYFRAME_S;
+
+            void append(const uint8_t *data, uint32_t length, uint32_t flags, int64_t pts);
+            void write_word(uint64_t position, uint64_t word);
+            uint64_t read_word(uint64_t position);
+            bool find_keyframe(int64_t from_pts, uint64_t &position, int64_t &pts);
+
+            unique_ptr< std::atomic<uint64_t>[] > arena;
+            uint64_t capacity_;
+            unique_ptr< KEYFRAME_S[] > keyframes_;
+            uint64_t keyframe_mask;
+
+            // Positions count bytes written since creation. Physical offsets are positions modulo capacity_.
+            std::atomic<uint64_t> overwritten;
+            std::atomic<uint64_t> committed;
+            std::atomic<uint64_t> keyframe_count;
+            std::atomic<uint64_t> dropped_;
+
+            // Only used by the callback
+            shared_ptr< RaspiH264Parser > parser;
+            uint64_t head;
+            uint64_t access_unit_start;
+            bool access_unit_has_sps;
+            bool access_unit_is_keyframe;
+            vector< uint8_t > config;
+    };
+
+}
+
+#endif /* __RASPIH264RINGBUFFER_H__ */
@@ -0,0 +1,156 @@
+/**
+ \file RaspiI420Kernels.h
+ */
+
+#ifndef __RASPII420KERNELS_H__
+#define __RASPII420KERNELS_H__
+
+#include <memory>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "interface/vcos/vcos.h"
+#include "interface/mmal/mmal.h"
+
+using namespace std;
+
+namespace raspivid {
+
+    /**
+     \brief Instruction set used by a RaspiI420Kernels instance.
+     */
+    typedef enum {
+        RASPII420_PATH_AUTO,            /**< The fastest path the build and CPU support */
+        RASPII420_PATH_SCALAR,          /**< Plain C++, the reference for all other paths */
+        RASPII420_PATH_SSE2,            /**< x86 SSE2 */
+        RASPII420_PATH_AVX2,            /**< x86 AVX2, chosen at run time if the CPU has it */
+        RASPII420_PATH_NEON             /**< ARM NEON, if the compiler targets it (aarch64, or -mfpu=neon on 32 bit ARM) */
+    } RASPII420_PATH_T;
+
+    /**
+     \typedef RASPII420_IMAGE_S
+     \brief Describes an I420 image in memory: three planes, each with its own stride, and the visible size. The chroma
+     planes are (width + 1) / 2 by (height + 1) / 2.
+     */
+    typedef struct {
+        uint8_t *plane[3];              /**< Y, U and V plane of the top left visible pixel */
+        uint32_t stride[3];             /**< Bytes from one row to the next, per plane */
+        uint32_t width;                 /**< Visible width in pixels */
+        uint32_t height;                /**< Visible height in pixels */
+    } RASPII420_IMAGE_S;
+
+    /**
+     \class RaspiI420Kernels "RaspiI420Kernels.h"
+     \brief Image processing kernels for I420 frames, such as those of the camera video port or RaspiResize.
+
+     The layout RaspiPort::set_format produces pads the planes to VCOS_ALIGN_UP(width, 32) by VCOS_ALIGN_UP(height, 16)
+     luma pixels; RaspiI420Kernels::image describes a buffer with that layout. Results are identical on every path, so
+     the scalar path serves as the reference when testing and benchmarking the others.
+     */
+    class RaspiI420Kernels {
+        public:
+            /**
+             \brief Creates a set of kernels.
+             \param path Instruction set to use
+             \return A shared pointer to RaspiI420Kernels, or nullptr if the path is not available in this build or on this CPU
+             */
+            static shared_ptr< RaspiI420Kernels > create(RASPII420_PATH_T path = RASPII420_PATH_AUTO);
+
+            /**
+             \brief Describes an I420 buffer with the padded layout of RaspiPort::set_format.
+             \param data Start of the buffer
+             \param width Visible width, as passed to RaspiPort::set_format
+             \param height Visible height, as passed to RaspiPort::set_format
+             \return The image
+             */
+            static RASPII420_IMAGE_S image(uint8_t *data, uint32_t width, uint32_t height);
+
+            /**
+             \return The size in bytes of an I420 buffer with the padded layout of RaspiPort::set_format
+             */
+            static size_t image_size(uint32_t width, uint32_t height);
+
+            /**
+             \brief Crops an image without copying, by moving the plane pointers. x and y are rounded down to even numbers
+             so that the chroma planes stay aligned with luma, width and height are kept, and the rectangle is clipped to the
+             image. RaspiFrameView::crop follows the same rule.
+             \return The cropped image, sharing memory with the original
+             */
+            static RASPII420_IMAGE_S crop(const RASPII420_IMAGE_S &image, uint32_t x, uint32_t y, uint32_t width, uint32_t height);
+
+            /**
+             \return The instruction set in use
+             */
+            RASPII420_PATH_T path();
+
+            /**
+             \return A short name for the instruction set in use
+             */
+            const char* name();
+
+            /**
+             \brief Copies one plane out of an image, dropping the padding.
+             \param image Source image
+             \param plane 0 for Y, 1 for U, 2 for V
+             \param dst Destination
+             \param dst_stride Bytes from one row of dst to the next
+             */
+            void extract_plane(const RASPII420_IMAGE_S &image, unsigned int plane, uint8_t *dst, uint32_t dst_stride);
+
+            /**
+             \brief Downscales an image by averaging 2x2 or 4x4 pixel blocks, rounding to nearest.
+             \param src Source image
+             \param dst Destination image, at most src.width / factor by src.height / factor
+             \param factor 2 or 4
+             \return MMAL_SUCCESS, or MMAL_EINVAL if the factor or the destination size is invalid
+             */
+            MMAL_STATUS_T downscale(const RASPII420_IMAGE_S &src, const RASPII420_IMAGE_S &dst, unsigned int factor);
+
+            /**
+             \brief Counts luma values.
+             \param image Source image
+             \param bins Receives the number of pixels with each luma value
+             */
+            void histogram(const RASPII420_IMAGE_S &image, uint32_t bins[256]);
+
+            /**
+             \brief Compares the luma of two images of the same size.
+             \param a First image
+             \param b Second image
+             \param threshold Pixels whose luma differs by more than this are counted
+             \param dst If not NULL, receives the absolute luma difference of every pixel
+             \param dst_stride Bytes from one row of dst to the next
+             \return The number of pixels whose luma differs by more than threshold
+             */
+            uint32_t difference(const RASPII420_IMAGE_S &a, const RASPII420_IMAGE_S &b, uint8_t threshold, uint8_t *dst = NULL, uint32_t dst_stride = 0);
+
+            /**
+             \brief Converts an image to packed 24 bit RGB, using BT.601 limited range coefficients as produced by the camera.
+             \param src Source image
+             \param dst Destination, width * 3 bytes per row
+             \param dst_stride Bytes from one row of dst to the next
+             */
+            void to_rgb24(const RASPII420_IMAGE_S &src, uint8_t *dst, uint32_t dst_stride);
+
+        protected:
+            RaspiI420Kernels(RASPII420_PATH_T path);
+
+        private:
+            typedef void (*DOWNSCALE_F)(const uint8_t *src, uint32_t src_stride, uint8_t *dst, uint32_t dst_stride, uint32_t width, uint32_t height);
+            typedef void (*HISTOGRAM_F)(const uint8_t *src, uint32_t src_stride, uint32_t width, uint32_t height, uint32_t *bins);
+            typedef uint32_t (*DIFFERENCE_F)(const uint8_t *a, uint32_t a_stride, const uint8_t *b, uint32_t b_stride, uint8_t *dst,
+                uint32_t dst_stride, uint32_t width, uint32_t height, uint8_t threshold);
+            typedef void (*RGB24_F)(const uint8_t *y, uint32_t y_stride, const uint8_t *u, uint32_t u_stride, const uint8_t *v,
+                uint32_t v_stride, uint8_t *dst, uint32_t dst_stride, uint32_t width, uint32_t height);
+
+            RASPII420_PATH_T path_;
+            DOWNSCALE_F downscale2;
+            DOWNSCALE_F downscale4;
+            HISTOGRAM_F histogram_;
+            DIFFERENCE_F difference_;
+            RGB24_F to_rgb24_;
+    };
+
+}
+
+#endif /* __RASPII420KERNELS_H__ */
@@ -0,0 +1,191 @@
+/**
+ \file RaspiMJPEGServer.h
+ */
+
+#ifndef __RASPIMJPEGSERVER_H__
+#define __RASPIMJPEGSERVER_H__
+
+#include <atomic>
+#include <deque>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include <stdint.h>
+
+#include "raspivid/RaspiCallback.h"
+#include "raspivid/RaspiFrameRef.h"
+
+/**
+ \brief Boundary between the JPEG parts of a RaspiMJPEGServer stream
+ */
+#define RASPIMJPEGSERVER_BOUNDARY "raspividframe"
+
+using namespace std;
+
+namespace raspivid {
+
+    /**
+     \brief MJPEG server parameter structure.
+     */
+    struct RASPIMJPEGSERVER_OPTION_S {
+        string address;                 /**< IPv4 address to listen on, "0.0.0.0" for all interfaces */
+        uint16_t port;                  /**< TCP port to listen on, 0 for any free port. \see RaspiMJPEGServer::get_port */
+        string path;                    /**< Path serving the stream, for example "/stream.mjpg". Any query string is ignored. */
+        uint32_t max_clients;           /**< Streaming clients served at once. Others are turned away with 503. */
+        uint32_t max_pinned_frames;     /**< Frames clients may send from encoder buffers. Older frames still being sent are copied out. */
+        uint32_t send_timeout_ms;       /**< Disconnect a client that has not taken a whole frame in this long. 0 means never. */
+        uint32_t send_buffer;           /**< SO_SNDBUF of client sockets in bytes, 0 for the system default */
+    };
+
+    /**
+     \typedef RASPIMJPEGSERVER_STATS_S
+     \brief What a RaspiMJPEGServer received and sent.
+     \see RaspiMJPEGServer::get_stats
+     */
+    typedef struct {
+        uint64_t frames;                /**< Complete JPEG frames received from the encoder */
+        uint64_t skipped;               /**< Frames replaced by a newer one before the server thread took them */
+        uint64_t connections;           /**< Connections accepted */
+        uint64_t rejected;              /**< Requests answered with an error: wrong path, bad request or too many clients */
+        uint64_t timeouts;              /**< Clients disconnected for taking longer than send_timeout_ms over a frame */
+        uint32_t clients;               /**< Clients streaming now */
+        uint64_t frames_sent;           /**< Frames sent in full, summed over clients */
+        uint64_t frames_dropped;        /**< Frames a client missed because its socket was still backed up, summed over clients */
+        uint64_t copied;                /**< Frames copied out of encoder buffers, to stay under max_pinned_frames or because they spanned too many buffers */
+        uint64_t bytes_sent;            /**< Bytes sent, headers included */
+    } RASPIMJPEGSERVER_STATS_S;
+
+    /**
+     \class RaspiMJPEGServer "RaspiMJPEGServer.h"
+     \brief Serves the output of a RaspiEncoder in MMAL_ENCODING_MJPEG mode as an HTTP multipart/x-mixed-replace stream,
+     which browsers and most video players show directly.
+
+     Add it to the encoder's output port with RaspiPort::add_callback. The callback only pins each buffer of a frame with
+     a RaspiFrameRef and hands the complete frame to the server thread, which runs every socket from one epoll loop.
+     A frame is shared by every client and never copied for them: each client sends its part header, the encoder's
+     buffers and the part trailer with one gathered write, from wherever its last write stopped.
+
+     Clients never wait for each other. A client whose socket is backed up keeps sending the frame it started and holds
+     only the newest frame after it, so frames that arrive meanwhile are dropped for that client alone. Pinned buffers
+     can't be refilled by the encoder, so once clients hold more than max_pinned_frames frames, the oldest is copied out
+     of its buffers and the buffers go back to the encoder. A frame spread over as many buffers as the port has, or over
+     more than 62, is copied too. Keep max_pinned_frames below the encoder's buffer_num.
+
+     Stop the server, or remove it from the port, before the encoder is destroyed.
+     */
+    class RaspiMJPEGServer : public RaspiCallback {
+        public:
+            /**
+             \brief Creates default server options: all interfaces, port 8080, "/stream.mjpg", 16 clients, 1 pinned
+             frame, a 10 s send timeout and the default send buffer.
+             \return A RASPIMJPEGSERVER_OPTION_S struct
+             */
+            static RASPIMJPEGSERVER_OPTION_S createDefaultServerOptions();
+
+            /**
+             \brief Creates a server, starts listening and starts the server thread.
+             \param options Server options
+             \return A shared pointer to a RaspiMJPEGServer, or nullptr if the socket could not be set up
+             \see RaspiMJPEGServer::createDefaultServerOptions()
+             */
+            static shared_ptr< RaspiMJPEGServer > create(RASPIMJPEGSERVER_OPTION_S options);
+
+            /**
+             \brief Collects the buffers of each frame and hands complete frames to the server thread.
+             */
+            void callback(MMAL_PORT_T *port, MMAL_BUFFER_HEADER_T *buffer);
+
+            /**
+             \brief Disconnects every client, drops every frame and stops the server thread. Remove the server from its
+             port first. Called by the destructor.
+             */
+            void stop();
+
+            /**
+             \return The TCP port the server listens on
+             */
+            uint16_t get_port();
+
+            /**
+             \return A snapshot of the statistics
+             */
+            RASPIMJPEGSERVER_STATS_S get_stats();
+
+            ~RaspiMJPEGServer();
+
+        protected:
+            RaspiMJPEGServer(RASPIMJPEGSERVER_OPTION_S options);
+
+        private:
+            typedef struct {
+                vector< RaspiFrameRef > parts;  /**< The encoder buffers holding the frame, empty once copied */
+                vector< uint8_t > copy;         /**< The frame, once copied out of the encoder buffers */
+                string header;                  /**< Part boundary and headers */
+                uint32_t length;                /**< JPEG bytes */
+            } FRAME_S;
+
+            typedef struct {
+                int fd;
+                bool streaming;                 /**< The request was accepted and the stream started */
+                bool closing;                   /**< Close once the pending bytes are sent */
+                string request;                 /**< The request read so far */
+                string pending;                 /**< Response head or error response, sent before any frame */
+                shared_ptr< FRAME_S > current;  /**< The frame being sent */
+                uint64_t offset;                /**< Bytes of the current frame already sent */
+                int64_t started_us;             /**< When the current frame started */
+                shared_ptr< FRAME_S > next;     /**< The newest frame not yet started */
+                bool writable_wait;             /**< Waiting for EPOLLOUT */
+            } CLIENT_S;
+
+            bool listen_socket();
+            void run();
+            void accept_clients();
+            void read_client(CLIENT_S &client);
+            void handle_request(CLIENT_S &client);
+            void take_frame();
+            void pin_limit();
+            void send_client(CLIENT_S &client);
+            void watch_writable(CLIENT_S &client, bool writable);
+            void close_client(int fd);
+
+            RASPIMJPEGSERVER_OPTION_S options_;
+            int listen_fd;
+            int event_fd;                       /**< Wakes the server thread for a new frame or to stop */
+            int epoll_fd;
+            uint16_t port_;
+
+            // Only used by the callback
+            vector< RaspiFrameRef > assembling;
+            vector< uint8_t > spill;            /**< The frame so far, once it needed too many buffers to pin */
+            uint32_t assembled;
+
+            // Shared with the server thread, under lock
+            mutex lock;
+            shared_ptr< FRAME_S > latest;
+            bool stopping;
+
+            // Only used by the server thread
+            map< int, CLIENT_S > clients;
+            deque< shared_ptr< FRAME_S > > pinned;  /**< Frames given to clients that still hold encoder buffers, oldest first */
+            uint32_t streaming;
+
+            thread worker;
+            std::atomic<bool> stopped;
+            std::atomic<uint64_t> frames;
+            std::atomic<uint64_t> skipped;
+            std::atomic<uint64_t> connections;
+            std::atomic<uint64_t> rejected;
+            std::atomic<uint64_t> timeouts;
+            std::atomic<uint32_t> clients_;
+            std::atomic<uint64_t> frames_sent;
+            std::atomic<uint64_t> frames_dropped;
+            std::atomic<uint64_t> copied;
+            std::atomic<uint64_t> bytes_sent;
+    };
+
+}
+
+#endif /* __RASPIMJPEGSERVER_H__ */
@@ -0,0 +1,226 @@
+/**
+ \file RaspiMP4Muxer.h
+ */
+
+#ifndef __RASPIMP4MUXER_H__
+#define __RASPIMP4MUXER_H__
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <stdint.h>
+#include <sys/uio.h>
+#include <thread>
+#include <vector>
+
+#include "raspivid/RaspiCallback.h"
+#include "raspivid/RaspiFrameRef.h"
+#include "raspivid/RaspiH264Parser.h"
+
+/**
+ \brief Fragments RaspiMP4Muxer lets wait for its writer thread before its callback waits too
+ */
+#define RASPIMP4MUXER_MAX_PENDING 4
+
+using namespace std;
+
+namespace raspivid {
+
+    /**
+     \brief When RaspiMP4Muxer closes a fragment.
+     */
+    typedef enum {
+        RASPIMP4MUXER_FRAGMENT_KEYFRAME,        /**< One fragment per keyframe interval. Each fragment starts with a keyframe. */
+        RASPIMP4MUXER_FRAGMENT_FRAME            /**< One fragment (a CMAF chunk) per frame, for the lowest latency */
+    } RASPIMP4MUXER_FRAGMENT_T;
+
+    /**
+     \brief MP4 muxer parameter structure.
+     */
+    struct RASPIMP4MUXER_OPTION_S {
+        RASPIMP4MUXER_FRAGMENT_T fragment;      /**< When to close a fragment */
+        uint32_t max_fragment_frames;           /**< Close a fragment after this many frames even without a keyframe. 0 means no limit. */
+        uint32_t timescale;                     /**< Media timescale in ticks per second */
+    };
+
+    /**
+     \class RaspiMP4Muxer "RaspiMP4Muxer.h"
+     \brief Writes H.264 encoder output to a file descriptor as fragmented MP4 (CMAF).
+
+     Add it to an encoder output port with RaspiPort::add_callback. An initialization segment (ftyp and moov) is written at
+     the first keyframe, using the SPS and PPS from the stream and the size and frame rate of the port format, followed by
+     a moof and mdat pair per fragment. Sample timing comes from the buffer dts, or pts if it has none, and pts - dts is
+     written as the composition offset. Frames before the first keyframe are skipped.
+
+     Annex B start codes are replaced by 4 byte lengths, and parameter sets and access unit delimiters are left out of the
+     samples, without copying: each fragment is written with a single gathered writev() straight from the encoder buffers,
+     which are pinned until it has been written. As the encoder stalls once all its buffers are pinned, at most one buffer
+     less than the port's pool holds is pinned at a time, counting fragments still waiting to be written, and the data of
+     any further buffer is copied. The first fragment that has to copy, and any later one that spans more buffers still, is
+     logged with the buffer_num that would have kept it copy-free. With RASPIMP4MUXER_FRAGMENT_KEYFRAME, a fragment spans a
+     whole keyframe interval, so raise the encoder output buffer_num with RaspiPort::resize_pool to keep it copy-free.
+
+     Fragments are written by a writer thread, so slow storage does not hold up the encoder callback. Once
+     RASPIMP4MUXER_MAX_PENDING fragments wait to be written, the callback waits for the writer. Writes are blocking, so use a
+     file or a blocking pipe or socket. After a write error, nothing more is written.
+     */
+    class RaspiMP4Muxer : public RaspiCallback {
+        public:
+            /**
+             \brief Creates default muxer options: fragments at keyframes, at most 300 frames per fragment, 90 kHz timescale.
+             \return A RASPIMP4MUXER_OPTION_S struct
+             */
+            static RASPIMP4MUXER_OPTION_S createDefaultMuxerOptions();
+
+            /**
+             \brief Creates a muxer with supplied options.
+             \param fd File descriptor to write to. It is not closed by the muxer.
+             \param options Muxer options
+             \return A shared pointer to a RaspiMP4Muxer
+             \see RaspiMP4Muxer::createDefaultMuxerOptions()
+             */
+            static shared_ptr< RaspiMP4Muxer > create(int fd, RASPIMP4MUXER_OPTION_S options);
+
+            /**
+             \brief Creates a muxer with default options.
+             \param fd File descriptor to write to. It is not closed by the muxer.
+             \return A shared pointer to a RaspiMP4Muxer
+             */
+            static shared_ptr< RaspiMP4Muxer > create(int fd);
+
+            void callback(MMAL_PORT_T *port, MMAL_BUFFER_HEADER_T *buffer);
+
+            /**
+             \brief Writes out the pending fragment and waits until the writer thread has written every fragment. Call it after the
+             muxer was removed from its port. A callback still running then finishes first.
+             \return MMAL_SUCCESS, or MMAL_EIO after a write error
+             */
+            MMAL_STATUS_T flush();
+
+            /**
+             \return The number of fragments written
+             */
+            uint64_t fragments();
+
+            /**
+             \return The number of frames written
+             */
+            uint64_t frames();
+
+            /**
+             \return The number of bytes written
+             */
+            uint64_t bytes_written();
+
+            /**
+             \return The number of sample bytes that had to be copied because too many encoder buffers were pinned
+             */
+            uint64_t bytes_copied();
+
+            /**
+             \return true if a write failed
+             */
+            bool failed();
+
+            ~RaspiMP4Muxer();
+
+        protected:
+            RaspiMP4Muxer(int fd, RASPIMP4MUXER_OPTION_S options);
+
+        private:
+            typedef struct {
+                const uint8_t *data;        /**< Pinned data, or NULL if the piece was copied to staging */
+                uint32_t offset;            /**< Offset in staging of a copied piece */
+                uint32_t length;
+            } PIECE_S;
+
+            typedef struct {
+                uint32_t first_piece;
+                uint32_t pieces;
+                uint32_t length;
+            } NAL_S;
+
+            /**
+             A fragment, or the initialization segment, handed to the writer thread. Its iov points into header, lengths,
+             staging and the pinned buffers.
+             */
+            typedef struct {
+                vector< RaspiFrameRef > pins;
+                vector< uint8_t > staging;
+                vector< uint8_t > header;
+                vector< uint8_t > lengths;
+                vector< struct iovec > iov;
+                uint32_t frames;
+            } FRAGMENT_S;
+
+            typedef struct {
+                uint32_t first_nal;
+                uint32_t nals;
+                uint32_t size;
+                bool keyframe;
+                int64_t dts;
+                int64_t pts;
+            } SAMPLE_S;
+
+            void frame_done();
+            void write_init(MMAL_PORT_T *port);
+            void write_fragment(int64_t next_dts);
+            unique_ptr< FRAGMENT_S > take_fragment();
+            void queue_fragment(unique_ptr< FRAGMENT_S > fragment);
+            void clear_fragment(FRAGMENT_S &fragment);
+            void run();
+            MMAL_STATUS_T write_all(struct iovec *iov, size_t count);
+            int64_t ticks(int64_t us);
+
+            int fd_;
+            RASPIMP4MUXER_OPTION_S options_;
+            shared_ptr< RaspiH264Parser > parser;
+
+            // Only used by the callback and flush, under callback_lock
+            mutex callback_lock;
+            vector< uint8_t > sps;
+            vector< uint8_t > pps;
+            bool initialized;
+            bool skipping_nal;
+            uint32_t width;
+            uint32_t height;
+            int64_t origin;
+            int64_t frame_duration_us;
+            int64_t last_dts;
+            int64_t frame_pts;
+            int64_t frame_dts;
+            bool frame_open;
+            bool frame_keyframe;
+            uint32_t frame_first_nal;
+            uint32_t sequence;
+            uint32_t fragment_buffers;          /**< Encoder buffers with sample data in the open fragment */
+            uint64_t fragment_copied;           /**< Sample bytes of the open fragment copied to staging */
+            uint32_t reported_buffers;          /**< fragment_buffers of the last copied fragment that was logged */
+
+            unique_ptr< FRAGMENT_S > building;
+            vector< PIECE_S > pieces;
+            vector< NAL_S > nals;
+            vector< SAMPLE_S > samples;
+
+            // Shared with the writer thread, under lock
+            deque< unique_ptr< FRAGMENT_S > > ready;
+            vector< unique_ptr< FRAGMENT_S > > spare;
+            mutex lock;
+            condition_variable changed;
+            bool writing;
+            bool stopping;
+
+            thread worker;
+            std::atomic<uint32_t> pinned;       /**< Buffers pinned by the open fragment and fragments waiting to be written */
+            std::atomic<uint64_t> fragments_;
+            std::atomic<uint64_t> frames_;
+            std::atomic<uint64_t> bytes_written_;
+            std::atomic<uint64_t> bytes_copied_;
+            std::atomic<bool> failed_;
+    };
+
+}
+
+#endif /* __RASPIMP4MUXER_H__ */
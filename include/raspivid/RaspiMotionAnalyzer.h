@@ -0,0 +1,167 @@
+/**
+ \file RaspiMotionAnalyzer.h
+ */
+
+#ifndef __RASPIMOTIONANALYZER_H__
+#define __RASPIMOTIONANALYZER_H__
+
+#include <memory>
+#include <mutex>
+#include <stdint.h>
+#include <vector>
+
+#include "raspivid/RaspiCallback.h"
+
+using namespace std;
+
+namespace raspivid {
+
+    /**
+     \brief Motion analyzer parameter structure.
+     */
+    struct RASPIMOTIONANALYZER_OPTION_S {
+        uint32_t columns;               /**< Number of region columns the frame is divided into */
+        uint32_t rows;                  /**< Number of region rows the frame is divided into */
+        uint8_t min_magnitude;          /**< A macroblock moves if its vector is at least this long, in pixels */
+        uint16_t max_sad;               /**< Ignore vectors whose SAD is above this, as the encoder found no good match. 0 means no limit. */
+        float start_fraction;           /**< A region starts moving when at least this fraction of its macroblocks moves... */
+        uint32_t start_frames;          /**< ...for this many consecutive frames */
+        float stop_fraction;            /**< A moving region stops when less than this fraction of its macroblocks moves... */
+        uint32_t stop_frames;           /**< ...for this many consecutive frames */
+    };
+
+    /**
+     \typedef RASPIMOTIONANALYZER_REGION_S
+     \brief Motion in one region of the latest frame
+     */
+    typedef struct {
+        float fraction;                 /**< Fraction of the region's macroblocks that moved */
+        float magnitude;                /**< Root mean square vector length over the region, in pixels */
+        bool moving;                    /**< Region state after hysteresis */
+    } RASPIMOTIONANALYZER_REGION_S;
+
+    /**
+     \typedef RASPIMOTIONANALYZER_EVENT_S
+     \brief A region started or stopped moving
+     */
+    typedef struct {
+        uint32_t region;                /**< Region index, row * columns + column */
+        bool start;                     /**< true when the region started moving, false when it stopped */
+        float fraction;                 /**< Fraction of the region's macroblocks that moved in the frame that triggered the event */
+        int64_t pts;                    /**< Presentation timestamp of that frame */
+    } RASPIMOTIONANALYZER_EVENT_S;
+
+    /**
+     \class RaspiMotionAnalyzer "RaspiMotionAnalyzer.h"
+     \brief Detects motion from the inline motion vectors of the H.264 encoder.
+
+     Add it to an encoder output port with RaspiPort::add_callback, with RASPIENCODER_OPTION_S::inlineMotionVectors set.
+     The encoder follows each frame with a MMAL_BUFFER_HEADER_FLAG_CODECSIDEINFO buffer holding one 4 byte record per
+     macroblock of the crop rectangle: signed x and y vector components and a 16 bit SAD, with one extra column per macroblock
+     row. Rows follow from the crop width, not from the padded width of the encoder input. The frame is
+     divided into a grid of regions, and for each region the analyzer counts the macroblocks whose vector is at least
+     min_magnitude long and sums the squared vector lengths, using NEON, AVX2 or SSE2 where the compiler targets them.
+
+     A region starts moving after start_frames consecutive frames with at least start_fraction of its macroblocks moving,
+     and stops after stop_frames consecutive frames below stop_fraction. Events are delivered from post_process, after the
+     encoder buffer has been returned, by calling RaspiMotionAnalyzer::motion_event; subclass and override it to act on
+     them.
+     */
+    class RaspiMotionAnalyzer : public RaspiCallback {
+        public:
+            /**
+             \brief Creates default motion analyzer options: 4 x 3 regions, vectors of 2 pixels or more, no SAD limit,
+             starting at 5% of macroblocks for 3 frames and stopping below 2% for 15 frames.
+             \return A RASPIMOTIONANALYZER_OPTION_S struct
+             */
+            static RASPIMOTIONANALYZER_OPTION_S createDefaultMotionAnalyzerOptions();
+
+            /**
+             \brief Creates a motion analyzer with supplied options.
+             \param options Motion analyzer options
+             \return A shared pointer to a RaspiMotionAnalyzer
+             \see RaspiMotionAnalyzer::createDefaultMotionAnalyzerOptions()
+             */
+            static shared_ptr< RaspiMotionAnalyzer > create(RASPIMOTIONANALYZER_OPTION_S options);
+
+            /**
+             \brief Creates a motion analyzer with default options.
+             \return A shared pointer to a RaspiMotionAnalyzer
+             */
+            static shared_ptr< RaspiMotionAnalyzer > create();
+
+            void callback(MMAL_PORT_T *port, MMAL_BUFFER_HEADER_T *buffer);
+
+            void post_process();
+
+            /**
+             \brief Analyzes one frame of motion vectors. Called by the callback for MMAL_BUFFER_HEADER_FLAG_CODECSIDEINFO
+             buffers; call it directly to analyze vectors from elsewhere. Must not be called concurrently with itself.
+             \param records Motion vector records
+             \param length Length of the records in bytes
+             \param width Picture width in pixels, the crop width rather than the padded width of the encoder input
+             \param pts Presentation timestamp of the frame
+             \return MMAL_SUCCESS, or MMAL_EINVAL if the records are not whole rows for the picture width
+             */
+            MMAL_STATUS_T analyze(const uint8_t *records, uint32_t length, uint32_t width, int64_t pts);
+
+            /**
+             \brief Called from post_process for each motion event. Does nothing by default.
+             \param event The event
+             */
+            virtual void motion_event(const RASPIMOTIONANALYZER_EVENT_S &event) { };
+
+            /**
+             \brief Copies out the region map of the latest frame.
+             \param regions Receives columns x rows regions, row by row
+             \return The pts of the latest frame, or MMAL_TIME_UNKNOWN if none was analyzed yet
+             */
+            int64_t get_regions(vector< RASPIMOTIONANALYZER_REGION_S > &regions);
+
+            /**
+             \return true if any region is moving
+             */
+            bool moving();
+
+            /**
+             \return The number of frames analyzed
+             */
+            uint64_t frames();
+
+            virtual ~RaspiMotionAnalyzer() { };
+
+        protected:
+            RaspiMotionAnalyzer(RASPIMOTIONANALYZER_OPTION_S options);
+
+        private:
+            typedef struct {
+                uint32_t mbs;               /**< Macroblocks in the region */
+                uint32_t moving;            /**< Moving macroblocks in the current frame */
+                uint32_t sum;               /**< Sum of squared vector lengths in the current frame */
+                uint32_t frames;            /**< Consecutive frames past the start or stop threshold */
+                bool active;
+            } STATE_S;
+
+            void layout(uint32_t columns, uint32_t rows);
+
+            RASPIMOTIONANALYZER_OPTION_S options_;
+
+            // Only used by analyze
+            uint32_t mb_width;
+            uint32_t mb_height;
+            vector< uint32_t > column_start;
+            vector< uint32_t > row_region;
+            vector< STATE_S > state;
+
+            // Shared with readers and post_process, under lock
+            mutex lock;
+            vector< RASPIMOTIONANALYZER_REGION_S > regions;
+            vector< RASPIMOTIONANALYZER_EVENT_S > pending;
+            int64_t pts_;
+            uint64_t frames_;
+            uint32_t moving_regions;
+    };
+
+}
+
+#endif /* __RASPIMOTIONANALYZER_H__ */
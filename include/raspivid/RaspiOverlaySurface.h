@@ -0,0 +1,166 @@
+/**
+ \file RaspiOverlaySurface.h
+ */
+
+#ifndef __RASPIOVERLAYSURFACE_H__
+#define __RASPIOVERLAYSURFACE_H__
+
+#include <memory>
+#include <vector>
+#include <stdint.h>
+
+#include "raspivid/components/RaspiOverlayRenderer.h"
+
+/**
+ \brief Dirty rectangles a pool buffer collects before they are merged into their bounding box
+ */
+#define RASPIOVERLAYSURFACE_MAX_RECTS 16
+
+using namespace std;
+
+namespace raspivid {
+
+    /**
+     \brief How a RaspiOverlaySurface stores its canvas.
+     */
+    typedef enum {
+        RASPIOVERLAYSURFACE_DIRECT,     /**< Pixels in the overlay's encoding: RGB24, BGR24, RGBA or BGRA */
+        RASPIOVERLAYSURFACE_PALETTE8    /**< One byte per pixel, an index into a 256 colour palette expanded when copied */
+    } RASPIOVERLAYSURFACE_MODE_T;
+
+    /**
+     \typedef RASPIOVERLAYSURFACE_STATS_S
+     \brief What a RaspiOverlaySurface copied into the overlay's buffers.
+     \see RaspiOverlaySurface::get_stats
+     */
+    typedef struct {
+        uint64_t updates;               /**< Buffers sent to the overlay renderer */
+        uint64_t full_copies;           /**< Updates that copied the whole canvas, because the buffer was new or the palette changed */
+        uint64_t rects;                 /**< Rectangles copied */
+        uint64_t bytes;                 /**< Bytes written into buffers */
+    } RASPIOVERLAYSURFACE_STATS_S;
+
+    /**
+     \class RaspiOverlaySurface "RaspiOverlaySurface.h"
+     \brief A CPU-side canvas for a RaspiOverlayRenderer that sends only what changed.
+
+     Filling a whole buffer from RaspiOverlayRenderer::get_buffer for every update copies a full frame, about 6 MB at
+     1920x1080 in RGB24, even to change a timestamp. A surface keeps the picture in its own canvas and tracks the
+     rectangles drawn since each of the renderer's pool buffers was last filled. RaspiOverlaySurface::update takes the
+     next buffer, copies only the rectangles that buffer is missing and sends it, so with double buffering each change
+     is copied once per pool buffer and the rest of the buffer keeps its old, still correct, pixels. Rectangles are merged
+     into their bounding box once a buffer collects more than RASPIOVERLAYSURFACE_MAX_RECTS.
+
+     In RASPIOVERLAYSURFACE_PALETTE8 mode the canvas holds one byte per pixel, a third or a quarter of the overlay's
+     encoding, and indexes a palette of 0xAARRGGBB colours. With an RGBA or BGRA overlay, palette entries with a low
+     alpha let the video show through. Changing the palette repaints the whole overlay.
+
+     Draw into the canvas returned by RaspiOverlaySurface::get_canvas and report each change with
+     RaspiOverlaySurface::invalidate, or use RaspiOverlaySurface::fill, which does both. A surface is not thread safe.
+     */
+    class RaspiOverlaySurface {
+        public:
+            /**
+             \brief Creates a surface the size of an overlay renderer's frame. The canvas starts out transparent black.
+             \param overlay The overlay renderer. Its encoding must be RGB24, BGR24, RGBA or BGRA.
+             \param mode How the canvas is stored
+             \return A shared pointer to a RaspiOverlaySurface, or nullptr if the overlay's encoding is not supported
+             */
+            static shared_ptr< RaspiOverlaySurface > create(shared_ptr< RaspiOverlayRenderer > overlay, RASPIOVERLAYSURFACE_MODE_T mode = RASPIOVERLAYSURFACE_DIRECT);
+
+            /**
+             \return The canvas. Row y starts at get_canvas() + y * get_stride().
+             */
+            uint8_t* get_canvas();
+
+            /**
+             \return Bytes per canvas row
+             */
+            uint32_t get_stride();
+
+            /**
+             \return Bytes per canvas pixel: 1 in palette mode, otherwise 3 or 4
+             */
+            uint32_t get_bytes_per_pixel();
+
+            /**
+             \return The overlay's encoding, which is also the canvas's in direct mode
+             */
+            uint32_t get_encoding();
+
+            /**
+             \return Canvas width in pixels
+             */
+            uint32_t get_width();
+
+            /**
+             \return Canvas height in pixels
+             */
+            uint32_t get_height();
+
+            /**
+             \brief Marks part of the canvas as changed, so the next updates copy it.
+             \param rect The changed rectangle in pixels. Clipped to the canvas.
+             */
+            void invalidate(MMAL_RECT_T rect);
+
+            /**
+             \brief Fills a rectangle of the canvas and marks it as changed.
+             \param rect The rectangle in pixels. Clipped to the canvas.
+             \param colour A colour as 0xAARRGGBB, or a palette index in palette mode
+             */
+            void fill(MMAL_RECT_T rect, uint32_t colour);
+
+            /**
+             \brief Sets a palette entry. Changing an entry marks the whole canvas as changed.
+             \param index The entry, 0 to 255
+             \param colour The colour as 0xAARRGGBB
+             */
+            void set_palette(uint8_t index, uint32_t colour);
+
+            /**
+             \brief Copies the changes the next pool buffer is missing into it and sends it to the overlay renderer. Waits
+             for a buffer if the renderer holds them all.
+             \param force Send a buffer even when nothing changed
+             \return MMAL_SUCCESS, also when nothing was sent, or the status of sending the buffer
+             */
+            MMAL_STATUS_T update(bool force = false);
+
+            /**
+             \return A snapshot of the statistics
+             */
+            RASPIOVERLAYSURFACE_STATS_S get_stats();
+
+        protected:
+            RaspiOverlaySurface(shared_ptr< RaspiOverlayRenderer > overlay, RASPIOVERLAYSURFACE_MODE_T mode, uint32_t encoding);
+
+        private:
+            typedef struct {
+                MMAL_BUFFER_HEADER_T *buffer;
+                vector< MMAL_RECT_T > dirty;    /**< Rectangles changed since this buffer was last filled */
+                bool full;                      /**< The whole buffer needs filling */
+            } BUFFER_S;
+
+            void pixel(uint32_t colour, uint8_t *out);
+            void copy(MMAL_BUFFER_HEADER_T *buffer, const MMAL_RECT_T &rect);
+            void mark_all();
+
+            shared_ptr< RaspiOverlayRenderer > overlay;
+            RASPIOVERLAYSURFACE_MODE_T mode_;
+            uint32_t encoding_;
+            uint32_t width;
+            uint32_t height;
+            uint32_t out_bpp;                   /**< Bytes per pixel in the overlay's buffers */
+            uint32_t out_stride;
+            uint32_t bpp;
+            uint32_t stride;
+            vector< uint8_t > canvas;
+            uint8_t palette[256][4];            /**< Palette entries already in the overlay's byte order */
+            vector< BUFFER_S > buffers;         /**< Every pool buffer seen so far */
+            bool changed;                       /**< Something changed since the last update */
+            RASPIOVERLAYSURFACE_STATS_S stats;
+    };
+
+}
+
+#endif /* __RASPIOVERLAYSURFACE_H__ */
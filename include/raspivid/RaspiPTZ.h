@@ -0,0 +1,161 @@
+/**
+ \file RaspiPTZ.h
+ */
+
+#ifndef __RASPIPTZ_H__
+#define __RASPIPTZ_H__
+
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <stdint.h>
+
+#include "raspivid/RaspiCallback.h"
+#include "raspivid/RaspiCamControl.h"
+#include "raspivid/RaspiCameraControl.h"
+#include "raspivid/RaspiPortMetrics.h"
+
+/**
+ \brief 1.0 in the 16.16 fixed point of MMAL_PARAMETER_INPUT_CROP
+ */
+#define RASPIPTZ_ONE 65536
+
+using namespace std;
+
+namespace raspivid {
+
+    using namespace raspi_cam_control;
+
+    /**
+     \brief How a move spreads over its duration.
+     */
+    typedef enum {
+        RASPIPTZ_EASE_LINEAR,       /**< Constant speed */
+        RASPIPTZ_EASE_IN,           /**< Starts slowly and arrives at full speed */
+        RASPIPTZ_EASE_OUT,          /**< Starts at full speed and slows down on arrival */
+        RASPIPTZ_EASE_IN_OUT        /**< Starts and arrives slowly (smoothstep) */
+    } RASPIPTZ_EASING_T;
+
+    /**
+     \typedef RASPIPTZ_STATS_S
+     \brief What a RaspiPTZ did with the commands and frames it received.
+     \see RaspiPTZ::get_stats
+     */
+    typedef struct {
+        uint64_t commands;                      /**< Calls to RaspiPTZ::move_to */
+        uint64_t replaced;                      /**< Moves cut short by a newer command before they arrived */
+        uint64_t frames;                        /**< Frames seen */
+        uint64_t updates;                       /**< Crops sent to the camera, at most one per frame */
+        uint64_t busy;                          /**< Frames that found the previous crop still being sent */
+        uint64_t failed;                        /**< Crops the camera rejected */
+        RASPIPORT_HISTOGRAM_S update_duration;  /**< Time spent sending each crop, a round trip to the camera */
+    } RASPIPTZ_STATS_S;
+
+    /**
+     \class RaspiPTZ "RaspiPTZ.h"
+     \brief Digital pan, tilt and zoom: moves the camera's crop smoothly to a target region of interest.
+
+     raspicamcontrol_zoom_in_zoom_out reads and writes MMAL_PARAMETER_INPUT_CROP on each call and only steps the zoom by a
+     fixed amount around the centre. A RaspiPTZ takes a target region, a duration and an easing curve instead, and
+     interpolates the crop in the same 16.16 fixed point the camera uses. It is a RaspiCallback: add it to one port that
+     carries the camera's frames and it works out the crop for each frame, sending it when it moved, so the camera gets at
+     most one update per frame however often commands arrive. Commands never queue: a new target starts from wherever the
+     crop is at that moment and replaces the move in progress. The crop is sent from RaspiCallback::post_process, after
+     the frame went back to the port, and a frame that finds the previous update still in flight is skipped.
+
+     Crops are sent through RaspiCameraControl::set_crop, so the control's applied RASPICAM_CAMERA_PARAMETERS::roi and its
+     snapshots always hold the crop last sent. A RaspiCameraControl::apply that sends a different roi moves the crop there at
+     once and ends any move in progress. The crop is not read back from the camera, so nothing else should change it.
+     \see RaspiCamera::ptz
+     */
+    class RaspiPTZ : public RaspiCallback {
+        public:
+            /**
+             \brief Creates a PTZ controller and sets it as the control's roi listener. Nothing is sent until the first command.
+             \param control The camera's control, which sends the crops
+             \param initial The crop the camera currently uses, normalised to [0,1]
+             \return A shared pointer to a RaspiPTZ
+             \see RaspiCameraControl::set_roi_listener
+             */
+            static shared_ptr< RaspiPTZ > create(shared_ptr< RaspiCameraControl > control, PARAM_FLOAT_RECT_T initial = { 0.0, 0.0, 1.0, 1.0 });
+
+            /**
+             \brief Starts moving the crop to a new region from where it is now.
+             \param roi The target region, normalised to [0,1]. Clamped to the sensor.
+             \param duration_ms How long the move takes. 0 jumps on the next frame.
+             \param easing The easing curve
+             */
+            void move_to(PARAM_FLOAT_RECT_T roi, uint32_t duration_ms, RASPIPTZ_EASING_T easing = RASPIPTZ_EASE_IN_OUT);
+
+            /**
+             \brief Starts moving the crop to a new region from where it is now.
+             \param roi The target region in 16.16 fixed point. Clamped to the sensor.
+             \param duration_ms How long the move takes. 0 jumps on the next frame.
+             \param easing The easing curve
+             */
+            void move_to(MMAL_RECT_T roi, uint32_t duration_ms, RASPIPTZ_EASING_T easing = RASPIPTZ_EASE_IN_OUT);
+
+            /**
+             \return Where the crop should be now, in 16.16 fixed point
+             */
+            MMAL_RECT_T get_position();
+
+            /**
+             \return true while a move has not arrived or its last position has not been sent
+             */
+            bool is_moving();
+
+            /**
+             \return A snapshot of the statistics
+             */
+            RASPIPTZ_STATS_S get_stats();
+
+            /**
+             \brief Notes that a frame arrived. Buffers flushed while the port stops carry no frame and are ignored.
+             */
+            void callback(MMAL_PORT_T *port, MMAL_BUFFER_HEADER_T *buffer);
+
+            /**
+             \brief Sends the crop for the frame that just arrived, if it moved since the last one sent.
+             */
+            void post_process();
+
+            /**
+             \brief Interpolates between two crops.
+             \param from The crop at the start of the move
+             \param to The crop at the end of the move
+             \param progress How far the move is, 0 to RASPIPTZ_ONE
+             \param easing The easing curve
+             \return The crop at that point of the move
+             */
+            static MMAL_RECT_T interpolate(const MMAL_RECT_T &from, const MMAL_RECT_T &to, int32_t progress, RASPIPTZ_EASING_T easing);
+
+        protected:
+            RaspiPTZ(shared_ptr< RaspiCameraControl > control, PARAM_FLOAT_RECT_T initial);
+
+        private:
+            MMAL_RECT_T position(int64_t now_us);
+            void roi_applied(const PARAM_FLOAT_RECT_T &roi);
+
+            shared_ptr< RaspiCameraControl > control;
+            std::mutex lock;                                    /**< Guards the move and the last crop sent */
+            MMAL_RECT_T from;
+            MMAL_RECT_T to;
+            int64_t start_us;
+            int64_t duration_us;
+            RASPIPTZ_EASING_T easing_;
+            MMAL_RECT_T sent;                                   /**< The last crop the camera accepted */
+            std::atomic<bool> frame;                            /**< A frame arrived since the last post_process */
+            std::atomic<bool> sending;
+            std::atomic<uint64_t> commands;
+            std::atomic<uint64_t> replaced;
+            std::atomic<uint64_t> frames;
+            std::atomic<uint64_t> updates;
+            std::atomic<uint64_t> busy;
+            std::atomic<uint64_t> failed;
+            RaspiPortMetrics::Histogram update_duration;
+    };
+
+}
+
+#endif /* __RASPIPTZ_H__ */
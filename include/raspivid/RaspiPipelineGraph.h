@@ -0,0 +1,362 @@
+/**
+ \file RaspiPipelineGraph.h
+ */
+
+#ifndef __RASPIPIPELINEGRAPH_H__
+#define __RASPIPIPELINEGRAPH_H__
+
+#include <atomic>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "raspivid/RaspiExecutor.h"
+#include "raspivid/RaspiPort.h"
+#include "raspivid/components/RaspiComponent.h"
+#include "raspivid/components/RaspiCamera.h"
+#include "raspivid/components/RaspiEncoder.h"
+#include "raspivid/components/RaspiNullsink.h"
+#include "raspivid/components/RaspiRenderer.h"
+#include "raspivid/components/RaspiResize.h"
+#include "raspivid/components/RaspiSplitter.h"
+
+using namespace std;
+
+namespace raspivid {
+
+    /**
+     \brief The kind of a node in a RaspiPipelineGraph.
+     */
+    typedef enum {
+        RASPIPIPELINE_NODE_CAMERA,          /**< A RaspiCamera. Outputs MMAL_CAMERA_PREVIEW_PORT, MMAL_CAMERA_VIDEO_PORT and MMAL_CAMERA_CAPTURE_PORT */
+        RASPIPIPELINE_NODE_SPLITTER,        /**< A RaspiSplitter. One input, two outputs in the input's format */
+        RASPIPIPELINE_NODE_RESIZE,          /**< A RaspiResize. One input, one output */
+        RASPIPIPELINE_NODE_ENCODER,         /**< A RaspiEncoder. One input, one output */
+        RASPIPIPELINE_NODE_RENDERER,        /**< A RaspiRenderer. One input */
+        RASPIPIPELINE_NODE_NULLSINK,        /**< A RaspiNullsink. One input */
+        RASPIPIPELINE_NODE_APPLICATION      /**< Frames consumed by the application through callbacks or queues on the port feeding it. One input */
+    } RASPIPIPELINE_NODE_T;
+
+    /**
+     \typedef RASPIPIPELINE_SPAN_S
+     \brief A startup phase, on the RaspiPortMetrics::now_us clock. Both fields are 0 if the phase did not happen.
+     */
+    typedef struct {
+        int64_t start_us;               /**< When the phase began */
+        int64_t end_us;                 /**< When the phase ended */
+    } RASPIPIPELINE_SPAN_S;
+
+    /**
+     \typedef RASPIPIPELINE_TIMING_S
+     \brief Startup phases of one node of a RaspiPipelineGraph.
+     */
+    typedef struct {
+        string name;                        /**< Node name */
+        RASPIPIPELINE_SPAN_S create;        /**< The component's create(), which also sets up its own port formats and enables it */
+        RASPIPIPELINE_SPAN_S enable;        /**< mmal_component_enable, within create */
+        RASPIPIPELINE_SPAN_S commit;        /**< Committing the negotiated output formats that differ from the component's own */
+        RASPIPIPELINE_SPAN_S connect;       /**< Creating and enabling the connection to the node's input */
+        int64_t first_frame_us;             /**< For application endpoints, when the first frame arrived, or 0 */
+    } RASPIPIPELINE_TIMING_S;
+
+    /**
+     \typedef RASPIPIPELINE_STARTUP_S
+     \brief Where the time from RaspiPipelineGraph::build to the first frame went.
+     \see RaspiPipelineGraph::get_startup
+     */
+    typedef struct {
+        int64_t build_us;                           /**< When RaspiPipelineGraph::build was called */
+        int64_t built_us;                           /**< When it returned successfully, or 0 */
+        int64_t start_us;                           /**< When RaspiPipelineGraph::start was called, or 0 */
+        int64_t first_frame_us;                     /**< When the last application endpoint received its first frame, or 0 until all have */
+        unsigned int commits;                       /**< Port format commits made by the graph */
+        vector< RASPIPIPELINE_TIMING_S > nodes;     /**< Phases of each node, in the order they were created */
+    } RASPIPIPELINE_STARTUP_S;
+
+    /**
+     \typedef RASPIPIPELINE_RECONFIGURE_S
+     \brief How long a live format switch by RaspiPipelineGraph::reconfigure took, on the RaspiPortMetrics::now_us clock.
+     \see RaspiPipelineGraph::get_reconfigure
+     */
+    typedef struct {
+        int64_t start_us;               /**< When RaspiPipelineGraph::reconfigure was called */
+        int64_t stopped_us;             /**< When every affected connection and endpoint port had stopped */
+        int64_t end_us;                 /**< When all of them were running again, or 0 if the switch failed */
+        unsigned int ports;             /**< Output ports whose format changed */
+        unsigned int stopped;           /**< Connections and endpoint ports stopped and restarted. Everything else kept running */
+    } RASPIPIPELINE_RECONFIGURE_S;
+
+    /**
+     \class RaspiPipelineGraph "RaspiPipelineGraph.h"
+     \brief Builds a pipeline of components from a declared set of nodes and edges.
+
+     Wiring components by hand means calling connect on each one in the right order and patching port formats in between,
+     such as switching the camera's video port to MMAL_ENCODING_I420 before a resizer can use it. A pipeline graph instead
+     takes the whole topology first. RaspiPipelineGraph::negotiate then checks it and works out the encoding and size of
+     every port without creating any component: each port starts with the encodings its component supports, every edge and
+     every splitter narrows its ports to what they have in common, and each remaining choice takes the cheapest encoding,
+     MMAL_ENCODING_OPAQUE where all consumers are GPU components. A graph that cannot work, for example because an input is
+     not connected, there is a cycle, no encoding suits both ends of an edge, or the encoder would exceed the H.264 level 4.2
+     macroblock rate, is rejected at that point. RaspiPipelineGraph::build then creates the components in dependency order,
+     connects them, and commits only the port formats that differ from what a component already has.
+
+     Creating a component is the slow part of startup, and components only depend on each other through their connections.
+     Given an executor, RaspiPipelineGraph::build creates and configures all components concurrently and only then connects
+     them in dependency order. RaspiPipelineGraph::get_startup reports when each phase of each node began and ended, and when
+     the first frame reached each application endpoint.
+
+     A built graph can switch a camera's resolution or frame rate, or a resizer's output size, while it runs.
+     RaspiPipelineGraph::reconfigure negotiates the sizes again and only touches the output ports whose format changes: the
+     connections and endpoint ports they feed are stopped, downstream first, the new formats are committed, and they are
+     restarted upstream first, re-creating endpoint buffer pools whose buffers no longer fit. Components are never destroyed,
+     and anything not fed by a changed port, such as the output of a resizer behind a camera that changes resolution, keeps
+     delivering frames throughout.
+
+     \code
+     auto graph = RaspiPipelineGraph::create();
+     graph->add_camera("camera");
+     graph->add_splitter("splitter");
+     graph->add_encoder("encoder");
+     graph->add_resize("resize", 640, 480);
+     graph->add_application("frames", MMAL_ENCODING_I420);
+     graph->connect("camera", MMAL_CAMERA_VIDEO_PORT, "splitter");
+     graph->connect("splitter", 0, "encoder");
+     graph->connect("splitter", 1, "resize");
+     graph->connect("resize", 0, "frames");
+     if (graph->build() == MMAL_SUCCESS) {
+         graph->get_endpoint("frames")->add_queue(queue);
+         graph->start();
+     }
+     \endcode
+     */
+    class RaspiPipelineGraph {
+        public:
+            /**
+             \brief Creates an empty pipeline graph.
+             \return A shared pointer to a RaspiPipelineGraph
+             */
+            static shared_ptr< RaspiPipelineGraph > create();
+
+            /**
+             \brief Adds a camera.
+             \param name A name unique within the graph
+             \param options Camera options
+             \return MMAL_SUCCESS, or MMAL_EINVAL if the name is taken or the graph is already built
+             */
+            MMAL_STATUS_T add_camera(const string &name, RASPICAMERA_OPTION_S options = RaspiCamera::createDefaultCameraOptions());
+
+            /**
+             \brief Adds a splitter.
+             \param name A name unique within the graph
+             \return MMAL_SUCCESS, or MMAL_EINVAL if the name is taken or the graph is already built
+             */
+            MMAL_STATUS_T add_splitter(const string &name);
+
+            /**
+             \brief Adds a resizer.
+             \param name A name unique within the graph
+             \param width Output frame width
+             \param height Output frame height
+             \return MMAL_SUCCESS, or MMAL_EINVAL if the name is taken or the graph is already built
+             */
+            MMAL_STATUS_T add_resize(const string &name, uint32_t width, uint32_t height);
+
+            /**
+             \brief Adds an encoder. Its width, height and framerate options are replaced by those negotiated for its input.
+             \param name A name unique within the graph
+             \param options Encoder options
+             \return MMAL_SUCCESS, or MMAL_EINVAL if the name is taken or the graph is already built
+             */
+            MMAL_STATUS_T add_encoder(const string &name, RASPIENCODER_OPTION_S options = RaspiEncoder::createDefaultEncoderOptions());
+
+            /**
+             \brief Adds a preview renderer.
+             \param name A name unique within the graph
+             \param alpha Alpha transparency of the preview
+             \param layer Layer at which the preview is rendered
+             \return MMAL_SUCCESS, or MMAL_EINVAL if the name is taken or the graph is already built
+             */
+            MMAL_STATUS_T add_renderer(const string &name, int alpha = 255, int layer = PREVIEW_LAYER);
+
+            /**
+             \brief Adds a nullsink.
+             \param name A name unique within the graph
+             \return MMAL_SUCCESS, or MMAL_EINVAL if the name is taken or the graph is already built
+             */
+            MMAL_STATUS_T add_nullsink(const string &name);
+
+            /**
+             \brief Adds an application endpoint. No component is created for it; the application subscribes to the port that
+             feeds it, which is returned by RaspiPipelineGraph::get_endpoint. Several endpoints may share one output port.
+             \param name A name unique within the graph
+             \param encoding The encoding the application reads, or 0 for any encoding other than MMAL_ENCODING_OPAQUE
+             \return MMAL_SUCCESS, or MMAL_EINVAL if the name is taken or the graph is already built
+             */
+            MMAL_STATUS_T add_application(const string &name, uint32_t encoding = 0);
+
+            /**
+             \brief Adds an edge from an output port of one node to the input port of another.
+             \param from Name of the node supplying frames
+             \param output Output port index of that node
+             \param to Name of the node receiving frames
+             \param input Input port index of that node
+             \return MMAL_SUCCESS, or MMAL_EINVAL if a node or port does not exist, the input is already connected, the output
+             is already connected to a component, or the graph is already built
+             */
+            MMAL_STATUS_T connect(const string &from, unsigned int output, const string &to, unsigned int input = 0);
+
+            /**
+             \brief Checks the graph and decides the format of every output port, without creating any component. Called by
+             RaspiPipelineGraph::build, and may be called on its own to validate a graph.
+             \return MMAL_SUCCESS, or MMAL_EINVAL if the graph cannot work. The reason is logged.
+             \see RaspiPipelineGraph::get_format
+             */
+            MMAL_STATUS_T negotiate();
+
+            /**
+             \brief Negotiates formats, then creates and connects all components. If any step fails, the components created so
+             far are released.
+             \param executor If not nullptr, components are created and configured concurrently on this executor, for example a
+             RaspiThreadPoolExecutor with a thread per component, then connected on the calling thread. If nullptr, everything
+             runs on the calling thread in dependency order.
+             \return MMAL_SUCCESS, MMAL_EINVAL if the graph cannot work or is already built, MMAL_ENOSYS if a component could not
+             be created, or the error of a failing connection or format commit
+             */
+            MMAL_STATUS_T build(shared_ptr< RaspiExecutor > executor = nullptr);
+
+            /**
+             \brief Starts every camera in the graph.
+             \return MMAL_SUCCESS, MMAL_EINVAL if the graph is not built, or the error of the failing camera
+             */
+            MMAL_STATUS_T start();
+
+            /**
+             \brief Changes the size, and for a camera the frame rate, of a node in a running graph without rebuilding it.
+
+             The new sizes are negotiated first, so a switch the graph cannot take, for example one exceeding the encoder's
+             macroblock rate, is rejected before anything stops. Then only the output ports whose format changes are stopped,
+             committed and restarted, as described for RaspiPipelineGraph. Stopping an endpoint port waits for frames pinned by
+             the application, as RaspiPort::disable does. Call this from an application thread, never from a callback.
+             \param name Name of a camera or resizer node
+             \param width New frame width
+             \param height New frame height
+             \param framerate New camera frame rate, 0 for variable. Ignored for resizers.
+             \return MMAL_SUCCESS, MMAL_EINVAL if the graph is not built, the node is neither a camera nor a resizer, or the new
+             formats cannot work, MMAL_EAGAIN if an endpoint's frames were not released in time, in which case nothing was
+             changed, or the error of a failing commit or connection, in which case the previous sizes and formats are
+             committed again and every stopped port is restarted
+             \see RaspiPipelineGraph::get_reconfigure
+             */
+            MMAL_STATUS_T reconfigure(const string &name, uint32_t width, uint32_t height, uint32_t framerate);
+
+            /**
+             \brief Reports how long the last successful RaspiPipelineGraph::reconfigure took and how much of the graph it touched.
+             \return A RASPIPIPELINE_RECONFIGURE_S, all zero before the first switch
+             */
+            RASPIPIPELINE_RECONFIGURE_S get_reconfigure();
+
+            /**
+             \brief Reports startup timing. First frames are only seen once the application has subscribed to its endpoints.
+             \return A RASPIPIPELINE_STARTUP_S
+             */
+            RASPIPIPELINE_STARTUP_S get_startup();
+
+            /**
+             \brief Releases the components, downstream ones first. The graph's nodes and edges are kept, so it may be built again.
+             */
+            void destroy();
+
+            /**
+             \brief Gets the negotiated format of an output port, as RaspiPort::get_format returns it once built: width and
+             height padded, crop the visible picture.
+             \param name Node name
+             \param output Output port index
+             \return The format, with encoding 0 if the port does not exist or the graph has not been negotiated
+             */
+            RASPIPORT_FORMAT_S get_format(const string &name, unsigned int output);
+
+            /**
+             \param name Node name
+             \return The node's component, or nullptr if the node does not exist, has no component, or the graph is not built
+             */
+            shared_ptr< RaspiComponent > get_component(const string &name);
+
+            /**
+             \brief Gets a node's component as its own type, for example get< RaspiEncoder >("encoder").
+             \return The component, or nullptr if it does not exist or is of another type
+             */
+            template< class T > shared_ptr< T > get(const string &name) {
+                return dynamic_pointer_cast< T >(get_component(name));
+            }
+
+            /**
+             \param name Node name
+             \param output Output port index
+             \return The output port, or nullptr if it does not exist or the graph is not built
+             */
+            shared_ptr< RaspiPort > get_output(const string &name, unsigned int output);
+
+            /**
+             \param name Name of an application endpoint
+             \return The port feeding the endpoint, or nullptr if there is no such endpoint or the graph is not built
+             */
+            shared_ptr< RaspiPort > get_endpoint(const string &name);
+
+            ~RaspiPipelineGraph();
+
+        protected:
+            RaspiPipelineGraph();
+
+        private:
+            typedef struct {
+                string name;
+                RASPIPIPELINE_NODE_T type;
+                RASPICAMERA_OPTION_S camera;
+                RASPIENCODER_OPTION_S encoder;
+                uint32_t width;
+                uint32_t height;
+                int alpha;
+                int layer;
+                uint32_t encoding;
+                int source;                                 /**< Index of the edge into the node's input, or -1 */
+                vector< uint32_t > masks;                   /**< Encodings each output may still take, one bit per negotiable encoding */
+                vector< RASPIPORT_FORMAT_S > formats;       /**< Negotiated format of each output */
+                shared_ptr< RaspiComponent > component;
+                shared_ptr< RaspiPort > input;
+                vector< shared_ptr< RaspiPort > > outputs;
+                RASPIPIPELINE_TIMING_S timing;
+            } NODE_S;
+
+            typedef struct {
+                int from;
+                unsigned int output;
+                int to;
+            } EDGE_S;
+
+            MMAL_STATUS_T add_node(NODE_S node);
+            int find(const string &name);
+            MMAL_STATUS_T sort();
+            MMAL_STATUS_T narrow();
+            MMAL_STATUS_T size_formats();
+            MMAL_STATUS_T create_component(NODE_S &node);
+            MMAL_STATUS_T connect_node(NODE_S &node);
+            MMAL_STATUS_T commit_outputs(NODE_S &node);
+            vector< shared_ptr< RaspiPort > > consumers(int index, unsigned int output);
+            void roll_back(const vector< NODE_S > &previous, int index, bool resized, const vector< pair< int, unsigned int > > &changed,
+                const vector< shared_ptr< RaspiPort > > &stopped);
+
+            vector< NODE_S > nodes;
+            vector< EDGE_S > edges;
+            vector< int > order;                            /**< Node indices, every node after the node feeding it */
+            atomic< unsigned int > commits;
+            int64_t build_us;
+            int64_t built_us;
+            int64_t start_us;
+            RASPIPIPELINE_RECONFIGURE_S last_reconfigure;
+            bool negotiated;
+            bool built;
+    };
+
+}
+
+#endif /* __RASPIPIPELINEGRAPH_H__ */
@@ -7,21 +7,44 @@
 #define __RASPIPORT_H__
 
 #include <memory>
+#include <mutex>
 #include <string>
+#include <vector>
 #include "raspivid/RaspiCallback.h"
+#include "raspivid/RaspiExecutor.h"
+#include "raspivid/RaspiFrameQueue.h"
+#include "raspivid/RaspiFrameRef.h"
+#include "raspivid/RaspiPortMetrics.h"
 
 using namespace std;
 
 namespace raspivid {
+    /**
+     \typedef RASPIPORT_SUBSCRIBER_S
+     \brief A consumer of a port's buffers. Exactly one of callback and queue is set.
+
+     \see RaspiPort::add_callback
+     \see RaspiPort::add_queue
+      */
+    typedef struct {
+        shared_ptr< RaspiCallback > callback;   /**< Called on the port's callback thread. Never skips a buffer */
+        shared_ptr< RaspiFrameQueue > queue;    /**< Receives its own reference to each buffer. The queue's overflow policy decides what this subscriber drops */
+        int priority;                           /**< Subscribers with a higher priority are served first. Equal priorities are served in the order they were added */
+    } RASPIPORT_SUBSCRIBER_S;
+
     /**
      \typedef RASPIPORT_USERDATA_S;
      \brief An internal structure that manages callback data.
 
+     The subscriber list is replaced as a whole, never modified in place, so the callback thread can read it without locking.
      \see RaspiPort::add_callback
+     \see RaspiPort::add_queue
       */
     typedef struct {
-        shared_ptr< RaspiCallback > cb_instance;
+        shared_ptr< const vector< RASPIPORT_SUBSCRIBER_S > > subscribers;
+        shared_ptr< RaspiExecutor > executor;
         MMAL_POOL_T* pool;
+        RaspiPortMetrics* metrics;
     } RASPIPORT_USERDATA_S;
 
     /**
@@ -38,6 +61,18 @@ namespace raspivid {
         uint32_t frame_rate_den;        /**< Desired frame rate denominator */
     } RASPIPORT_FORMAT_S;
 
+    /**
+     \typedef RASPIPORT_POOL_POLICY_S
+     \brief Bounds and pacing for adaptive buffer pool sizing.
+     \see RaspiPort::adapt_pool
+      */
+    typedef struct {
+        uint32_t min_buffers;           /**< Smallest buffer_num RaspiPort::adapt_pool picks. The port's buffer_num_min is always respected */
+        uint32_t max_buffers;           /**< Largest buffer_num RaspiPort::adapt_pool picks */
+        uint32_t shrink_after;          /**< Consecutive RaspiPort::adapt_pool calls that must find a spare buffer before one is released */
+        uint32_t drain_timeout_ms;      /**< How long a resize waits for pinned buffers to be released */
+    } RASPIPORT_POOL_POLICY_S;
+
     /**
      \class RaspiPort "RaspiPort.h"
      \brief A wrapper class to manage a component port.
@@ -84,11 +119,148 @@ namespace raspivid {
 
             /**
              \brief Adds a callback to this port.
+
+             A port may have any number of callbacks and queues. They all see the same buffer, so one output can feed several
+             consumers without a splitter component. The port is enabled when the first subscriber is added.
+             Buffers are returned to the port when their last reference is released, so a callback may keep a frame
+             beyond its return by taking a RaspiFrameRef.
              \param callback A shared pointer to a RaspiCallback instance.
+             \param priority Callbacks and queues with a higher priority receive each buffer first.
              \return An MMAL_STATUS_T (MMAL_SUCCESS if the operation was successful).
              \see RaspiCallback
+             \see RaspiPort::remove_callback
+             */
+            MMAL_STATUS_T add_callback(shared_ptr< RaspiCallback > callback, int priority = 0);
+
+            /**
+             \brief Removes a callback added with RaspiPort::add_callback. The port stays enabled.
+             \param callback A shared pointer to a RaspiCallback instance.
+             \return MMAL_SUCCESS, or MMAL_EINVAL if the callback was not subscribed to this port.
+             */
+            MMAL_STATUS_T remove_callback(shared_ptr< RaspiCallback > callback);
+
+            /**
+             \brief Hands this port's buffers to a worker thread through a frame queue.
+
+             Buffers are queued without being copied. Each queue holds its own reference to a buffer, so a slow consumer of a
+             RASPIFRAMEQUEUE_DROP_OLDEST or RASPIFRAMEQUEUE_DROP_NEWEST queue only drops frames and does not hold up other
+             subscribers. A full RASPIFRAMEQUEUE_BLOCK queue waits on the port's callback thread, which stalls every other
+             callback and queue on this port until its consumer makes room. Queued buffers
+             and buffers held by the consumer are unavailable to the port, so buffer_num should exceed the queue depth plus the
+             buffers the consumer holds at once. Otherwise the port starves instead of the queue dropping frames. The consumer takes them with RaspiFrameQueue::wait
+             or RaspiFrameQueue::pop and must return each one with RaspiPort::release_buffer. The consumer should be
+             stopped before the port is destroyed; destroying the port closes the queue and releases any buffers still in it.
+             \param queue A shared pointer to a RaspiFrameQueue.
+             \param priority Callbacks and queues with a higher priority receive each buffer first.
+             \return An MMAL_STATUS_T (MMAL_SUCCESS if the operation was successful).
+             \see RaspiFrameQueue
+             \see RaspiPort::release_buffer
+             \see RaspiPort::add_callback
+             */
+            MMAL_STATUS_T add_queue(shared_ptr< RaspiFrameQueue > queue, int priority = 0);
+
+            /**
+             \brief Stops queueing buffers to a queue added with RaspiPort::add_queue. Buffers already in the queue must still be
+             released by its consumer.
+             \param queue A shared pointer to a RaspiFrameQueue.
+             \return MMAL_SUCCESS, or MMAL_EINVAL if the queue was not subscribed to this port.
+             */
+            MMAL_STATUS_T remove_queue(shared_ptr< RaspiFrameQueue > queue);
+
+            /**
+             \brief Releases a buffer taken from this port's frame queue. The buffer is sent back to the port once no
+             RaspiFrameRef holds it any more.
+             \param buffer[in] A C pointer to an MMAL_BUFFER_HEADER_T obtained from the queue.
+             \see RaspiPort::add_queue
+             */
+            void release_buffer(MMAL_BUFFER_HEADER_T *buffer);
+
+            /**
+             \brief Sets where RaspiCallback::post_process runs for this port's callbacks.
+
+             By default post processing runs on the MMAL callback thread, which delays the next buffer on this port and on every other
+             port served by the same thread. With an executor the callback thread only hands the work off. One executor may be shared
+             by several ports. If the executor drops a task, that post_process call is skipped.
+             \param executor A shared pointer to a RaspiExecutor, or nullptr to run post processing inline.
+             \see RaspiThreadExecutor
+             \see RaspiThreadPoolExecutor
+             */
+            void set_executor(shared_ptr< RaspiExecutor > executor);
+
+            /**
+             \brief Returns a struct containing the default pool policy
+             \return a RASPIPORT_POOL_POLICY_S
+             \see RaspiPort::set_pool_policy
+             */
+            static RASPIPORT_POOL_POLICY_S createDefaultPoolPolicy();
+
+            /**
+             \brief Sets the bounds used by RaspiPort::adapt_pool. Takes effect the next time the pool is adapted.
+             \param policy A RASPIPORT_POOL_POLICY_S
+             */
+            void set_pool_policy(RASPIPORT_POOL_POLICY_S policy);
+
+            /**
+             \brief Grows or shrinks the buffer pool of a port with callbacks or queues, based on its metrics since the previous call.
+
+             The pool grows as soon as the port was starved, to cover the most buffers consumers held at once or the frame rate times the
+             99th percentile hold time, plus one buffer for the port to fill. It shrinks by one buffer after RASPIPORT_POOL_POLICY_S::shrink_after
+             calls in a row that found a spare buffer. Resizing briefly disables the port, so call this from an application thread, for example
+             once a second, and never from a callback.
+             \return MMAL_SUCCESS if the pool is already the right size or was resized, or the error from RaspiPort::resize_pool.
+             \see RaspiPort::set_pool_policy
+             */
+            MMAL_STATUS_T adapt_pool();
+
+            /**
+             \brief Re-creates the buffer pool of a port with callbacks or queues with a new number of buffers.
+
+             The port is disabled while all buffers, including ones pinned by RaspiFrameRef or frame queues, come back. If they are not released
+             within RASPIPORT_POOL_POLICY_S::drain_timeout_ms, the old pool is kept and the port re-enabled. The pool policy's min_buffers and
+             max_buffers do not apply here; only the port's buffer_num_min does.
+             \param buffer_num The new number of buffers
+             \return An MMAL_STATUS_T (MMAL_SUCCESS if the operation was successful, MMAL_EAGAIN if buffers were not released in time).
+             */
+            MMAL_STATUS_T resize_pool(uint32_t buffer_num);
+
+            /**
+             \brief Stops this port so that the format of the output feeding it can change while the rest of the pipeline keeps running.
+
+             An input port disables its connection, which also stops the output port on the other side. An output port with callbacks or
+             queues is disabled and waits, as RaspiPort::resize_pool does, for buffers pinned by consumers or frame queues to come back, so
+             no frame in the old format is handed out after this returns. Other ports are left as they are.
+             \return An MMAL_STATUS_T (MMAL_SUCCESS if the operation was successful, MMAL_EAGAIN if buffers were not released in time, in
+             which case the port is enabled again).
+             \see RaspiPort::enable
+             */
+            MMAL_STATUS_T disable();
+
+            /**
+             \brief Restarts a port stopped by RaspiPort::disable with the format committed in the meantime.
+
+             An input port takes over the format of the output port feeding it and commits it before enabling the connection. An output port
+             with callbacks or queues re-creates its buffer pool if the new format needs a different buffer size, and otherwise reuses it.
+             \return An MMAL_STATUS_T (MMAL_SUCCESS if the operation was successful).
+             \see RaspiPort::disable
+             */
+            MMAL_STATUS_T enable();
+
+            /**
+             \return The number of buffers in this port's pool, or the port's buffer_num if no pool has been created.
+             */
+            uint32_t get_buffer_num();
+
+            /**
+             \brief Returns a snapshot of this port's runtime metrics. Metrics are collected for ports with callbacks or queues.
+             \return A RASPIPORT_METRICS_S
+             \see RaspiPortMetrics
+             */
+            RASPIPORT_METRICS_S get_metrics();
+
+            /**
+             \brief Clears this port's runtime metrics.
              */
-            MMAL_STATUS_T add_callback(shared_ptr< RaspiCallback > callback);
+            void reset_metrics();
 
             /**
              \brief Connects this port to another port.
@@ -150,6 +322,18 @@ namespace raspivid {
             RaspiPort(MMAL_PORT_T *port, string port_name_);
         private:
             static void callback_wrapper(MMAL_PORT_T *port, MMAL_BUFFER_HEADER_T *buffer);
+            static MMAL_BOOL_T pool_callback(MMAL_POOL_T *pool, MMAL_BUFFER_HEADER_T *buffer, void *userdata);
+            MMAL_STATUS_T enable_with_pool(MMAL_PORT_BH_CB_T cb);
+            void send_pool_buffers();
+            bool drain_pool();
+            MMAL_STATUS_T subscribe(RASPIPORT_SUBSCRIBER_S subscriber);
+            MMAL_STATUS_T unsubscribe(shared_ptr< RaspiCallback > callback, shared_ptr< RaspiFrameQueue > queue);
+            std::mutex subscribers_lock;
+            RaspiPortMetrics metrics;
+            RASPIPORT_POOL_POLICY_S pool_policy;
+            RASPIPORT_HISTOGRAM_S adapted_hold_time;
+            uint64_t adapted_starved;
+            uint32_t spare_rounds;
             RASPIPORT_USERDATA_S userdata;
             MMAL_POOL_T *pool;
             MMAL_PORT_T *port;
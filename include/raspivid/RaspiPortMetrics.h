@@ -0,0 +1,170 @@
+/**
+ \file RaspiPortMetrics.h
+ */
+
+#ifndef __RASPIPORTMETRICS_H__
+#define __RASPIPORTMETRICS_H__
+
+#include <atomic>
+#include <memory>
+#include <vector>
+#include <stdint.h>
+
+#include "interface/vcos/vcos.h"
+#include "interface/mmal/mmal.h"
+
+/**
+ \brief Number of buckets in a RASPIPORT_HISTOGRAM_S
+ */
+#define RASPIPORT_HISTOGRAM_BUCKETS 24
+
+namespace raspivid {
+
+    /**
+     \typedef RASPIPORT_HISTOGRAM_S
+     \brief A snapshot of a histogram of durations with power-of-two microsecond buckets.
+     */
+    typedef struct {
+        uint64_t buckets[RASPIPORT_HISTOGRAM_BUCKETS];  /**< buckets[0] counts values below 2 us, buckets[i] values in [2^i, 2^(i+1)) us. The last bucket also counts everything above */
+        uint64_t count;                                 /**< Number of recorded values */
+        uint64_t sum_us;                                /**< Sum of recorded values */
+        uint64_t max_us;                                /**< Largest recorded value */
+    } RASPIPORT_HISTOGRAM_S;
+
+    /**
+     \typedef RASPIPORT_METRICS_S
+     \brief A snapshot of a port's runtime metrics.
+     \see RaspiPort::get_metrics
+     */
+    typedef struct {
+        uint64_t buffers;                           /**< Buffers received from the port */
+        uint64_t frames;                            /**< Buffers that ended a frame (MMAL_BUFFER_HEADER_FLAG_FRAME_END) */
+        uint64_t bytes;                             /**< Payload bytes received */
+        uint64_t starved;                           /**< Times the port was left without a buffer to fill */
+        double fps;                                 /**< Frame rate derived from the mean frame interval */
+        double jitter_us;                           /**< Standard deviation of the frame interval */
+        RASPIPORT_HISTOGRAM_S frame_interval;       /**< Time between consecutive frame ends */
+        RASPIPORT_HISTOGRAM_S callback_duration;    /**< Time spent serving all subscribers of a buffer, including post processing */
+        RASPIPORT_HISTOGRAM_S hold_time;            /**< Time from receiving a buffer until it goes back to the port, including time pinned by a RaspiFrameRef or queue */
+        int64_t held;                               /**< Buffers currently received and not yet returned to the port */
+        int64_t peak_held;                          /**< Most buffers held at once since the last reset */
+        int64_t first_frame_us;                     /**< When the first frame since the last reset arrived, on the RaspiPortMetrics::now_us clock, or 0 */
+    } RASPIPORT_METRICS_S;
+
+    /**
+     \class RaspiPortMetrics "RaspiPortMetrics.h"
+     \brief Lock-free counters and histograms updated by RaspiPort on its callback thread.
+
+     Every value is a relaxed atomic, so recording costs a few uncontended atomic adds per buffer and metrics can be left on.
+     Values are read individually, so a snapshot taken while buffers arrive may be off by one buffer between fields.
+     \see RaspiPort::get_metrics
+     */
+    class RaspiPortMetrics {
+        public:
+            RaspiPortMetrics();
+
+            /**
+             \return A monotonic timestamp in microseconds
+             */
+            static int64_t now_us();
+
+            /**
+             \brief Sets the pool whose buffers the port sends, so their receive times can be kept by buffer. Call while none of
+             its buffers is held, and with NULL before the pool is destroyed.
+             \param pool The port's pool, or NULL
+             */
+            void set_pool(MMAL_POOL_T *pool);
+
+            /**
+             \brief Records a buffer about to be handed to the port.
+             */
+            void buffer_sent();
+
+            /**
+             \brief Undoes RaspiPortMetrics::buffer_sent for a buffer the port did not accept.
+             */
+            void buffer_send_failed();
+
+            /**
+             \brief Records a buffer returned by the port.
+             \param port The MMAL port that returned the buffer
+             \param buffer The buffer
+             \param now_us The time the buffer was received, from RaspiPortMetrics::now_us
+             */
+            void buffer_received(MMAL_PORT_T *port, MMAL_BUFFER_HEADER_T *buffer, int64_t now_us);
+
+            /**
+             \brief Records a buffer going back to the port after its last reference was released.
+             \param buffer The buffer
+             \param now_us The current time, from RaspiPortMetrics::now_us
+             */
+            void buffer_returned(MMAL_BUFFER_HEADER_T *buffer, int64_t now_us);
+
+            /**
+             \brief Records how long serving a buffer took.
+             \param start_us The time the buffer was received, from RaspiPortMetrics::now_us
+             */
+            void callback_done(int64_t start_us);
+
+            /**
+             \return A snapshot of all metrics
+             */
+            RASPIPORT_METRICS_S snapshot();
+
+            /**
+             \brief Clears all counters and histograms. Buffers currently owned by the port are still accounted for.
+             */
+            void reset();
+
+            /**
+             \brief Restarts peak_held from the number of buffers held now.
+             */
+            void reset_peak_held();
+
+            /**
+             \brief Estimates a percentile from a histogram snapshot.
+             \param histogram A histogram snapshot
+             \param percentile A percentile between 0 and 100
+             \return The upper bound of the bucket containing the percentile, in microseconds, capped at the largest recorded value
+             */
+            static uint64_t percentile(const RASPIPORT_HISTOGRAM_S &histogram, double percentile);
+
+            /**
+             \brief A histogram of durations that one thread at a time records into and any thread may read.
+             */
+            class Histogram {
+                public:
+                    Histogram();
+                    void record(uint64_t value_us);
+                    void read(RASPIPORT_HISTOGRAM_S &result);
+                    void reset();
+                private:
+                    std::atomic<uint64_t> buckets[RASPIPORT_HISTOGRAM_BUCKETS];
+                    std::atomic<uint64_t> count;
+                    std::atomic<uint64_t> sum_us;
+                    std::atomic<uint64_t> max_us;
+            };
+
+        private:
+            int find_buffer(MMAL_BUFFER_HEADER_T *buffer);
+
+            std::vector< MMAL_BUFFER_HEADER_T * > headers;          /**< The pool's buffers, in pool order */
+            std::unique_ptr< std::atomic<int64_t>[] > received_us;  /**< When each of headers was received, 0 while it is not held */
+            std::atomic<uint64_t> buffers;
+            std::atomic<uint64_t> frames;
+            std::atomic<uint64_t> bytes;
+            std::atomic<uint64_t> starved;
+            std::atomic<int64_t> port_buffers;          /**< Buffers currently owned by the port */
+            std::atomic<int64_t> first_frame_us;
+            std::atomic<int64_t> last_frame_us;
+            std::atomic<uint64_t> interval_sum_squares;
+            std::atomic<int64_t> held;
+            std::atomic<int64_t> peak_held;
+            Histogram frame_interval;
+            Histogram callback_duration;
+            Histogram hold_time;
+    };
+
+}
+
+#endif /* __RASPIPORTMETRICS_H__ */
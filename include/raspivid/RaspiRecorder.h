@@ -0,0 +1,205 @@
+/**
+ \file RaspiRecorder.h
+ */
+
+#ifndef __RASPIRECORDER_H__
+#define __RASPIRECORDER_H__
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <stdint.h>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "raspivid/RaspiCallback.h"
+#include "raspivid/RaspiH264Parser.h"
+
+using namespace std;
+
+namespace raspivid {
+
+    /**
+     \brief How RaspiRecorder writes to storage.
+     */
+    typedef enum {
+        RASPIRECORDER_IO_AUTO,          /**< io_uring if the kernel supports it, pwrite otherwise */
+        RASPIRECORDER_IO_URING,         /**< io_uring, with several writes in flight. Falls back to pwrite if unavailable. */
+        RASPIRECORDER_IO_PWRITE         /**< One pwrite at a time */
+    } RASPIRECORDER_IO_T;
+
+    struct RASPIRECORDER_URING_S;
+
+    /**
+     \brief Recorder parameter structure.
+     */
+    struct RASPIRECORDER_OPTION_S {
+        string path;                    /**< printf style pattern for segment file names, with one %u for the segment number. For example "video-%04u.h264". */
+        uint32_t segment_ms;            /**< Start a new segment at the first keyframe after this many milliseconds. 0 means no limit. */
+        uint64_t segment_bytes;         /**< Start a new segment at the first keyframe after this many bytes. 0 means no limit. */
+        uint32_t buffer_size;           /**< Size of each I/O buffer in bytes, rounded up to a multiple of 4096 */
+        uint32_t buffers;               /**< Number of I/O buffers, at least 2 */
+        RASPIRECORDER_IO_T io;          /**< I/O method */
+        bool direct;                    /**< Open segments with O_DIRECT, bypassing the page cache, where the file system allows it */
+    };
+
+    /**
+     \class RaspiRecorder "RaspiRecorder.h"
+     \brief Records H.264 encoder output to a series of Annex B files, writing on a dedicated I/O thread.
+
+     Add it to an encoder output port with RaspiPort::add_callback. The callback only copies the encoded data into one of a
+     fixed set of I/O buffers, allocated up front, and hands full buffers to the I/O thread, so slow storage never stalls
+     the encoder. A new segment is started at the first keyframe after segment_ms or segment_bytes, and each segment starts
+     with SPS and PPS so it can be played on its own.
+
+     The buffers absorb storage stalls: buffers x buffer_size should exceed the bitrate times the longest expected stall.
+     The defaults, 8 buffers of 1 MB, cover about 3.5 s at 17 Mbit/s. If the I/O thread falls so far behind that no buffer
+     is free, frames are dropped until the next keyframe, so the recorded stream stays decodable. A frame is only written
+     once all of it is in the buffers, so buffers x buffer_size must also exceed the largest frame.
+     */
+    class RaspiRecorder : public RaspiCallback {
+        public:
+            /**
+             \brief Creates default recorder options: "segment-%04u.h264", 60 s segments, 8 buffers of 1 MB, automatic I/O
+             method, O_DIRECT.
+             \return A RASPIRECORDER_OPTION_S struct
+             */
+            static RASPIRECORDER_OPTION_S createDefaultRecorderOptions();
+
+            /**
+             \brief Creates a recorder and starts its I/O thread. Segments are only created once data arrives.
+             \param options Recorder options
+             \return A shared pointer to a RaspiRecorder, or nullptr if the buffers could not be allocated
+             \see RaspiRecorder::createDefaultRecorderOptions()
+             */
+            static shared_ptr< RaspiRecorder > create(RASPIRECORDER_OPTION_S options);
+
+            void callback(MMAL_PORT_T *port, MMAL_BUFFER_HEADER_T *buffer);
+
+            /**
+             \brief Closes the current segment, waits for all data to be written and stops the I/O thread. Remove the recorder
+             from its port first. Called by the destructor.
+             \return MMAL_SUCCESS, or MMAL_EIO if any write failed
+             */
+            MMAL_STATUS_T stop();
+
+            /**
+             \return The I/O method in use, RASPIRECORDER_IO_URING or RASPIRECORDER_IO_PWRITE
+             */
+            RASPIRECORDER_IO_T io_method();
+
+            /**
+             \return The number of segments completed
+             */
+            uint32_t segments();
+
+            /**
+             \return The number of frames handed to the I/O thread
+             */
+            uint64_t frames_recorded();
+
+            /**
+             \return The number of frames dropped because no I/O buffer was free
+             */
+            uint64_t frames_dropped();
+
+            /**
+             \return The number of bytes written to storage
+             */
+            uint64_t bytes_written();
+
+            /**
+             \return The number of failed writes, opens or closes
+             */
+            uint64_t errors();
+
+            /**
+             \return The longest time a write took, in microseconds
+             */
+            uint64_t max_write_us();
+
+            ~RaspiRecorder();
+
+        protected:
+            RaspiRecorder(RASPIRECORDER_OPTION_S options);
+
+        private:
+            typedef struct {
+                int buffer;                 /**< I/O buffer index, or -1 for a segment end without data */
+                uint32_t length;
+                uint32_t segment;
+                bool start;                 /**< Open the segment file first */
+                bool end;                   /**< Close the segment file afterwards */
+            } JOB_S;
+
+            bool allocate();
+            bool put(const uint8_t *data, uint32_t length);
+            void begin_frame();
+            void commit_frame();
+            void rollback_frame();
+            void submit(bool end);
+            void push_job(int buffer, uint32_t length, bool end);
+            void start_segment(int64_t pts);
+            void end_segment();
+            void run();
+            void process(vector< JOB_S > &batch);
+            bool open_segment(uint32_t segment);
+            void close_segment();
+            bool write_pwrite(const uint8_t *data, uint32_t length, uint64_t offset);
+            void note_error();
+
+            RASPIRECORDER_OPTION_S options_;
+            shared_ptr< RaspiH264Parser > parser;
+
+            // Only used by the callback
+            vector< uint8_t > config;
+            bool config_pending;
+            bool frame_open;
+            bool frame_skipped;
+            bool waiting_for_keyframe;
+            bool segment_open;
+            bool segment_started;
+            uint32_t segment;
+            int64_t segment_start_pts;
+            uint64_t segment_bytes;
+            int current;
+            uint32_t filled;
+            vector< int > staged;               /**< Buffers the open frame filled, submitted once it is complete */
+            int frame_buffer;                   /**< current when the open frame began */
+            uint32_t frame_filled;              /**< filled when the open frame began */
+            uint64_t frame_segment_bytes;       /**< segment_bytes when the open frame began */
+            bool frame_config_pending;          /**< config_pending when the open frame began */
+
+            // Shared with the I/O thread, under lock
+            vector< uint8_t* > buffers_;
+            vector< int > free_buffers;
+            deque< JOB_S > jobs;
+            mutex lock;
+            condition_variable available;
+            bool stopping;
+
+            // Only used by the I/O thread
+            struct RASPIRECORDER_URING_S *uring;
+            int fd;
+            bool fd_direct;
+            uint64_t file_offset;
+            uint64_t file_size;
+
+            std::atomic<RASPIRECORDER_IO_T> io_;   /**< The I/O method in use, set by the I/O thread once it falls back to pwrite */
+
+            thread worker;
+            std::atomic<bool> stopped;
+            std::atomic<uint32_t> segments_;
+            std::atomic<uint64_t> frames_recorded_;
+            std::atomic<uint64_t> frames_dropped_;
+            std::atomic<uint64_t> bytes_written_;
+            std::atomic<uint64_t> errors_;
+            std::atomic<uint64_t> max_write_us_;
+    };
+
+}
+
+#endif /* __RASPIRECORDER_H__ */
@@ -0,0 +1,164 @@
+/**
+ \file RaspiTextRasterizer.h
+ */
+
+#ifndef __RASPITEXTRASTERIZER_H__
+#define __RASPITEXTRASTERIZER_H__
+
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+#include <stdint.h>
+
+#include "raspivid/RaspiOverlaySurface.h"
+
+using namespace std;
+
+namespace raspivid {
+
+    /**
+     \brief Instruction set used by a RaspiTextRasterizer to blend text.
+     */
+    typedef enum {
+        RASPITEXT_PATH_AUTO,            /**< The fastest path the build supports */
+        RASPITEXT_PATH_SCALAR,          /**< Plain C++, the reference for all other paths */
+        RASPITEXT_PATH_SSE2,            /**< x86 SSE2 */
+        RASPITEXT_PATH_NEON             /**< ARM NEON, if the compiler targets it (aarch64, or -mfpu=neon on 32 bit ARM) */
+    } RASPITEXT_PATH_T;
+
+    /**
+     \typedef RASPITEXT_TARGET_S
+     \brief Packed pixels to draw text into.
+     */
+    typedef struct {
+        uint8_t *data;                  /**< The top left pixel */
+        uint32_t stride;                /**< Bytes from one row to the next */
+        uint32_t width;                 /**< Width in pixels */
+        uint32_t height;                /**< Height in pixels */
+        uint32_t encoding;              /**< MMAL_ENCODING_RGB24, BGR24, RGBA or BGRA */
+    } RASPITEXT_TARGET_S;
+
+    /**
+     \typedef RASPITEXT_STATS_S
+     \brief How much work a RaspiTextRasterizer did.
+     \see RaspiTextRasterizer::get_stats
+     */
+    typedef struct {
+        uint64_t draws;                 /**< Calls to RaspiTextRasterizer::draw */
+        uint64_t layout_hits;           /**< Draws that found their text already laid out */
+        uint64_t layout_misses;         /**< Draws that laid out their text from the glyph atlas */
+        uint64_t glyphs;                /**< Glyphs copied out of the atlas while laying out text */
+        uint64_t bytes;                 /**< Target bytes blended */
+    } RASPITEXT_STATS_S;
+
+    /**
+     \class RaspiTextRasterizer "RaspiTextRasterizer.h"
+     \brief Draws text into RaspiOverlayRenderer buffers or a RaspiOverlaySurface, for overlays the camera's annotation
+     cannot show: more than MMAL_CAMERA_ANNOTATE_MAX_TEXT_LEN_V3 characters, several lines, or any position.
+
+     The built-in 5x7 font covers printable ASCII; other characters are drawn as '?'. Every glyph is rasterized once, at
+     creation, into an atlas of 8 bit coverage scaled up by an integer factor. Drawing a string composes its glyphs from
+     the atlas into a coverage mask laid out for the target's pixel size, and keeps the mask in a small cache, so a
+     string that does not change is never laid out again. The mask is then alpha-blended over the target, skipping
+     empty rows and columns, with SSE2 or NEON where available. The results are identical on every path.
+
+     Lines are separated by '\\n'. A rasterizer is not thread safe.
+     */
+    class RaspiTextRasterizer {
+        public:
+            /**
+             \brief Creates a text rasterizer and rasterizes its glyph atlas.
+             \param scale Size of a font pixel in target pixels, 1 to 16. Glyph cells are 6 * scale by 8 * scale pixels.
+             \param path Instruction set to use
+             \param cache_entries Laid out strings to keep. 0 lays out every string on every draw.
+             \return A shared pointer to RaspiTextRasterizer, or nullptr if the scale is out of range or the path is not
+             available in this build
+             */
+            static shared_ptr< RaspiTextRasterizer > create(unsigned int scale = 2, RASPITEXT_PATH_T path = RASPITEXT_PATH_AUTO, unsigned int cache_entries = 64);
+
+            /**
+             \brief Describes an overlay buffer with the padded layout RaspiOverlayRenderer commits.
+             \param data Start of the buffer
+             \param format The overlay renderer's format
+             \return The target
+             */
+            static RASPITEXT_TARGET_S target(uint8_t *data, const RASPIOVERLAYRENDERER_FORMAT_S &format);
+
+            /**
+             \param text The text
+             \return The size of the text in pixels, at position 0, 0
+             */
+            MMAL_RECT_T measure(const string &text);
+
+            /**
+             \brief Draws text.
+             \param target Where to draw
+             \param x Left edge of the text
+             \param y Top edge of the text
+             \param text The text
+             \param colour Text colour as 0xAARRGGBB. The alpha scales the glyphs' coverage.
+             \param background Colour of a box blended behind the text as 0xAARRGGBB, 0 for none
+             \return The rectangle of the target that changed, clipped to the target. Empty if nothing was drawn.
+             */
+            MMAL_RECT_T draw(const RASPITEXT_TARGET_S &target, int32_t x, int32_t y, const string &text, uint32_t colour, uint32_t background = 0);
+
+            /**
+             \brief Draws text into a surface's canvas and invalidates the rectangle that changed.
+             \param surface A surface in RASPIOVERLAYSURFACE_DIRECT mode. Nothing is drawn in palette mode.
+             \see RaspiTextRasterizer::draw
+             */
+            MMAL_RECT_T draw(shared_ptr< RaspiOverlaySurface > surface, int32_t x, int32_t y, const string &text, uint32_t colour, uint32_t background = 0);
+
+            /**
+             \return The instruction set in use
+             */
+            RASPITEXT_PATH_T path();
+
+            /**
+             \return A short name for the instruction set in use
+             */
+            const char* name();
+
+            /**
+             \return A snapshot of the statistics
+             */
+            RASPITEXT_STATS_S get_stats();
+
+        protected:
+            RaspiTextRasterizer(unsigned int scale, RASPITEXT_PATH_T path, unsigned int cache_entries);
+
+        private:
+            typedef void (*BLEND_F)(uint8_t *dst, const uint8_t *colour, const uint8_t *alpha, uint32_t bytes);
+
+            typedef struct {
+                uint32_t width;                     /**< In pixels */
+                uint32_t height;
+                uint32_t bpp;
+                vector< uint8_t > alpha;            /**< Coverage repeated for every byte of a pixel, width * bpp per row */
+                vector< uint32_t > spans;           /**< First and last covered pixel + 1 of each row, 0 0 for an empty row */
+                uint64_t used;                      /**< Draw count when last used, to find the least recently used layout */
+            } LAYOUT_S;
+
+            const LAYOUT_S& layout(const string &text, uint32_t bpp);
+            void lay_out(const string &text, LAYOUT_S &result);
+            void fill_row(vector< uint8_t > &row, uint32_t colour, uint32_t encoding, uint32_t pixels);
+
+            unsigned int scale_;
+            uint32_t cell_width;
+            uint32_t cell_height;
+            RASPITEXT_PATH_T path_;
+            BLEND_F blend;
+            unsigned int cache_entries_;
+            vector< uint8_t > atlas;                /**< Every glyph side by side, cell_width * 95 by cell_height */
+            map< pair< uint32_t, string >, LAYOUT_S > layouts;
+            LAYOUT_S scratch;                       /**< The layout used when caching is off */
+            vector< uint8_t > colour_row;           /**< The text colour repeated across a row, in the target's byte order */
+            vector< uint8_t > background_row;       /**< The background colour repeated across a row */
+            vector< uint8_t > alpha_row;            /**< Coverage scaled by the colour's alpha, or the background's alpha */
+            RASPITEXT_STATS_S stats;
+    };
+
+}
+
+#endif /* __RASPITEXTRASTERIZER_H__ */
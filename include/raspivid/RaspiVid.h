@@ -53,7 +53,26 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 
 #include "raspivid/RaspiPort.h"
 #include "raspivid/RaspiCamControl.h"
+#include "raspivid/RaspiCameraControl.h"
+#include "raspivid/RaspiCameraTelemetry.h"
+#include "raspivid/RaspiAnnotator.h"
 #include "raspivid/RaspiCallback.h"
+#include "raspivid/RaspiExecutor.h"
+#include "raspivid/RaspiFrameQueue.h"
+#include "raspivid/RaspiFrameRef.h"
+#include "raspivid/RaspiFrameView.h"
+#include "raspivid/RaspiH264Parser.h"
+#include "raspivid/RaspiH264RingBuffer.h"
+#include "raspivid/RaspiI420Kernels.h"
+#include "raspivid/RaspiMJPEGServer.h"
+#include "raspivid/RaspiMotionAnalyzer.h"
+#include "raspivid/RaspiMP4Muxer.h"
+#include "raspivid/RaspiOverlaySurface.h"
+#include "raspivid/RaspiPipelineGraph.h"
+#include "raspivid/RaspiPortMetrics.h"
+#include "raspivid/RaspiPTZ.h"
+#include "raspivid/RaspiRecorder.h"
+#include "raspivid/RaspiTextRasterizer.h"
 #include "raspivid/components/RaspiComponent.h"
 #include "raspivid/components/RaspiCamera.h"
 #include "raspivid/components/RaspiEncoder.h"
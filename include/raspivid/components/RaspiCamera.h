@@ -10,6 +10,10 @@
 #include "raspivid/components/RaspiRenderer.h"
 #include "raspivid/RaspiPort.h"
 #include "raspivid/RaspiCamControl.h"
+#include "raspivid/RaspiCameraControl.h"
+#include "raspivid/RaspiCameraTelemetry.h"
+#include "raspivid/RaspiAnnotator.h"
+#include "raspivid/RaspiPTZ.h"
 
 // Standard port setting for the camera component
 #define MMAL_CAMERA_PREVIEW_PORT 0
@@ -43,11 +47,14 @@ namespace raspivid {
      */
     typedef struct {
         shared_ptr< RaspiCameraCallback > cb_instance;
+        shared_ptr< RaspiCameraControl > control;               /**< Receives every settings event before cb_instance */
+        shared_ptr< RaspiCameraTelemetry > telemetry;           /**< Records every settings event before cb_instance */
     } RASPICAMERA_USERDATA_S;
 
     /**
      \class DefaultRaspiCameraCallback RaspiCamera.h "components/RaspiCamera.h"
-     \brief Default camera control callback. Prints a message that a control parameter has changed.
+     \brief Default camera control callback. Prints a message that a control parameter has changed. Settings arrive with every
+     frame, so prefer reading RaspiCamera::telemetry to logging them.
      */
     class DefaultRaspiCameraCallback : public RaspiCameraCallback {
         public:
@@ -63,6 +70,8 @@ namespace raspivid {
         uint32_t framerate;                                     /**< Desired camera framerate */
         int cameraNum;                                          /**< Camera number. Usually 0. */
         int sensor_mode;                                        /**< Camera sensor mode. */
+        unsigned int telemetry_records;                         /**< Settings reports RaspiCamera::telemetry keeps. \see RaspiCameraTelemetry::create */
+        bool annotator;                                         /**< Create RaspiCamera::annotator, which runs its own thread. Off by default. */
         bool verbose;                                           /**< Verbose debugging output */
         RASPICAM_CAMERA_PARAMETERS camera_parameters;           /**< RaspiCam parameter structure. \see RaspiCamControl.h */
         shared_ptr< RaspiCameraCallback > settings_callback;    /**< A shared pointer to a camera settings control callback */
@@ -77,6 +86,10 @@ namespace raspivid {
             shared_ptr< RaspiPort > still;                      /**< The camera's still photo port */
             shared_ptr< RaspiPort > video;                      /**< The camera's video port. This is the default_output port */
             shared_ptr< RaspiPort > preview;                    /**< The camera's preview video port. */
+            shared_ptr< RaspiCameraControl > control;           /**< Applies camera parameters, sending only those that changed, and caches the camera's settings */
+            shared_ptr< RaspiCameraTelemetry > telemetry;       /**< The settings the camera reported for each frame, for lock-free readers */
+            shared_ptr< RaspiPTZ > ptz;                         /**< Moves the crop smoothly once added as a callback to a port carrying the camera's frames */
+            shared_ptr< RaspiAnnotator > annotator;             /**< Updates the annotation from its own thread, right after frames once added as a callback to a port carrying them. nullptr unless RASPICAMERA_OPTION_S::annotator is set. */
 
             /**
              \brief Creates RaspiCamera object. Uses the default settings.
@@ -99,18 +112,34 @@ namespace raspivid {
              \see RASPICAMERA_OPTION_S
              */
             static RASPICAMERA_OPTION_S createDefaultCameraOptions();
+
+            /**
+             \brief Class destructor. Stops the settings events and the annotator before the members and the component they reach are destroyed.
+             */
+            ~RaspiCamera();
             
             /**
              \brief Starts frame capture on this camera. Effectively, this turns the camera "on" and starts frame output on each port.
              \return An MMAL_STATUS_T. MMAL_SUCCESS if the operation was successful.
              */
             MMAL_STATUS_T start();
+
+            /**
+             \brief Reconfigures the sensor for a new resolution and frame rate while the camera component stays created. Every camera port
+             must be disabled first. The port formats are not changed here; commit them afterwards, as RaspiPipelineGraph::reconfigure does.
+             \param width The new frame width
+             \param height The new frame height
+             \param framerate The new frame rate, 0 for variable
+             \return An MMAL_STATUS_T. MMAL_SUCCESS if the operation was successful.
+             */
+            MMAL_STATUS_T set_resolution(uint32_t width, uint32_t height, uint32_t framerate);
         protected:
             const char* component_name();
             MMAL_STATUS_T init();
             RASPICAMERA_OPTION_S options_;
         private:
             static void callback_wrapper(MMAL_PORT_T *port, MMAL_BUFFER_HEADER_T *buffer);
+            MMAL_STATUS_T set_camera_config();
             RASPICAMERA_USERDATA_S userdata;
     };
 };
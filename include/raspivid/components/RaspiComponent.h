@@ -9,6 +9,7 @@
 #include <string>
 #include <memory.h>
 #include "raspivid/RaspiPort.h"
+#include "raspivid/RaspiPortMetrics.h"
 
 #include "interface/vcos/vcos.h"
 
@@ -25,6 +26,17 @@ using namespace std;
 
 namespace raspivid {
 
+    /**
+     \typedef RASPICOMPONENT_TIMING_S
+     \brief When a component was created and enabled, on the RaspiPortMetrics::now_us clock. Fields are 0 for steps that have not happened.
+     */
+    typedef struct {
+        int64_t create_us;              /**< When mmal_component_create was called */
+        int64_t created_us;             /**< When mmal_component_create returned */
+        int64_t enable_us;              /**< When mmal_component_enable was first called */
+        int64_t enabled_us;             /**< When mmal_component_enable last returned */
+    } RASPICOMPONENT_TIMING_S;
+
     /**
      \class RaspiComponent RaspiComponent.h "components/RaspiComponent.h"
      \brief An abstract base class for all Raspberry Pi MMAL components.
@@ -60,12 +72,21 @@ namespace raspivid {
              \see #default_output
              */
             MMAL_STATUS_T connect(shared_ptr< RaspiPort > source_port);
+
+            /**
+             \brief Gets the time spent creating and enabling the underlying MMAL component, to find out where startup time goes.
+             \return A RASPICOMPONENT_TIMING_S
+             */
+            RASPICOMPONENT_TIMING_S get_timing();
+
             shared_ptr< RaspiPort > default_input = nullptr;    /**< Default input port for this component */
             shared_ptr< RaspiPort > default_output = nullptr;   /**< Default output port for this component */
         protected:
             RaspiComponent();
             MMAL_STATUS_T init();
+            MMAL_STATUS_T enable();
             MMAL_COMPONENT_T *component;
+            RASPICOMPONENT_TIMING_S timing;
             virtual const char* component_name() =0;
             void assert_ports(int inputs, int outputs);
     };
@@ -46,9 +46,16 @@ namespace raspivid {
             /**
              \brief Sends a buffer back to the overlay renderer to be drawn.
              \param buffer[in] A C pointer to an MMAL_BUFFER_HEADER_T to be drawn. This buffer should be retrieved from get_buffer.
+             \return An MMAL_STATUS_T. MMAL_SUCCESS if the buffer was sent.
              \see RaspiOverlayRenderer::get_buffer
+             \see RaspiOverlaySurface
              */
-            void send_buffer(MMAL_BUFFER_HEADER_T *buffer);
+            MMAL_STATUS_T send_buffer(MMAL_BUFFER_HEADER_T *buffer);
+
+            /**
+             \return The format the overlay renderer was created with
+             */
+            RASPIOVERLAYRENDERER_FORMAT_S get_format();
 
             /**
              \brief Returns a RASPIOVERLAYRENDERER_FORMAT_S struct with default settings.
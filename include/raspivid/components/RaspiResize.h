@@ -29,6 +29,12 @@ namespace raspivid {
             shared_ptr< RaspiPort > output;     /**< The output port for this component. This is the default_output port. \see RaspiComponent#default_output */
             MMAL_STATUS_T connect( shared_ptr< RaspiComponent > source_component ); /**< \see RaspiComponent::connect( shared_ptr< RaspiComponent > source_component ) */
             MMAL_STATUS_T connect( shared_ptr< RaspiPort > source_port ); /**< \see RaspiComponent::connect( shared_ptr< RaspiPort > source_port */
+            /**
+             \brief Changes the output dimensions. Takes effect the next time the output format is set, for example by connect.
+             \param width The output frame width
+             \param height The output frame height
+             */
+            void set_size(int width, int height);
         protected:
             const char* component_name();
             MMAL_STATUS_T init();
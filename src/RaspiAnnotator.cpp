@@ -0,0 +1,168 @@
+#include <chrono>
+#include <stdio.h>
+#include <string.h>
+
+#include "raspivid/RaspiAnnotator.h"
+
+namespace raspivid {
+
+    shared_ptr< RaspiAnnotator > RaspiAnnotator::create(MMAL_COMPONENT_T *camera, uint32_t min_interval_ms, uint32_t frame_timeout_ms) {
+        return shared_ptr< RaspiAnnotator >( new RaspiAnnotator(camera, min_interval_ms, frame_timeout_ms) );
+    }
+
+    RaspiAnnotator::RaspiAnnotator(MMAL_COMPONENT_T *camera_, uint32_t min_interval_ms, uint32_t frame_timeout_ms) : camera(camera_),
+        min_interval_us((int64_t)min_interval_ms * 1000), frame_timeout_us((int64_t)frame_timeout_ms * 1000), generation(0), frames(0),
+        stopping(false), rendered_second(0), has_sent(false), requests(0), coalesced(0), renders(0), unchanged(0), updates(0),
+        unsynchronised(0), failed(0) {
+        request.settings = 0;
+        request.text_size = 0;
+        request.text_colour = -1;
+        request.bg_colour = -1;
+        memset(&tm, 0, sizeof(tm));
+        memset(&sent, 0, sizeof(sent));
+        worker = thread(&RaspiAnnotator::run, this);
+    }
+
+    RaspiAnnotator::~RaspiAnnotator() {
+        stop();
+    }
+
+    void RaspiAnnotator::stop() {
+        {
+            std::lock_guard< std::mutex > guard(lock);
+            stopping = true;
+        }
+        wake.notify_all();
+        if (worker.joinable() && worker.get_id() != this_thread::get_id()) {
+            worker.join();
+        }
+    }
+
+    void RaspiAnnotator::set(int settings, const char *text, int text_size, int text_colour, int bg_colour) {
+        {
+            std::lock_guard< std::mutex > guard(lock);
+            if (stopping) {
+                return;
+            }
+            request.settings = settings;
+            request.text = text ? text : "";
+            request.text_size = text_size;
+            request.text_colour = text_colour;
+            request.bg_colour = bg_colour;
+            generation++;
+        }
+        requests++;
+        wake.notify_all();
+    }
+
+    void RaspiAnnotator::set(const RASPICAM_CAMERA_PARAMETERS &params) {
+        char text[sizeof(params.annotate_string) + 1];
+        snprintf(text, sizeof(text), "%.*s", (int)sizeof(params.annotate_string), params.annotate_string);
+        set(params.enable_annotate, text, params.annotate_text_size, params.annotate_text_colour, params.annotate_bg_colour);
+    }
+
+    void RaspiAnnotator::callback(MMAL_PORT_T *port, MMAL_BUFFER_HEADER_T *buffer) {
+        if (!buffer->length) {
+            return;
+        }
+        {
+            std::lock_guard< std::mutex > guard(lock);
+            frames++;
+        }
+        wake.notify_all();
+    }
+
+    bool RaspiAnnotator::render(const REQUEST_S &current, MMAL_PARAMETER_CAMERA_ANNOTATE_V3_T &annotate) {
+        time_t now = time(NULL);
+        if (now != rendered_second) {
+            localtime_r(&now, &tm);
+            rendered_second = now;
+        }
+        raspicamcontrol_build_annotate(&annotate, current.settings, current.text.c_str(), current.text_size, current.text_colour,
+            current.bg_colour, &tm);
+        renders++;
+        // The parameter has no padding and its text is zero filled, so equal annotations compare equal byte for byte
+        return !has_sent || memcmp(&annotate, &sent, sizeof(annotate));
+    }
+
+    void RaspiAnnotator::run() {
+        std::unique_lock< std::mutex > guard(lock);
+        uint64_t rendered = 0;
+        int64_t last_update_us = 0;
+        while (!stopping) {
+            if (generation == rendered) {
+                bool timed = generation && (request.settings & (ANNOTATE_DATE_TEXT | ANNOTATE_TIME_TEXT));
+                if (!timed) {
+                    wake.wait(guard);
+                    continue;
+                }
+                // Nothing new was requested, but the date and time move on at the next second
+                chrono::system_clock::time_point next = chrono::system_clock::from_time_t(rendered_second + 1);
+                if (wake.wait_until(guard, next, [&]() { return stopping || generation != rendered; })) {
+                    continue;
+                }
+                if (time(NULL) == rendered_second) {
+                    continue;
+                }
+            }
+
+            if (has_sent && min_interval_us) {
+                int64_t wait_us = last_update_us + min_interval_us - RaspiPortMetrics::now_us();
+                if (wait_us > 0 && wake.wait_for(guard, chrono::microseconds(wait_us), [&]() { return stopping; })) {
+                    break;
+                }
+            }
+
+            // Sending right after a frame leaves the camera the rest of the frame interval to apply the annotation
+            uint64_t seen = frames;
+            bool synchronised = wake.wait_for(guard, chrono::microseconds(frame_timeout_us), [&]() { return stopping || frames != seen; });
+            if (stopping) {
+                break;
+            }
+
+            REQUEST_S current = request;
+            if (generation - rendered > 1) {
+                coalesced += generation - rendered - 1;
+            }
+            rendered = generation;
+            guard.unlock();
+
+            MMAL_PARAMETER_CAMERA_ANNOTATE_V3_T annotate;
+            if (!render(current, annotate)) {
+                unchanged++;
+                guard.lock();
+                continue;
+            }
+            int64_t start = RaspiPortMetrics::now_us();
+            MMAL_STATUS_T status = mmal_port_parameter_set(camera->control, &annotate.hdr);
+            last_update_us = RaspiPortMetrics::now_us();
+            update_duration.record(last_update_us - start);
+            if (status == MMAL_SUCCESS) {
+                sent = annotate;
+                has_sent = true;
+                updates++;
+                if (!synchronised) {
+                    unsynchronised++;
+                }
+            } else {
+                failed++;
+                vcos_log_error("RaspiAnnotator::run(): unable to set the annotation (%u)", status);
+            }
+            guard.lock();
+        }
+    }
+
+    RASPIANNOTATOR_STATS_S RaspiAnnotator::get_stats() {
+        RASPIANNOTATOR_STATS_S result;
+        result.requests = requests.load();
+        result.coalesced = coalesced.load();
+        result.renders = renders.load();
+        result.unchanged = unchanged.load();
+        result.updates = updates.load();
+        result.unsynchronised = unsynchronised.load();
+        result.failed = failed.load();
+        update_duration.read(result.update_duration);
+        return result;
+    }
+
+}
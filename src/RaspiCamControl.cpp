@@ -737,14 +737,32 @@ namespace raspi_cam_control {
      */
     int raspicamcontrol_set_annotate(MMAL_COMPONENT_T *camera, const int settings, const char *string,
                     const int text_size, const int text_colour, const int bg_colour)
+    {
+       MMAL_PARAMETER_CAMERA_ANNOTATE_V3_T annotate;
+       time_t t = time(NULL);
+       struct tm tm;
+
+       localtime_r(&t, &tm);
+       raspicamcontrol_build_annotate(&annotate, settings, string, text_size, text_colour, bg_colour, &tm);
+       return mmal_status_to_int(mmal_port_parameter_set(camera->control, &annotate.hdr));
+    }
+
+    /**
+     * Fill in the annotate parameter raspicamcontrol_set_annotate sends, without sending it
+     * @param annotate The parameter to fill in
+     * @param tm The local time to render date and time text with
+     *
+     * @see raspicamcontrol_set_annotate for the other parameters
+     */
+    void raspicamcontrol_build_annotate(MMAL_PARAMETER_CAMERA_ANNOTATE_V3_T *annotate_out, const int settings, const char *string,
+                    const int text_size, const int text_colour, const int bg_colour, const struct tm *tm_in)
     {
        MMAL_PARAMETER_CAMERA_ANNOTATE_V3_T annotate =
           {{MMAL_PARAMETER_ANNOTATE, sizeof(MMAL_PARAMETER_CAMERA_ANNOTATE_V3_T)}};
 
        if (settings)
        {
-          time_t t = time(NULL);
-          struct tm tm = *localtime(&t);
+          struct tm tm = *tm_in;
           char tmp[MMAL_CAMERA_ANNOTATE_MAX_TEXT_LEN_V3];
           int process_datetime = 1;
 
@@ -828,7 +846,7 @@ namespace raspi_cam_control {
         else
            annotate.enable = 0;
 
-       return mmal_status_to_int(mmal_port_parameter_set(camera->control, &annotate.hdr));
+       *annotate_out = annotate;
     }
 
     int raspicamcontrol_set_stereo_mode(MMAL_PORT_T *port, MMAL_PARAMETER_STEREOSCOPIC_MODE_T *stereo_mode)
@@ -0,0 +1,274 @@
+#include <string.h>
+#include <vector>
+
+#include "raspivid/RaspiCameraControl.h"
+
+namespace raspivid {
+
+    typedef struct {
+        const char *name;
+        bool (*changed)(const RASPICAM_CAMERA_PARAMETERS &applied, const RASPICAM_CAMERA_PARAMETERS &params);
+        int (*send)(MMAL_COMPONENT_T *camera, const RASPICAM_CAMERA_PARAMETERS &params);
+        const char *follows;            // Name of an earlier parameter that, when sent, requires this one to be sent too, or NULL
+    } PARAMETER_S;
+
+#define FIELD_CHANGED(field) [](const RASPICAM_CAMERA_PARAMETERS &a, const RASPICAM_CAMERA_PARAMETERS &b) { return a.field != b.field; }
+#define SEND(call) [](MMAL_COMPONENT_T *camera, const RASPICAM_CAMERA_PARAMETERS &p) { return call; }
+
+    static bool annotate_changed(const RASPICAM_CAMERA_PARAMETERS &a, const RASPICAM_CAMERA_PARAMETERS &b) {
+        // Date and time are rendered into the text when it is sent, so they are out of date by the next call
+        if (b.enable_annotate & (ANNOTATE_DATE_TEXT | ANNOTATE_TIME_TEXT)) {
+            return true;
+        }
+        return a.enable_annotate != b.enable_annotate || strncmp(a.annotate_string, b.annotate_string, sizeof(a.annotate_string)) ||
+            a.annotate_text_size != b.annotate_text_size || a.annotate_text_colour != b.annotate_text_colour ||
+            a.annotate_bg_colour != b.annotate_bg_colour;
+    }
+
+    // In the order of raspicamcontrol_set_all_parameters
+    static const PARAMETER_S PARAMETERS[] = {
+        { "saturation", FIELD_CHANGED(saturation), SEND(raspicamcontrol_set_saturation(camera, p.saturation)), NULL },
+        { "sharpness", FIELD_CHANGED(sharpness), SEND(raspicamcontrol_set_sharpness(camera, p.sharpness)), NULL },
+        { "contrast", FIELD_CHANGED(contrast), SEND(raspicamcontrol_set_contrast(camera, p.contrast)), NULL },
+        { "brightness", FIELD_CHANGED(brightness), SEND(raspicamcontrol_set_brightness(camera, p.brightness)), NULL },
+        { "ISO", FIELD_CHANGED(ISO), SEND(raspicamcontrol_set_ISO(camera, p.ISO)), NULL },
+        { "video stabilisation", FIELD_CHANGED(videoStabilisation), SEND(raspicamcontrol_set_video_stabilisation(camera, p.videoStabilisation)), NULL },
+        { "exposure compensation", FIELD_CHANGED(exposureCompensation), SEND(raspicamcontrol_set_exposure_compensation(camera, p.exposureCompensation)), NULL },
+        { "exposure mode", FIELD_CHANGED(exposureMode), SEND(raspicamcontrol_set_exposure_mode(camera, p.exposureMode)), NULL },
+        { "flicker avoid mode", FIELD_CHANGED(flickerAvoidMode), SEND(raspicamcontrol_set_flicker_avoid_mode(camera, p.flickerAvoidMode)), NULL },
+        { "metering mode", FIELD_CHANGED(exposureMeterMode), SEND(raspicamcontrol_set_metering_mode(camera, p.exposureMeterMode)), NULL },
+        { "AWB mode", FIELD_CHANGED(awbMode), SEND(raspicamcontrol_set_awb_mode(camera, p.awbMode)), NULL },
+        {
+            "AWB gains",
+            [](const RASPICAM_CAMERA_PARAMETERS &a, const RASPICAM_CAMERA_PARAMETERS &b) { return a.awb_gains_r != b.awb_gains_r || a.awb_gains_b != b.awb_gains_b; },
+            SEND(raspicamcontrol_set_awb_gains(camera, p.awb_gains_r, p.awb_gains_b)),
+            "AWB mode"
+        },
+        { "image effect", FIELD_CHANGED(imageEffect), SEND(raspicamcontrol_set_imageFX(camera, p.imageEffect)), NULL },
+        {
+            "colour effect",
+            [](const RASPICAM_CAMERA_PARAMETERS &a, const RASPICAM_CAMERA_PARAMETERS &b) {
+                return a.colourEffects.enable != b.colourEffects.enable || a.colourEffects.u != b.colourEffects.u || a.colourEffects.v != b.colourEffects.v;
+            },
+            SEND(raspicamcontrol_set_colourFX(camera, &p.colourEffects)),
+            NULL
+        },
+        { "rotation", FIELD_CHANGED(rotation), SEND(raspicamcontrol_set_rotation(camera, p.rotation)), NULL },
+        {
+            "flips",
+            [](const RASPICAM_CAMERA_PARAMETERS &a, const RASPICAM_CAMERA_PARAMETERS &b) { return a.hflip != b.hflip || a.vflip != b.vflip; },
+            SEND(raspicamcontrol_set_flips(camera, p.hflip, p.vflip)),
+            NULL
+        },
+        {
+            "ROI",
+            [](const RASPICAM_CAMERA_PARAMETERS &a, const RASPICAM_CAMERA_PARAMETERS &b) {
+                return a.roi.x != b.roi.x || a.roi.y != b.roi.y || a.roi.w != b.roi.w || a.roi.h != b.roi.h;
+            },
+            SEND(raspicamcontrol_set_ROI(camera, p.roi)),
+            NULL
+        },
+        { "shutter speed", FIELD_CHANGED(shutter_speed), SEND(raspicamcontrol_set_shutter_speed(camera, p.shutter_speed)), NULL },
+        { "DRC", FIELD_CHANGED(drc_level), SEND(raspicamcontrol_set_DRC(camera, p.drc_level)), NULL },
+        { "stats pass", FIELD_CHANGED(stats_pass), SEND(raspicamcontrol_set_stats_pass(camera, p.stats_pass)), NULL },
+        {
+            "annotate",
+            annotate_changed,
+            SEND(raspicamcontrol_set_annotate(camera, p.enable_annotate, p.annotate_string, p.annotate_text_size, p.annotate_text_colour, p.annotate_bg_colour)),
+            NULL
+        }
+    };
+
+#undef FIELD_CHANGED
+#undef SEND
+
+    static_assert(sizeof(PARAMETERS) / sizeof(PARAMETERS[0]) == RASPICAMERACONTROL_PARAMETERS, "RASPICAMERACONTROL_PARAMETERS does not match the parameter table");
+
+    // Finds a parameter in PARAMETERS by name, so that references to it survive reordering the table. Returns -1 for NULL.
+    static int find_parameter(const char *name) {
+        if (!name) {
+            return -1;
+        }
+        for (unsigned int i = 0; i < RASPICAMERACONTROL_PARAMETERS; i++) {
+            if (!strcmp(PARAMETERS[i].name, name)) {
+                return i;
+            }
+        }
+        vcos_assert(!"no such camera parameter");
+        return -1;
+    }
+
+    static vector< int > resolve_follows() {
+        vector< int > follows(RASPICAMERACONTROL_PARAMETERS);
+        for (unsigned int i = 0; i < RASPICAMERACONTROL_PARAMETERS; i++) {
+            follows[i] = find_parameter(PARAMETERS[i].follows);
+            // apply() sends in table order, so it only knows about earlier parameters
+            vcos_assert(follows[i] < (int)i);
+        }
+        return follows;
+    }
+
+    // PARAMETERS[i].follows as an index, or -1
+    static const vector< int > FOLLOWS = resolve_follows();
+
+    static const unsigned int ROI_PARAMETER = find_parameter("ROI");
+
+    shared_ptr< RaspiCameraControl > RaspiCameraControl::create(MMAL_COMPONENT_T *camera) {
+        return shared_ptr< RaspiCameraControl >( new RaspiCameraControl(camera) );
+    }
+
+    RaspiCameraControl::RaspiCameraControl(MMAL_COMPONENT_T *camera_) : camera(camera_), valid(false), retry(0), version(0) {
+        memset(&applied, 0, sizeof(applied));
+        reset_stats();
+        publish(NULL, NULL);
+    }
+
+    MMAL_STATUS_T RaspiCameraControl::apply(const RASPICAM_CAMERA_PARAMETERS &params) {
+        std::lock_guard< std::mutex > guard(lock);
+        int64_t start = RaspiPortMetrics::now_us();
+        uint32_t sending = 0, failures = 0;
+        for (unsigned int i = 0; i < RASPICAMERACONTROL_PARAMETERS; i++) {
+            const PARAMETER_S &parameter = PARAMETERS[i];
+            bool needed = !valid || (retry & (1 << i)) || parameter.changed(applied, params) ||
+                (FOLLOWS[i] >= 0 && (sending & (1 << FOLLOWS[i])));
+            if (!needed) {
+                skipped.fetch_add(1, std::memory_order_relaxed);
+                continue;
+            }
+            sending |= 1 << i;
+            int64_t set_start = RaspiPortMetrics::now_us();
+            int result = parameter.send(camera, params);
+            set_duration.record(RaspiPortMetrics::now_us() - set_start);
+            sent.fetch_add(1, std::memory_order_relaxed);
+            sent_by_parameter[i].fetch_add(1, std::memory_order_relaxed);
+            if (result) {
+                failures |= 1 << i;
+                failed.fetch_add(1, std::memory_order_relaxed);
+                vcos_log_error("RaspiCameraControl::apply(): unable to set %s", parameter.name);
+            }
+        }
+        if ((sending & (1 << ROI_PARAMETER)) && !(failures & (1 << ROI_PARAMETER)) && roi_listener) {
+            roi_listener(params.roi);
+        }
+        applied = params;
+        valid = true;
+        retry = failures;
+        applies.fetch_add(1, std::memory_order_relaxed);
+        apply_duration.record(RaspiPortMetrics::now_us() - start);
+        if (sending) {
+            publish(&params, NULL);
+        }
+        return failures ? MMAL_EINVAL : MMAL_SUCCESS;
+    }
+
+    MMAL_STATUS_T RaspiCameraControl::set_crop(const MMAL_RECT_T &crop) {
+        std::lock_guard< std::mutex > guard(lock);
+        MMAL_PARAMETER_INPUT_CROP_T parameter = {{MMAL_PARAMETER_INPUT_CROP, sizeof(MMAL_PARAMETER_INPUT_CROP_T)}, crop};
+        int64_t start = RaspiPortMetrics::now_us();
+        MMAL_STATUS_T status = mmal_port_parameter_set(camera->control, &parameter.hdr);
+        set_duration.record(RaspiPortMetrics::now_us() - start);
+        sent.fetch_add(1, std::memory_order_relaxed);
+        sent_by_parameter[ROI_PARAMETER].fetch_add(1, std::memory_order_relaxed);
+        if (status != MMAL_SUCCESS) {
+            failed.fetch_add(1, std::memory_order_relaxed);
+            return status;
+        }
+        // Exact in a double, so raspicamcontrol_set_ROI turns it back into the same crop
+        applied.roi.x = crop.x / 65536.0;
+        applied.roi.y = crop.y / 65536.0;
+        applied.roi.w = crop.width / 65536.0;
+        applied.roi.h = crop.height / 65536.0;
+        retry &= ~(1 << ROI_PARAMETER);
+        if (valid) {
+            publish(&applied, NULL);
+        }
+        return MMAL_SUCCESS;
+    }
+
+    void RaspiCameraControl::set_roi_listener(function< void(const PARAM_FLOAT_RECT_T &roi) > listener) {
+        std::lock_guard< std::mutex > guard(lock);
+        roi_listener = listener;
+    }
+
+    void RaspiCameraControl::invalidate() {
+        std::lock_guard< std::mutex > guard(lock);
+        valid = false;
+    }
+
+    bool RaspiCameraControl::get_applied(RASPICAM_CAMERA_PARAMETERS *params) {
+        std::lock_guard< std::mutex > guard(lock);
+        if (params) {
+            *params = applied;
+        }
+        return valid;
+    }
+
+    void RaspiCameraControl::parameter_changed(const MMAL_PARAMETER_HEADER_T *param) {
+        if (param->id != MMAL_PARAMETER_CAMERA_SETTINGS || param->size < sizeof(MMAL_PARAMETER_CAMERA_SETTINGS_T)) {
+            return;
+        }
+        publish(NULL, (const MMAL_PARAMETER_CAMERA_SETTINGS_T *)param);
+    }
+
+    uint64_t RaspiCameraControl::get_version() {
+        return version.load(std::memory_order_acquire);
+    }
+
+    shared_ptr< const RASPICAMERACONTROL_SNAPSHOT_S > RaspiCameraControl::get_snapshot() {
+        return std::atomic_load(&snapshot);
+    }
+
+    void RaspiCameraControl::publish(const RASPICAM_CAMERA_PARAMETERS *parameters, const MMAL_PARAMETER_CAMERA_SETTINGS_T *settings) {
+        std::lock_guard< std::mutex > guard(snapshot_lock);
+        shared_ptr< RASPICAMERACONTROL_SNAPSHOT_S > next = make_shared< RASPICAMERACONTROL_SNAPSHOT_S >();
+        if (snapshot) {
+            *next = *snapshot;
+        } else {
+            memset(next.get(), 0, sizeof(RASPICAMERACONTROL_SNAPSHOT_S));
+        }
+        if (parameters) {
+            next->parameters = *parameters;
+            next->applied = true;
+        }
+        if (settings) {
+            next->settings = *settings;
+            next->settings_us = RaspiPortMetrics::now_us();
+            next->settings_reports++;
+        }
+        next->version = version.load(std::memory_order_relaxed) + 1;
+        std::atomic_store(&snapshot, shared_ptr< const RASPICAMERACONTROL_SNAPSHOT_S >(next));
+        // Stored after the snapshot, so a reader that sees the new version finds at least that snapshot
+        version.store(next->version, std::memory_order_release);
+    }
+
+    RASPICAMERACONTROL_STATS_S RaspiCameraControl::get_stats() {
+        RASPICAMERACONTROL_STATS_S result;
+        result.applies = applies.load(std::memory_order_relaxed);
+        result.sent = sent.load(std::memory_order_relaxed);
+        result.skipped = skipped.load(std::memory_order_relaxed);
+        result.failed = failed.load(std::memory_order_relaxed);
+        for (unsigned int i = 0; i < RASPICAMERACONTROL_PARAMETERS; i++) {
+            result.sent_by_parameter[i] = sent_by_parameter[i].load(std::memory_order_relaxed);
+        }
+        apply_duration.read(result.apply_duration);
+        set_duration.read(result.set_duration);
+        return result;
+    }
+
+    void RaspiCameraControl::reset_stats() {
+        applies.store(0, std::memory_order_relaxed);
+        sent.store(0, std::memory_order_relaxed);
+        skipped.store(0, std::memory_order_relaxed);
+        failed.store(0, std::memory_order_relaxed);
+        for (unsigned int i = 0; i < RASPICAMERACONTROL_PARAMETERS; i++) {
+            sent_by_parameter[i].store(0, std::memory_order_relaxed);
+        }
+        apply_duration.reset();
+        set_duration.reset();
+    }
+
+    const char* RaspiCameraControl::parameter_name(unsigned int parameter) {
+        return parameter < RASPICAMERACONTROL_PARAMETERS ? PARAMETERS[parameter].name : NULL;
+    }
+
+}
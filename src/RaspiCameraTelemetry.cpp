@@ -0,0 +1,112 @@
+#include <string.h>
+
+#include "raspivid/RaspiCameraTelemetry.h"
+#include "raspivid/RaspiPortMetrics.h"
+
+namespace raspivid {
+
+    shared_ptr< RaspiCameraTelemetry > RaspiCameraTelemetry::create(unsigned int capacity) {
+        return shared_ptr< RaspiCameraTelemetry >( new RaspiCameraTelemetry(capacity) );
+    }
+
+    RaspiCameraTelemetry::RaspiCameraTelemetry(unsigned int capacity) : count_(0) {
+        unsigned int size = 1;
+        while (size < capacity) {
+            size <<= 1;
+        }
+        slots = vector< SLOT_S >(size);
+        for (SLOT_S &slot : slots) {
+            slot.sequence.store(0, std::memory_order_relaxed);
+            for (unsigned int i = 0; i < WORDS; i++) {
+                slot.words[i].store(0, std::memory_order_relaxed);
+            }
+        }
+        mask = size - 1;
+    }
+
+    void RaspiCameraTelemetry::push(const MMAL_PARAMETER_CAMERA_SETTINGS_T &settings, int64_t pts) {
+        uint64_t n = count_.load(std::memory_order_relaxed);
+        RASPICAMERATELEMETRY_RECORD_S record;
+        memset(&record, 0, sizeof(record));
+        record.sequence = n;
+        record.timestamp_us = RaspiPortMetrics::now_us();
+        record.pts = pts;
+        record.exposure = settings.exposure;
+        record.analog_gain = settings.analog_gain;
+        record.digital_gain = settings.digital_gain;
+        record.awb_red_gain = settings.awb_red_gain;
+        record.awb_blue_gain = settings.awb_blue_gain;
+        record.focus_position = settings.focus_position;
+        uint64_t words[WORDS] = { 0 };
+        memcpy(words, &record, sizeof(record));
+
+        SLOT_S &slot = slots[n & mask];
+        slot.sequence.store(2 * n + 1, std::memory_order_relaxed);
+        // A reader that loads one of the new words also sees the odd sequence that came before it
+        for (unsigned int i = 0; i < WORDS; i++) {
+            slot.words[i].store(words[i], std::memory_order_release);
+        }
+        slot.sequence.store(2 * n + 2, std::memory_order_release);
+        count_.store(n + 1, std::memory_order_release);
+    }
+
+    bool RaspiCameraTelemetry::copy(uint64_t sequence, RASPICAMERATELEMETRY_RECORD_S *record) {
+        SLOT_S &slot = slots[sequence & mask];
+        uint64_t expected = 2 * sequence + 2;
+        if (slot.sequence.load(std::memory_order_acquire) != expected) {
+            return false;
+        }
+        uint64_t words[WORDS];
+        // Acquire loads keep the second look at the sequence after the copy, so a write that overlapped it is noticed
+        for (unsigned int i = 0; i < WORDS; i++) {
+            words[i] = slot.words[i].load(std::memory_order_acquire);
+        }
+        if (slot.sequence.load(std::memory_order_relaxed) != expected) {
+            return false;
+        }
+        memcpy(record, words, sizeof(RASPICAMERATELEMETRY_RECORD_S));
+        return true;
+    }
+
+    bool RaspiCameraTelemetry::latest(RASPICAMERATELEMETRY_RECORD_S *record) {
+        for (;;) {
+            uint64_t n = count_.load(std::memory_order_acquire);
+            if (!n) {
+                return false;
+            }
+            if (copy(n - 1, record)) {
+                return true;
+            }
+        }
+    }
+
+    unsigned int RaspiCameraTelemetry::read(uint64_t *cursor, RASPICAMERATELEMETRY_RECORD_S *records, unsigned int max) {
+        unsigned int copied = 0;
+        while (copied < max) {
+            uint64_t n = count_.load(std::memory_order_acquire);
+            if (*cursor >= n) {
+                break;
+            }
+            if (n - *cursor > slots.size()) {
+                *cursor = n - slots.size();
+            }
+            if (copy(*cursor, &records[copied])) {
+                copied++;
+                (*cursor)++;
+            } else if (count_.load(std::memory_order_acquire) - *cursor <= mask) {
+                break;
+            }
+            // Otherwise overwritten while copying: the next pass skips ahead once the writer is done with the slot
+        }
+        return copied;
+    }
+
+    uint64_t RaspiCameraTelemetry::count() {
+        return count_.load(std::memory_order_acquire);
+    }
+
+    unsigned int RaspiCameraTelemetry::capacity() {
+        return (unsigned int)slots.size();
+    }
+
+}
@@ -0,0 +1,174 @@
+#include "raspivid/RaspiExecutor.h"
+
+namespace raspivid {
+
+    shared_ptr< RaspiInlineExecutor > RaspiInlineExecutor::create() {
+        return shared_ptr< RaspiInlineExecutor >( new RaspiInlineExecutor() );
+    }
+
+    bool RaspiInlineExecutor::execute(function< void() > task) {
+        task();
+        return true;
+    }
+
+    shared_ptr< RaspiThreadExecutor > RaspiThreadExecutor::create(size_t max_pending) {
+        return shared_ptr< RaspiThreadExecutor >( new RaspiThreadExecutor(max_pending) );
+    }
+
+    RaspiThreadExecutor::RaspiThreadExecutor(size_t max_pending) : max_pending_(max_pending), stopping(false), dropped_(0) {
+        worker = thread(&RaspiThreadExecutor::run, this);
+    }
+
+    RaspiThreadExecutor::~RaspiThreadExecutor() {
+        stop();
+    }
+
+    bool RaspiThreadExecutor::execute(function< void() > task) {
+        {
+            lock_guard< mutex > guard(lock);
+            if (stopping || (max_pending_ && tasks.size() >= max_pending_)) {
+                dropped_++;
+                return false;
+            }
+            tasks.push_back(std::move(task));
+        }
+        available.notify_one();
+        return true;
+    }
+
+    uint64_t RaspiThreadExecutor::dropped() {
+        return dropped_.load();
+    }
+
+    void RaspiThreadExecutor::stop() {
+        {
+            lock_guard< mutex > guard(lock);
+            stopping = true;
+        }
+        available.notify_one();
+        if (worker.joinable()) {
+            worker.join();
+        }
+    }
+
+    void RaspiThreadExecutor::run() {
+        unique_lock< mutex > guard(lock);
+        while (true) {
+            available.wait(guard, [this]() { return stopping || !tasks.empty(); });
+            if (tasks.empty()) {
+                return;
+            }
+            function< void() > task = std::move(tasks.front());
+            tasks.pop_front();
+            guard.unlock();
+            task();
+            guard.lock();
+        }
+    }
+
+    shared_ptr< RaspiThreadPoolExecutor > RaspiThreadPoolExecutor::create(unsigned int threads, size_t max_pending) {
+        return shared_ptr< RaspiThreadPoolExecutor >( new RaspiThreadPoolExecutor(threads, max_pending) );
+    }
+
+    RaspiThreadPoolExecutor::RaspiThreadPoolExecutor(unsigned int threads, size_t max_pending) : max_pending_(max_pending), next(0), pending(0), dropped_(0), stolen_(0), stopping(false) {
+        if (threads == 0) {
+            threads = thread::hardware_concurrency();
+        }
+        if (threads == 0) {
+            threads = 1;
+        }
+        for (unsigned int i = 0; i < threads; i++) {
+            workers.push_back(unique_ptr< Worker >( new Worker() ));
+        }
+        for (unsigned int i = 0; i < threads; i++) {
+            threads_.push_back(thread(&RaspiThreadPoolExecutor::run, this, i));
+        }
+    }
+
+    RaspiThreadPoolExecutor::~RaspiThreadPoolExecutor() {
+        stop();
+    }
+
+    bool RaspiThreadPoolExecutor::execute(function< void() > task) {
+        if (stopping.load() || (max_pending_ && pending.load() >= max_pending_)) {
+            dropped_++;
+            return false;
+        }
+        Worker &worker = *workers[next++ % workers.size()];
+        {
+            // Counted before the lock is released. Workers take tasks, and count them down, under the same lock, so pending
+            // never drops below zero, and a worker that sees pending > 0 finds the task.
+            lock_guard< mutex > guard(worker.lock);
+            worker.tasks.push_back(std::move(task));
+            pending++;
+        }
+        {
+            lock_guard< mutex > guard(sleep_lock);
+        }
+        available.notify_one();
+        return true;
+    }
+
+    bool RaspiThreadPoolExecutor::take(unsigned int index, function< void() > &task) {
+        {
+            Worker &own = *workers[index];
+            lock_guard< mutex > guard(own.lock);
+            if (!own.tasks.empty()) {
+                task = std::move(own.tasks.front());
+                own.tasks.pop_front();
+                pending--;
+                return true;
+            }
+        }
+        // Steal the newest task from another worker, leaving its oldest tasks to their owner
+        for (unsigned int i = 1; i < workers.size(); i++) {
+            Worker &victim = *workers[(index + i) % workers.size()];
+            lock_guard< mutex > guard(victim.lock);
+            if (!victim.tasks.empty()) {
+                task = std::move(victim.tasks.back());
+                victim.tasks.pop_back();
+                pending--;
+                stolen_++;
+                return true;
+            }
+        }
+        return false;
+    }
+
+    void RaspiThreadPoolExecutor::run(unsigned int index) {
+        while (true) {
+            function< void() > task;
+            if (take(index, task)) {
+                task();
+                continue;
+            }
+            unique_lock< mutex > guard(sleep_lock);
+            available.wait(guard, [this]() { return stopping.load() || pending.load() > 0; });
+            if (stopping.load() && pending.load() == 0) {
+                return;
+            }
+        }
+    }
+
+    uint64_t RaspiThreadPoolExecutor::dropped() {
+        return dropped_.load();
+    }
+
+    uint64_t RaspiThreadPoolExecutor::stolen() {
+        return stolen_.load();
+    }
+
+    void RaspiThreadPoolExecutor::stop() {
+        {
+            lock_guard< mutex > guard(sleep_lock);
+            stopping.store(true);
+        }
+        available.notify_all();
+        for (thread &worker : threads_) {
+            if (worker.joinable()) {
+                worker.join();
+            }
+        }
+    }
+
+}
@@ -0,0 +1,125 @@
+#include <chrono>
+
+#include "raspivid/RaspiFrameQueue.h"
+
+namespace raspivid {
+
+    shared_ptr< RaspiFrameQueue > RaspiFrameQueue::create(unsigned int depth, RASPIFRAMEQUEUE_OVERFLOW_T overflow) {
+        return shared_ptr< RaspiFrameQueue >( new RaspiFrameQueue(depth, overflow) );
+    }
+
+    RaspiFrameQueue::RaspiFrameQueue(unsigned int depth, RASPIFRAMEQUEUE_OVERFLOW_T overflow) : overflow_(overflow), head(0), tail(0), dropped_(0), closed(false), consumer_waiting(false), producer_waiting(false) {
+        unsigned int size = 1;
+        while (size < depth) {
+            size <<= 1;
+        }
+        slots = vector< std::atomic< MMAL_BUFFER_HEADER_T* > >(size);
+        for (unsigned int i = 0; i < size; i++) {
+            slots[i].store(NULL, std::memory_order_relaxed);
+        }
+        mask = size - 1;
+    }
+
+    void RaspiFrameQueue::wake(std::atomic<bool> &waiting, std::condition_variable &condition) {
+        // The waiting thread re-checks the indices while holding the lock, so taking it here closes the gap
+        // between that check and the wait
+        if (waiting.load()) {
+            {
+                std::lock_guard< std::mutex > guard(lock);
+            }
+            condition.notify_all();
+        }
+    }
+
+    MMAL_BUFFER_HEADER_T* RaspiFrameQueue::push(MMAL_BUFFER_HEADER_T *buffer) {
+        vcos_assert(buffer);
+        MMAL_BUFFER_HEADER_T *evicted = NULL;
+        uint64_t t = tail.load(std::memory_order_relaxed);
+
+        while (!closed.load() && t - head.load() > mask) {
+            if (overflow_ == RASPIFRAMEQUEUE_DROP_NEWEST) {
+                dropped_++;
+                return buffer;
+            } else if (overflow_ == RASPIFRAMEQUEUE_DROP_OLDEST) {
+                // Races with the consumer for the oldest slot; whoever advances head owns the buffer
+                uint64_t h = head.load();
+                MMAL_BUFFER_HEADER_T *oldest = slots[h & mask].load(std::memory_order_relaxed);
+                if (t - h > mask && head.compare_exchange_strong(h, h + 1)) {
+                    evicted = oldest;
+                    dropped_++;
+                }
+            } else {
+                producer_waiting.store(true);
+                {
+                    std::unique_lock< std::mutex > guard(lock);
+                    not_full.wait(guard, [this, t]() { return closed.load() || t - head.load() <= mask; });
+                }
+                producer_waiting.store(false);
+            }
+        }
+
+        if (closed.load()) {
+            dropped_++;
+            return buffer;
+        }
+
+        slots[t & mask].store(buffer, std::memory_order_relaxed);
+        tail.store(t + 1);
+        wake(consumer_waiting, not_empty);
+        return evicted;
+    }
+
+    MMAL_BUFFER_HEADER_T* RaspiFrameQueue::pop() {
+        uint64_t h = head.load();
+        while (h != tail.load()) {
+            MMAL_BUFFER_HEADER_T *buffer = slots[h & mask].load(std::memory_order_relaxed);
+            if (head.compare_exchange_weak(h, h + 1)) {
+                wake(producer_waiting, not_full);
+                return buffer;
+            }
+        }
+        return NULL;
+    }
+
+    MMAL_BUFFER_HEADER_T* RaspiFrameQueue::wait(uint32_t timeout_ms) {
+        MMAL_BUFFER_HEADER_T *buffer = pop();
+        if (buffer || closed.load()) {
+            return buffer;
+        }
+
+        consumer_waiting.store(true);
+        {
+            std::unique_lock< std::mutex > guard(lock);
+            not_empty.wait_for(guard, std::chrono::milliseconds(timeout_ms), [this]() { return closed.load() || head.load() != tail.load(); });
+        }
+        consumer_waiting.store(false);
+        return pop();
+    }
+
+    void RaspiFrameQueue::close() {
+        closed.store(true);
+        {
+            std::lock_guard< std::mutex > guard(lock);
+        }
+        not_empty.notify_all();
+        not_full.notify_all();
+    }
+
+    bool RaspiFrameQueue::is_closed() {
+        return closed.load();
+    }
+
+    unsigned int RaspiFrameQueue::size() {
+        uint64_t h = head.load();
+        return (unsigned int)(tail.load() - h);
+    }
+
+    unsigned int RaspiFrameQueue::depth() {
+        return (unsigned int)(mask + 1);
+    }
+
+    uint64_t RaspiFrameQueue::dropped() {
+        return dropped_.load();
+    }
+
+}
@@ -0,0 +1,92 @@
+#include "raspivid/RaspiFrameRef.h"
+
+namespace raspivid {
+
+    RaspiFrameRef::RaspiFrameRef() : buffer_(NULL) {
+    }
+
+    RaspiFrameRef::RaspiFrameRef(MMAL_BUFFER_HEADER_T *buffer) : buffer_(NULL) {
+        pin(buffer);
+    }
+
+    RaspiFrameRef::RaspiFrameRef(const RaspiFrameRef &other) : buffer_(NULL) {
+        pin(other.buffer_);
+    }
+
+    RaspiFrameRef::RaspiFrameRef(RaspiFrameRef &&other) : buffer_(other.buffer_) {
+        other.buffer_ = NULL;
+    }
+
+    RaspiFrameRef& RaspiFrameRef::operator=(const RaspiFrameRef &other) {
+        if (this != &other) {
+            MMAL_BUFFER_HEADER_T *previous = buffer_;
+            buffer_ = NULL;
+            pin(other.buffer_);
+            if (previous) {
+                mmal_buffer_header_mem_unlock(previous);
+                mmal_buffer_header_release(previous);
+            }
+        }
+        return *this;
+    }
+
+    RaspiFrameRef& RaspiFrameRef::operator=(RaspiFrameRef &&other) {
+        if (this != &other) {
+            reset();
+            buffer_ = other.buffer_;
+            other.buffer_ = NULL;
+        }
+        return *this;
+    }
+
+    RaspiFrameRef::~RaspiFrameRef() {
+        reset();
+    }
+
+    void RaspiFrameRef::pin(MMAL_BUFFER_HEADER_T *buffer) {
+        if (!buffer) {
+            return;
+        }
+        mmal_buffer_header_acquire(buffer);
+        if (mmal_buffer_header_mem_lock(buffer) != MMAL_SUCCESS) {
+            vcos_log_error("RaspiFrameRef::pin(): unable to lock buffer memory");
+            mmal_buffer_header_release(buffer);
+            return;
+        }
+        buffer_ = buffer;
+    }
+
+    void RaspiFrameRef::reset() {
+        if (buffer_) {
+            MMAL_BUFFER_HEADER_T *buffer = buffer_;
+            buffer_ = NULL;
+            mmal_buffer_header_mem_unlock(buffer);
+            mmal_buffer_header_release(buffer);
+        }
+    }
+
+    MMAL_BUFFER_HEADER_T* RaspiFrameRef::buffer() const {
+        return buffer_;
+    }
+
+    const uint8_t* RaspiFrameRef::data() const {
+        return buffer_ ? buffer_->data + buffer_->offset : NULL;
+    }
+
+    uint32_t RaspiFrameRef::length() const {
+        return buffer_ ? buffer_->length : 0;
+    }
+
+    uint32_t RaspiFrameRef::flags() const {
+        return buffer_ ? buffer_->flags : 0;
+    }
+
+    int64_t RaspiFrameRef::pts() const {
+        return buffer_ ? buffer_->pts : MMAL_TIME_UNKNOWN;
+    }
+
+    RaspiFrameRef::operator bool() const {
+        return buffer_ != NULL;
+    }
+
+}
@@ -0,0 +1,206 @@
+#include <string.h>
+
+#include "raspivid/RaspiFrameView.h"
+
+namespace raspivid {
+
+    static uint32_t packed_bytes_per_pixel(uint32_t encoding) {
+        switch (encoding) {
+            case MMAL_ENCODING_RGB16:
+            case MMAL_ENCODING_BGR16:
+                return 2;
+            case MMAL_ENCODING_RGB24:
+            case MMAL_ENCODING_BGR24:
+                return 3;
+            case MMAL_ENCODING_RGBA:
+            case MMAL_ENCODING_BGRA:
+            case MMAL_ENCODING_RGB32:
+            case MMAL_ENCODING_BGR32:
+                return 4;
+            default:
+                return 0;
+        }
+    }
+
+    RaspiFrameView::RaspiFrameView() : encoding_(0), width_(0), height_(0), planes_(0), bytes_per_pixel_(0) {
+        memset(plane_, 0, sizeof(plane_));
+        memset(stride_, 0, sizeof(stride_));
+    }
+
+    RaspiFrameView::RaspiFrameView(MMAL_PORT_T *port, MMAL_BUFFER_HEADER_T *buffer) : RaspiFrameView() {
+        MMAL_ES_FORMAT_T *format = port->format;
+        RASPIPORT_FORMAT_S committed;
+        committed.encoding = format->encoding;
+        committed.encoding_variant = format->encoding_variant;
+        committed.width = format->es->video.width;
+        committed.height = format->es->video.height;
+        committed.crop = format->es->video.crop;
+        committed.frame_rate_num = format->es->video.frame_rate.num;
+        committed.frame_rate_den = format->es->video.frame_rate.den;
+        init(committed, buffer->data + buffer->offset, buffer->length);
+    }
+
+    RaspiFrameView::RaspiFrameView(const RASPIPORT_FORMAT_S &format, MMAL_BUFFER_HEADER_T *buffer) : RaspiFrameView() {
+        init(format, buffer->data + buffer->offset, buffer->length);
+    }
+
+    RaspiFrameView::RaspiFrameView(const RASPIPORT_FORMAT_S &format, uint8_t *data, uint32_t length) : RaspiFrameView() {
+        init(format, data, length);
+    }
+
+    void RaspiFrameView::init(const RASPIPORT_FORMAT_S &format, uint8_t *data, uint32_t length) {
+        uint32_t padded_width = VCOS_ALIGN_UP(format.width, 32);
+        uint32_t padded_height = VCOS_ALIGN_UP(format.height, 16);
+        MMAL_RECT_T crop = format.crop;
+        if (!crop.width || !crop.height) {
+            crop.x = 0;
+            crop.y = 0;
+            crop.width = format.width;
+            crop.height = format.height;
+        }
+        if (!data || crop.x < 0 || crop.y < 0 || (uint32_t)(crop.x + crop.width) > padded_width || (uint32_t)(crop.y + crop.height) > padded_height) {
+            vcos_log_error("RaspiFrameView::init(): crop rectangle lies outside the %ux%u frame", padded_width, padded_height);
+            return;
+        }
+
+        size_t size;
+        if (format.encoding == MMAL_ENCODING_I420) {
+            size = (size_t)padded_width * padded_height * 3 / 2;
+        } else if (packed_bytes_per_pixel(format.encoding)) {
+            size = (size_t)padded_width * padded_height * packed_bytes_per_pixel(format.encoding);
+        } else {
+            vcos_log_error("RaspiFrameView::init(): unsupported encoding %4.4s", (const char *)&format.encoding);
+            return;
+        }
+        if (length < size) {
+            vcos_log_error("RaspiFrameView::init(): %u bytes are too few for a %ux%u frame", length, padded_width, padded_height);
+            return;
+        }
+
+        encoding_ = format.encoding;
+        width_ = crop.width;
+        height_ = crop.height;
+        if (encoding_ == MMAL_ENCODING_I420) {
+            // Crop to even coordinates, so that chroma samples stay aligned with luma. Rounds down, as RaspiI420Kernels::crop does
+            uint32_t x = crop.x & ~1, y = crop.y & ~1;
+            planes_ = 3;
+            bytes_per_pixel_ = 1;
+            stride_[0] = padded_width;
+            stride_[1] = stride_[2] = padded_width / 2;
+            plane_[0] = data + y * stride_[0] + x;
+            plane_[1] = data + padded_width * padded_height + (y / 2) * stride_[1] + x / 2;
+            plane_[2] = data + padded_width * padded_height + stride_[1] * (padded_height / 2) + (y / 2) * stride_[2] + x / 2;
+        } else {
+            planes_ = 1;
+            bytes_per_pixel_ = packed_bytes_per_pixel(encoding_);
+            stride_[0] = padded_width * bytes_per_pixel_;
+            plane_[0] = data + crop.y * stride_[0] + crop.x * bytes_per_pixel_;
+        }
+    }
+
+    RaspiFrameView::operator bool() const {
+        return planes_ != 0;
+    }
+
+    uint32_t RaspiFrameView::encoding() const {
+        return encoding_;
+    }
+
+    uint32_t RaspiFrameView::width() const {
+        return width_;
+    }
+
+    uint32_t RaspiFrameView::height() const {
+        return height_;
+    }
+
+    unsigned int RaspiFrameView::planes() const {
+        return planes_;
+    }
+
+    uint8_t* RaspiFrameView::plane(unsigned int plane) const {
+        return plane < planes_ ? plane_[plane] : NULL;
+    }
+
+    uint32_t RaspiFrameView::stride(unsigned int plane) const {
+        return plane < planes_ ? stride_[plane] : 0;
+    }
+
+    uint32_t RaspiFrameView::plane_width(unsigned int plane) const {
+        if (plane >= planes_) {
+            return 0;
+        }
+        return plane ? (width_ + 1) / 2 : width_;
+    }
+
+    uint32_t RaspiFrameView::plane_height(unsigned int plane) const {
+        if (plane >= planes_) {
+            return 0;
+        }
+        return plane ? (height_ + 1) / 2 : height_;
+    }
+
+    uint32_t RaspiFrameView::bytes_per_pixel() const {
+        return bytes_per_pixel_;
+    }
+
+    uint8_t* RaspiFrameView::y() const {
+        return encoding_ == MMAL_ENCODING_I420 ? plane_[0] : NULL;
+    }
+
+    uint8_t* RaspiFrameView::u() const {
+        return encoding_ == MMAL_ENCODING_I420 ? plane_[1] : NULL;
+    }
+
+    uint8_t* RaspiFrameView::v() const {
+        return encoding_ == MMAL_ENCODING_I420 ? plane_[2] : NULL;
+    }
+
+    uint8_t* RaspiFrameView::row(unsigned int plane, uint32_t y) const {
+        return plane < planes_ ? plane_[plane] + (size_t)y * stride_[plane] : NULL;
+    }
+
+    RaspiFrameView::Rows RaspiFrameView::rows(unsigned int plane) const {
+        if (plane >= planes_) {
+            return Rows(NULL, 0, 0);
+        }
+        return Rows(plane_[plane], stride_[plane], plane_height(plane));
+    }
+
+    RaspiFrameView RaspiFrameView::crop(uint32_t x, uint32_t y, uint32_t width, uint32_t height) const {
+        RaspiFrameView result = *this;
+        if (!planes_) {
+            return result;
+        }
+        if (encoding_ == MMAL_ENCODING_I420) {
+            // The same rule as RaspiI420Kernels::crop
+            x = vcos_min(x & ~1u, width_ & ~1u);
+            y = vcos_min(y & ~1u, height_ & ~1u);
+        }
+        x = vcos_min(x, width_);
+        y = vcos_min(y, height_);
+        result.width_ = vcos_min(width, width_ - x);
+        result.height_ = vcos_min(height, height_ - y);
+        for (unsigned int i = 0; i < planes_; i++) {
+            uint32_t shift = i ? 1 : 0;
+            result.plane_[i] += (size_t)(y >> shift) * stride_[i] + (x >> shift) * bytes_per_pixel_;
+        }
+        return result;
+    }
+
+    RASPII420_IMAGE_S RaspiFrameView::i420() const {
+        RASPII420_IMAGE_S image;
+        memset(&image, 0, sizeof(image));
+        if (encoding_ != MMAL_ENCODING_I420) {
+            return image;
+        }
+        for (int i = 0; i < 3; i++) {
+            image.plane[i] = plane_[i];
+            image.stride[i] = stride_[i];
+        }
+        image.width = width_;
+        image.height = height_;
+        return image;
+    }
+
+}
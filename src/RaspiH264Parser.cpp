@@ -0,0 +1,166 @@
+#include "raspivid/RaspiH264Parser.h"
+
+namespace raspivid {
+
+    // Zero bytes held back at the end of one buffer that turn out to be NAL payload are reported from here
+    static const uint8_t held_zero_bytes[3] = { 0, 0, 0 };
+
+    shared_ptr< RaspiH264Parser > RaspiH264Parser::create() {
+        return shared_ptr< RaspiH264Parser >( new RaspiH264Parser() );
+    }
+
+    RaspiH264Parser::RaspiH264Parser() : count(0), overflowed_(0), pts_(MMAL_TIME_UNKNOWN) {
+        reset();
+    }
+
+    void RaspiH264Parser::reset() {
+        in_nal = false;
+        nal_started = false;
+        header_pending = false;
+        held_zeros = 0;
+        type = 0;
+        ref_idc = 0;
+    }
+
+    const RASPIH264_NAL_S* RaspiH264Parser::nals() const {
+        return nals_;
+    }
+
+    uint64_t RaspiH264Parser::overflowed() const {
+        return overflowed_;
+    }
+
+    void RaspiH264Parser::emit(const uint8_t *data, uint32_t length, uint16_t flags) {
+        if (!nal_started) {
+            flags |= RASPIH264_NAL_FLAG_START;
+            nal_started = true;
+        }
+        if (count >= RASPIH264_MAX_NALS) {
+            overflowed_++;
+            return;
+        }
+        RASPIH264_NAL_S &nal = nals_[count++];
+        nal.data = data;
+        nal.length = length;
+        nal.type = type;
+        nal.ref_idc = ref_idc;
+        nal.flags = flags;
+        nal.pts = pts_;
+    }
+
+    void RaspiH264Parser::start_nal(uint8_t header) {
+        type = header & 0x1f;
+        ref_idc = (header >> 5) & 0x3;
+        in_nal = true;
+        nal_started = false;
+    }
+
+    void RaspiH264Parser::end_nal(const uint8_t *data, uint32_t length, uint16_t flags) {
+        // A NAL never ends in a zero byte, so zeros before a start code are trailing_zero_8bits or part of a 4 byte start code
+        while (length && data[length - 1] == 0) {
+            length--;
+        }
+        emit(data, length, flags | RASPIH264_NAL_FLAG_END);
+        in_nal = false;
+    }
+
+    uint32_t RaspiH264Parser::parse(MMAL_BUFFER_HEADER_T *buffer) {
+        return parse(buffer->data + buffer->offset, buffer->length, buffer->flags, buffer->pts);
+    }
+
+    uint32_t RaspiH264Parser::parse(const uint8_t *data, uint32_t length, uint32_t flags, int64_t pts) {
+        count = 0;
+        if (flags & MMAL_BUFFER_HEADER_FLAG_CODECSIDEINFO) {
+            return 0;
+        }
+        pts_ = pts;
+        if (!length && !(flags & (MMAL_BUFFER_HEADER_FLAG_FRAME_END | MMAL_BUFFER_HEADER_FLAG_CONFIG))) {
+            return 0;
+        }
+
+        uint32_t piece_start = 0;
+        uint32_t pos = 0;
+
+        if (header_pending && length) {
+            // The previous buffer ended with a start code
+            header_pending = false;
+            start_nal(data[0]);
+            pos = 1;
+        } else if (held_zeros && length) {
+            // The previous buffer ended in zeros, which may be the beginning of a start code
+            uint32_t zeros = 0;
+            while (zeros < length && zeros < 3 && data[zeros] == 0) {
+                zeros++;
+            }
+            if (zeros == length && !(flags & (MMAL_BUFFER_HEADER_FLAG_FRAME_END | MMAL_BUFFER_HEADER_FLAG_CONFIG))) {
+                // Still nothing but zeros. Keep holding the last three, the ones before them are payload.
+                uint32_t total = held_zeros + zeros;
+                held_zeros = total < 3 ? total : 3;
+                if (in_nal && total > held_zeros) {
+                    emit(held_zero_bytes, total - held_zeros, 0);
+                }
+                return count;
+            } else if (zeros < length && data[zeros] == 1 && held_zeros + zeros >= 2) {
+                if (in_nal) {
+                    end_nal(data, 0, 0);
+                }
+                if (zeros + 1 < length) {
+                    start_nal(data[zeros + 1]);
+                    piece_start = zeros + 1;
+                    pos = zeros + 2;
+                } else {
+                    header_pending = true;
+                    piece_start = pos = length;
+                }
+            } else if (in_nal && zeros < length) {
+                emit(held_zero_bytes, held_zeros, 0);
+            }
+            held_zeros = 0;
+        }
+
+        uint32_t k = pos + 2;
+        while (k < length) {
+            if (data[k] > 1) {
+                k += 3;
+            } else if (data[k] == 1 && data[k - 1] == 0 && data[k - 2] == 0) {
+                if (in_nal) {
+                    end_nal(data + piece_start, k - 2 - piece_start, 0);
+                }
+                if (k + 1 < length) {
+                    start_nal(data[k + 1]);
+                    piece_start = k + 1;
+                    k += 4;
+                } else {
+                    header_pending = true;
+                    piece_start = length;
+                    break;
+                }
+            } else {
+                k++;
+            }
+        }
+
+        if (flags & (MMAL_BUFFER_HEADER_FLAG_FRAME_END | MMAL_BUFFER_HEADER_FLAG_CONFIG)) {
+            if (in_nal) {
+                end_nal(data + piece_start, length - piece_start,
+                    flags & MMAL_BUFFER_HEADER_FLAG_FRAME_END ? RASPIH264_NAL_FLAG_ACCESS_UNIT_END : 0);
+            }
+            header_pending = false;
+            return count;
+        }
+
+        if (!header_pending) {
+            // Hold back trailing zeros until the next buffer shows whether they start a start code
+            uint32_t end = length;
+            while (end > piece_start && length - end < 3 && data[end - 1] == 0) {
+                end--;
+            }
+            held_zeros = length - end;
+            if (in_nal && end > piece_start) {
+                emit(data + piece_start, end - piece_start, 0);
+            }
+        }
+        return count;
+    }
+
+}
@@ -0,0 +1,228 @@
+#include <string.h>
+
+#include "raspivid/RaspiH264RingBuffer.h"
+
+#define RASPIH264RINGBUFFER_RECORD_HEADER   16
+#define RASPIH264RINGBUFFER_SNAPSHOT_TRIES  4
+
+namespace raspivid {
+
+    static uint64_t round_up_power_of_two(uint64_t value) {
+        uint64_t result = 1;
+        while (result < value) {
+            result <<= 1;
+        }
+        return result;
+    }
+
+    shared_ptr< RaspiH264RingBuffer > RaspiH264RingBuffer::create(size_t capacity, unsigned int keyframes) {
+        if (capacity < 4096) {
+            capacity = 4096;
+        }
+        if (keyframes < 2) {
+            keyframes = 2;
+        }
+        return shared_ptr< RaspiH264RingBuffer >( new RaspiH264RingBuffer(capacity, keyframes) );
+    }
+
+    RaspiH264RingBuffer::RaspiH264RingBuffer(size_t capacity, unsigned int keyframes) :
+            capacity_(round_up_power_of_two(capacity)), keyframe_mask(round_up_power_of_two(keyframes) - 1),
+            overwritten(0), committed(0), keyframe_count(0), dropped_(0), head(0), access_unit_start(0),
+            access_unit_has_sps(false), access_unit_is_keyframe(false) {
+        arena.reset(new std::atomic<uint64_t>[capacity_ / 8]);
+        for (uint64_t i = 0; i < capacity_ / 8; i++) {
+            arena[i].store(0, std::memory_order_relaxed);
+        }
+        keyframes_.reset(new KEYFRAME_S[keyframe_mask + 1]);
+        for (uint64_t i = 0; i <= keyframe_mask; i++) {
+            keyframes_[i].sequence.store(0, std::memory_order_relaxed);
+            keyframes_[i].position.store(0, std::memory_order_relaxed);
+            keyframes_[i].pts.store(MMAL_TIME_UNKNOWN, std::memory_order_relaxed);
+        }
+        parser = RaspiH264Parser::create();
+        // SPS and PPS are a few dozen bytes, so copying them never has to allocate
+        config.reserve(1024);
+    }
+
+    void RaspiH264RingBuffer::write_word(uint64_t position, uint64_t word) {
+        arena[(position & (capacity_ - 1)) >> 3].store(word, std::memory_order_relaxed);
+    }
+
+    uint64_t RaspiH264RingBuffer::read_word(uint64_t position) {
+        return arena[(position & (capacity_ - 1)) >> 3].load(std::memory_order_relaxed);
+    }
+
+    void RaspiH264RingBuffer::callback(MMAL_PORT_T *port, MMAL_BUFFER_HEADER_T *buffer) {
+        if (!port->is_enabled || !buffer->length || (buffer->flags & MMAL_BUFFER_HEADER_FLAG_CODECSIDEINFO)) {
+            return;
+        }
+        const uint8_t *data = buffer->data + buffer->offset;
+        if ((buffer->flags & MMAL_BUFFER_HEADER_FLAG_CONFIG) && buffer->length <= config.capacity()) {
+            config.assign(data, data + buffer->length);
+        }
+
+        bool idr = false;
+        uint32_t count = parser->parse(buffer);
+        const RASPIH264_NAL_S *nals = parser->nals();
+        for (uint32_t i = 0; i < count; i++) {
+            if (!(nals[i].flags & RASPIH264_NAL_FLAG_START)) {
+                continue;
+            }
+            if (nals[i].type == RASPIH264_NAL_SPS) {
+                access_unit_has_sps = true;
+            } else if (nals[i].type == RASPIH264_NAL_IDR) {
+                idr = true;
+            }
+        }
+        if (idr && !access_unit_is_keyframe) {
+            access_unit_is_keyframe = true;
+            if (!access_unit_has_sps && !config.empty()) {
+                append(config.data(), config.size(), MMAL_BUFFER_HEADER_FLAG_CONFIG, MMAL_TIME_UNKNOWN);
+            }
+        }
+
+        append(data, buffer->length, buffer->flags, buffer->pts);
+
+        if (!(buffer->flags & MMAL_BUFFER_HEADER_FLAG_FRAME_END)) {
+            return;
+        }
+        committed.store(head, std::memory_order_release);
+        if (access_unit_is_keyframe) {
+            uint64_t n = keyframe_count.load(std::memory_order_relaxed);
+            KEYFRAME_S &keyframe = keyframes_[n & keyframe_mask];
+            keyframe.sequence.store(2 * n + 1, std::memory_order_relaxed);
+            std::atomic_thread_fence(std::memory_order_release);
+            keyframe.position.store(access_unit_start, std::memory_order_relaxed);
+            keyframe.pts.store(buffer->pts, std::memory_order_relaxed);
+            keyframe.sequence.store(2 * n + 2, std::memory_order_release);
+            keyframe_count.store(n + 1, std::memory_order_release);
+        }
+        access_unit_start = head;
+        access_unit_has_sps = false;
+        access_unit_is_keyframe = false;
+    }
+
+    void RaspiH264RingBuffer::append(const uint8_t *data, uint32_t length, uint32_t flags, int64_t pts) {
+        uint64_t size = RASPIH264RINGBUFFER_RECORD_HEADER + ((length + 7) & ~(uint64_t)7);
+        if (size > capacity_) {
+            dropped_.fetch_add(1, std::memory_order_relaxed);
+            return;
+        }
+        uint64_t end = head + size;
+        if (end > capacity_ && end - capacity_ > overwritten.load(std::memory_order_relaxed)) {
+            // Readers check this after copying, so it must be visible before any of the words below
+            overwritten.store(end - capacity_, std::memory_order_relaxed);
+            std::atomic_thread_fence(std::memory_order_release);
+        }
+        write_word(head, length | ((uint64_t)flags << 32));
+        write_word(head + 8, (uint64_t)pts);
+        uint64_t position = head + RASPIH264RINGBUFFER_RECORD_HEADER;
+        uint32_t i = 0;
+        for (; i + 8 <= length; i += 8, position += 8) {
+            uint64_t word;
+            memcpy(&word, data + i, 8);
+            write_word(position, word);
+        }
+        if (i < length) {
+            uint64_t word = 0;
+            memcpy(&word, data + i, length - i);
+            write_word(position, word);
+        }
+        head = end;
+    }
+
+    bool RaspiH264RingBuffer::find_keyframe(int64_t from_pts, uint64_t &position, int64_t &pts) {
+        uint64_t count = keyframe_count.load(std::memory_order_acquire);
+        uint64_t oldest = count > keyframe_mask + 1 ? count - (keyframe_mask + 1) : 0;
+        uint64_t floor = overwritten.load(std::memory_order_acquire);
+        bool found = false;
+        for (uint64_t i = count; i-- > oldest; ) {
+            KEYFRAME_S &keyframe = keyframes_[i & keyframe_mask];
+            uint64_t sequence = keyframe.sequence.load(std::memory_order_acquire);
+            uint64_t keyframe_position = keyframe.position.load(std::memory_order_relaxed);
+            int64_t keyframe_pts = keyframe.pts.load(std::memory_order_relaxed);
+            std::atomic_thread_fence(std::memory_order_acquire);
+            if (sequence != 2 * i + 2 || keyframe.sequence.load(std::memory_order_relaxed) != sequence ||
+                    keyframe_position < floor) {
+                // Overwritten, and so is every older keyframe
+                break;
+            }
+            position = keyframe_position;
+            pts = keyframe_pts;
+            found = true;
+            if (from_pts != MMAL_TIME_UNKNOWN && keyframe_pts != MMAL_TIME_UNKNOWN && keyframe_pts <= from_pts) {
+                break;
+            }
+        }
+        return found;
+    }
+
+    MMAL_STATUS_T RaspiH264RingBuffer::snapshot(vector< uint8_t > &data, vector< RASPIH264RINGBUFFER_RECORD_S > &records, int64_t from_pts) {
+        for (int attempt = 0; attempt < RASPIH264RINGBUFFER_SNAPSHOT_TRIES; attempt++) {
+            uint64_t start;
+            int64_t start_pts;
+            if (!find_keyframe(from_pts, start, start_pts)) {
+                return MMAL_ENOENT;
+            }
+            uint64_t end = committed.load(std::memory_order_acquire);
+            data.clear();
+            records.clear();
+
+            // Headers may be torn by the callback overwriting them, so check every length against the end before using it
+            bool torn = false;
+            uint64_t position = start;
+            while (position < end) {
+                uint64_t header = read_word(position);
+                RASPIH264RINGBUFFER_RECORD_S record;
+                record.offset = data.size();
+                record.length = (uint32_t)header;
+                record.flags = (uint32_t)(header >> 32);
+                record.pts = (int64_t)read_word(position + 8);
+                uint64_t size = RASPIH264RINGBUFFER_RECORD_HEADER + ((record.length + 7) & ~(uint64_t)7);
+                if (position + size > end) {
+                    torn = true;
+                    break;
+                }
+                data.resize(record.offset + record.length);
+                uint8_t *out = data.data() + record.offset;
+                uint64_t word_position = position + RASPIH264RINGBUFFER_RECORD_HEADER;
+                for (uint32_t i = 0; i < record.length; i += 8, word_position += 8) {
+                    uint64_t word = read_word(word_position);
+                    memcpy(out + i, &word, record.length - i < 8 ? record.length - i : 8);
+                }
+                records.push_back(record);
+                position += size;
+            }
+
+            std::atomic_thread_fence(std::memory_order_acquire);
+            if (!torn && overwritten.load(std::memory_order_relaxed) <= start) {
+                return MMAL_SUCCESS;
+            }
+        }
+        vcos_log_error("RaspiH264RingBuffer::snapshot(): data was overwritten while copying");
+        data.clear();
+        records.clear();
+        return MMAL_EAGAIN;
+    }
+
+    int64_t RaspiH264RingBuffer::oldest_keyframe_pts() {
+        uint64_t position;
+        int64_t pts;
+        return find_keyframe(MMAL_TIME_UNKNOWN, position, pts) ? pts : MMAL_TIME_UNKNOWN;
+    }
+
+    uint64_t RaspiH264RingBuffer::dropped() {
+        return dropped_.load(std::memory_order_relaxed);
+    }
+
+    void RaspiH264RingBuffer::clear() {
+        // Positions never go back, so snapshots racing with this simply find nothing after the new floor
+        overwritten.store(head, std::memory_order_release);
+        committed.store(head, std::memory_order_release);
+        access_unit_start = head;
+        access_unit_has_sps = false;
+        access_unit_is_keyframe = false;
+        parser->reset();
+    }
+
+}
@@ -0,0 +1,699 @@
+#include <string.h>
+
+#include "raspivid/RaspiI420Kernels.h"
+
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+#include <arm_neon.h>
+#define RASPII420_NEON 1
+#endif
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#define RASPII420_SSE2 1
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#include <immintrin.h>
+#define RASPII420_AVX2 1
+#define RASPII420_TARGET_AVX2 __attribute__((target("avx2")))
+#endif
+#endif
+
+namespace raspivid {
+
+    static inline uint8_t clamp_byte(int32_t value) {
+        return value < 0 ? 0 : value > 255 ? 255 : (uint8_t)value;
+    }
+
+    /*
+     Scalar reference kernels. Every other path must produce exactly the same output.
+     */
+
+    static void downscale2_scalar(const uint8_t *src, uint32_t src_stride, uint8_t *dst, uint32_t dst_stride, uint32_t width, uint32_t height) {
+        for (uint32_t y = 0; y < height; y++) {
+            const uint8_t *s0 = src + 2 * y * src_stride, *s1 = s0 + src_stride;
+            uint8_t *d = dst + y * dst_stride;
+            for (uint32_t x = 0; x < width; x++) {
+                d[x] = (s0[2 * x] + s0[2 * x + 1] + s1[2 * x] + s1[2 * x + 1] + 2) >> 2;
+            }
+        }
+    }
+
+    static void downscale4_scalar(const uint8_t *src, uint32_t src_stride, uint8_t *dst, uint32_t dst_stride, uint32_t width, uint32_t height) {
+        for (uint32_t y = 0; y < height; y++) {
+            const uint8_t *s = src + 4 * y * src_stride;
+            uint8_t *d = dst + y * dst_stride;
+            for (uint32_t x = 0; x < width; x++) {
+                uint32_t sum = 0;
+                for (uint32_t r = 0; r < 4; r++) {
+                    const uint8_t *p = s + r * src_stride + 4 * x;
+                    sum += p[0] + p[1] + p[2] + p[3];
+                }
+                d[x] = (sum + 8) >> 4;
+            }
+        }
+    }
+
+    static void histogram_scalar(const uint8_t *src, uint32_t src_stride, uint32_t width, uint32_t height, uint32_t *bins) {
+        for (uint32_t y = 0; y < height; y++) {
+            const uint8_t *s = src + y * src_stride;
+            for (uint32_t x = 0; x < width; x++) {
+                bins[s[x]]++;
+            }
+        }
+    }
+
+    static uint32_t difference_scalar(const uint8_t *a, uint32_t a_stride, const uint8_t *b, uint32_t b_stride, uint8_t *dst,
+            uint32_t dst_stride, uint32_t width, uint32_t height, uint8_t threshold) {
+        uint32_t count = 0;
+        for (uint32_t y = 0; y < height; y++) {
+            const uint8_t *pa = a + y * a_stride, *pb = b + y * b_stride;
+            uint8_t *d = dst ? dst + y * dst_stride : NULL;
+            for (uint32_t x = 0; x < width; x++) {
+                uint8_t diff = pa[x] > pb[x] ? pa[x] - pb[x] : pb[x] - pa[x];
+                if (d) {
+                    d[x] = diff;
+                }
+                count += diff > threshold;
+            }
+        }
+        return count;
+    }
+
+    // BT.601 limited range: 1.164 (Y - 16) + 1.596 (V - 128) and so on, in 8 bit fixed point
+    static inline void rgb_pixel(uint8_t y, uint8_t u, uint8_t v, uint8_t *rgb) {
+        int32_t c = 298 * ((int32_t)y - 16) + 128, d = (int32_t)u - 128, e = (int32_t)v - 128;
+        rgb[0] = clamp_byte((c + 409 * e) >> 8);
+        rgb[1] = clamp_byte((c - 100 * d - 208 * e) >> 8);
+        rgb[2] = clamp_byte((c + 516 * d) >> 8);
+    }
+
+    static void rgb24_row_scalar(const uint8_t *y, const uint8_t *u, const uint8_t *v, uint8_t *dst, uint32_t x, uint32_t width) {
+        for (; x < width; x++) {
+            rgb_pixel(y[x], u[x >> 1], v[x >> 1], dst + 3 * x);
+        }
+    }
+
+    static void to_rgb24_scalar(const uint8_t *y, uint32_t y_stride, const uint8_t *u, uint32_t u_stride, const uint8_t *v,
+            uint32_t v_stride, uint8_t *dst, uint32_t dst_stride, uint32_t width, uint32_t height) {
+        for (uint32_t row = 0; row < height; row++) {
+            rgb24_row_scalar(y + row * y_stride, u + (row >> 1) * u_stride, v + (row >> 1) * v_stride, dst + row * dst_stride, 0, width);
+        }
+    }
+
+    /*
+     Histograms do not vectorize without a scatter instruction. Instead, spreading neighbouring pixels over four tables
+     breaks the dependency between increments of the same bin, which is what limits the simple loop on flat images.
+     */
+    static void histogram_split(const uint8_t *src, uint32_t src_stride, uint32_t width, uint32_t height, uint32_t *bins) {
+        uint32_t tables[4][256];
+        memset(tables, 0, sizeof(tables));
+        for (uint32_t y = 0; y < height; y++) {
+            const uint8_t *s = src + y * src_stride;
+            uint32_t x = 0;
+            for (; x + 4 <= width; x += 4) {
+                tables[0][s[x]]++;
+                tables[1][s[x + 1]]++;
+                tables[2][s[x + 2]]++;
+                tables[3][s[x + 3]]++;
+            }
+            for (; x < width; x++) {
+                tables[0][s[x]]++;
+            }
+        }
+        for (int i = 0; i < 256; i++) {
+            bins[i] += tables[0][i] + tables[1][i] + tables[2][i] + tables[3][i];
+        }
+    }
+
+#ifdef RASPII420_SSE2
+    // Adds the even and odd bytes of v into 16 bit lanes: pairwise horizontal sums
+    static inline __m128i pair_sums(__m128i v) {
+        return _mm_add_epi16(_mm_and_si128(v, _mm_set1_epi16(0xff)), _mm_srli_epi16(v, 8));
+    }
+
+    static void downscale2_sse2(const uint8_t *src, uint32_t src_stride, uint8_t *dst, uint32_t dst_stride, uint32_t width, uint32_t height) {
+        const __m128i round = _mm_set1_epi16(2);
+        for (uint32_t y = 0; y < height; y++) {
+            const uint8_t *s0 = src + 2 * y * src_stride, *s1 = s0 + src_stride;
+            uint8_t *d = dst + y * dst_stride;
+            uint32_t x = 0;
+            for (; x + 16 <= width; x += 16) {
+                __m128i low = _mm_add_epi16(pair_sums(_mm_loadu_si128((const __m128i *)(s0 + 2 * x))),
+                    pair_sums(_mm_loadu_si128((const __m128i *)(s1 + 2 * x))));
+                __m128i high = _mm_add_epi16(pair_sums(_mm_loadu_si128((const __m128i *)(s0 + 2 * x + 16))),
+                    pair_sums(_mm_loadu_si128((const __m128i *)(s1 + 2 * x + 16))));
+                low = _mm_srli_epi16(_mm_add_epi16(low, round), 2);
+                high = _mm_srli_epi16(_mm_add_epi16(high, round), 2);
+                _mm_storeu_si128((__m128i *)(d + x), _mm_packus_epi16(low, high));
+            }
+            for (; x < width; x++) {
+                d[x] = (s0[2 * x] + s0[2 * x + 1] + s1[2 * x] + s1[2 * x + 1] + 2) >> 2;
+            }
+        }
+    }
+
+    static void downscale4_sse2(const uint8_t *src, uint32_t src_stride, uint8_t *dst, uint32_t dst_stride, uint32_t width, uint32_t height) {
+        const __m128i ones = _mm_set1_epi16(1);
+        const __m128i round = _mm_set1_epi32(8);
+        for (uint32_t y = 0; y < height; y++) {
+            const uint8_t *s = src + 4 * y * src_stride;
+            uint8_t *d = dst + y * dst_stride;
+            uint32_t x = 0;
+            for (; x + 8 <= width; x += 8) {
+                __m128i low = _mm_setzero_si128(), high = _mm_setzero_si128();
+                for (uint32_t r = 0; r < 4; r++) {
+                    const uint8_t *p = s + r * src_stride + 4 * x;
+                    low = _mm_add_epi16(low, pair_sums(_mm_loadu_si128((const __m128i *)p)));
+                    high = _mm_add_epi16(high, pair_sums(_mm_loadu_si128((const __m128i *)(p + 16))));
+                }
+                // madd with ones adds neighbouring pairs, completing the 4x4 sums in 32 bit lanes
+                low = _mm_srli_epi32(_mm_add_epi32(_mm_madd_epi16(low, ones), round), 4);
+                high = _mm_srli_epi32(_mm_add_epi32(_mm_madd_epi16(high, ones), round), 4);
+                __m128i words = _mm_packs_epi32(low, high);
+                _mm_storel_epi64((__m128i *)(d + x), _mm_packus_epi16(words, words));
+            }
+            for (; x < width; x++) {
+                uint32_t sum = 0;
+                for (uint32_t r = 0; r < 4; r++) {
+                    const uint8_t *p = s + r * src_stride + 4 * x;
+                    sum += p[0] + p[1] + p[2] + p[3];
+                }
+                d[x] = (sum + 8) >> 4;
+            }
+        }
+    }
+
+    static uint32_t difference_sse2(const uint8_t *a, uint32_t a_stride, const uint8_t *b, uint32_t b_stride, uint8_t *dst,
+            uint32_t dst_stride, uint32_t width, uint32_t height, uint8_t threshold) {
+        const __m128i limit = _mm_set1_epi8((char)threshold);
+        const __m128i ones = _mm_set1_epi8(1);
+        const __m128i zero = _mm_setzero_si128();
+        __m128i counts = _mm_setzero_si128();
+        uint32_t count = 0;
+        for (uint32_t y = 0; y < height; y++) {
+            const uint8_t *pa = a + y * a_stride, *pb = b + y * b_stride;
+            uint8_t *d = dst ? dst + y * dst_stride : NULL;
+            uint32_t x = 0;
+            for (; x + 16 <= width; x += 16) {
+                __m128i va = _mm_loadu_si128((const __m128i *)(pa + x));
+                __m128i vb = _mm_loadu_si128((const __m128i *)(pb + x));
+                __m128i diff = _mm_or_si128(_mm_subs_epu8(va, vb), _mm_subs_epu8(vb, va));
+                if (d) {
+                    _mm_storeu_si128((__m128i *)(d + x), diff);
+                }
+                __m128i over = _mm_andnot_si128(_mm_cmpeq_epi8(_mm_subs_epu8(diff, limit), zero), ones);
+                counts = _mm_add_epi64(counts, _mm_sad_epu8(over, zero));
+            }
+            for (; x < width; x++) {
+                uint8_t diff = pa[x] > pb[x] ? pa[x] - pb[x] : pb[x] - pa[x];
+                if (d) {
+                    d[x] = diff;
+                }
+                count += diff > threshold;
+            }
+        }
+        uint64_t lanes[2];
+        _mm_storeu_si128((__m128i *)lanes, counts);
+        return count + (uint32_t)(lanes[0] + lanes[1]);
+    }
+
+    // Packs two signed 16 bit values into each 32 bit lane, as madd coefficients for (low, high) pairs
+    static inline __m128i coefficients(int16_t low, int16_t high) {
+        return _mm_set1_epi32((int32_t)(((uint32_t)(uint16_t)high << 16) | (uint16_t)low));
+    }
+
+    // Converts 8 pixels, given as 16 bit Y - 16, U - 128 and V - 128, to 16 bit R, G and B before clamping
+    static inline void rgb8_sse2(__m128i c, __m128i d, __m128i e, __m128i *r, __m128i *g, __m128i *b) {
+        const __m128i one = _mm_set1_epi16(1), round = _mm_set1_epi32(128);
+        const __m128i k_r = coefficients(298, 409), k_g = coefficients(298, -100), k_gv = coefficients(-208, 128), k_b = coefficients(298, 516);
+        __m128i ce_low = _mm_unpacklo_epi16(c, e), ce_high = _mm_unpackhi_epi16(c, e);
+        __m128i cd_low = _mm_unpacklo_epi16(c, d), cd_high = _mm_unpackhi_epi16(c, d);
+        // G has three terms, so its rounding constant rides along with V as 128 * 1
+        __m128i e1_low = _mm_unpacklo_epi16(e, one), e1_high = _mm_unpackhi_epi16(e, one);
+        *r = _mm_packs_epi32(_mm_srai_epi32(_mm_add_epi32(_mm_madd_epi16(ce_low, k_r), round), 8),
+            _mm_srai_epi32(_mm_add_epi32(_mm_madd_epi16(ce_high, k_r), round), 8));
+        *g = _mm_packs_epi32(_mm_srai_epi32(_mm_add_epi32(_mm_madd_epi16(cd_low, k_g), _mm_madd_epi16(e1_low, k_gv)), 8),
+            _mm_srai_epi32(_mm_add_epi32(_mm_madd_epi16(cd_high, k_g), _mm_madd_epi16(e1_high, k_gv)), 8));
+        *b = _mm_packs_epi32(_mm_srai_epi32(_mm_add_epi32(_mm_madd_epi16(cd_low, k_b), round), 8),
+            _mm_srai_epi32(_mm_add_epi32(_mm_madd_epi16(cd_high, k_b), round), 8));
+    }
+
+    // Converts 16 pixels to R, G and B bytes
+    static inline void rgb16_sse2(const uint8_t *y, const uint8_t *u, const uint8_t *v, __m128i *r, __m128i *g, __m128i *b) {
+        const __m128i zero = _mm_setzero_si128();
+        __m128i vy = _mm_loadu_si128((const __m128i *)y);
+        __m128i vu = _mm_loadl_epi64((const __m128i *)u);
+        __m128i vv = _mm_loadl_epi64((const __m128i *)v);
+        vu = _mm_unpacklo_epi8(vu, vu);
+        vv = _mm_unpacklo_epi8(vv, vv);
+        const __m128i y_offset = _mm_set1_epi16(16), uv_offset = _mm_set1_epi16(128);
+        __m128i r_low, g_low, b_low, r_high, g_high, b_high;
+        rgb8_sse2(_mm_sub_epi16(_mm_unpacklo_epi8(vy, zero), y_offset), _mm_sub_epi16(_mm_unpacklo_epi8(vu, zero), uv_offset),
+            _mm_sub_epi16(_mm_unpacklo_epi8(vv, zero), uv_offset), &r_low, &g_low, &b_low);
+        rgb8_sse2(_mm_sub_epi16(_mm_unpackhi_epi8(vy, zero), y_offset), _mm_sub_epi16(_mm_unpackhi_epi8(vu, zero), uv_offset),
+            _mm_sub_epi16(_mm_unpackhi_epi8(vv, zero), uv_offset), &r_high, &g_high, &b_high);
+        *r = _mm_packus_epi16(r_low, r_high);
+        *g = _mm_packus_epi16(g_low, g_high);
+        *b = _mm_packus_epi16(b_low, b_high);
+    }
+
+    static void to_rgb24_sse2(const uint8_t *y, uint32_t y_stride, const uint8_t *u, uint32_t u_stride, const uint8_t *v,
+            uint32_t v_stride, uint8_t *dst, uint32_t dst_stride, uint32_t width, uint32_t height) {
+        uint8_t channels[3][16];
+        for (uint32_t row = 0; row < height; row++) {
+            const uint8_t *py = y + row * y_stride, *pu = u + (row >> 1) * u_stride, *pv = v + (row >> 1) * v_stride;
+            uint8_t *d = dst + row * dst_stride;
+            uint32_t x = 0;
+            for (; x + 16 <= width; x += 16) {
+                __m128i r, g, b;
+                rgb16_sse2(py + x, pu + (x >> 1), pv + (x >> 1), &r, &g, &b);
+                // SSE2 has no byte shuffle, so the channels are interleaved through memory
+                _mm_storeu_si128((__m128i *)channels[0], r);
+                _mm_storeu_si128((__m128i *)channels[1], g);
+                _mm_storeu_si128((__m128i *)channels[2], b);
+                uint8_t *out = d + 3 * x;
+                for (int i = 0; i < 16; i++) {
+                    out[3 * i] = channels[0][i];
+                    out[3 * i + 1] = channels[1][i];
+                    out[3 * i + 2] = channels[2][i];
+                }
+            }
+            rgb24_row_scalar(py, pu, pv, d, x, width);
+        }
+    }
+#endif
+
+#ifdef RASPII420_AVX2
+    RASPII420_TARGET_AVX2 static inline __m256i pair_sums_avx2(__m256i v) {
+        return _mm256_add_epi16(_mm256_and_si256(v, _mm256_set1_epi16(0xff)), _mm256_srli_epi16(v, 8));
+    }
+
+    RASPII420_TARGET_AVX2 static void downscale2_avx2(const uint8_t *src, uint32_t src_stride, uint8_t *dst, uint32_t dst_stride, uint32_t width, uint32_t height) {
+        const __m256i round = _mm256_set1_epi16(2);
+        for (uint32_t y = 0; y < height; y++) {
+            const uint8_t *s0 = src + 2 * y * src_stride, *s1 = s0 + src_stride;
+            uint8_t *d = dst + y * dst_stride;
+            uint32_t x = 0;
+            for (; x + 32 <= width; x += 32) {
+                __m256i low = _mm256_add_epi16(pair_sums_avx2(_mm256_loadu_si256((const __m256i *)(s0 + 2 * x))),
+                    pair_sums_avx2(_mm256_loadu_si256((const __m256i *)(s1 + 2 * x))));
+                __m256i high = _mm256_add_epi16(pair_sums_avx2(_mm256_loadu_si256((const __m256i *)(s0 + 2 * x + 32))),
+                    pair_sums_avx2(_mm256_loadu_si256((const __m256i *)(s1 + 2 * x + 32))));
+                low = _mm256_srli_epi16(_mm256_add_epi16(low, round), 2);
+                high = _mm256_srli_epi16(_mm256_add_epi16(high, round), 2);
+                // packus works within 128 bit lanes, so the 64 bit quarters come out as low0 high0 low1 high1
+                __m256i packed = _mm256_permute4x64_epi64(_mm256_packus_epi16(low, high), 0xd8);
+                _mm256_storeu_si256((__m256i *)(d + x), packed);
+            }
+            if (x < width) {
+                downscale2_sse2(s0 + 2 * x, src_stride, d + x, dst_stride, width - x, 1);
+            }
+        }
+    }
+
+    RASPII420_TARGET_AVX2 static uint32_t difference_avx2(const uint8_t *a, uint32_t a_stride, const uint8_t *b, uint32_t b_stride, uint8_t *dst,
+            uint32_t dst_stride, uint32_t width, uint32_t height, uint8_t threshold) {
+        const __m256i limit = _mm256_set1_epi8((char)threshold);
+        const __m256i ones = _mm256_set1_epi8(1);
+        const __m256i zero = _mm256_setzero_si256();
+        __m256i counts = _mm256_setzero_si256();
+        uint32_t count = 0;
+        for (uint32_t y = 0; y < height; y++) {
+            const uint8_t *pa = a + y * a_stride, *pb = b + y * b_stride;
+            uint8_t *d = dst ? dst + y * dst_stride : NULL;
+            uint32_t x = 0;
+            for (; x + 32 <= width; x += 32) {
+                __m256i va = _mm256_loadu_si256((const __m256i *)(pa + x));
+                __m256i vb = _mm256_loadu_si256((const __m256i *)(pb + x));
+                __m256i diff = _mm256_or_si256(_mm256_subs_epu8(va, vb), _mm256_subs_epu8(vb, va));
+                if (d) {
+                    _mm256_storeu_si256((__m256i *)(d + x), diff);
+                }
+                __m256i over = _mm256_andnot_si256(_mm256_cmpeq_epi8(_mm256_subs_epu8(diff, limit), zero), ones);
+                counts = _mm256_add_epi64(counts, _mm256_sad_epu8(over, zero));
+            }
+            if (x < width) {
+                count += difference_sse2(pa + x, a_stride, pb + x, b_stride, d ? d + x : NULL, dst_stride, width - x, 1, threshold);
+            }
+        }
+        uint64_t lanes[4];
+        _mm256_storeu_si256((__m256i *)lanes, counts);
+        return count + (uint32_t)(lanes[0] + lanes[1] + lanes[2] + lanes[3]);
+    }
+
+    // pshufb masks that interleave 16 R, G and B bytes into three 16 byte blocks of packed RGB24, -1 selecting zero
+    static const int8_t rgb24_shuffle[3][3][16] = {
+        {
+            { 0, -1, -1, 1, -1, -1, 2, -1, -1, 3, -1, -1, 4, -1, -1, 5 },
+            { -1, 0, -1, -1, 1, -1, -1, 2, -1, -1, 3, -1, -1, 4, -1, -1 },
+            { -1, -1, 0, -1, -1, 1, -1, -1, 2, -1, -1, 3, -1, -1, 4, -1 }
+        },
+        {
+            { -1, -1, 6, -1, -1, 7, -1, -1, 8, -1, -1, 9, -1, -1, 10, -1 },
+            { 5, -1, -1, 6, -1, -1, 7, -1, -1, 8, -1, -1, 9, -1, -1, 10 },
+            { -1, 5, -1, -1, 6, -1, -1, 7, -1, -1, 8, -1, -1, 9, -1, -1 }
+        },
+        {
+            { -1, 11, -1, -1, 12, -1, -1, 13, -1, -1, 14, -1, -1, 15, -1, -1 },
+            { -1, -1, 11, -1, -1, 12, -1, -1, 13, -1, -1, 14, -1, -1, 15, -1 },
+            { 10, -1, -1, 11, -1, -1, 12, -1, -1, 13, -1, -1, 14, -1, -1, 15 }
+        }
+    };
+
+    RASPII420_TARGET_AVX2 static void to_rgb24_avx2(const uint8_t *y, uint32_t y_stride, const uint8_t *u, uint32_t u_stride, const uint8_t *v,
+            uint32_t v_stride, uint8_t *dst, uint32_t dst_stride, uint32_t width, uint32_t height) {
+        __m128i masks[3][3];
+        for (int block = 0; block < 3; block++) {
+            for (int channel = 0; channel < 3; channel++) {
+                masks[block][channel] = _mm_loadu_si128((const __m128i *)rgb24_shuffle[block][channel]);
+            }
+        }
+        for (uint32_t row = 0; row < height; row++) {
+            const uint8_t *py = y + row * y_stride, *pu = u + (row >> 1) * u_stride, *pv = v + (row >> 1) * v_stride;
+            uint8_t *d = dst + row * dst_stride;
+            uint32_t x = 0;
+            for (; x + 16 <= width; x += 16) {
+                __m128i r, g, b;
+                rgb16_sse2(py + x, pu + (x >> 1), pv + (x >> 1), &r, &g, &b);
+                uint8_t *out = d + 3 * x;
+                for (int block = 0; block < 3; block++) {
+                    __m128i packed = _mm_or_si128(_mm_or_si128(_mm_shuffle_epi8(r, masks[block][0]), _mm_shuffle_epi8(g, masks[block][1])),
+                        _mm_shuffle_epi8(b, masks[block][2]));
+                    _mm_storeu_si128((__m128i *)(out + 16 * block), packed);
+                }
+            }
+            rgb24_row_scalar(py, pu, pv, d, x, width);
+        }
+    }
+
+    static bool cpu_has_avx2() {
+        __builtin_cpu_init();
+        return __builtin_cpu_supports("avx2");
+    }
+#endif
+
+#ifdef RASPII420_NEON
+    static void downscale2_neon(const uint8_t *src, uint32_t src_stride, uint8_t *dst, uint32_t dst_stride, uint32_t width, uint32_t height) {
+        for (uint32_t y = 0; y < height; y++) {
+            const uint8_t *s0 = src + 2 * y * src_stride, *s1 = s0 + src_stride;
+            uint8_t *d = dst + y * dst_stride;
+            uint32_t x = 0;
+            for (; x + 8 <= width; x += 8) {
+                uint16x8_t sum = vpaddlq_u8(vld1q_u8(s0 + 2 * x));
+                sum = vpadalq_u8(sum, vld1q_u8(s1 + 2 * x));
+                vst1_u8(d + x, vrshrn_n_u16(sum, 2));
+            }
+            for (; x < width; x++) {
+                d[x] = (s0[2 * x] + s0[2 * x + 1] + s1[2 * x] + s1[2 * x + 1] + 2) >> 2;
+            }
+        }
+    }
+
+    static void downscale4_neon(const uint8_t *src, uint32_t src_stride, uint8_t *dst, uint32_t dst_stride, uint32_t width, uint32_t height) {
+        for (uint32_t y = 0; y < height; y++) {
+            const uint8_t *s = src + 4 * y * src_stride;
+            uint8_t *d = dst + y * dst_stride;
+            uint32_t x = 0;
+            for (; x + 8 <= width; x += 8) {
+                uint16x8_t low = vdupq_n_u16(0), high = vdupq_n_u16(0);
+                for (uint32_t r = 0; r < 4; r++) {
+                    const uint8_t *p = s + r * src_stride + 4 * x;
+                    low = vpadalq_u8(low, vld1q_u8(p));
+                    high = vpadalq_u8(high, vld1q_u8(p + 16));
+                }
+                uint16x8_t sums = vcombine_u16(vrshrn_n_u32(vpaddlq_u16(low), 4), vrshrn_n_u32(vpaddlq_u16(high), 4));
+                vst1_u8(d + x, vmovn_u16(sums));
+            }
+            for (; x < width; x++) {
+                uint32_t sum = 0;
+                for (uint32_t r = 0; r < 4; r++) {
+                    const uint8_t *p = s + r * src_stride + 4 * x;
+                    sum += p[0] + p[1] + p[2] + p[3];
+                }
+                d[x] = (sum + 8) >> 4;
+            }
+        }
+    }
+
+    static uint32_t difference_neon(const uint8_t *a, uint32_t a_stride, const uint8_t *b, uint32_t b_stride, uint8_t *dst,
+            uint32_t dst_stride, uint32_t width, uint32_t height, uint8_t threshold) {
+        const uint8x16_t limit = vdupq_n_u8(threshold);
+        uint32x4_t counts = vdupq_n_u32(0);
+        uint32_t count = 0;
+        for (uint32_t y = 0; y < height; y++) {
+            const uint8_t *pa = a + y * a_stride, *pb = b + y * b_stride;
+            uint8_t *d = dst ? dst + y * dst_stride : NULL;
+            // Each 16 bit lane gains at most 2 per 16 pixels, so one row cannot overflow it
+            uint16x8_t row_counts = vdupq_n_u16(0);
+            uint32_t x = 0;
+            for (; x + 16 <= width; x += 16) {
+                uint8x16_t diff = vabdq_u8(vld1q_u8(pa + x), vld1q_u8(pb + x));
+                if (d) {
+                    vst1q_u8(d + x, diff);
+                }
+                row_counts = vpadalq_u8(row_counts, vshrq_n_u8(vcgtq_u8(diff, limit), 7));
+            }
+            counts = vpadalq_u16(counts, row_counts);
+            for (; x < width; x++) {
+                uint8_t diff = pa[x] > pb[x] ? pa[x] - pb[x] : pb[x] - pa[x];
+                if (d) {
+                    d[x] = diff;
+                }
+                count += diff > threshold;
+            }
+        }
+        uint32_t lanes[4];
+        vst1q_u32(lanes, counts);
+        return count + lanes[0] + lanes[1] + lanes[2] + lanes[3];
+    }
+
+    // Clamps two halves of 32 bit R, G or B values, already offset by the rounding constant, to bytes
+    static inline uint8x8_t channel_neon(int32x4_t low, int32x4_t high) {
+        return vqmovn_u16(vcombine_u16(vqshrun_n_s32(low, 8), vqshrun_n_s32(high, 8)));
+    }
+
+    static inline void rgb8_neon(int16x8_t c, int16x8_t d, int16x8_t e, uint8x8_t *r, uint8x8_t *g, uint8x8_t *b) {
+        int32x4_t base_low = vmlal_n_s16(vdupq_n_s32(128), vget_low_s16(c), 298);
+        int32x4_t base_high = vmlal_n_s16(vdupq_n_s32(128), vget_high_s16(c), 298);
+        *r = channel_neon(vmlal_n_s16(base_low, vget_low_s16(e), 409), vmlal_n_s16(base_high, vget_high_s16(e), 409));
+        *g = channel_neon(vmlal_n_s16(vmlal_n_s16(base_low, vget_low_s16(d), -100), vget_low_s16(e), -208),
+            vmlal_n_s16(vmlal_n_s16(base_high, vget_high_s16(d), -100), vget_high_s16(e), -208));
+        *b = channel_neon(vmlal_n_s16(base_low, vget_low_s16(d), 516), vmlal_n_s16(base_high, vget_high_s16(d), 516));
+    }
+
+    static void to_rgb24_neon(const uint8_t *y, uint32_t y_stride, const uint8_t *u, uint32_t u_stride, const uint8_t *v,
+            uint32_t v_stride, uint8_t *dst, uint32_t dst_stride, uint32_t width, uint32_t height) {
+        const int16x8_t y_offset = vdupq_n_s16(16), uv_offset = vdupq_n_s16(128);
+        for (uint32_t row = 0; row < height; row++) {
+            const uint8_t *py = y + row * y_stride, *pu = u + (row >> 1) * u_stride, *pv = v + (row >> 1) * v_stride;
+            uint8_t *d = dst + row * dst_stride;
+            uint32_t x = 0;
+            for (; x + 16 <= width; x += 16) {
+                uint8x16_t vy = vld1q_u8(py + x);
+                uint8x8x2_t vu = vzip_u8(vld1_u8(pu + (x >> 1)), vld1_u8(pu + (x >> 1)));
+                uint8x8x2_t vv = vzip_u8(vld1_u8(pv + (x >> 1)), vld1_u8(pv + (x >> 1)));
+                uint8x8_t r_low, g_low, b_low, r_high, g_high, b_high;
+                rgb8_neon(vsubq_s16(vreinterpretq_s16_u16(vmovl_u8(vget_low_u8(vy))), y_offset),
+                    vsubq_s16(vreinterpretq_s16_u16(vmovl_u8(vu.val[0])), uv_offset),
+                    vsubq_s16(vreinterpretq_s16_u16(vmovl_u8(vv.val[0])), uv_offset), &r_low, &g_low, &b_low);
+                rgb8_neon(vsubq_s16(vreinterpretq_s16_u16(vmovl_u8(vget_high_u8(vy))), y_offset),
+                    vsubq_s16(vreinterpretq_s16_u16(vmovl_u8(vu.val[1])), uv_offset),
+                    vsubq_s16(vreinterpretq_s16_u16(vmovl_u8(vv.val[1])), uv_offset), &r_high, &g_high, &b_high);
+                uint8x16x3_t rgb;
+                rgb.val[0] = vcombine_u8(r_low, r_high);
+                rgb.val[1] = vcombine_u8(g_low, g_high);
+                rgb.val[2] = vcombine_u8(b_low, b_high);
+                vst3q_u8(d + 3 * x, rgb);
+            }
+            rgb24_row_scalar(py, pu, pv, d, x, width);
+        }
+    }
+#endif
+
+    /*
+     Fills the destination pixels at or right of x0, or at or below y0, by averaging whatever part of their source block
+     lies within the source plane. Used for the edge that a whole block does not cover, such as the last chroma column
+     of an odd width image.
+     */
+    static void downscale_edges(const uint8_t *src, uint32_t src_stride, uint32_t src_width, uint32_t src_height, uint8_t *dst,
+            uint32_t dst_stride, uint32_t width, uint32_t height, uint32_t x0, uint32_t y0, unsigned int factor) {
+        for (uint32_t y = 0; y < height; y++) {
+            for (uint32_t x = y < y0 ? x0 : 0; x < width; x++) {
+                uint32_t sum = 0, count = 0;
+                for (uint32_t sy = y * factor; sy < (y + 1) * factor && sy < src_height; sy++) {
+                    for (uint32_t sx = x * factor; sx < (x + 1) * factor && sx < src_width; sx++) {
+                        sum += src[sy * src_stride + sx];
+                        count++;
+                    }
+                }
+                dst[y * dst_stride + x] = count ? (sum + count / 2) / count : 0;
+            }
+        }
+    }
+
+    shared_ptr< RaspiI420Kernels > RaspiI420Kernels::create(RASPII420_PATH_T path) {
+        if (path == RASPII420_PATH_AUTO) {
+#if defined(RASPII420_NEON)
+            path = RASPII420_PATH_NEON;
+#elif defined(RASPII420_AVX2)
+            path = cpu_has_avx2() ? RASPII420_PATH_AVX2 : RASPII420_PATH_SSE2;
+#elif defined(RASPII420_SSE2)
+            path = RASPII420_PATH_SSE2;
+#else
+            path = RASPII420_PATH_SCALAR;
+#endif
+        }
+        switch (path) {
+            case RASPII420_PATH_SCALAR:
+                break;
+#ifdef RASPII420_SSE2
+            case RASPII420_PATH_SSE2:
+                break;
+#endif
+#ifdef RASPII420_AVX2
+            case RASPII420_PATH_AVX2:
+                if (!cpu_has_avx2()) {
+                    return nullptr;
+                }
+                break;
+#endif
+#ifdef RASPII420_NEON
+            case RASPII420_PATH_NEON:
+                break;
+#endif
+            default:
+                return nullptr;
+        }
+        return shared_ptr< RaspiI420Kernels >( new RaspiI420Kernels(path) );
+    }
+
+    RaspiI420Kernels::RaspiI420Kernels(RASPII420_PATH_T path) : path_(path), downscale2(downscale2_scalar), downscale4(downscale4_scalar),
+            histogram_(histogram_scalar), difference_(difference_scalar), to_rgb24_(to_rgb24_scalar) {
+        if (path_ != RASPII420_PATH_SCALAR) {
+            histogram_ = histogram_split;
+        }
+#ifdef RASPII420_SSE2
+        if (path_ == RASPII420_PATH_SSE2 || path_ == RASPII420_PATH_AVX2) {
+            downscale2 = downscale2_sse2;
+            downscale4 = downscale4_sse2;
+            difference_ = difference_sse2;
+            to_rgb24_ = to_rgb24_sse2;
+        }
+#endif
+#ifdef RASPII420_AVX2
+        if (path_ == RASPII420_PATH_AVX2) {
+            downscale2 = downscale2_avx2;
+            difference_ = difference_avx2;
+            to_rgb24_ = to_rgb24_avx2;
+        }
+#endif
+#ifdef RASPII420_NEON
+        if (path_ == RASPII420_PATH_NEON) {
+            downscale2 = downscale2_neon;
+            downscale4 = downscale4_neon;
+            difference_ = difference_neon;
+            to_rgb24_ = to_rgb24_neon;
+        }
+#endif
+    }
+
+    RASPII420_IMAGE_S RaspiI420Kernels::image(uint8_t *data, uint32_t width, uint32_t height) {
+        uint32_t stride = VCOS_ALIGN_UP(width, 32);
+        uint32_t rows = VCOS_ALIGN_UP(height, 16);
+        RASPII420_IMAGE_S result;
+        result.plane[0] = data;
+        result.plane[1] = data + stride * rows;
+        result.plane[2] = result.plane[1] + (stride / 2) * (rows / 2);
+        result.stride[0] = stride;
+        result.stride[1] = stride / 2;
+        result.stride[2] = stride / 2;
+        result.width = width;
+        result.height = height;
+        return result;
+    }
+
+    size_t RaspiI420Kernels::image_size(uint32_t width, uint32_t height) {
+        size_t stride = VCOS_ALIGN_UP(width, 32);
+        size_t rows = VCOS_ALIGN_UP(height, 16);
+        return stride * rows * 3 / 2;
+    }
+
+    RASPII420_IMAGE_S RaspiI420Kernels::crop(const RASPII420_IMAGE_S &image, uint32_t x, uint32_t y, uint32_t width, uint32_t height) {
+        x = vcos_min(x & ~1u, image.width & ~1u);
+        y = vcos_min(y & ~1u, image.height & ~1u);
+        RASPII420_IMAGE_S result = image;
+        result.plane[0] += y * image.stride[0] + x;
+        result.plane[1] += (y / 2) * image.stride[1] + x / 2;
+        result.plane[2] += (y / 2) * image.stride[2] + x / 2;
+        result.width = vcos_min(width, image.width - x);
+        result.height = vcos_min(height, image.height - y);
+        return result;
+    }
+
+    RASPII420_PATH_T RaspiI420Kernels::path() {
+        return path_;
+    }
+
+    const char* RaspiI420Kernels::name() {
+        switch (path_) {
+            case RASPII420_PATH_SSE2:
+                return "sse2";
+            case RASPII420_PATH_AVX2:
+                return "avx2";
+            case RASPII420_PATH_NEON:
+                return "neon";
+            default:
+                return "scalar";
+        }
+    }
+
+    void RaspiI420Kernels::extract_plane(const RASPII420_IMAGE_S &image, unsigned int plane, uint8_t *dst, uint32_t dst_stride) {
+        if (plane > 2) {
+            return;
+        }
+        uint32_t width = plane ? (image.width + 1) / 2 : image.width;
+        uint32_t height = plane ? (image.height + 1) / 2 : image.height;
+        for (uint32_t y = 0; y < height; y++) {
+            memcpy(dst + y * dst_stride, image.plane[plane] + y * image.stride[plane], width);
+        }
+    }
+
+    MMAL_STATUS_T RaspiI420Kernels::downscale(const RASPII420_IMAGE_S &src, const RASPII420_IMAGE_S &dst, unsigned int factor) {
+        if ((factor != 2 && factor != 4) || !dst.width || !dst.height || dst.width > src.width / factor || dst.height > src.height / factor) {
+            vcos_log_error("RaspiI420Kernels::downscale(): cannot downscale %ux%u to %ux%u by %u", src.width, src.height, dst.width, dst.height, factor);
+            return MMAL_EINVAL;
+        }
+        DOWNSCALE_F kernel = factor == 2 ? downscale2 : downscale4;
+        for (int plane = 0; plane < 3; plane++) {
+            uint32_t src_width = plane ? (src.width + 1) / 2 : src.width;
+            uint32_t src_height = plane ? (src.height + 1) / 2 : src.height;
+            uint32_t dst_width = plane ? (dst.width + 1) / 2 : dst.width;
+            uint32_t dst_height = plane ? (dst.height + 1) / 2 : dst.height;
+            uint32_t width = vcos_min(dst_width, src_width / factor);
+            uint32_t height = vcos_min(dst_height, src_height / factor);
+            if (width && height) {
+                kernel(src.plane[plane], src.stride[plane], dst.plane[plane], dst.stride[plane], width, height);
+            }
+            if (width < dst_width || height < dst_height) {
+                downscale_edges(src.plane[plane], src.stride[plane], src_width, src_height, dst.plane[plane], dst.stride[plane],
+                    dst_width, dst_height, width, height, factor);
+            }
+        }
+        return MMAL_SUCCESS;
+    }
+
+    void RaspiI420Kernels::histogram(const RASPII420_IMAGE_S &image, uint32_t bins[256]) {
+        memset(bins, 0, 256 * sizeof(uint32_t));
+        histogram_(image.plane[0], image.stride[0], image.width, image.height, bins);
+    }
+
+    uint32_t RaspiI420Kernels::difference(const RASPII420_IMAGE_S &a, const RASPII420_IMAGE_S &b, uint8_t threshold, uint8_t *dst, uint32_t dst_stride) {
+        uint32_t width = vcos_min(a.width, b.width);
+        uint32_t height = vcos_min(a.height, b.height);
+        return difference_(a.plane[0], a.stride[0], b.plane[0], b.stride[0], dst, dst_stride, width, height, threshold);
+    }
+
+    void RaspiI420Kernels::to_rgb24(const RASPII420_IMAGE_S &src, uint8_t *dst, uint32_t dst_stride) {
+        to_rgb24_(src.plane[0], src.stride[0], src.plane[1], src.stride[1], src.plane[2], src.stride[2], dst, dst_stride, src.width, src.height);
+    }
+
+}
@@ -0,0 +1,550 @@
+#include <arpa/inet.h>
+#include <errno.h>
+#include <netinet/in.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <sys/uio.h>
+#include <unistd.h>
+
+#include "raspivid/RaspiMJPEGServer.h"
+#include "raspivid/RaspiPortMetrics.h"
+
+#define RASPIMJPEGSERVER_MAX_REQUEST 8192
+#define RASPIMJPEGSERVER_MAX_EVENTS 64
+#define RASPIMJPEGSERVER_MAX_IOV 64
+#define RASPIMJPEGSERVER_TICK_MS 100
+
+namespace raspivid {
+
+    static const char RESPONSE_HEAD[] =
+        "HTTP/1.0 200 OK\r\n"
+        "Server: libraspivid\r\n"
+        "Connection: close\r\n"
+        "Cache-Control: no-cache, no-store, must-revalidate\r\n"
+        "Pragma: no-cache\r\n"
+        "Content-Type: multipart/x-mixed-replace; boundary=" RASPIMJPEGSERVER_BOUNDARY "\r\n"
+        "\r\n";
+
+    static const char PART_TRAILER[] = "\r\n";
+
+    static string error_response(const char *status) {
+        return string("HTTP/1.0 ") + status + "\r\nServer: libraspivid\r\nContent-Length: 0\r\nConnection: close\r\n\r\n";
+    }
+
+    RASPIMJPEGSERVER_OPTION_S RaspiMJPEGServer::createDefaultServerOptions() {
+        RASPIMJPEGSERVER_OPTION_S options;
+        options.address = "0.0.0.0";
+        options.port = 8080;
+        options.path = "/stream.mjpg";
+        options.max_clients = 16;
+        options.max_pinned_frames = 1;
+        options.send_timeout_ms = 10000;
+        options.send_buffer = 0;
+        return options;
+    }
+
+    shared_ptr< RaspiMJPEGServer > RaspiMJPEGServer::create(RASPIMJPEGSERVER_OPTION_S options) {
+        if (options.path.empty() || options.path[0] != '/') {
+            vcos_log_error("RaspiMJPEGServer::create(): the path must start with /");
+            return nullptr;
+        }
+        if (options.max_clients < 1) {
+            options.max_clients = 1;
+        }
+        shared_ptr< RaspiMJPEGServer > server = shared_ptr< RaspiMJPEGServer >( new RaspiMJPEGServer(options) );
+        if (!server->listen_socket()) {
+            return nullptr;
+        }
+        server->worker = thread(&RaspiMJPEGServer::run, server.get());
+        return server;
+    }
+
+    RaspiMJPEGServer::RaspiMJPEGServer(RASPIMJPEGSERVER_OPTION_S options) : options_(options), listen_fd(-1), event_fd(-1),
+            epoll_fd(-1), port_(0), assembled(0), stopping(false), streaming(0), stopped(false), frames(0), skipped(0),
+            connections(0), rejected(0), timeouts(0), clients_(0), frames_sent(0), frames_dropped(0), copied(0), bytes_sent(0) {
+    }
+
+    RaspiMJPEGServer::~RaspiMJPEGServer() {
+        stop();
+        assembling.clear();
+        if (epoll_fd >= 0) {
+            close(epoll_fd);
+        }
+        if (event_fd >= 0) {
+            close(event_fd);
+        }
+        if (listen_fd >= 0) {
+            close(listen_fd);
+        }
+    }
+
+    bool RaspiMJPEGServer::listen_socket() {
+        struct sockaddr_in address;
+        memset(&address, 0, sizeof(address));
+        address.sin_family = AF_INET;
+        address.sin_port = htons(options_.port);
+        if (inet_pton(AF_INET, options_.address.c_str(), &address.sin_addr) != 1) {
+            vcos_log_error("RaspiMJPEGServer::listen_socket(): invalid address %s", options_.address.c_str());
+            return false;
+        }
+
+        listen_fd = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+        int one = 1;
+        if (listen_fd < 0 || setsockopt(listen_fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one)) != 0 ||
+                bind(listen_fd, (struct sockaddr *)&address, sizeof(address)) != 0 || listen(listen_fd, 64) != 0) {
+            vcos_log_error("RaspiMJPEGServer::listen_socket(): unable to listen on %s:%u (%s)", options_.address.c_str(),
+                options_.port, strerror(errno));
+            return false;
+        }
+        socklen_t length = sizeof(address);
+        if (getsockname(listen_fd, (struct sockaddr *)&address, &length) == 0) {
+            port_ = ntohs(address.sin_port);
+        }
+
+        event_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+        epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+        if (event_fd < 0 || epoll_fd < 0) {
+            vcos_log_error("RaspiMJPEGServer::listen_socket(): unable to create the event loop (%s)", strerror(errno));
+            return false;
+        }
+        struct epoll_event event;
+        memset(&event, 0, sizeof(event));
+        event.events = EPOLLIN;
+        event.data.fd = listen_fd;
+        epoll_ctl(epoll_fd, EPOLL_CTL_ADD, listen_fd, &event);
+        event.data.fd = event_fd;
+        epoll_ctl(epoll_fd, EPOLL_CTL_ADD, event_fd, &event);
+        return true;
+    }
+
+    void RaspiMJPEGServer::callback(MMAL_PORT_T *port, MMAL_BUFFER_HEADER_T *buffer) {
+        if (stopped.load() || (buffer->flags & (MMAL_BUFFER_HEADER_FLAG_CONFIG | MMAL_BUFFER_HEADER_FLAG_CODECSIDEINFO))) {
+            return;
+        }
+        if (buffer->length) {
+            // Pinning every buffer of the port would stall the encoder, so the rest of a large frame is copied. So is a frame
+            // with more parts than one gathered write takes besides its header and trailer.
+            if (!spill.empty() || assembling.size() + 1 >= port->buffer_num || assembling.size() + 2 >= RASPIMJPEGSERVER_MAX_IOV) {
+                for (const RaspiFrameRef &part : assembling) {
+                    spill.insert(spill.end(), part.data(), part.data() + part.length());
+                }
+                assembling.clear();
+                spill.insert(spill.end(), buffer->data + buffer->offset, buffer->data + buffer->offset + buffer->length);
+            } else {
+                assembling.emplace_back(buffer);
+            }
+            assembled += buffer->length;
+        }
+        if (!(buffer->flags & MMAL_BUFFER_HEADER_FLAG_FRAME_END) || !assembled) {
+            return;
+        }
+
+        shared_ptr< FRAME_S > frame = make_shared< FRAME_S >();
+        frame->parts.swap(assembling);
+        if (!spill.empty()) {
+            frame->copy.swap(spill);
+            copied++;
+        }
+        frame->length = assembled;
+        assembled = 0;
+        char header[128];
+        snprintf(header, sizeof(header), "--" RASPIMJPEGSERVER_BOUNDARY "\r\nContent-Type: image/jpeg\r\nContent-Length: %u\r\n\r\n",
+            frame->length);
+        frame->header = header;
+        frames++;
+
+        shared_ptr< FRAME_S > replaced;
+        {
+            lock_guard< mutex > guard(lock);
+            replaced.swap(latest);
+            latest = frame;
+        }
+        if (replaced) {
+            skipped++;
+        }
+        uint64_t one = 1;
+        if (write(event_fd, &one, sizeof(one)) < 0 && errno != EAGAIN) {
+            vcos_log_error("RaspiMJPEGServer::callback(): unable to wake the server thread (%s)", strerror(errno));
+        }
+    }
+
+    void RaspiMJPEGServer::stop() {
+        if (!stopped.exchange(true)) {
+            {
+                lock_guard< mutex > guard(lock);
+                stopping = true;
+            }
+            uint64_t one = 1;
+            if (event_fd >= 0 && write(event_fd, &one, sizeof(one)) < 0) {
+                vcos_log_error("RaspiMJPEGServer::stop(): unable to wake the server thread (%s)", strerror(errno));
+            }
+        }
+        if (worker.joinable()) {
+            worker.join();
+        }
+        lock_guard< mutex > guard(lock);
+        latest.reset();
+    }
+
+    void RaspiMJPEGServer::run() {
+        struct epoll_event events[RASPIMJPEGSERVER_MAX_EVENTS];
+        while (true) {
+            {
+                lock_guard< mutex > guard(lock);
+                if (stopping) {
+                    break;
+                }
+            }
+            int count = epoll_wait(epoll_fd, events, RASPIMJPEGSERVER_MAX_EVENTS, RASPIMJPEGSERVER_TICK_MS);
+            if (count < 0 && errno != EINTR) {
+                vcos_log_error("RaspiMJPEGServer::run(): epoll_wait failed (%s)", strerror(errno));
+                break;
+            }
+            for (int i = 0; i < count; i++) {
+                int fd = events[i].data.fd;
+                if (fd == listen_fd) {
+                    accept_clients();
+                    continue;
+                }
+                if (fd == event_fd) {
+                    take_frame();
+                    continue;
+                }
+                map< int, CLIENT_S >::iterator client = clients.find(fd);
+                if (client != clients.end() && (events[i].events & (EPOLLIN | EPOLLRDHUP | EPOLLHUP | EPOLLERR))) {
+                    read_client(client->second);
+                    client = clients.find(fd);
+                }
+                if (client != clients.end() && (events[i].events & EPOLLOUT)) {
+                    send_client(client->second);
+                }
+            }
+
+            if (options_.send_timeout_ms) {
+                int64_t now = RaspiPortMetrics::now_us();
+                vector< int > late;
+                for (map< int, CLIENT_S >::iterator i = clients.begin(); i != clients.end(); ++i) {
+                    if (i->second.current && now - i->second.started_us > (int64_t)options_.send_timeout_ms * 1000) {
+                        late.push_back(i->first);
+                    }
+                }
+                for (int fd : late) {
+                    timeouts++;
+                    close_client(fd);
+                }
+            }
+        }
+
+        while (!clients.empty()) {
+            close_client(clients.begin()->first);
+        }
+        pinned.clear();
+    }
+
+    void RaspiMJPEGServer::accept_clients() {
+        while (true) {
+            int fd = accept4(listen_fd, NULL, NULL, SOCK_NONBLOCK | SOCK_CLOEXEC);
+            if (fd < 0) {
+                if (errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR) {
+                    vcos_log_error("RaspiMJPEGServer::accept_clients(): accept failed (%s)", strerror(errno));
+                }
+                if (errno == EINTR) {
+                    continue;
+                }
+                return;
+            }
+            if (options_.send_buffer) {
+                int size = options_.send_buffer;
+                setsockopt(fd, SOL_SOCKET, SO_SNDBUF, &size, sizeof(size));
+            }
+            struct epoll_event event;
+            memset(&event, 0, sizeof(event));
+            event.events = EPOLLIN | EPOLLRDHUP;
+            event.data.fd = fd;
+            if (epoll_ctl(epoll_fd, EPOLL_CTL_ADD, fd, &event) != 0) {
+                close(fd);
+                continue;
+            }
+            CLIENT_S &client = clients[fd];
+            client.fd = fd;
+            client.streaming = false;
+            client.closing = false;
+            client.offset = 0;
+            client.started_us = 0;
+            client.writable_wait = false;
+            connections++;
+        }
+    }
+
+    void RaspiMJPEGServer::read_client(CLIENT_S &client) {
+        char buffer[2048];
+        while (true) {
+            ssize_t length = recv(client.fd, buffer, sizeof(buffer), 0);
+            if (length == 0) {
+                close_client(client.fd);
+                return;
+            }
+            if (length < 0) {
+                if (errno == EINTR) {
+                    continue;
+                }
+                if (errno != EAGAIN && errno != EWOULDBLOCK) {
+                    close_client(client.fd);
+                }
+                return;
+            }
+            // Anything sent after the request is ignored
+            if (client.streaming || client.closing) {
+                continue;
+            }
+            client.request.append(buffer, length);
+            if (client.request.find("\r\n\r\n") != string::npos) {
+                handle_request(client);
+                return;
+            }
+            if (client.request.size() > RASPIMJPEGSERVER_MAX_REQUEST) {
+                rejected++;
+                client.pending = error_response("431 Request Header Fields Too Large");
+                client.closing = true;
+                send_client(client);
+                return;
+            }
+        }
+    }
+
+    void RaspiMJPEGServer::handle_request(CLIENT_S &client) {
+        string line = client.request.substr(0, client.request.find("\r\n"));
+        client.request.clear();
+        size_t first = line.find(' ');
+        size_t second = first == string::npos ? string::npos : line.find(' ', first + 1);
+        const char *status = NULL;
+        if (second == string::npos) {
+            status = "400 Bad Request";
+        } else if (line.compare(0, first, "GET") != 0) {
+            status = "405 Method Not Allowed";
+        } else {
+            string target = line.substr(first + 1, second - first - 1);
+            target = target.substr(0, target.find('?'));
+            if (target != options_.path) {
+                status = "404 Not Found";
+            } else if (streaming >= options_.max_clients) {
+                status = "503 Service Unavailable";
+            }
+        }
+
+        if (status) {
+            rejected++;
+            client.pending = error_response(status);
+            client.closing = true;
+        } else {
+            client.pending = RESPONSE_HEAD;
+            client.streaming = true;
+            streaming++;
+            clients_++;
+        }
+        send_client(client);
+    }
+
+    void RaspiMJPEGServer::take_frame() {
+        uint64_t value;
+        if (read(event_fd, &value, sizeof(value)) < 0 && errno != EAGAIN) {
+            vcos_log_error("RaspiMJPEGServer::take_frame(): unable to read the event (%s)", strerror(errno));
+        }
+        shared_ptr< FRAME_S > frame;
+        {
+            lock_guard< mutex > guard(lock);
+            frame.swap(latest);
+        }
+        if (!frame) {
+            return;
+        }
+
+        vector< int > ready;
+        for (map< int, CLIENT_S >::iterator i = clients.begin(); i != clients.end(); ++i) {
+            CLIENT_S &client = i->second;
+            if (!client.streaming) {
+                continue;
+            }
+            if (!client.current) {
+                client.current = frame;
+                client.offset = 0;
+                client.started_us = RaspiPortMetrics::now_us();
+                if (!client.writable_wait) {
+                    ready.push_back(i->first);
+                }
+            } else {
+                // The socket is backed up: the newest frame waits, the one it replaces is lost to this client
+                if (client.next) {
+                    frames_dropped++;
+                }
+                client.next = frame;
+            }
+        }
+        if (frame.use_count() > 1) {
+            pinned.push_back(frame);
+        }
+        frame.reset();
+        pin_limit();
+
+        for (int fd : ready) {
+            map< int, CLIENT_S >::iterator client = clients.find(fd);
+            if (client != clients.end()) {
+                send_client(client->second);
+            }
+        }
+    }
+
+    void RaspiMJPEGServer::pin_limit() {
+        for (deque< shared_ptr< FRAME_S > >::iterator i = pinned.begin(); i != pinned.end(); ) {
+            if (i->use_count() == 1) {
+                i = pinned.erase(i);
+            } else {
+                ++i;
+            }
+        }
+        while (pinned.size() > options_.max_pinned_frames) {
+            FRAME_S &frame = *pinned.front();
+            frame.copy.resize(frame.length);
+            uint32_t filled = 0;
+            for (const RaspiFrameRef &part : frame.parts) {
+                memcpy(frame.copy.data() + filled, part.data(), part.length());
+                filled += part.length();
+            }
+            frame.parts.clear();
+            pinned.pop_front();
+            copied++;
+        }
+    }
+
+    void RaspiMJPEGServer::send_client(CLIENT_S &client) {
+        while (true) {
+            struct iovec iov[RASPIMJPEGSERVER_MAX_IOV];
+            size_t count = 0;
+            if (!client.pending.empty()) {
+                iov[count].iov_base = (void *)client.pending.data();
+                iov[count++].iov_len = client.pending.size();
+            }
+            uint64_t total = 0;
+            if (client.current) {
+                // Header, JPEG data and trailer, skipping what was already sent
+                const FRAME_S &frame = *client.current;
+                total = frame.header.size() + frame.length + sizeof(PART_TRAILER) - 1;
+                uint64_t skip = client.offset;
+                struct iovec segments[RASPIMJPEGSERVER_MAX_IOV];
+                size_t parts = 0;
+                segments[parts].iov_base = (void *)frame.header.data();
+                segments[parts++].iov_len = frame.header.size();
+                if (frame.parts.empty()) {
+                    segments[parts].iov_base = (void *)frame.copy.data();
+                    segments[parts++].iov_len = frame.copy.size();
+                }
+                // The callback copies frames with more parts than fit
+                vcos_assert(frame.parts.size() + 2 <= RASPIMJPEGSERVER_MAX_IOV);
+                for (const RaspiFrameRef &part : frame.parts) {
+                    segments[parts].iov_base = (void *)part.data();
+                    segments[parts++].iov_len = part.length();
+                }
+                segments[parts].iov_base = (void *)PART_TRAILER;
+                segments[parts++].iov_len = sizeof(PART_TRAILER) - 1;
+                for (size_t i = 0; i < parts && count < RASPIMJPEGSERVER_MAX_IOV; i++) {
+                    if (skip >= segments[i].iov_len) {
+                        skip -= segments[i].iov_len;
+                        continue;
+                    }
+                    iov[count].iov_base = (uint8_t *)segments[i].iov_base + skip;
+                    iov[count++].iov_len = segments[i].iov_len - skip;
+                    skip = 0;
+                }
+            }
+
+            if (!count) {
+                if (client.closing) {
+                    close_client(client.fd);
+                } else {
+                    watch_writable(client, false);
+                }
+                return;
+            }
+
+            struct msghdr message;
+            memset(&message, 0, sizeof(message));
+            message.msg_iov = iov;
+            message.msg_iovlen = count;
+            ssize_t sent = sendmsg(client.fd, &message, MSG_NOSIGNAL | MSG_DONTWAIT);
+            if (sent < 0) {
+                if (errno == EINTR) {
+                    continue;
+                }
+                if (errno == EAGAIN || errno == EWOULDBLOCK) {
+                    watch_writable(client, true);
+                } else {
+                    close_client(client.fd);
+                }
+                return;
+            }
+            bytes_sent += sent;
+
+            size_t from_pending = vcos_min((size_t)sent, client.pending.size());
+            client.pending.erase(0, from_pending);
+            client.offset += sent - from_pending;
+            if (client.current && client.offset >= total) {
+                frames_sent++;
+                client.current.reset();
+                client.current.swap(client.next);
+                client.offset = 0;
+                client.started_us = RaspiPortMetrics::now_us();
+                pin_limit();
+            }
+        }
+    }
+
+    void RaspiMJPEGServer::watch_writable(CLIENT_S &client, bool writable) {
+        if (client.writable_wait == writable) {
+            return;
+        }
+        struct epoll_event event;
+        memset(&event, 0, sizeof(event));
+        event.events = EPOLLIN | EPOLLRDHUP | (writable ? EPOLLOUT : 0);
+        event.data.fd = client.fd;
+        epoll_ctl(epoll_fd, EPOLL_CTL_MOD, client.fd, &event);
+        client.writable_wait = writable;
+    }
+
+    void RaspiMJPEGServer::close_client(int fd) {
+        map< int, CLIENT_S >::iterator client = clients.find(fd);
+        if (client == clients.end()) {
+            return;
+        }
+        if (client->second.streaming) {
+            streaming--;
+            clients_--;
+        }
+        epoll_ctl(epoll_fd, EPOLL_CTL_DEL, fd, NULL);
+        close(fd);
+        clients.erase(client);
+        pin_limit();
+    }
+
+    uint16_t RaspiMJPEGServer::get_port() {
+        return port_;
+    }
+
+    RASPIMJPEGSERVER_STATS_S RaspiMJPEGServer::get_stats() {
+        RASPIMJPEGSERVER_STATS_S result;
+        result.frames = frames.load();
+        result.skipped = skipped.load();
+        result.connections = connections.load();
+        result.rejected = rejected.load();
+        result.timeouts = timeouts.load();
+        result.clients = clients_.load();
+        result.frames_sent = frames_sent.load();
+        result.frames_dropped = frames_dropped.load();
+        result.copied = copied.load();
+        result.bytes_sent = bytes_sent.load();
+        return result;
+    }
+
+}
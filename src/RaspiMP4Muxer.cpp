@@ -0,0 +1,707 @@
+#include <errno.h>
+#include <limits.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "raspivid/RaspiMP4Muxer.h"
+#include "raspivid/RaspiPort.h"
+
+#ifndef IOV_MAX
+#define IOV_MAX 1024
+#endif
+
+#define RASPIMP4MUXER_TRACK_ID              1
+#define RASPIMP4MUXER_SAMPLE_SYNC           0x02000000
+#define RASPIMP4MUXER_SAMPLE_NON_SYNC       0x01010000
+
+namespace raspivid {
+
+    static void put8(vector< uint8_t > &out, uint8_t value) {
+        out.push_back(value);
+    }
+
+    static void put16(vector< uint8_t > &out, uint16_t value) {
+        out.push_back(value >> 8);
+        out.push_back(value);
+    }
+
+    static void put32(vector< uint8_t > &out, uint32_t value) {
+        out.push_back(value >> 24);
+        out.push_back(value >> 16);
+        out.push_back(value >> 8);
+        out.push_back(value);
+    }
+
+    static void put64(vector< uint8_t > &out, uint64_t value) {
+        put32(out, value >> 32);
+        put32(out, value);
+    }
+
+    static void put_bytes(vector< uint8_t > &out, const void *data, size_t length) {
+        out.insert(out.end(), (const uint8_t *)data, (const uint8_t *)data + length);
+    }
+
+    static void patch32(vector< uint8_t > &out, size_t offset, uint32_t value) {
+        out[offset] = value >> 24;
+        out[offset + 1] = value >> 16;
+        out[offset + 2] = value >> 8;
+        out[offset + 3] = value;
+    }
+
+    static size_t begin_box(vector< uint8_t > &out, const char *type) {
+        size_t start = out.size();
+        put32(out, 0);
+        put_bytes(out, type, 4);
+        return start;
+    }
+
+    static void end_box(vector< uint8_t > &out, size_t start) {
+        patch32(out, start, out.size() - start);
+    }
+
+    // Reads an unsigned Exp-Golomb code from an RBSP, advancing bit. Returns false if the code runs past the end.
+    static bool read_ue(const vector< uint8_t > &rbsp, size_t &bit, uint32_t &value) {
+        int zeros = 0;
+        while (true) {
+            if (bit >= rbsp.size() * 8 || zeros > 31) {
+                return false;
+            }
+            if ((rbsp[bit >> 3] >> (7 - (bit & 7))) & 1) {
+                break;
+            }
+            zeros++;
+            bit++;
+        }
+        bit++;
+        if (bit + zeros > rbsp.size() * 8) {
+            return false;
+        }
+        value = 0;
+        for (int i = 0; i < zeros; i++, bit++) {
+            value = (value << 1) | ((rbsp[bit >> 3] >> (7 - (bit & 7))) & 1);
+        }
+        value += (1u << zeros) - 1;
+        return true;
+    }
+
+    // Reads chroma_format_idc and the bit depths of a High profile SPS, which follow its seq_parameter_set_id
+    static void read_high_profile(const vector< uint8_t > &sps, uint32_t &chroma_format, uint32_t &luma_depth, uint32_t &chroma_depth) {
+        vector< uint8_t > rbsp;
+        rbsp.reserve(sps.size());
+        for (size_t i = 1; i < sps.size(); i++) {
+            // Drop emulation prevention bytes
+            if (sps[i] == 3 && rbsp.size() >= 2 && !rbsp[rbsp.size() - 1] && !rbsp[rbsp.size() - 2]) {
+                continue;
+            }
+            rbsp.push_back(sps[i]);
+        }
+        size_t bit = 24;
+        uint32_t id, format, luma, chroma;
+        if (!read_ue(rbsp, bit, id) || !read_ue(rbsp, bit, format)) {
+            return;
+        }
+        if (format == 3) {
+            // separate_colour_plane_flag
+            bit++;
+        }
+        if (!read_ue(rbsp, bit, luma) || !read_ue(rbsp, bit, chroma)) {
+            return;
+        }
+        chroma_format = format & 3;
+        luma_depth = luma & 7;
+        chroma_depth = chroma & 7;
+    }
+
+    static void put_matrix(vector< uint8_t > &out) {
+        static const uint32_t identity[9] = { 0x00010000, 0, 0, 0, 0x00010000, 0, 0, 0, 0x40000000 };
+        for (int i = 0; i < 9; i++) {
+            put32(out, identity[i]);
+        }
+    }
+
+    RASPIMP4MUXER_OPTION_S RaspiMP4Muxer::createDefaultMuxerOptions() {
+        RASPIMP4MUXER_OPTION_S options;
+        options.fragment = RASPIMP4MUXER_FRAGMENT_KEYFRAME;
+        options.max_fragment_frames = 300;
+        options.timescale = 90000;
+        return options;
+    }
+
+    shared_ptr< RaspiMP4Muxer > RaspiMP4Muxer::create(int fd, RASPIMP4MUXER_OPTION_S options) {
+        if (fd < 0) {
+            vcos_log_error("RaspiMP4Muxer::create(): invalid file descriptor");
+            return nullptr;
+        }
+        if (!options.timescale) {
+            options.timescale = 90000;
+        }
+        return shared_ptr< RaspiMP4Muxer >( new RaspiMP4Muxer(fd, options) );
+    }
+
+    shared_ptr< RaspiMP4Muxer > RaspiMP4Muxer::create(int fd) {
+        return create(fd, createDefaultMuxerOptions());
+    }
+
+    RaspiMP4Muxer::RaspiMP4Muxer(int fd, RASPIMP4MUXER_OPTION_S options) : fd_(fd), options_(options),
+            initialized(false), skipping_nal(true), width(0), height(0), origin(0), frame_duration_us(33333),
+            last_dts(MMAL_TIME_UNKNOWN), frame_pts(MMAL_TIME_UNKNOWN), frame_dts(MMAL_TIME_UNKNOWN), frame_open(false),
+            frame_keyframe(false), frame_first_nal(0), sequence(0), fragment_buffers(0), fragment_copied(0), reported_buffers(0),
+            writing(false), stopping(false), pinned(0), fragments_(0), frames_(0), bytes_written_(0), bytes_copied_(0), failed_(false) {
+        parser = RaspiH264Parser::create();
+        sps.reserve(256);
+        pps.reserve(256);
+        pieces.reserve(1024);
+        nals.reserve(1024);
+        samples.reserve(options_.max_fragment_frames ? options_.max_fragment_frames : 300);
+        building = take_fragment();
+        worker = thread(&RaspiMP4Muxer::run, this);
+    }
+
+    RaspiMP4Muxer::~RaspiMP4Muxer() {
+        {
+            lock_guard< mutex > guard(lock);
+            stopping = true;
+        }
+        changed.notify_all();
+        if (worker.joinable()) {
+            worker.join();
+        }
+        clear_fragment(*building);
+    }
+
+    void RaspiMP4Muxer::callback(MMAL_PORT_T *port, MMAL_BUFFER_HEADER_T *buffer) {
+        lock_guard< mutex > guard(callback_lock);
+        if (!port->is_enabled || failed_ || (buffer->flags & MMAL_BUFFER_HEADER_FLAG_CODECSIDEINFO)) {
+            return;
+        }
+        if (!buffer->length && !(buffer->flags & MMAL_BUFFER_HEADER_FLAG_FRAME_END)) {
+            return;
+        }
+
+        uint32_t count = parser->parse(buffer);
+        const RASPIH264_NAL_S *found = parser->nals();
+
+        if (!frame_open && !(buffer->flags & MMAL_BUFFER_HEADER_FLAG_CONFIG)) {
+            bool idr = false;
+            for (uint32_t i = 0; i < count; i++) {
+                if ((found[i].flags & RASPIH264_NAL_FLAG_START) && found[i].type == RASPIH264_NAL_IDR) {
+                    idr = true;
+                }
+            }
+            if (!samples.empty() && ((idr && options_.fragment == RASPIMP4MUXER_FRAGMENT_KEYFRAME) ||
+                    (options_.max_fragment_frames && samples.size() >= options_.max_fragment_frames))) {
+                // The fragment ends right before this frame, so its last sample duration is known exactly
+                write_fragment(buffer->dts != MMAL_TIME_UNKNOWN ? buffer->dts : buffer->pts);
+            }
+            frame_open = true;
+            frame_keyframe = idr;
+            frame_first_nal = nals.size();
+            frame_pts = MMAL_TIME_UNKNOWN;
+            frame_dts = MMAL_TIME_UNKNOWN;
+        }
+
+        // Keep at least one buffer of the pool for the encoder, or it stalls. Fragments waiting for the writer still pin theirs.
+        RASPIPORT_USERDATA_S *userdata = (RASPIPORT_USERDATA_S *)port->userdata;
+        uint32_t pool_size = userdata && userdata->pool ? userdata->pool->headers_num : port->buffer_num;
+        bool copy = pinned.load(std::memory_order_relaxed) + 1 >= pool_size;
+        bool used = false;
+        for (uint32_t i = 0; i < count; i++) {
+            const RASPIH264_NAL_S &nal = found[i];
+            if (nal.flags & RASPIH264_NAL_FLAG_START) {
+                if (nal.type == RASPIH264_NAL_SPS) {
+                    sps.clear();
+                } else if (nal.type == RASPIH264_NAL_PPS) {
+                    pps.clear();
+                }
+                // Parameter sets go in the sample description. Frames before the first keyframe can't be decoded.
+                skipping_nal = nal.type == RASPIH264_NAL_SPS || nal.type == RASPIH264_NAL_PPS || nal.type == RASPIH264_NAL_AUD ||
+                    !frame_open || !(initialized || frame_keyframe);
+                if (!skipping_nal) {
+                    NAL_S entry = { (uint32_t)pieces.size(), 0, 0 };
+                    nals.push_back(entry);
+                }
+            }
+            if (nal.type == RASPIH264_NAL_SPS && sps.size() + nal.length <= sps.capacity()) {
+                put_bytes(sps, nal.data, nal.length);
+            } else if (nal.type == RASPIH264_NAL_PPS && pps.size() + nal.length <= pps.capacity()) {
+                put_bytes(pps, nal.data, nal.length);
+            }
+            if (skipping_nal || !nal.length) {
+                continue;
+            }
+            PIECE_S piece;
+            piece.length = nal.length;
+            if (copy) {
+                piece.data = NULL;
+                piece.offset = building->staging.size();
+                put_bytes(building->staging, nal.data, nal.length);
+                fragment_copied += nal.length;
+                bytes_copied_.fetch_add(nal.length, std::memory_order_relaxed);
+            } else {
+                piece.data = nal.data;
+                piece.offset = 0;
+            }
+            used = true;
+            pieces.push_back(piece);
+            nals.back().pieces++;
+            nals.back().length += nal.length;
+        }
+        if (used) {
+            fragment_buffers++;
+            if (!copy) {
+                building->pins.emplace_back(buffer);
+                pinned.fetch_add(1, std::memory_order_relaxed);
+            }
+        }
+
+        if (buffer->flags & MMAL_BUFFER_HEADER_FLAG_CONFIG) {
+            return;
+        }
+        if (buffer->pts != MMAL_TIME_UNKNOWN) {
+            frame_pts = buffer->pts;
+        }
+        if (buffer->dts != MMAL_TIME_UNKNOWN) {
+            frame_dts = buffer->dts;
+        }
+        if (!initialized && frame_keyframe && sps.size() >= 4 && !pps.empty()) {
+            write_init(port);
+        }
+        if (frame_open && (buffer->flags & MMAL_BUFFER_HEADER_FLAG_FRAME_END)) {
+            frame_done();
+            if (options_.fragment == RASPIMP4MUXER_FRAGMENT_FRAME) {
+                write_fragment(MMAL_TIME_UNKNOWN);
+            }
+        }
+    }
+
+    void RaspiMP4Muxer::frame_done() {
+        frame_open = false;
+        if (!initialized) {
+            // No parameter sets yet, so drop the frame
+            clear_fragment(*building);
+            pieces.clear();
+            nals.clear();
+            fragment_buffers = 0;
+            fragment_copied = 0;
+            return;
+        }
+        if (nals.size() == frame_first_nal) {
+            return;
+        }
+        SAMPLE_S sample;
+        sample.first_nal = frame_first_nal;
+        sample.nals = nals.size() - frame_first_nal;
+        sample.size = 0;
+        for (uint32_t i = frame_first_nal; i < nals.size(); i++) {
+            sample.size += 4 + nals[i].length;
+        }
+        sample.keyframe = frame_keyframe;
+        sample.pts = frame_pts;
+        sample.dts = frame_dts != MMAL_TIME_UNKNOWN ? frame_dts : frame_pts;
+        if (sample.pts == MMAL_TIME_UNKNOWN) {
+            sample.pts = sample.dts = last_dts != MMAL_TIME_UNKNOWN ? last_dts + frame_duration_us : origin;
+        }
+        if (last_dts != MMAL_TIME_UNKNOWN && sample.dts > last_dts) {
+            frame_duration_us = sample.dts - last_dts;
+        }
+        last_dts = sample.dts;
+        samples.push_back(sample);
+    }
+
+    int64_t RaspiMP4Muxer::ticks(int64_t us) {
+        int64_t relative = us - origin;
+        int64_t scaled = (relative < 0 ? -relative : relative) * options_.timescale + 500000;
+        return relative < 0 ? -(scaled / 1000000) : scaled / 1000000;
+    }
+
+    void RaspiMP4Muxer::write_init(MMAL_PORT_T *port) {
+        MMAL_VIDEO_FORMAT_T &video = port->format->es->video;
+        width = video.crop.width ? video.crop.width : video.width;
+        height = video.crop.height ? video.crop.height : video.height;
+        if (video.frame_rate.num > 0 && video.frame_rate.den > 0) {
+            frame_duration_us = (int64_t)1000000 * video.frame_rate.den / video.frame_rate.num;
+        }
+        origin = frame_dts != MMAL_TIME_UNKNOWN ? frame_dts : (frame_pts != MMAL_TIME_UNKNOWN ? frame_pts : 0);
+
+        unique_ptr< FRAGMENT_S > init = take_fragment();
+        vector< uint8_t > &header = init->header;
+        size_t ftyp = begin_box(header, "ftyp");
+        put_bytes(header, "isom", 4);
+        put32(header, 0x200);
+        put_bytes(header, "isomiso6cmfcavc1mp41", 20);
+        end_box(header, ftyp);
+
+        size_t moov = begin_box(header, "moov");
+        size_t mvhd = begin_box(header, "mvhd");
+        put32(header, 0);
+        put32(header, 0);
+        put32(header, 0);
+        put32(header, 1000);
+        put32(header, 0);
+        put32(header, 0x00010000);
+        put16(header, 0x0100);
+        put16(header, 0);
+        put64(header, 0);
+        put_matrix(header);
+        for (int i = 0; i < 6; i++) {
+            put32(header, 0);
+        }
+        put32(header, RASPIMP4MUXER_TRACK_ID + 1);
+        end_box(header, mvhd);
+
+        size_t trak = begin_box(header, "trak");
+        size_t tkhd = begin_box(header, "tkhd");
+        put32(header, 0x00000003);
+        put32(header, 0);
+        put32(header, 0);
+        put32(header, RASPIMP4MUXER_TRACK_ID);
+        put32(header, 0);
+        put32(header, 0);
+        put64(header, 0);
+        put16(header, 0);
+        put16(header, 0);
+        put16(header, 0);
+        put16(header, 0);
+        put_matrix(header);
+        put32(header, width << 16);
+        put32(header, height << 16);
+        end_box(header, tkhd);
+
+        size_t mdia = begin_box(header, "mdia");
+        size_t mdhd = begin_box(header, "mdhd");
+        put32(header, 0);
+        put32(header, 0);
+        put32(header, 0);
+        put32(header, options_.timescale);
+        put32(header, 0);
+        put16(header, 0x55c4);
+        put16(header, 0);
+        end_box(header, mdhd);
+        size_t hdlr = begin_box(header, "hdlr");
+        put32(header, 0);
+        put32(header, 0);
+        put_bytes(header, "vide", 4);
+        put32(header, 0);
+        put32(header, 0);
+        put32(header, 0);
+        put_bytes(header, "VideoHandler", 13);
+        end_box(header, hdlr);
+
+        size_t minf = begin_box(header, "minf");
+        size_t vmhd = begin_box(header, "vmhd");
+        put32(header, 1);
+        put16(header, 0);
+        put16(header, 0);
+        put16(header, 0);
+        put16(header, 0);
+        end_box(header, vmhd);
+        size_t dinf = begin_box(header, "dinf");
+        size_t dref = begin_box(header, "dref");
+        put32(header, 0);
+        put32(header, 1);
+        size_t url = begin_box(header, "url ");
+        put32(header, 1);
+        end_box(header, url);
+        end_box(header, dref);
+        end_box(header, dinf);
+
+        size_t stbl = begin_box(header, "stbl");
+        size_t stsd = begin_box(header, "stsd");
+        put32(header, 0);
+        put32(header, 1);
+        size_t avc1 = begin_box(header, "avc1");
+        put32(header, 0);
+        put16(header, 0);
+        put16(header, 1);
+        put16(header, 0);
+        put16(header, 0);
+        put32(header, 0);
+        put32(header, 0);
+        put32(header, 0);
+        put16(header, width);
+        put16(header, height);
+        put32(header, 0x00480000);
+        put32(header, 0x00480000);
+        put32(header, 0);
+        put16(header, 1);
+        for (int i = 0; i < 8; i++) {
+            put32(header, 0);
+        }
+        put16(header, 0x0018);
+        put16(header, 0xffff);
+        size_t avcc = begin_box(header, "avcC");
+        put8(header, 1);
+        put8(header, sps[1]);
+        put8(header, sps[2]);
+        put8(header, sps[3]);
+        put8(header, 0xff);
+        put8(header, 0xe1);
+        put16(header, sps.size());
+        put_bytes(header, sps.data(), sps.size());
+        put8(header, 1);
+        put16(header, pps.size());
+        put_bytes(header, pps.data(), pps.size());
+        if (sps[1] == 100 || sps[1] == 110 || sps[1] == 122 || sps[1] == 144) {
+            // High profiles add the chroma format, bit depths and a count of SPS extensions
+            uint32_t chroma_format = 1, luma_depth = 0, chroma_depth = 0;
+            read_high_profile(sps, chroma_format, luma_depth, chroma_depth);
+            put8(header, 0xfc | chroma_format);
+            put8(header, 0xf8 | luma_depth);
+            put8(header, 0xf8 | chroma_depth);
+            put8(header, 0);
+        }
+        end_box(header, avcc);
+        end_box(header, avc1);
+        end_box(header, stsd);
+        const char *empty_tables[] = { "stts", "stsc", "stco" };
+        for (int i = 0; i < 3; i++) {
+            size_t table = begin_box(header, empty_tables[i]);
+            put32(header, 0);
+            put32(header, 0);
+            end_box(header, table);
+        }
+        size_t stsz = begin_box(header, "stsz");
+        put32(header, 0);
+        put32(header, 0);
+        put32(header, 0);
+        end_box(header, stsz);
+        end_box(header, stbl);
+        end_box(header, minf);
+        end_box(header, mdia);
+        end_box(header, trak);
+
+        size_t mvex = begin_box(header, "mvex");
+        size_t trex = begin_box(header, "trex");
+        put32(header, 0);
+        put32(header, RASPIMP4MUXER_TRACK_ID);
+        put32(header, 1);
+        put32(header, 0);
+        put32(header, 0);
+        put32(header, 0);
+        end_box(header, trex);
+        end_box(header, mvex);
+        end_box(header, moov);
+
+        struct iovec vec;
+        vec.iov_base = header.data();
+        vec.iov_len = header.size();
+        init->iov.push_back(vec);
+        queue_fragment(move(init));
+        initialized = true;
+    }
+
+    void RaspiMP4Muxer::write_fragment(int64_t next_dts) {
+        if (samples.empty()) {
+            return;
+        }
+        int64_t estimate = (frame_duration_us * options_.timescale + 500000) / 1000000;
+        uint32_t mdat_size = 8;
+        for (size_t i = 0; i < samples.size(); i++) {
+            mdat_size += samples[i].size;
+        }
+
+        vector< uint8_t > &header = building->header;
+        size_t moof = begin_box(header, "moof");
+        size_t mfhd = begin_box(header, "mfhd");
+        put32(header, 0);
+        put32(header, ++sequence);
+        end_box(header, mfhd);
+        size_t traf = begin_box(header, "traf");
+        size_t tfhd = begin_box(header, "tfhd");
+        // default-base-is-moof
+        put32(header, 0x020000);
+        put32(header, RASPIMP4MUXER_TRACK_ID);
+        end_box(header, tfhd);
+        size_t tfdt = begin_box(header, "tfdt");
+        put32(header, 0x01000000);
+        put64(header, ticks(samples[0].dts));
+        end_box(header, tfdt);
+        size_t trun = begin_box(header, "trun");
+        // Version 1 for signed composition offsets. Data offset, sample duration, size, flags and composition offset.
+        put32(header, 0x01000f01);
+        put32(header, samples.size());
+        size_t data_offset = header.size();
+        put32(header, 0);
+        for (size_t i = 0; i < samples.size(); i++) {
+            SAMPLE_S &sample = samples[i];
+            int64_t next = i + 1 < samples.size() ? samples[i + 1].dts : next_dts;
+            int64_t duration = next != MMAL_TIME_UNKNOWN ? ticks(next) - ticks(sample.dts) : 0;
+            put32(header, duration > 0 ? duration : estimate);
+            put32(header, sample.size);
+            put32(header, sample.keyframe ? RASPIMP4MUXER_SAMPLE_SYNC : RASPIMP4MUXER_SAMPLE_NON_SYNC);
+            put32(header, (uint32_t)(int32_t)(ticks(sample.pts) - ticks(sample.dts)));
+        }
+        end_box(header, trun);
+        end_box(header, traf);
+        end_box(header, moof);
+        patch32(header, data_offset, header.size() - moof + 8);
+        put32(header, mdat_size);
+        put_bytes(header, "mdat", 4);
+
+        vector< uint8_t > &lengths = building->lengths;
+        for (size_t i = 0; i < nals.size(); i++) {
+            put32(lengths, nals[i].length);
+        }
+
+        vector< struct iovec > &iov = building->iov;
+        struct iovec vec;
+        vec.iov_base = header.data();
+        vec.iov_len = header.size();
+        iov.push_back(vec);
+        for (size_t i = 0; i < samples.size(); i++) {
+            for (uint32_t n = samples[i].first_nal; n < samples[i].first_nal + samples[i].nals; n++) {
+                vec.iov_base = lengths.data() + 4 * n;
+                vec.iov_len = 4;
+                iov.push_back(vec);
+                for (uint32_t p = nals[n].first_piece; p < nals[n].first_piece + nals[n].pieces; p++) {
+                    vec.iov_base = (void *)(pieces[p].data ? pieces[p].data : building->staging.data() + pieces[p].offset);
+                    vec.iov_len = pieces[p].length;
+                    iov.push_back(vec);
+                }
+            }
+        }
+
+        if (fragment_copied && fragment_buffers > reported_buffers) {
+            reported_buffers = fragment_buffers;
+            vcos_log_error("RaspiMP4Muxer::write_fragment(): copied %llu bytes of fragment %u, which spans %u encoder buffers. "
+                "A buffer_num of %u or more keeps such fragments copy-free", (unsigned long long)fragment_copied, sequence,
+                fragment_buffers, fragment_buffers + 1);
+        }
+
+        building->frames = samples.size();
+        queue_fragment(move(building));
+        building = take_fragment();
+        pieces.clear();
+        nals.clear();
+        samples.clear();
+        fragment_buffers = 0;
+        fragment_copied = 0;
+    }
+
+    unique_ptr< RaspiMP4Muxer::FRAGMENT_S > RaspiMP4Muxer::take_fragment() {
+        {
+            lock_guard< mutex > guard(lock);
+            if (!spare.empty()) {
+                unique_ptr< FRAGMENT_S > fragment = move(spare.back());
+                spare.pop_back();
+                return fragment;
+            }
+        }
+        unique_ptr< FRAGMENT_S > fragment(new FRAGMENT_S());
+        fragment->pins.reserve(64);
+        fragment->staging.reserve(1 << 20);
+        fragment->header.reserve(4096);
+        fragment->lengths.reserve(4096);
+        fragment->iov.reserve(2048);
+        fragment->frames = 0;
+        return fragment;
+    }
+
+    void RaspiMP4Muxer::queue_fragment(unique_ptr< FRAGMENT_S > fragment) {
+        {
+            unique_lock< mutex > guard(lock);
+            changed.wait(guard, [this]{ return ready.size() < RASPIMP4MUXER_MAX_PENDING; });
+            ready.push_back(move(fragment));
+        }
+        changed.notify_all();
+    }
+
+    void RaspiMP4Muxer::clear_fragment(FRAGMENT_S &fragment) {
+        pinned.fetch_sub(fragment.pins.size(), std::memory_order_relaxed);
+        fragment.pins.clear();
+        fragment.staging.clear();
+        fragment.header.clear();
+        fragment.lengths.clear();
+        fragment.iov.clear();
+        fragment.frames = 0;
+    }
+
+    void RaspiMP4Muxer::run() {
+        unique_lock< mutex > guard(lock);
+        while (true) {
+            changed.wait(guard, [this]{ return !ready.empty() || stopping; });
+            if (ready.empty()) {
+                break;
+            }
+            unique_ptr< FRAGMENT_S > fragment = move(ready.front());
+            ready.pop_front();
+            writing = true;
+            guard.unlock();
+            changed.notify_all();
+            // After a write error, queued fragments are only released
+            if (!failed_ && write_all(fragment->iov.data(), fragment->iov.size()) == MMAL_SUCCESS && fragment->frames) {
+                fragments_.fetch_add(1, std::memory_order_relaxed);
+                frames_.fetch_add(fragment->frames, std::memory_order_relaxed);
+            }
+            clear_fragment(*fragment);
+            guard.lock();
+            spare.push_back(move(fragment));
+            writing = false;
+            changed.notify_all();
+        }
+    }
+
+    MMAL_STATUS_T RaspiMP4Muxer::write_all(struct iovec *vec, size_t count) {
+        size_t index = 0;
+        while (index < count) {
+            if (!vec[index].iov_len) {
+                index++;
+                continue;
+            }
+            ssize_t written = writev(fd_, vec + index, count - index < IOV_MAX ? count - index : IOV_MAX);
+            if (written < 0) {
+                if (errno == EINTR) {
+                    continue;
+                }
+                vcos_log_error("RaspiMP4Muxer::write_all(): writev failed: %s", strerror(errno));
+                failed_ = true;
+                return MMAL_EIO;
+            }
+            bytes_written_.fetch_add(written, std::memory_order_relaxed);
+            while (written > 0) {
+                if ((size_t)written >= vec[index].iov_len) {
+                    written -= vec[index].iov_len;
+                    index++;
+                } else {
+                    vec[index].iov_base = (uint8_t *)vec[index].iov_base + written;
+                    vec[index].iov_len -= written;
+                    written = 0;
+                }
+            }
+        }
+        return MMAL_SUCCESS;
+    }
+
+    MMAL_STATUS_T RaspiMP4Muxer::flush() {
+        {
+            lock_guard< mutex > guard(callback_lock);
+            if (!failed_) {
+                write_fragment(MMAL_TIME_UNKNOWN);
+            }
+        }
+        unique_lock< mutex > guard(lock);
+        changed.wait(guard, [this]{ return ready.empty() && !writing; });
+        return failed_ ? MMAL_EIO : MMAL_SUCCESS;
+    }
+
+    uint64_t RaspiMP4Muxer::fragments() {
+        return fragments_.load(std::memory_order_relaxed);
+    }
+
+    uint64_t RaspiMP4Muxer::frames() {
+        return frames_.load(std::memory_order_relaxed);
+    }
+
+    uint64_t RaspiMP4Muxer::bytes_written() {
+        return bytes_written_.load(std::memory_order_relaxed);
+    }
+
+    uint64_t RaspiMP4Muxer::bytes_copied() {
+        return bytes_copied_.load(std::memory_order_relaxed);
+    }
+
+    bool RaspiMP4Muxer::failed() {
+        return failed_;
+    }
+
+}
@@ -0,0 +1,265 @@
+#include <math.h>
+
+#include "raspivid/RaspiMotionAnalyzer.h"
+
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+#include <arm_neon.h>
+#define RASPIMOTIONANALYZER_NEON 1
+#elif defined(__AVX2__)
+#include <immintrin.h>
+#define RASPIMOTIONANALYZER_AVX2 1
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#define RASPIMOTIONANALYZER_SSE2 1
+#endif
+
+#define RASPIMOTIONANALYZER_RECORD_SIZE     4
+
+namespace raspivid {
+
+    /*
+     Adds up count motion vector records {int8_t x; int8_t y; uint16_t sad;}. Vectors with a SAD above max_sad are left out.
+     Adds the squared lengths of the remaining vectors to sum, and the number of them at least min_magnitude2 long to moving.
+     */
+    static void accumulate(const uint8_t *records, uint32_t count, uint32_t min_magnitude2, uint32_t max_sad, uint32_t *moving, uint32_t *sum) {
+        uint32_t i = 0, m = 0, s = 0;
+#if defined(RASPIMOTIONANALYZER_NEON)
+        // vld4 splits 16 records into x, y and the two SAD bytes. x * x + y * y is at most 32768, which fits 16 bits unsigned.
+        uint16x8_t vmin = vdupq_n_u16((uint16_t)min_magnitude2);
+        uint16x8_t vmax = vdupq_n_u16((uint16_t)max_sad);
+        uint32x4_t vsum = vdupq_n_u32(0), vmoving = vdupq_n_u32(0);
+        for (; i + 16 <= count; i += 16) {
+            uint8x16x4_t r = vld4q_u8(records + i * RASPIMOTIONANALYZER_RECORD_SIZE);
+            int8x16_t x = vreinterpretq_s8_u8(r.val[0]);
+            int8x16_t y = vreinterpretq_s8_u8(r.val[1]);
+            uint16x8_t sad_low = vorrq_u16(vmovl_u8(vget_low_u8(r.val[2])), vshll_n_u8(vget_low_u8(r.val[3]), 8));
+            uint16x8_t sad_high = vorrq_u16(vmovl_u8(vget_high_u8(r.val[2])), vshll_n_u8(vget_high_u8(r.val[3]), 8));
+            uint16x8_t mag_low = vreinterpretq_u16_s16(vmlal_s8(vmull_s8(vget_low_s8(x), vget_low_s8(x)), vget_low_s8(y), vget_low_s8(y)));
+            uint16x8_t mag_high = vreinterpretq_u16_s16(vmlal_s8(vmull_s8(vget_high_s8(x), vget_high_s8(x)), vget_high_s8(y), vget_high_s8(y)));
+            uint16x8_t valid_low = vcleq_u16(sad_low, vmax);
+            uint16x8_t valid_high = vcleq_u16(sad_high, vmax);
+            mag_low = vandq_u16(mag_low, valid_low);
+            mag_high = vandq_u16(mag_high, valid_high);
+            vsum = vpadalq_u16(vsum, mag_low);
+            vsum = vpadalq_u16(vsum, mag_high);
+            vmoving = vpadalq_u16(vmoving, vshrq_n_u16(vandq_u16(valid_low, vcgeq_u16(mag_low, vmin)), 15));
+            vmoving = vpadalq_u16(vmoving, vshrq_n_u16(vandq_u16(valid_high, vcgeq_u16(mag_high, vmin)), 15));
+        }
+        uint32_t lanes[4];
+        vst1q_u32(lanes, vsum);
+        s += lanes[0] + lanes[1] + lanes[2] + lanes[3];
+        vst1q_u32(lanes, vmoving);
+        m += lanes[0] + lanes[1] + lanes[2] + lanes[3];
+#elif defined(RASPIMOTIONANALYZER_AVX2) || defined(RASPIMOTIONANALYZER_SSE2)
+        /*
+         Each 32 bit lane holds one record. Masking off the SAD leaves x and y in the low 16 bit half, which are sign extended
+         into 16 bit lanes of their own so that madd computes x * x and y * y in 32 bits.
+         */
+#if defined(RASPIMOTIONANALYZER_AVX2)
+        __m256i wmin = _mm256_set1_epi32((int32_t)min_magnitude2 - 1);
+        __m256i wmax = _mm256_set1_epi32((int32_t)max_sad + 1);
+        __m256i wlow = _mm256_set1_epi32(0xffff);
+        __m256i wsum = _mm256_setzero_si256(), wmoving = _mm256_setzero_si256();
+        for (; i + 8 <= count; i += 8) {
+            __m256i r = _mm256_loadu_si256((const __m256i *)(records + i * RASPIMOTIONANALYZER_RECORD_SIZE));
+            __m256i xy = _mm256_and_si256(r, wlow);
+            __m256i x = _mm256_srai_epi16(_mm256_slli_epi16(xy, 8), 8);
+            __m256i y = _mm256_srai_epi16(xy, 8);
+            __m256i mag = _mm256_add_epi32(_mm256_madd_epi16(x, x), _mm256_madd_epi16(y, y));
+            __m256i valid = _mm256_cmpgt_epi32(wmax, _mm256_srli_epi32(r, 16));
+            mag = _mm256_and_si256(mag, valid);
+            wsum = _mm256_add_epi32(wsum, mag);
+            wmoving = _mm256_sub_epi32(wmoving, _mm256_and_si256(valid, _mm256_cmpgt_epi32(mag, wmin)));
+        }
+        __m128i vsum = _mm_add_epi32(_mm256_castsi256_si128(wsum), _mm256_extracti128_si256(wsum, 1));
+        __m128i vmoving = _mm_add_epi32(_mm256_castsi256_si128(wmoving), _mm256_extracti128_si256(wmoving, 1));
+#else
+        __m128i vsum = _mm_setzero_si128(), vmoving = _mm_setzero_si128();
+#endif
+        __m128i vmin = _mm_set1_epi32((int32_t)min_magnitude2 - 1);
+        __m128i vmax = _mm_set1_epi32((int32_t)max_sad + 1);
+        __m128i vlow = _mm_set1_epi32(0xffff);
+        for (; i + 4 <= count; i += 4) {
+            __m128i r = _mm_loadu_si128((const __m128i *)(records + i * RASPIMOTIONANALYZER_RECORD_SIZE));
+            __m128i xy = _mm_and_si128(r, vlow);
+            __m128i x = _mm_srai_epi16(_mm_slli_epi16(xy, 8), 8);
+            __m128i y = _mm_srai_epi16(xy, 8);
+            __m128i mag = _mm_add_epi32(_mm_madd_epi16(x, x), _mm_madd_epi16(y, y));
+            __m128i valid = _mm_cmpgt_epi32(vmax, _mm_srli_epi32(r, 16));
+            mag = _mm_and_si128(mag, valid);
+            vsum = _mm_add_epi32(vsum, mag);
+            vmoving = _mm_sub_epi32(vmoving, _mm_and_si128(valid, _mm_cmpgt_epi32(mag, vmin)));
+        }
+        uint32_t lanes[4];
+        _mm_storeu_si128((__m128i *)lanes, vsum);
+        s += lanes[0] + lanes[1] + lanes[2] + lanes[3];
+        _mm_storeu_si128((__m128i *)lanes, vmoving);
+        m += lanes[0] + lanes[1] + lanes[2] + lanes[3];
+#endif
+        for (; i < count; i++) {
+            const uint8_t *record = records + i * RASPIMOTIONANALYZER_RECORD_SIZE;
+            uint32_t sad = record[2] | ((uint32_t)record[3] << 8);
+            if (sad > max_sad) {
+                continue;
+            }
+            int32_t x = (int8_t)record[0];
+            int32_t y = (int8_t)record[1];
+            uint32_t magnitude2 = x * x + y * y;
+            s += magnitude2;
+            m += magnitude2 >= min_magnitude2;
+        }
+        *moving += m;
+        *sum += s;
+    }
+
+    RASPIMOTIONANALYZER_OPTION_S RaspiMotionAnalyzer::createDefaultMotionAnalyzerOptions() {
+        RASPIMOTIONANALYZER_OPTION_S options;
+        options.columns = 4;
+        options.rows = 3;
+        options.min_magnitude = 2;
+        options.max_sad = 0;
+        options.start_fraction = 0.05f;
+        options.start_frames = 3;
+        options.stop_fraction = 0.02f;
+        options.stop_frames = 15;
+        return options;
+    }
+
+    shared_ptr< RaspiMotionAnalyzer > RaspiMotionAnalyzer::create(RASPIMOTIONANALYZER_OPTION_S options) {
+        if (!options.columns || !options.rows) {
+            vcos_log_error("RaspiMotionAnalyzer::create(): at least one region column and row are needed");
+            return nullptr;
+        }
+        return shared_ptr< RaspiMotionAnalyzer >( new RaspiMotionAnalyzer(options) );
+    }
+
+    shared_ptr< RaspiMotionAnalyzer > RaspiMotionAnalyzer::create() {
+        return create(createDefaultMotionAnalyzerOptions());
+    }
+
+    RaspiMotionAnalyzer::RaspiMotionAnalyzer(RASPIMOTIONANALYZER_OPTION_S options) : options_(options), mb_width(0), mb_height(0),
+            pts_(MMAL_TIME_UNKNOWN), frames_(0), moving_regions(0) {
+        uint32_t count = options_.columns * options_.rows;
+        STATE_S idle = { 0, 0, 0, 0, false };
+        state.assign(count, idle);
+        RASPIMOTIONANALYZER_REGION_S still = { 0.0f, 0.0f, false };
+        regions.assign(count, still);
+        pending.reserve(count * 2);
+    }
+
+    void RaspiMotionAnalyzer::layout(uint32_t columns, uint32_t rows) {
+        mb_width = columns;
+        mb_height = rows;
+        column_start.resize(options_.columns + 1);
+        for (uint32_t c = 0; c <= options_.columns; c++) {
+            column_start[c] = c * mb_width / options_.columns;
+        }
+        row_region.resize(mb_height);
+        for (uint32_t y = 0; y < mb_height; y++) {
+            row_region[y] = y * options_.rows / mb_height;
+        }
+        for (size_t i = 0; i < state.size(); i++) {
+            state[i].mbs = 0;
+        }
+        for (uint32_t y = 0; y < mb_height; y++) {
+            for (uint32_t c = 0; c < options_.columns; c++) {
+                state[row_region[y] * options_.columns + c].mbs += column_start[c + 1] - column_start[c];
+            }
+        }
+    }
+
+    void RaspiMotionAnalyzer::callback(MMAL_PORT_T *port, MMAL_BUFFER_HEADER_T *buffer) {
+        if (!port->is_enabled || !(buffer->flags & MMAL_BUFFER_HEADER_FLAG_CODECSIDEINFO) || !buffer->length) {
+            return;
+        }
+        // The encoder sends vectors for the macroblocks of the picture, not of the padded frame
+        MMAL_VIDEO_FORMAT_T &video = port->format->es->video;
+        uint32_t width = video.crop.width ? video.crop.width : video.width;
+        analyze(buffer->data + buffer->offset, buffer->length, width, buffer->pts);
+    }
+
+    MMAL_STATUS_T RaspiMotionAnalyzer::analyze(const uint8_t *records, uint32_t length, uint32_t width, int64_t pts) {
+        // The encoder adds one record past the last macroblock of each row
+        uint32_t columns = VCOS_ALIGN_UP(width, 16) >> 4;
+        uint32_t stride = columns + 1;
+        uint32_t rows = columns ? length / RASPIMOTIONANALYZER_RECORD_SIZE / stride : 0;
+        if (!records || !rows || length != rows * stride * RASPIMOTIONANALYZER_RECORD_SIZE) {
+            vcos_log_error("RaspiMotionAnalyzer::analyze(): %u bytes of motion vectors do not fit a width of %u", length, width);
+            return MMAL_EINVAL;
+        }
+        if (columns != mb_width || rows != mb_height) {
+            layout(columns, rows);
+        }
+
+        for (size_t i = 0; i < state.size(); i++) {
+            state[i].moving = 0;
+            state[i].sum = 0;
+        }
+        uint32_t min_magnitude2 = (uint32_t)options_.min_magnitude * options_.min_magnitude;
+        uint32_t max_sad = options_.max_sad ? options_.max_sad : 0xffff;
+        for (uint32_t y = 0; y < mb_height; y++) {
+            const uint8_t *line = records + y * stride * RASPIMOTIONANALYZER_RECORD_SIZE;
+            STATE_S *row = &state[row_region[y] * options_.columns];
+            for (uint32_t c = 0; c < options_.columns; c++) {
+                accumulate(line + column_start[c] * RASPIMOTIONANALYZER_RECORD_SIZE, column_start[c + 1] - column_start[c],
+                    min_magnitude2, max_sad, &row[c].moving, &row[c].sum);
+            }
+        }
+
+        lock_guard< mutex > guard(lock);
+        uint32_t active = 0;
+        for (uint32_t i = 0; i < state.size(); i++) {
+            STATE_S &s = state[i];
+            float fraction = s.mbs ? (float)s.moving / s.mbs : 0.0f;
+            bool crossed = s.active ? fraction < options_.stop_fraction : s.mbs && fraction >= options_.start_fraction;
+            if (!crossed) {
+                s.frames = 0;
+            } else if (++s.frames >= (s.active ? options_.stop_frames : options_.start_frames)) {
+                s.active = !s.active;
+                s.frames = 0;
+                RASPIMOTIONANALYZER_EVENT_S event = { i, s.active, fraction, pts };
+                pending.push_back(event);
+            }
+            regions[i].fraction = fraction;
+            regions[i].magnitude = s.mbs ? sqrtf((float)s.sum / s.mbs) : 0.0f;
+            regions[i].moving = s.active;
+            active += s.active;
+        }
+        moving_regions = active;
+        pts_ = pts;
+        frames_++;
+        return MMAL_SUCCESS;
+    }
+
+    void RaspiMotionAnalyzer::post_process() {
+        vector< RASPIMOTIONANALYZER_EVENT_S > events;
+        {
+            lock_guard< mutex > guard(lock);
+            if (pending.empty()) {
+                return;
+            }
+            events.swap(pending);
+            pending.reserve(events.capacity());
+        }
+        for (size_t i = 0; i < events.size(); i++) {
+            motion_event(events[i]);
+        }
+    }
+
+    int64_t RaspiMotionAnalyzer::get_regions(vector< RASPIMOTIONANALYZER_REGION_S > &regions_) {
+        lock_guard< mutex > guard(lock);
+        regions_ = regions;
+        return pts_;
+    }
+
+    bool RaspiMotionAnalyzer::moving() {
+        lock_guard< mutex > guard(lock);
+        return moving_regions > 0;
+    }
+
+    uint64_t RaspiMotionAnalyzer::frames() {
+        lock_guard< mutex > guard(lock);
+        return frames_;
+    }
+
+}
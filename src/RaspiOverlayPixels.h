@@ -0,0 +1,62 @@
+/**
+ \file RaspiOverlayPixels.h
+ \brief Packed pixel helpers shared by RaspiOverlaySurface and RaspiTextRasterizer.
+ */
+
+#ifndef __RASPIOVERLAYPIXELS_H__
+#define __RASPIOVERLAYPIXELS_H__
+
+#include <stdint.h>
+
+#include "interface/mmal/mmal.h"
+#include "interface/mmal/util/mmal_util.h"
+#include "interface/vcos/vcos.h"
+
+namespace raspivid {
+
+    /**
+     \return Bytes per pixel of a packed RGB encoding the overlay helpers draw into, or 0 if the encoding is not one of them
+     */
+    static inline uint32_t overlay_bytes_per_pixel(uint32_t encoding) {
+        switch (encoding) {
+            case MMAL_ENCODING_RGB24:
+            case MMAL_ENCODING_BGR24:
+                return 3;
+            case MMAL_ENCODING_RGBA:
+            case MMAL_ENCODING_BGRA:
+                return 4;
+            default:
+                return 0;
+        }
+    }
+
+    /**
+     \return Bytes from one row of an overlay buffer to the next
+     */
+    static inline uint32_t overlay_stride(uint32_t encoding, uint32_t width) {
+        // Matches the frame RaspiOverlayRenderer::init commits
+        return mmal_encoding_width_to_stride(encoding, VCOS_ALIGN_UP(width, 32));
+    }
+
+    /**
+     \brief Clips a rectangle to a width x height area.
+     \return false if nothing of the rectangle is left
+     */
+    static inline bool overlay_clip(uint32_t width, uint32_t height, MMAL_RECT_T &rect) {
+        int32_t x0 = vcos_max(rect.x, 0);
+        int32_t y0 = vcos_max(rect.y, 0);
+        int32_t x1 = vcos_min((int64_t)rect.x + rect.width, (int64_t)width);
+        int32_t y1 = vcos_min((int64_t)rect.y + rect.height, (int64_t)height);
+        if (x1 <= x0 || y1 <= y0) {
+            return false;
+        }
+        rect.x = x0;
+        rect.y = y0;
+        rect.width = x1 - x0;
+        rect.height = y1 - y0;
+        return true;
+    }
+
+}
+
+#endif
@@ -0,0 +1,232 @@
+#include <string.h>
+
+#include "raspivid/RaspiOverlaySurface.h"
+#include "RaspiOverlayPixels.h"
+
+namespace raspivid {
+
+    shared_ptr< RaspiOverlaySurface > RaspiOverlaySurface::create(shared_ptr< RaspiOverlayRenderer > overlay, RASPIOVERLAYSURFACE_MODE_T mode) {
+        if (!overlay) {
+            return nullptr;
+        }
+        uint32_t encoding = overlay->get_format().encoding;
+        if (!overlay_bytes_per_pixel(encoding)) {
+            vcos_log_error("RaspiOverlaySurface::create(): unsupported overlay encoding %4.4s", (char *)&encoding);
+            return nullptr;
+        }
+        return shared_ptr< RaspiOverlaySurface >( new RaspiOverlaySurface(overlay, mode, encoding) );
+    }
+
+    RaspiOverlaySurface::RaspiOverlaySurface(shared_ptr< RaspiOverlayRenderer > overlay_, RASPIOVERLAYSURFACE_MODE_T mode, uint32_t encoding) :
+        overlay(overlay_), mode_(mode), encoding_(encoding), changed(true) {
+        RASPIOVERLAYRENDERER_FORMAT_S format = overlay->get_format();
+        width = format.width;
+        height = format.height;
+        out_bpp = overlay_bytes_per_pixel(encoding);
+        out_stride = overlay_stride(encoding, width);
+        bpp = mode == RASPIOVERLAYSURFACE_PALETTE8 ? 1 : out_bpp;
+        stride = width * bpp;
+        canvas.assign((size_t)stride * height, 0);
+        for (unsigned int i = 0; i < 256; i++) {
+            pixel(0, palette[i]);
+        }
+        memset(&stats, 0, sizeof(stats));
+    }
+
+    uint8_t* RaspiOverlaySurface::get_canvas() {
+        return canvas.data();
+    }
+
+    uint32_t RaspiOverlaySurface::get_stride() {
+        return stride;
+    }
+
+    uint32_t RaspiOverlaySurface::get_bytes_per_pixel() {
+        return bpp;
+    }
+
+    uint32_t RaspiOverlaySurface::get_encoding() {
+        return encoding_;
+    }
+
+    uint32_t RaspiOverlaySurface::get_width() {
+        return width;
+    }
+
+    uint32_t RaspiOverlaySurface::get_height() {
+        return height;
+    }
+
+    void RaspiOverlaySurface::pixel(uint32_t colour, uint8_t *out) {
+        uint8_t a = colour >> 24, r = colour >> 16, g = colour >> 8, b = colour;
+        bool bgr = encoding_ == MMAL_ENCODING_BGR24 || encoding_ == MMAL_ENCODING_BGRA;
+        out[0] = bgr ? b : r;
+        out[1] = g;
+        out[2] = bgr ? r : b;
+        if (out_bpp == 4) {
+            out[3] = a;
+        }
+    }
+
+    static bool contains(const MMAL_RECT_T &outer, const MMAL_RECT_T &inner) {
+        return inner.x >= outer.x && inner.y >= outer.y && inner.x + inner.width <= outer.x + outer.width &&
+            inner.y + inner.height <= outer.y + outer.height;
+    }
+
+    void RaspiOverlaySurface::invalidate(MMAL_RECT_T rect) {
+        if (!overlay_clip(width, height, rect)) {
+            return;
+        }
+        changed = true;
+        for (BUFFER_S &entry : buffers) {
+            if (entry.full) {
+                continue;
+            }
+            // The same region redrawn before a buffer comes round again is copied once
+            bool covered = false;
+            for (size_t i = 0; i < entry.dirty.size() && !covered; ) {
+                if (contains(entry.dirty[i], rect)) {
+                    covered = true;
+                } else if (contains(rect, entry.dirty[i])) {
+                    entry.dirty[i] = entry.dirty.back();
+                    entry.dirty.pop_back();
+                } else {
+                    i++;
+                }
+            }
+            if (covered) {
+                continue;
+            }
+            if (entry.dirty.size() < RASPIOVERLAYSURFACE_MAX_RECTS) {
+                entry.dirty.push_back(rect);
+                continue;
+            }
+            // Too many pieces: copy their bounding box instead
+            MMAL_RECT_T box = rect;
+            for (const MMAL_RECT_T &r : entry.dirty) {
+                int32_t x1 = vcos_max(box.x + box.width, r.x + r.width);
+                int32_t y1 = vcos_max(box.y + box.height, r.y + r.height);
+                box.x = vcos_min(box.x, r.x);
+                box.y = vcos_min(box.y, r.y);
+                box.width = x1 - box.x;
+                box.height = y1 - box.y;
+            }
+            entry.dirty.assign(1, box);
+        }
+    }
+
+    void RaspiOverlaySurface::mark_all() {
+        changed = true;
+        for (BUFFER_S &entry : buffers) {
+            entry.full = true;
+            entry.dirty.clear();
+        }
+    }
+
+    void RaspiOverlaySurface::fill(MMAL_RECT_T rect, uint32_t colour) {
+        if (!overlay_clip(width, height, rect)) {
+            return;
+        }
+        uint8_t value[4];
+        if (mode_ == RASPIOVERLAYSURFACE_PALETTE8) {
+            value[0] = (uint8_t)colour;
+        } else {
+            pixel(colour, value);
+        }
+        uint8_t *row = canvas.data() + (size_t)rect.y * stride + (size_t)rect.x * bpp;
+        for (int32_t y = 0; y < rect.height; y++, row += stride) {
+            if (bpp == 1) {
+                memset(row, value[0], rect.width);
+            } else {
+                uint8_t *p = row;
+                for (int32_t x = 0; x < rect.width; x++, p += bpp) {
+                    memcpy(p, value, bpp);
+                }
+            }
+        }
+        invalidate(rect);
+    }
+
+    void RaspiOverlaySurface::set_palette(uint8_t index, uint32_t colour) {
+        uint8_t value[4] = { 0, 0, 0, 0 };
+        pixel(colour, value);
+        if (memcmp(value, palette[index], out_bpp)) {
+            memcpy(palette[index], value, sizeof(value));
+            if (mode_ == RASPIOVERLAYSURFACE_PALETTE8) {
+                mark_all();
+            }
+        }
+    }
+
+    void RaspiOverlaySurface::copy(MMAL_BUFFER_HEADER_T *buffer, const MMAL_RECT_T &rect) {
+        const uint8_t *in = canvas.data() + (size_t)rect.y * stride + (size_t)rect.x * bpp;
+        uint8_t *out = buffer->data + (size_t)rect.y * out_stride + (size_t)rect.x * out_bpp;
+        for (int32_t y = 0; y < rect.height; y++, in += stride, out += out_stride) {
+            if (mode_ == RASPIOVERLAYSURFACE_DIRECT) {
+                memcpy(out, in, (size_t)rect.width * bpp);
+            } else if (out_bpp == 4) {
+                for (int32_t x = 0; x < rect.width; x++) {
+                    memcpy(out + 4 * x, palette[in[x]], 4);
+                }
+            } else {
+                for (int32_t x = 0; x < rect.width; x++) {
+                    memcpy(out + 3 * x, palette[in[x]], 3);
+                }
+            }
+        }
+        stats.rects++;
+        stats.bytes += (uint64_t)rect.width * rect.height * out_bpp;
+    }
+
+    MMAL_STATUS_T RaspiOverlaySurface::update(bool force) {
+        if (!changed && !force) {
+            return MMAL_SUCCESS;
+        }
+        MMAL_BUFFER_HEADER_T *buffer = overlay->get_buffer();
+        if (!buffer) {
+            vcos_log_error("RaspiOverlaySurface::update(): no buffer available");
+            return MMAL_EAGAIN;
+        }
+
+        BUFFER_S *entry = NULL;
+        for (BUFFER_S &known : buffers) {
+            if (known.buffer == buffer) {
+                entry = &known;
+            }
+        }
+        if (!entry) {
+            BUFFER_S added = { buffer, vector< MMAL_RECT_T >(), true };
+            buffers.push_back(added);
+            entry = &buffers.back();
+        }
+
+        if (entry->full) {
+            // Also clears the alignment padding, which the renderer may show
+            memset(buffer->data, 0, buffer->alloc_size);
+            MMAL_RECT_T all = { 0, 0, (int32_t)width, (int32_t)height };
+            copy(buffer, all);
+            stats.full_copies++;
+        } else {
+            for (const MMAL_RECT_T &rect : entry->dirty) {
+                copy(buffer, rect);
+            }
+        }
+        entry->dirty.clear();
+        entry->full = false;
+
+        changed = false;
+        stats.updates++;
+        MMAL_STATUS_T status = overlay->send_buffer(buffer);
+        if (status != MMAL_SUCCESS) {
+            vcos_log_error("RaspiOverlaySurface::update(): unable to send buffer (%u)", status);
+            // The buffer may not come back, so it has to be filled from scratch if it does
+            entry->full = true;
+        }
+        return status;
+    }
+
+    RASPIOVERLAYSURFACE_STATS_S RaspiOverlaySurface::get_stats() {
+        return stats;
+    }
+
+}
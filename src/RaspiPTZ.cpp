@@ -0,0 +1,182 @@
+#include "raspivid/RaspiPTZ.h"
+
+namespace raspivid {
+
+    static int32_t to_16p16(double value) {
+        return (int32_t)(value * RASPIPTZ_ONE + 0.5);
+    }
+
+    static int32_t clamp(int32_t value, int32_t low, int32_t high) {
+        return value < low ? low : (value > high ? high : value);
+    }
+
+    static MMAL_RECT_T clamp_rect(MMAL_RECT_T rect) {
+        rect.width = clamp(rect.width, 1, RASPIPTZ_ONE);
+        rect.height = clamp(rect.height, 1, RASPIPTZ_ONE);
+        rect.x = clamp(rect.x, 0, RASPIPTZ_ONE - rect.width);
+        rect.y = clamp(rect.y, 0, RASPIPTZ_ONE - rect.height);
+        return rect;
+    }
+
+    static bool same_rect(const MMAL_RECT_T &a, const MMAL_RECT_T &b) {
+        return a.x == b.x && a.y == b.y && a.width == b.width && a.height == b.height;
+    }
+
+    static int32_t ease(int32_t t, RASPIPTZ_EASING_T easing) {
+        int64_t t64 = t;
+        switch (easing) {
+            case RASPIPTZ_EASE_IN:
+                return (int32_t)((t64 * t64) >> 16);
+            case RASPIPTZ_EASE_OUT: {
+                int64_t rest = RASPIPTZ_ONE - t64;
+                return (int32_t)(RASPIPTZ_ONE - ((rest * rest) >> 16));
+            }
+            case RASPIPTZ_EASE_IN_OUT:
+                // t * t * (3 - 2t)
+                return (int32_t)((((t64 * t64) >> 16) * (3 * RASPIPTZ_ONE - 2 * t64)) >> 16);
+            default:
+                return t;
+        }
+    }
+
+    static int32_t lerp(int32_t from, int32_t to, int32_t eased) {
+        return from + (int32_t)(((int64_t)(to - from) * eased) >> 16);
+    }
+
+    static MMAL_RECT_T to_rect(const PARAM_FLOAT_RECT_T &roi) {
+        MMAL_RECT_T rect = { to_16p16(roi.x), to_16p16(roi.y), to_16p16(roi.w), to_16p16(roi.h) };
+        return rect;
+    }
+
+    shared_ptr< RaspiPTZ > RaspiPTZ::create(shared_ptr< RaspiCameraControl > control, PARAM_FLOAT_RECT_T initial) {
+        shared_ptr< RaspiPTZ > ptz( new RaspiPTZ(control, initial) );
+        weak_ptr< RaspiPTZ > listener = ptz;
+        control->set_roi_listener([listener](const PARAM_FLOAT_RECT_T &roi) {
+            shared_ptr< RaspiPTZ > ptz = listener.lock();
+            if (ptz) {
+                ptz->roi_applied(roi);
+            }
+        });
+        return ptz;
+    }
+
+    RaspiPTZ::RaspiPTZ(shared_ptr< RaspiCameraControl > control_, PARAM_FLOAT_RECT_T initial) : control(control_), start_us(0), duration_us(0),
+        easing_(RASPIPTZ_EASE_LINEAR), frame(false), sending(false), commands(0), replaced(0), frames(0), updates(0), busy(0), failed(0) {
+        from = to = sent = clamp_rect(to_rect(initial));
+    }
+
+    MMAL_RECT_T RaspiPTZ::interpolate(const MMAL_RECT_T &from, const MMAL_RECT_T &to, int32_t progress, RASPIPTZ_EASING_T easing) {
+        int32_t eased = ease(clamp(progress, 0, RASPIPTZ_ONE), easing);
+        MMAL_RECT_T result = {
+            lerp(from.x, to.x, eased),
+            lerp(from.y, to.y, eased),
+            lerp(from.width, to.width, eased),
+            lerp(from.height, to.height, eased)
+        };
+        return result;
+    }
+
+    MMAL_RECT_T RaspiPTZ::position(int64_t now_us) {
+        int64_t elapsed = now_us - start_us;
+        if (elapsed >= duration_us) {
+            return to;
+        }
+        return interpolate(from, to, (int32_t)((elapsed << 16) / duration_us), easing_);
+    }
+
+    void RaspiPTZ::move_to(PARAM_FLOAT_RECT_T roi, uint32_t duration_ms, RASPIPTZ_EASING_T easing) {
+        move_to(to_rect(roi), duration_ms, easing);
+    }
+
+    void RaspiPTZ::move_to(MMAL_RECT_T roi, uint32_t duration_ms, RASPIPTZ_EASING_T easing) {
+        std::lock_guard< std::mutex > guard(lock);
+        int64_t now = RaspiPortMetrics::now_us();
+        if (now - start_us < duration_us) {
+            replaced++;
+        }
+        from = position(now);
+        to = clamp_rect(roi);
+        start_us = now;
+        duration_us = (int64_t)duration_ms * 1000;
+        easing_ = easing;
+        commands++;
+    }
+
+    void RaspiPTZ::roi_applied(const PARAM_FLOAT_RECT_T &roi) {
+        std::lock_guard< std::mutex > guard(lock);
+        int64_t now = RaspiPortMetrics::now_us();
+        if (now - start_us < duration_us) {
+            replaced++;
+        }
+        // As raspicamcontrol_set_ROI converts it, so the crop the camera has compares equal
+        MMAL_RECT_T applied = { (int32_t)(RASPIPTZ_ONE * roi.x), (int32_t)(RASPIPTZ_ONE * roi.y), (int32_t)(RASPIPTZ_ONE * roi.w),
+            (int32_t)(RASPIPTZ_ONE * roi.h) };
+        sent = applied;
+        from = to = clamp_rect(applied);
+        start_us = now;
+        duration_us = 0;
+    }
+
+    MMAL_RECT_T RaspiPTZ::get_position() {
+        std::lock_guard< std::mutex > guard(lock);
+        return position(RaspiPortMetrics::now_us());
+    }
+
+    bool RaspiPTZ::is_moving() {
+        std::lock_guard< std::mutex > guard(lock);
+        int64_t now = RaspiPortMetrics::now_us();
+        return now - start_us < duration_us || !same_rect(position(now), sent);
+    }
+
+    void RaspiPTZ::callback(MMAL_PORT_T *port, MMAL_BUFFER_HEADER_T *buffer) {
+        if (buffer->length) {
+            frame.store(true);
+        }
+    }
+
+    void RaspiPTZ::post_process() {
+        if (!frame.exchange(false)) {
+            return;
+        }
+        frames++;
+        if (sending.exchange(true)) {
+            busy++;
+            return;
+        }
+        MMAL_RECT_T next;
+        {
+            std::lock_guard< std::mutex > guard(lock);
+            next = position(RaspiPortMetrics::now_us());
+            if (same_rect(next, sent)) {
+                sending.store(false);
+                return;
+            }
+        }
+
+        int64_t start = RaspiPortMetrics::now_us();
+        MMAL_STATUS_T status = control->set_crop(next);
+        update_duration.record(RaspiPortMetrics::now_us() - start);
+        if (status == MMAL_SUCCESS) {
+            std::lock_guard< std::mutex > guard(lock);
+            sent = next;
+            updates++;
+        } else {
+            failed++;
+            vcos_log_error("RaspiPTZ::post_process(): unable to set the crop (%u)", status);
+        }
+        sending.store(false);
+    }
+
+    RASPIPTZ_STATS_S RaspiPTZ::get_stats() {
+        RASPIPTZ_STATS_S result;
+        result.commands = commands.load();
+        result.replaced = replaced.load();
+        result.frames = frames.load();
+        result.updates = updates.load();
+        result.busy = busy.load();
+        result.failed = failed.load();
+        update_duration.read(result.update_duration);
+        return result;
+    }
+
+}
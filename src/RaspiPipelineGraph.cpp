@@ -0,0 +1,821 @@
+#include <condition_variable>
+#include <mutex>
+
+#include "raspivid/RaspiPipelineGraph.h"
+
+namespace raspivid {
+
+    // Encodings a port can be negotiated to, cheapest first. Bit i of a mask stands for ENCODINGS[i].
+    static const uint32_t ENCODINGS[] = {
+        MMAL_ENCODING_OPAQUE,
+        MMAL_ENCODING_I420,
+        MMAL_ENCODING_RGB24,
+        MMAL_ENCODING_BGR24,
+        MMAL_ENCODING_RGBA,
+        MMAL_ENCODING_BGRA,
+        MMAL_ENCODING_H264,
+        MMAL_ENCODING_MJPEG
+    };
+    static const unsigned int ENCODING_COUNT = sizeof(ENCODINGS) / sizeof(ENCODINGS[0]);
+
+    static const uint32_t MASK_OPAQUE = 1 << 0;
+    static const uint32_t MASK_I420 = 1 << 1;
+    static const uint32_t MASK_RAW = 0x3f;
+    static const uint32_t MASK_ALL = (1 << ENCODING_COUNT) - 1;
+
+    // Highest H.264 level 4.2 macroblock rate, as RaspiEncoder::init enforces
+    static const uint64_t MAX_MACROBLOCKS_PER_SECOND = 522240;
+
+    static uint32_t encoding_mask(uint32_t encoding) {
+        for (unsigned int i = 0; i < ENCODING_COUNT; i++) {
+            if (ENCODINGS[i] == encoding) {
+                return 1 << i;
+            }
+        }
+        return 0;
+    }
+
+    static unsigned int input_count(RASPIPIPELINE_NODE_T type) {
+        return type == RASPIPIPELINE_NODE_CAMERA ? 0 : 1;
+    }
+
+    static unsigned int output_count(RASPIPIPELINE_NODE_T type) {
+        switch (type) {
+            case RASPIPIPELINE_NODE_CAMERA:
+                return 3;
+            case RASPIPIPELINE_NODE_SPLITTER:
+                return 2;
+            case RASPIPIPELINE_NODE_RESIZE:
+            case RASPIPIPELINE_NODE_ENCODER:
+                return 1;
+            default:
+                return 0;
+        }
+    }
+
+    static void set_size(RASPIPORT_FORMAT_S &format, uint32_t width, uint32_t height) {
+        format.width = VCOS_ALIGN_UP(width, 32);
+        format.height = VCOS_ALIGN_UP(height, 16);
+        format.crop.x = 0;
+        format.crop.y = 0;
+        format.crop.width = width;
+        format.crop.height = height;
+    }
+
+    static bool same_format(const RASPIPORT_FORMAT_S &a, const RASPIPORT_FORMAT_S &b) {
+        return a.encoding == b.encoding && a.encoding_variant == b.encoding_variant && a.width == b.width && a.height == b.height &&
+            a.crop.x == b.crop.x && a.crop.y == b.crop.y && a.crop.width == b.crop.width && a.crop.height == b.crop.height &&
+            a.frame_rate_num == b.frame_rate_num && a.frame_rate_den == b.frame_rate_den;
+    }
+
+    shared_ptr< RaspiPipelineGraph > RaspiPipelineGraph::create() {
+        return shared_ptr< RaspiPipelineGraph >( new RaspiPipelineGraph() );
+    }
+
+    RaspiPipelineGraph::RaspiPipelineGraph() : commits(0), build_us(0), built_us(0), start_us(0), negotiated(false), built(false) {
+        last_reconfigure = RASPIPIPELINE_RECONFIGURE_S();
+    }
+
+    RaspiPipelineGraph::~RaspiPipelineGraph() {
+        destroy();
+    }
+
+    int RaspiPipelineGraph::find(const string &name) {
+        for (size_t i = 0; i < nodes.size(); i++) {
+            if (nodes[i].name == name) {
+                return (int)i;
+            }
+        }
+        return -1;
+    }
+
+    MMAL_STATUS_T RaspiPipelineGraph::add_node(NODE_S node) {
+        if (built) {
+            vcos_log_error("RaspiPipelineGraph::add_node(): cannot add %s to a built graph", node.name.c_str());
+            return MMAL_EINVAL;
+        }
+        if (node.name.empty() || find(node.name) >= 0) {
+            vcos_log_error("RaspiPipelineGraph::add_node(): node name \"%s\" is empty or already taken", node.name.c_str());
+            return MMAL_EINVAL;
+        }
+        node.source = -1;
+        node.timing.name = node.name;
+        node.masks.assign(output_count(node.type), 0);
+        node.formats.resize(output_count(node.type));
+        nodes.push_back(node);
+        negotiated = false;
+        return MMAL_SUCCESS;
+    }
+
+    MMAL_STATUS_T RaspiPipelineGraph::add_camera(const string &name, RASPICAMERA_OPTION_S options) {
+        NODE_S node = NODE_S();
+        node.name = name;
+        node.type = RASPIPIPELINE_NODE_CAMERA;
+        node.camera = options;
+        return add_node(node);
+    }
+
+    MMAL_STATUS_T RaspiPipelineGraph::add_splitter(const string &name) {
+        NODE_S node = NODE_S();
+        node.name = name;
+        node.type = RASPIPIPELINE_NODE_SPLITTER;
+        return add_node(node);
+    }
+
+    MMAL_STATUS_T RaspiPipelineGraph::add_resize(const string &name, uint32_t width, uint32_t height) {
+        NODE_S node = NODE_S();
+        node.name = name;
+        node.type = RASPIPIPELINE_NODE_RESIZE;
+        node.width = width;
+        node.height = height;
+        return add_node(node);
+    }
+
+    MMAL_STATUS_T RaspiPipelineGraph::add_encoder(const string &name, RASPIENCODER_OPTION_S options) {
+        NODE_S node = NODE_S();
+        node.name = name;
+        node.type = RASPIPIPELINE_NODE_ENCODER;
+        node.encoder = options;
+        return add_node(node);
+    }
+
+    MMAL_STATUS_T RaspiPipelineGraph::add_renderer(const string &name, int alpha, int layer) {
+        NODE_S node = NODE_S();
+        node.name = name;
+        node.type = RASPIPIPELINE_NODE_RENDERER;
+        node.alpha = alpha;
+        node.layer = layer;
+        return add_node(node);
+    }
+
+    MMAL_STATUS_T RaspiPipelineGraph::add_nullsink(const string &name) {
+        NODE_S node = NODE_S();
+        node.name = name;
+        node.type = RASPIPIPELINE_NODE_NULLSINK;
+        return add_node(node);
+    }
+
+    MMAL_STATUS_T RaspiPipelineGraph::add_application(const string &name, uint32_t encoding) {
+        NODE_S node = NODE_S();
+        node.name = name;
+        node.type = RASPIPIPELINE_NODE_APPLICATION;
+        node.encoding = encoding;
+        return add_node(node);
+    }
+
+    MMAL_STATUS_T RaspiPipelineGraph::connect(const string &from, unsigned int output, const string &to, unsigned int input) {
+        if (built) {
+            vcos_log_error("RaspiPipelineGraph::connect(): cannot connect %s to %s in a built graph", from.c_str(), to.c_str());
+            return MMAL_EINVAL;
+        }
+        int f = find(from), t = find(to);
+        if (f < 0 || t < 0 || f == t) {
+            vcos_log_error("RaspiPipelineGraph::connect(): cannot connect %s to %s", from.c_str(), to.c_str());
+            return MMAL_EINVAL;
+        }
+        if (output >= output_count(nodes[f].type) || input >= input_count(nodes[t].type)) {
+            vcos_log_error("RaspiPipelineGraph::connect(): %s has no output %u, or %s has no input %u", from.c_str(), output, to.c_str(), input);
+            return MMAL_EINVAL;
+        }
+        if (nodes[t].source >= 0) {
+            vcos_log_error("RaspiPipelineGraph::connect(): input %u of %s is already connected", input, to.c_str());
+            return MMAL_EINVAL;
+        }
+        for (const EDGE_S &edge : edges) {
+            // A tunnelled connection is one to one, whereas any number of application subscribers can share a port
+            if (edge.from == f && edge.output == output &&
+                    (nodes[t].type != RASPIPIPELINE_NODE_APPLICATION || nodes[edge.to].type != RASPIPIPELINE_NODE_APPLICATION)) {
+                vcos_log_error("RaspiPipelineGraph::connect(): %s:%u already feeds %s; use a splitter", from.c_str(), output, nodes[edge.to].name.c_str());
+                return MMAL_EINVAL;
+            }
+        }
+        EDGE_S edge;
+        edge.from = f;
+        edge.output = output;
+        edge.to = t;
+        nodes[t].source = (int)edges.size();
+        edges.push_back(edge);
+        negotiated = false;
+        return MMAL_SUCCESS;
+    }
+
+    MMAL_STATUS_T RaspiPipelineGraph::sort() {
+        order.clear();
+        for (const NODE_S &node : nodes) {
+            if (input_count(node.type) && node.source < 0) {
+                vcos_log_error("RaspiPipelineGraph::sort(): the input of %s is not connected", node.name.c_str());
+                return MMAL_EINVAL;
+            }
+        }
+
+        // Each node has at most one input, so a node is ready once the node feeding it is placed
+        vector< bool > placed(nodes.size(), false);
+        while (order.size() < nodes.size()) {
+            size_t before = order.size();
+            for (size_t i = 0; i < nodes.size(); i++) {
+                if (!placed[i] && (nodes[i].source < 0 || placed[edges[nodes[i].source].from])) {
+                    placed[i] = true;
+                    order.push_back((int)i);
+                }
+            }
+            if (order.size() == before) {
+                for (size_t i = 0; i < nodes.size(); i++) {
+                    if (!placed[i]) {
+                        vcos_log_error("RaspiPipelineGraph::sort(): %s is part of a cycle", nodes[i].name.c_str());
+                        break;
+                    }
+                }
+                return MMAL_EINVAL;
+            }
+        }
+        return MMAL_SUCCESS;
+    }
+
+    MMAL_STATUS_T RaspiPipelineGraph::narrow() {
+        // Encodings each output port may take, before looking at its neighbours
+        for (NODE_S &node : nodes) {
+            uint32_t mask = 0;
+            switch (node.type) {
+                case RASPIPIPELINE_NODE_CAMERA:
+                case RASPIPIPELINE_NODE_SPLITTER:
+                    mask = MASK_RAW;
+                    break;
+                case RASPIPIPELINE_NODE_RESIZE:
+                    mask = MASK_RAW & ~MASK_OPAQUE;
+                    break;
+                case RASPIPIPELINE_NODE_ENCODER:
+                    mask = encoding_mask(node.encoder.encoding) & ~MASK_RAW;
+                    if (!mask) {
+                        vcos_log_error("RaspiPipelineGraph::narrow(): %s must encode to MMAL_ENCODING_H264 or MMAL_ENCODING_MJPEG", node.name.c_str());
+                        return MMAL_EINVAL;
+                    }
+                    break;
+                default:
+                    break;
+            }
+            node.masks.assign(node.masks.size(), mask);
+        }
+
+        // Encodings each input port accepts
+        vector< uint32_t > accepts(nodes.size(), 0);
+        for (size_t i = 0; i < nodes.size(); i++) {
+            switch (nodes[i].type) {
+                case RASPIPIPELINE_NODE_SPLITTER:
+                    accepts[i] = MASK_RAW;
+                    break;
+                case RASPIPIPELINE_NODE_RESIZE:
+                    accepts[i] = MASK_RAW & ~MASK_OPAQUE;
+                    break;
+                case RASPIPIPELINE_NODE_ENCODER:
+                case RASPIPIPELINE_NODE_RENDERER:
+                    accepts[i] = MASK_OPAQUE | MASK_I420;
+                    break;
+                case RASPIPIPELINE_NODE_NULLSINK:
+                    accepts[i] = MASK_ALL;
+                    break;
+                case RASPIPIPELINE_NODE_APPLICATION:
+                    accepts[i] = nodes[i].encoding ? encoding_mask(nodes[i].encoding) : MASK_ALL & ~MASK_OPAQUE;
+                    if (!accepts[i]) {
+                        vcos_log_error("RaspiPipelineGraph::narrow(): %s asks for an encoding no component produces", nodes[i].name.c_str());
+                        return MMAL_EINVAL;
+                    }
+                    break;
+                default:
+                    break;
+            }
+        }
+
+        // Narrow every port to what it has in common with its neighbours: both ends of an edge, and the input and outputs of a
+        // splitter, share one format. Masks only lose bits, so this settles.
+        auto settle = [this, &accepts]() -> MMAL_STATUS_T {
+            bool changed = true;
+            while (changed) {
+                changed = false;
+                for (const EDGE_S &edge : edges) {
+                    uint32_t &mask = nodes[edge.from].masks[edge.output];
+                    uint32_t narrowed = mask & accepts[edge.to];
+                    if (nodes[edge.to].type == RASPIPIPELINE_NODE_SPLITTER) {
+                        for (uint32_t output : nodes[edge.to].masks) {
+                            narrowed &= output;
+                        }
+                        for (uint32_t &output : nodes[edge.to].masks) {
+                            changed = changed || output != narrowed;
+                            output = narrowed;
+                        }
+                    }
+                    if (!narrowed) {
+                        vcos_log_error("RaspiPipelineGraph::narrow(): no encoding suits both %s:%u and %s", nodes[edge.from].name.c_str(),
+                            edge.output, nodes[edge.to].name.c_str());
+                        return MMAL_EINVAL;
+                    }
+                    if (narrowed != mask) {
+                        mask = narrowed;
+                        changed = true;
+                    }
+                }
+            }
+            return MMAL_SUCCESS;
+        };
+
+        MMAL_STATUS_T status;
+        if ((status = settle()) != MMAL_SUCCESS) {
+            return status;
+        }
+        // Settle the remaining choices upstream first, taking the cheapest encoding each time
+        for (int index : order) {
+            for (uint32_t &mask : nodes[index].masks) {
+                if (mask & (mask - 1)) {
+                    mask &= -mask;
+                    if ((status = settle()) != MMAL_SUCCESS) {
+                        return status;
+                    }
+                }
+            }
+        }
+        return MMAL_SUCCESS;
+    }
+
+    MMAL_STATUS_T RaspiPipelineGraph::size_formats() {
+        for (int index : order) {
+            NODE_S &node = nodes[index];
+            RASPIPORT_FORMAT_S input = RASPIPORT_FORMAT_S();
+            if (node.source >= 0) {
+                const EDGE_S &edge = edges[node.source];
+                input = nodes[edge.from].formats[edge.output];
+            }
+
+            for (size_t i = 0; i < node.formats.size(); i++) {
+                RASPIPORT_FORMAT_S &format = node.formats[i];
+                format = input;
+                switch (node.type) {
+                    case RASPIPIPELINE_NODE_CAMERA:
+                        set_size(format, node.camera.width, node.camera.height);
+                        if (i == MMAL_CAMERA_VIDEO_PORT) {
+                            format.frame_rate_num = node.camera.framerate;
+                            format.frame_rate_den = VIDEO_FRAME_RATE_DEN;
+                        } else {
+                            format.frame_rate_num = PREVIEW_FRAME_RATE_NUM;
+                            format.frame_rate_den = PREVIEW_FRAME_RATE_DEN;
+                        }
+                        break;
+                    case RASPIPIPELINE_NODE_RESIZE:
+                        set_size(format, node.width, node.height);
+                        break;
+                    default:
+                        break;
+                }
+                unsigned int bit = 0;
+                while (!(node.masks[i] & (1 << bit))) {
+                    bit++;
+                }
+                format.encoding = ENCODINGS[bit];
+                format.encoding_variant = (format.encoding == MMAL_ENCODING_OPAQUE || format.encoding == MMAL_ENCODING_I420) ? MMAL_ENCODING_I420 : 0;
+                if (!format.crop.width || !format.crop.height) {
+                    vcos_log_error("RaspiPipelineGraph::size_formats(): %s:%u would have no pixels", node.name.c_str(), (unsigned int)i);
+                    return MMAL_EINVAL;
+                }
+            }
+
+            if (node.type == RASPIPIPELINE_NODE_ENCODER) {
+                node.encoder.width = input.crop.width;
+                node.encoder.height = input.crop.height;
+                if (input.frame_rate_num && input.frame_rate_den) {
+                    node.encoder.framerate = input.frame_rate_num / input.frame_rate_den;
+                }
+                uint64_t macroblocks = (uint64_t)(VCOS_ALIGN_UP(node.encoder.width, 16) >> 4) * (VCOS_ALIGN_UP(node.encoder.height, 16) >> 4);
+                if (node.encoder.encoding == MMAL_ENCODING_H264 && macroblocks * node.encoder.framerate > MAX_MACROBLOCKS_PER_SECOND) {
+                    vcos_log_error("RaspiPipelineGraph::size_formats(): %ux%u at %u fps is too much for %s", node.encoder.width,
+                        node.encoder.height, node.encoder.framerate, node.name.c_str());
+                    return MMAL_EINVAL;
+                }
+            }
+        }
+        return MMAL_SUCCESS;
+    }
+
+    MMAL_STATUS_T RaspiPipelineGraph::negotiate() {
+        MMAL_STATUS_T status;
+        negotiated = false;
+        if ((status = sort()) != MMAL_SUCCESS || (status = narrow()) != MMAL_SUCCESS || (status = size_formats()) != MMAL_SUCCESS) {
+            return status;
+        }
+        negotiated = true;
+
+        for (const EDGE_S &edge : edges) {
+            const RASPIPORT_FORMAT_S &format = nodes[edge.from].formats[edge.output];
+            vcos_log_error("RaspiPipelineGraph::negotiate(): %s:%u -> %s: %4.4s %ux%u", nodes[edge.from].name.c_str(), edge.output,
+                nodes[edge.to].name.c_str(), (const char *)&format.encoding, format.crop.width, format.crop.height);
+        }
+        return MMAL_SUCCESS;
+    }
+
+    MMAL_STATUS_T RaspiPipelineGraph::commit_outputs(NODE_S &node) {
+        MMAL_STATUS_T status = MMAL_SUCCESS;
+        node.timing.commit.start_us = RaspiPortMetrics::now_us();
+        for (size_t i = 0; i < node.outputs.size() && status == MMAL_SUCCESS; i++) {
+            if (same_format(node.outputs[i]->get_format(), node.formats[i])) {
+                continue;
+            }
+            if ((status = node.outputs[i]->set_format(node.formats[i])) != MMAL_SUCCESS) {
+                vcos_log_error("RaspiPipelineGraph::commit_outputs(): unable to set the format of %s:%u", node.name.c_str(), (unsigned int)i);
+            }
+            commits++;
+        }
+        node.timing.commit.end_us = RaspiPortMetrics::now_us();
+        return status;
+    }
+
+    MMAL_STATUS_T RaspiPipelineGraph::create_component(NODE_S &node) {
+        if (node.type == RASPIPIPELINE_NODE_APPLICATION) {
+            return MMAL_SUCCESS;
+        }
+        node.timing.create.start_us = RaspiPortMetrics::now_us();
+        switch (node.type) {
+            case RASPIPIPELINE_NODE_CAMERA: {
+                shared_ptr< RaspiCamera > camera = RaspiCamera::create(node.camera);
+                if (camera) {
+                    node.component = camera;
+                    node.outputs = { camera->preview, camera->video, camera->still };
+                }
+                break;
+            }
+            case RASPIPIPELINE_NODE_SPLITTER: {
+                shared_ptr< RaspiSplitter > splitter = RaspiSplitter::create();
+                if (splitter) {
+                    node.component = splitter;
+                    node.input = splitter->input;
+                    node.outputs = { splitter->output_0, splitter->output_1 };
+                }
+                break;
+            }
+            case RASPIPIPELINE_NODE_RESIZE: {
+                shared_ptr< RaspiResize > resize = RaspiResize::create(node.width, node.height);
+                if (resize) {
+                    node.component = resize;
+                    node.input = resize->input;
+                    node.outputs = { resize->output };
+                }
+                break;
+            }
+            case RASPIPIPELINE_NODE_ENCODER: {
+                shared_ptr< RaspiEncoder > encoder = RaspiEncoder::create(node.encoder);
+                if (encoder) {
+                    node.component = encoder;
+                    node.input = encoder->input;
+                    node.outputs = { encoder->output };
+                }
+                break;
+            }
+            case RASPIPIPELINE_NODE_RENDERER: {
+                shared_ptr< RaspiRenderer > renderer = RaspiRenderer::create(node.alpha, node.layer);
+                if (renderer) {
+                    node.component = renderer;
+                    node.input = renderer->input;
+                }
+                break;
+            }
+            case RASPIPIPELINE_NODE_NULLSINK: {
+                shared_ptr< RaspiNullsink > nullsink = RaspiNullsink::create();
+                if (nullsink) {
+                    node.component = nullsink;
+                    node.input = nullsink->input;
+                }
+                break;
+            }
+            default:
+                break;
+        }
+        node.timing.create.end_us = RaspiPortMetrics::now_us();
+        if (!node.component) {
+            vcos_log_error("RaspiPipelineGraph::create_component(): unable to create %s", node.name.c_str());
+            return MMAL_ENOSYS;
+        }
+        RASPICOMPONENT_TIMING_S timing = node.component->get_timing();
+        node.timing.enable.start_us = timing.enable_us;
+        node.timing.enable.end_us = timing.enabled_us;
+
+        // Without an input, nothing else decides the output formats
+        if (node.source < 0) {
+            return commit_outputs(node);
+        }
+        return MMAL_SUCCESS;
+    }
+
+    MMAL_STATUS_T RaspiPipelineGraph::connect_node(NODE_S &node) {
+        if (!node.input) {
+            return MMAL_SUCCESS;
+        }
+        MMAL_STATUS_T status;
+        const EDGE_S &edge = edges[node.source];
+        node.timing.connect.start_us = RaspiPortMetrics::now_us();
+        status = node.input->connect(nodes[edge.from].outputs[edge.output]);
+        node.timing.connect.end_us = RaspiPortMetrics::now_us();
+        if (status != MMAL_SUCCESS) {
+            vcos_log_error("RaspiPipelineGraph::connect_node(): unable to connect %s:%u to %s", nodes[edge.from].name.c_str(), edge.output,
+                node.name.c_str());
+            return status;
+        }
+        // The encoder sets up its own compressed output format
+        if (node.type != RASPIPIPELINE_NODE_ENCODER) {
+            return commit_outputs(node);
+        }
+        return MMAL_SUCCESS;
+    }
+
+    MMAL_STATUS_T RaspiPipelineGraph::build(shared_ptr< RaspiExecutor > executor) {
+        if (built) {
+            vcos_log_error("RaspiPipelineGraph::build(): already built");
+            return MMAL_EINVAL;
+        }
+        build_us = RaspiPortMetrics::now_us();
+        built_us = 0;
+        start_us = 0;
+        commits = 0;
+        for (NODE_S &node : nodes) {
+            string name = node.name;
+            node.timing = RASPIPIPELINE_TIMING_S();
+            node.timing.name = name;
+        }
+
+        MMAL_STATUS_T status;
+        if ((status = negotiate()) != MMAL_SUCCESS) {
+            return status;
+        }
+
+        if (executor) {
+            // Each task only touches its own node, and connections are made once all of them are done
+            std::mutex lock;
+            std::condition_variable done;
+            size_t pending = order.size();
+            for (int index : order) {
+                function< void() > task = [this, index, &lock, &done, &pending, &status]() {
+                    MMAL_STATUS_T result = create_component(nodes[index]);
+                    std::lock_guard< std::mutex > guard(lock);
+                    if (result != MMAL_SUCCESS && status == MMAL_SUCCESS) {
+                        status = result;
+                    }
+                    if (--pending == 0) {
+                        done.notify_all();
+                    }
+                };
+                if (!executor->execute(task)) {
+                    task();
+                }
+            }
+            std::unique_lock< std::mutex > guard(lock);
+            done.wait(guard, [&pending]() { return pending == 0; });
+        }
+
+        for (size_t i = 0; i < order.size() && status == MMAL_SUCCESS; i++) {
+            NODE_S &node = nodes[order[i]];
+            if (!executor) {
+                status = create_component(node);
+            }
+            if (status == MMAL_SUCCESS) {
+                status = connect_node(node);
+            }
+        }
+        if (status != MMAL_SUCCESS) {
+            destroy();
+            return status;
+        }
+        built = true;
+        built_us = RaspiPortMetrics::now_us();
+        vcos_log_error("RaspiPipelineGraph::build(): success with %u format commits in %lld us!", commits.load(), (long long)(built_us - build_us));
+        return MMAL_SUCCESS;
+    }
+
+    MMAL_STATUS_T RaspiPipelineGraph::start() {
+        if (!built) {
+            vcos_log_error("RaspiPipelineGraph::start(): graph is not built");
+            return MMAL_EINVAL;
+        }
+        MMAL_STATUS_T status;
+        start_us = RaspiPortMetrics::now_us();
+        for (int index : order) {
+            if (nodes[index].type == RASPIPIPELINE_NODE_CAMERA &&
+                    (status = static_pointer_cast< RaspiCamera >(nodes[index].component)->start()) != MMAL_SUCCESS) {
+                vcos_log_error("RaspiPipelineGraph::start(): unable to start %s", nodes[index].name.c_str());
+                return status;
+            }
+        }
+        return MMAL_SUCCESS;
+    }
+
+    vector< shared_ptr< RaspiPort > > RaspiPipelineGraph::consumers(int index, unsigned int output) {
+        // A component is stopped through the connection into its input. Application endpoints share the output port itself.
+        vector< shared_ptr< RaspiPort > > result;
+        bool endpoint = false;
+        for (const EDGE_S &edge : edges) {
+            if (edge.from != index || edge.output != output) {
+                continue;
+            }
+            if (nodes[edge.to].type != RASPIPIPELINE_NODE_APPLICATION) {
+                result.push_back(nodes[edge.to].input);
+            } else if (!endpoint) {
+                result.push_back(nodes[index].outputs[output]);
+                endpoint = true;
+            }
+        }
+        return result;
+    }
+
+    MMAL_STATUS_T RaspiPipelineGraph::reconfigure(const string &name, uint32_t width, uint32_t height, uint32_t framerate) {
+        int index = find(name);
+        if (!built || index < 0 || (nodes[index].type != RASPIPIPELINE_NODE_CAMERA && nodes[index].type != RASPIPIPELINE_NODE_RESIZE)) {
+            vcos_log_error("RaspiPipelineGraph::reconfigure(): %s is not a camera or resizer of a built graph", name.c_str());
+            return MMAL_EINVAL;
+        }
+        RASPIPIPELINE_RECONFIGURE_S report = RASPIPIPELINE_RECONFIGURE_S();
+        report.start_us = RaspiPortMetrics::now_us();
+
+        // Negotiate the new sizes first, so that a switch the graph cannot take changes nothing
+        MMAL_STATUS_T status;
+        vector< NODE_S > previous = nodes;
+        NODE_S &node = nodes[index];
+        bool resized = false;
+        if (node.type == RASPIPIPELINE_NODE_CAMERA) {
+            resized = node.camera.width != width || node.camera.height != height;
+            node.camera.width = width;
+            node.camera.height = height;
+            node.camera.framerate = framerate;
+        } else {
+            node.width = width;
+            node.height = height;
+        }
+        if ((status = size_formats()) != MMAL_SUCCESS) {
+            nodes = previous;
+            return status;
+        }
+
+        // Only output ports whose format changes are touched, listed upstream first
+        vector< pair< int, unsigned int > > changed;
+        for (int i : order) {
+            for (unsigned int output = 0; output < nodes[i].formats.size(); output++) {
+                if (!same_format(previous[i].formats[output], nodes[i].formats[output])) {
+                    changed.push_back(make_pair(i, output));
+                }
+            }
+        }
+        report.ports = changed.size();
+
+        // Stop downstream first, so that no component is handed frames in a format it has not committed
+        vector< shared_ptr< RaspiPort > > stopped;
+        for (auto it = changed.rbegin(); it != changed.rend(); ++it) {
+            for (shared_ptr< RaspiPort > port : consumers(it->first, it->second)) {
+                if ((status = port->disable()) != MMAL_SUCCESS) {
+                    vcos_log_error("RaspiPipelineGraph::reconfigure(): unable to stop %s, keeping the previous formats", port->port_name.c_str());
+                    // Nothing has been committed yet, so whatever was stopped restarts as it was
+                    for (auto restart = stopped.rbegin(); restart != stopped.rend(); ++restart) {
+                        (*restart)->enable();
+                    }
+                    nodes = previous;
+                    return status;
+                }
+                stopped.push_back(port);
+            }
+        }
+        report.stopped = stopped.size();
+        report.stopped_us = RaspiPortMetrics::now_us();
+
+        if (resized) {
+            if ((status = static_pointer_cast< RaspiCamera >(node.component)->set_resolution(width, height, framerate)) != MMAL_SUCCESS) {
+                vcos_log_error("RaspiPipelineGraph::reconfigure(): unable to reconfigure %s for %ux%u", name.c_str(), width, height);
+                roll_back(previous, index, resized, changed, stopped);
+                return status;
+            }
+        } else if (node.type == RASPIPIPELINE_NODE_RESIZE) {
+            static_pointer_cast< RaspiResize >(node.component)->set_size(width, height);
+        }
+
+        // Restart upstream first. Each input takes over the format of the port feeding it as its connection is enabled, which
+        // is also how the encoder learns its new output format.
+        for (const pair< int, unsigned int > &output : changed) {
+            NODE_S &source = nodes[output.first];
+            if (source.type != RASPIPIPELINE_NODE_ENCODER) {
+                if ((status = source.outputs[output.second]->set_format(source.formats[output.second])) != MMAL_SUCCESS) {
+                    vcos_log_error("RaspiPipelineGraph::reconfigure(): unable to set the format of %s:%u", source.name.c_str(), output.second);
+                    roll_back(previous, index, resized, changed, stopped);
+                    return status;
+                }
+                commits++;
+            }
+            for (shared_ptr< RaspiPort > port : consumers(output.first, output.second)) {
+                if ((status = port->enable()) != MMAL_SUCCESS) {
+                    vcos_log_error("RaspiPipelineGraph::reconfigure(): unable to restart %s", port->port_name.c_str());
+                    roll_back(previous, index, resized, changed, stopped);
+                    return status;
+                }
+            }
+        }
+
+        report.end_us = RaspiPortMetrics::now_us();
+        last_reconfigure = report;
+        vcos_log_error("RaspiPipelineGraph::reconfigure(): %s switched to %ux%u in %lld us, %u ports changed, %u restarted", name.c_str(),
+            width, height, (long long)(report.end_us - report.start_us), report.ports, report.stopped);
+        return MMAL_SUCCESS;
+    }
+
+    void RaspiPipelineGraph::roll_back(const vector< NODE_S > &previous, int index, bool resized,
+            const vector< pair< int, unsigned int > > &changed, const vector< shared_ptr< RaspiPort > > &stopped) {
+        // Consumers the restart already reached are stopped again, so that every previous format can be committed
+        for (const shared_ptr< RaspiPort > &port : stopped) {
+            port->disable();
+        }
+        nodes = previous;
+        NODE_S &node = nodes[index];
+        if (resized) {
+            if (static_pointer_cast< RaspiCamera >(node.component)->set_resolution(node.camera.width, node.camera.height,
+                    node.camera.framerate) != MMAL_SUCCESS) {
+                vcos_log_error("RaspiPipelineGraph::roll_back(): unable to restore %s to %ux%u", node.name.c_str(), node.camera.width,
+                    node.camera.height);
+            }
+        } else if (node.type == RASPIPIPELINE_NODE_RESIZE) {
+            static_pointer_cast< RaspiResize >(node.component)->set_size(node.width, node.height);
+        }
+        for (const pair< int, unsigned int > &output : changed) {
+            NODE_S &source = nodes[output.first];
+            if (source.type != RASPIPIPELINE_NODE_ENCODER) {
+                if (source.outputs[output.second]->set_format(source.formats[output.second]) != MMAL_SUCCESS) {
+                    vcos_log_error("RaspiPipelineGraph::roll_back(): unable to restore the format of %s:%u", source.name.c_str(), output.second);
+                }
+                commits++;
+            }
+        }
+        for (auto restart = stopped.rbegin(); restart != stopped.rend(); ++restart) {
+            if ((*restart)->enable() != MMAL_SUCCESS) {
+                vcos_log_error("RaspiPipelineGraph::roll_back(): unable to restart %s", (*restart)->port_name.c_str());
+            }
+        }
+    }
+
+    RASPIPIPELINE_RECONFIGURE_S RaspiPipelineGraph::get_reconfigure() {
+        return last_reconfigure;
+    }
+
+    RASPIPIPELINE_STARTUP_S RaspiPipelineGraph::get_startup() {
+        RASPIPIPELINE_STARTUP_S result;
+        result.build_us = build_us;
+        result.built_us = built_us;
+        result.start_us = start_us;
+        result.first_frame_us = 0;
+        result.commits = commits;
+        bool all_frames = true;
+        for (int index : order) {
+            RASPIPIPELINE_TIMING_S timing = nodes[index].timing;
+            if (nodes[index].type == RASPIPIPELINE_NODE_APPLICATION) {
+                shared_ptr< RaspiPort > endpoint = get_endpoint(nodes[index].name);
+                timing.first_frame_us = endpoint ? endpoint->get_metrics().first_frame_us : 0;
+                all_frames = all_frames && timing.first_frame_us;
+                result.first_frame_us = vcos_max(result.first_frame_us, timing.first_frame_us);
+            }
+            result.nodes.push_back(timing);
+        }
+        if (!all_frames) {
+            result.first_frame_us = 0;
+        }
+        return result;
+    }
+
+    void RaspiPipelineGraph::destroy() {
+        // Downstream components go first, so each connection is torn down from its input side while its source still exists
+        for (auto it = order.rbegin(); it != order.rend(); ++it) {
+            NODE_S &node = nodes[*it];
+            node.input.reset();
+            node.outputs.clear();
+            node.component.reset();
+        }
+        built = false;
+    }
+
+    RASPIPORT_FORMAT_S RaspiPipelineGraph::get_format(const string &name, unsigned int output) {
+        int index = find(name);
+        if (!negotiated || index < 0 || output >= nodes[index].formats.size()) {
+            return RASPIPORT_FORMAT_S();
+        }
+        return nodes[index].formats[output];
+    }
+
+    shared_ptr< RaspiComponent > RaspiPipelineGraph::get_component(const string &name) {
+        int index = find(name);
+        return index >= 0 ? nodes[index].component : nullptr;
+    }
+
+    shared_ptr< RaspiPort > RaspiPipelineGraph::get_output(const string &name, unsigned int output) {
+        int index = find(name);
+        if (index < 0 || output >= nodes[index].outputs.size()) {
+            return nullptr;
+        }
+        return nodes[index].outputs[output];
+    }
+
+    shared_ptr< RaspiPort > RaspiPipelineGraph::get_endpoint(const string &name) {
+        int index = find(name);
+        if (!built || index < 0 || nodes[index].type != RASPIPIPELINE_NODE_APPLICATION || nodes[index].source < 0) {
+            return nullptr;
+        }
+        const EDGE_S &edge = edges[nodes[index].source];
+        return nodes[edge.from].outputs[edge.output];
+    }
+
+}
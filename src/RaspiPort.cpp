@@ -1,3 +1,8 @@
+#include <chrono>
+#include <math.h>
+#include <string.h>
+#include <thread>
+
 #include "raspivid/RaspiPort.h"
 
 namespace raspivid {
@@ -7,6 +12,15 @@ namespace raspivid {
     }
 
     void RaspiPort::destroy() {
+        shared_ptr< const vector< RASPIPORT_SUBSCRIBER_S > > subscribers = std::atomic_load(&userdata.subscribers);
+        if (subscribers) {
+            // Wake the callback thread if it is blocked on a full queue, so the port can be disabled
+            for (const RASPIPORT_SUBSCRIBER_S &subscriber : *subscribers) {
+                if (subscriber.queue) {
+                    subscriber.queue->close();
+                }
+            }
+        }
         if (connection) {
             mmal_connection_destroy(connection);
             connection = NULL;
@@ -14,18 +28,34 @@ namespace raspivid {
             if (port && port->is_enabled) {
                 mmal_port_disable(port);
             }
+            if (subscribers) {
+                for (const RASPIPORT_SUBSCRIBER_S &subscriber : *subscribers) {
+                    MMAL_BUFFER_HEADER_T *buffer;
+                    while (subscriber.queue && (buffer = subscriber.queue->pop()) != NULL) {
+                        mmal_buffer_header_release(buffer);
+                    }
+                }
+            }
             if (pool) {
+                metrics.set_pool(NULL);
                 mmal_port_pool_destroy(port, pool);
                 pool = NULL;
             }
         }
+        port = NULL;
     }
 
     shared_ptr< RaspiPort > RaspiPort::create(MMAL_PORT_T *mmal_port, string port_name_) {
         return shared_ptr< RaspiPort >( new RaspiPort(mmal_port, port_name_ ) );
     }
 
-    RaspiPort::RaspiPort(MMAL_PORT_T *mmal_port, string port_name_) : port(mmal_port), port_name(port_name_), pool(NULL) {
+    RaspiPort::RaspiPort(MMAL_PORT_T *mmal_port, string port_name_) : port(mmal_port), port_name(port_name_), pool(NULL), connection(NULL) {
+        userdata.pool = NULL;
+        userdata.metrics = &metrics;
+        pool_policy = createDefaultPoolPolicy();
+        memset(&adapted_hold_time, 0, sizeof(adapted_hold_time));
+        adapted_starved = 0;
+        spare_rounds = 0;
         set_zero_copy();
     }
 
@@ -120,23 +150,81 @@ namespace raspivid {
         return connect(output_port->port, &connection);
     }
 
+    MMAL_BOOL_T RaspiPort::pool_callback(MMAL_POOL_T *pool, MMAL_BUFFER_HEADER_T *buffer, void *userdata) {
+        // Called once the last reference to a buffer has been released. Hand the buffer straight back to the
+        // port so frames pinned by a RaspiFrameRef only hold up the port while they are referenced.
+        RaspiPort *raspi_port = (RaspiPort *)userdata;
+        MMAL_PORT_T *port = raspi_port->port;
+        raspi_port->metrics.buffer_returned(buffer, RaspiPortMetrics::now_us());
+        if (port && port->is_enabled) {
+            // Counted before sending, since the port may return the buffer before mmal_port_send_buffer does
+            raspi_port->metrics.buffer_sent();
+            if (mmal_port_send_buffer(port, buffer) == MMAL_SUCCESS) {
+                return MMAL_FALSE;
+            }
+            raspi_port->metrics.buffer_send_failed();
+            vcos_log_error("RaspiPort::pool_callback(): unable to return a buffer");
+        }
+        return MMAL_TRUE;
+    }
+
     void RaspiPort::callback_wrapper(MMAL_PORT_T *port, MMAL_BUFFER_HEADER_T *buffer) {
         RASPIPORT_USERDATA_S *userdata = (RASPIPORT_USERDATA_S *)port->userdata;
         vcos_assert(userdata);
+        int64_t received_us = RaspiPortMetrics::now_us();
+        userdata->metrics->buffer_received(port, buffer, received_us);
+        shared_ptr< const vector< RASPIPORT_SUBSCRIBER_S > > subscribers = std::atomic_load(&userdata->subscribers);
+        if (!subscribers) {
+            mmal_buffer_header_release(buffer);
+            return;
+        }
+
         mmal_buffer_header_mem_lock(buffer);
-        userdata->cb_instance->callback(port, buffer);
+        for (const RASPIPORT_SUBSCRIBER_S &subscriber : *subscribers) {
+            if (subscriber.callback) {
+                subscriber.callback->callback(port, buffer);
+            } else if (port->is_enabled) {
+                // Buffers flushed while the port is being disabled carry no frame, so they are not queued
+                mmal_buffer_header_acquire(buffer);
+                MMAL_BUFFER_HEADER_T *dropped = subscriber.queue->push(buffer);
+                if (dropped) {
+                    mmal_buffer_header_release(dropped);
+                }
+            }
+        }
         mmal_buffer_header_mem_unlock(buffer);
-        MMAL_POOL_T *pool = userdata->pool;
         mmal_buffer_header_release(buffer);
-        if (pool && port->is_enabled) {
-            MMAL_BUFFER_HEADER_T *new_buffer = mmal_queue_get(pool->queue);
-            if (new_buffer) {
-                if (mmal_port_send_buffer(port, new_buffer) != MMAL_SUCCESS) {
-                    vcos_log_error("RaspiPort::callback_wrapper(): unable to return a buffer");
-                }
+
+        shared_ptr< RaspiExecutor > executor = std::atomic_load(&userdata->executor);
+        for (const RASPIPORT_SUBSCRIBER_S &subscriber : *subscribers) {
+            if (!subscriber.callback) {
+                continue;
+            }
+            if (executor) {
+                shared_ptr< RaspiCallback > callback = subscriber.callback;
+                executor->execute([callback]() { callback->post_process(); });
+            } else {
+                subscriber.callback->post_process();
             }
         }
-        userdata->cb_instance->post_process();
+        userdata->metrics->callback_done(received_us);
+    }
+
+    void RaspiPort::set_executor(shared_ptr< RaspiExecutor > executor) {
+        std::atomic_store(&userdata.executor, executor);
+    }
+
+    RASPIPORT_METRICS_S RaspiPort::get_metrics() {
+        return metrics.snapshot();
+    }
+
+    void RaspiPort::reset_metrics() {
+        metrics.reset();
+    }
+
+    void RaspiPort::release_buffer(MMAL_BUFFER_HEADER_T *buffer) {
+        vcos_assert(buffer);
+        mmal_buffer_header_release(buffer);
     }
 
     MMAL_BUFFER_HEADER_T* RaspiPort::get_buffer() {
@@ -152,56 +240,340 @@ namespace raspivid {
     MMAL_STATUS_T RaspiPort::create_buffer_pool() {
         vcos_assert(port);
         if (!pool) {
-            //port->buffer_num = port->buffer_num_recommended;
-            //port->buffer_size = port->buffer_size_recommended;
-            /*
-            if (port->buffer_num < 3) {
-                port->buffer_num = 3;
-            }
-            */
             vcos_log_error("RaspiPort::create_buffer_pool(): creating %d buffers of size %d for port %s", port->buffer_num, port->buffer_size, port_name.c_str());
             pool = mmal_port_pool_create(port, port->buffer_num, port->buffer_size);
             if (!pool) {
                 vcos_log_error("RaspiPort::create_buffer_pool(): unable to create buffer pool");
                 return MMAL_ENOSYS;
             }
+            metrics.set_pool(pool);
         } else {
             vcos_log_error("RaspiPort::create_buffer_pool(): buffer pool already created for port");
         }
         return MMAL_SUCCESS;
     }
 
-    MMAL_STATUS_T RaspiPort::add_callback(shared_ptr< RaspiCallback > cb_instance) {
+    MMAL_STATUS_T RaspiPort::enable_with_pool(MMAL_PORT_BH_CB_T cb) {
         port->userdata = (struct MMAL_PORT_USERDATA_T *)&userdata;
-        
-        userdata.cb_instance = cb_instance;
+
+        // buffer_num can only change while the port is disabled. The pool policy only bounds RaspiPort::adapt_pool
+        if (port->buffer_num < port->buffer_num_min) {
+            port->buffer_num = port->buffer_num_min;
+        }
 
         MMAL_STATUS_T status;
 
-        if ((status = mmal_port_enable(port, callback_wrapper)) != MMAL_SUCCESS) {
-            vcos_log_error("RaspiPort::add_callback(): unable to setup callback on port");
+        if ((status = mmal_port_enable(port, cb)) != MMAL_SUCCESS) {
+            vcos_log_error("RaspiPort::enable_with_pool(): unable to setup callback on port");
             return status;
         }
 
         
         if ((status = create_buffer_pool()) != MMAL_SUCCESS) {
-            vcos_log_error("RaspiPort::add_callback(): unable to allocate buffers for callback");
+            vcos_log_error("RaspiPort::enable_with_pool(): unable to allocate buffers for callback");
             return status;
         }
        
         userdata.pool = pool;
-        int queue_length = mmal_queue_length(pool->queue);
-        for (int i = 0; i < queue_length; i++) {
-            MMAL_BUFFER_HEADER_T *buffer = mmal_queue_get(pool->queue);
-            if (!buffer) {
-                vcos_log_error("RaspiPort:add_callback(): unable to get buffer from pool");
+        mmal_pool_callback_set(pool, pool_callback, this);
+        send_pool_buffers();
+
+        return MMAL_SUCCESS;
+    }
+
+    void RaspiPort::send_pool_buffers() {
+        vector< MMAL_BUFFER_HEADER_T* > buffers;
+        MMAL_BUFFER_HEADER_T *buffer;
+        while ((buffer = mmal_queue_get(pool->queue)) != NULL) {
+            buffers.push_back(buffer);
+        }
+        // Count them all first, so the port is not seen as starved while the first buffers are already being filled
+        for (size_t i = 0; i < buffers.size(); i++) {
+            metrics.buffer_sent();
+        }
+        for (size_t i = 0; i < buffers.size(); i++) {
+            if (mmal_port_send_buffer(port, buffers[i]) != MMAL_SUCCESS) {
+                vcos_log_error("RaspiPort::send_pool_buffers(): unable to send buffer to output port");
+                metrics.buffer_send_failed();
+            }
+        }
+    }
+
+    RASPIPORT_POOL_POLICY_S RaspiPort::createDefaultPoolPolicy() {
+        RASPIPORT_POOL_POLICY_S result;
+        result.min_buffers = 2;
+        result.max_buffers = 8;
+        result.shrink_after = 10;
+        result.drain_timeout_ms = 500;
+        return result;
+    }
+
+    void RaspiPort::set_pool_policy(RASPIPORT_POOL_POLICY_S policy) {
+        pool_policy = policy;
+    }
+
+    uint32_t RaspiPort::get_buffer_num() {
+        if (pool) {
+            return pool->headers_num;
+        }
+        return port ? port->buffer_num : 0;
+    }
+
+    MMAL_STATUS_T RaspiPort::adapt_pool() {
+        if (!port || !pool) {
+            return MMAL_EINVAL;
+        }
+
+        RASPIPORT_METRICS_S snapshot = metrics.snapshot();
+        metrics.reset_peak_held();
+
+        // Only look at what happened since the previous call
+        RASPIPORT_HISTOGRAM_S hold_time = snapshot.hold_time;
+        if (hold_time.count >= adapted_hold_time.count) {
+            for (int i = 0; i < RASPIPORT_HISTOGRAM_BUCKETS; i++) {
+                hold_time.buckets[i] -= adapted_hold_time.buckets[i];
+            }
+            hold_time.count -= adapted_hold_time.count;
+        }
+        uint64_t starved = snapshot.starved >= adapted_starved ? snapshot.starved - adapted_starved : snapshot.starved;
+        adapted_hold_time = snapshot.hold_time;
+        adapted_starved = snapshot.starved;
+
+        uint32_t needed = (uint32_t)vcos_max(snapshot.peak_held, (int64_t)0);
+        if (snapshot.fps > 0 && hold_time.count) {
+            double hold_s = RaspiPortMetrics::percentile(hold_time, 99) / 1000000.0;
+            needed = vcos_max(needed, (uint32_t)ceil(snapshot.fps * hold_s));
+        }
+        needed += 1;
+
+        uint32_t current = pool->headers_num;
+        uint32_t target = current;
+        if (starved) {
+            target = vcos_max(current + 1, needed);
+            spare_rounds = 0;
+        } else if (needed < current) {
+            if (++spare_rounds >= pool_policy.shrink_after) {
+                target = current - 1;
+                spare_rounds = 0;
+            }
+        } else {
+            spare_rounds = 0;
+        }
+
+        uint32_t min_buffers = vcos_max(pool_policy.min_buffers, port->buffer_num_min);
+        target = vcos_max(target, min_buffers);
+        if (pool_policy.max_buffers >= min_buffers) {
+            target = vcos_min(target, pool_policy.max_buffers);
+        }
+        if (target == current) {
+            return MMAL_SUCCESS;
+        }
+        vcos_log_error("RaspiPort::adapt_pool(): resizing pool of %s from %u to %u buffers", port_name.c_str(), current, target);
+        return resize_pool(target);
+    }
+
+    MMAL_STATUS_T RaspiPort::resize_pool(uint32_t buffer_num) {
+        if (!port || !pool || connection) {
+            return MMAL_EINVAL;
+        }
+
+        MMAL_STATUS_T status;
+        if ((status = mmal_port_disable(port)) != MMAL_SUCCESS) {
+            vcos_log_error("RaspiPort::resize_pool(): unable to disable port %s", port_name.c_str());
+            return status;
+        }
+
+        if (!drain_pool()) {
+            vcos_log_error("RaspiPort::resize_pool(): buffers of %s still pinned, keeping %u buffers", port_name.c_str(), pool->headers_num);
+            if ((status = mmal_port_enable(port, callback_wrapper)) != MMAL_SUCCESS) {
+                vcos_log_error("RaspiPort::resize_pool(): unable to re-enable port %s", port_name.c_str());
+                return status;
+            }
+            send_pool_buffers();
+            return MMAL_EAGAIN;
+        }
+
+        metrics.set_pool(NULL);
+        mmal_port_pool_destroy(port, pool);
+        pool = NULL;
+        userdata.pool = NULL;
+        port->buffer_num = buffer_num;
+        return enable_with_pool(callback_wrapper);
+    }
+
+    bool RaspiPort::drain_pool() {
+        // Buffers pinned by consumers come back to the pool queue once released, since the pool callback only resends to an enabled port
+        int64_t deadline = RaspiPortMetrics::now_us() + (int64_t)pool_policy.drain_timeout_ms * 1000;
+        while (mmal_queue_length(pool->queue) < pool->headers_num) {
+            if (RaspiPortMetrics::now_us() > deadline) {
+                return false;
+            }
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+        return true;
+    }
+
+    MMAL_STATUS_T RaspiPort::disable() {
+        if (!port) {
+            return MMAL_EINVAL;
+        }
+
+        MMAL_STATUS_T status;
+        if (connection) {
+            if (connection->is_enabled && (status = mmal_connection_disable(connection)) != MMAL_SUCCESS) {
+                vcos_log_error("RaspiPort::disable(): unable to disable connection to %s", port_name.c_str());
+                return status;
+            }
+            return MMAL_SUCCESS;
+        }
+        if (!pool || !port->is_enabled) {
+            return MMAL_SUCCESS;
+        }
+
+        if ((status = mmal_port_disable(port)) != MMAL_SUCCESS) {
+            vcos_log_error("RaspiPort::disable(): unable to disable port %s", port_name.c_str());
+            return status;
+        }
+        if (!drain_pool()) {
+            vcos_log_error("RaspiPort::disable(): buffers of %s still pinned, enabling it again", port_name.c_str());
+            if ((status = mmal_port_enable(port, callback_wrapper)) != MMAL_SUCCESS) {
+                vcos_log_error("RaspiPort::disable(): unable to re-enable port %s", port_name.c_str());
+                return status;
+            }
+            send_pool_buffers();
+            return MMAL_EAGAIN;
+        }
+        return MMAL_SUCCESS;
+    }
+
+    MMAL_STATUS_T RaspiPort::enable() {
+        if (!port) {
+            return MMAL_EINVAL;
+        }
+
+        MMAL_STATUS_T status;
+        if (connection) {
+            if (connection->is_enabled) {
+                return MMAL_SUCCESS;
+            }
+            mmal_format_copy(port->format, connection->out->format);
+            if ((status = mmal_port_format_commit(port)) != MMAL_SUCCESS) {
+                vcos_log_error("RaspiPort::enable(): unable to commit new format of %s", port_name.c_str());
+                return status;
+            }
+            if ((status = mmal_connection_enable(connection)) != MMAL_SUCCESS) {
+                vcos_log_error("RaspiPort::enable(): unable to enable connection to %s", port_name.c_str());
+                return status;
+            }
+            return MMAL_SUCCESS;
+        }
+        if (!pool || port->is_enabled) {
+            return MMAL_SUCCESS;
+        }
+
+        // A new format may need bigger buffers, and a smaller one should not keep the old allocation
+        uint32_t buffer_size = vcos_max(port->buffer_size_recommended, port->buffer_size_min);
+        if (pool->header[0]->alloc_size != buffer_size) {
+            vcos_log_error("RaspiPort::enable(): buffers of %s change from %u to %u bytes", port_name.c_str(), pool->header[0]->alloc_size, buffer_size);
+            metrics.set_pool(NULL);
+            mmal_port_pool_destroy(port, pool);
+            pool = NULL;
+            userdata.pool = NULL;
+            port->buffer_size = buffer_size;
+            return enable_with_pool(callback_wrapper);
+        }
+        if ((status = mmal_port_enable(port, callback_wrapper)) != MMAL_SUCCESS) {
+            vcos_log_error("RaspiPort::enable(): unable to enable port %s", port_name.c_str());
+            return status;
+        }
+        send_pool_buffers();
+        return MMAL_SUCCESS;
+    }
+
+    MMAL_STATUS_T RaspiPort::subscribe(RASPIPORT_SUBSCRIBER_S subscriber) {
+        std::lock_guard< std::mutex > guard(subscribers_lock);
+
+        shared_ptr< vector< RASPIPORT_SUBSCRIBER_S > > subscribers( new vector< RASPIPORT_SUBSCRIBER_S >() );
+        shared_ptr< const vector< RASPIPORT_SUBSCRIBER_S > > current = std::atomic_load(&userdata.subscribers);
+        if (current) {
+            *subscribers = *current;
+        }
+        auto position = subscribers->begin();
+        while (position != subscribers->end() && position->priority >= subscriber.priority) {
+            position++;
+        }
+        subscribers->insert(position, subscriber);
+        std::atomic_store(&userdata.subscribers, shared_ptr< const vector< RASPIPORT_SUBSCRIBER_S > >(subscribers));
+
+        if (!pool) {
+            MMAL_STATUS_T status;
+            if ((status = enable_with_pool(callback_wrapper)) != MMAL_SUCCESS) {
+                std::atomic_store(&userdata.subscribers, current);
+                return status;
             }
-            if (mmal_port_send_buffer(port, buffer) != MMAL_SUCCESS) {
-                vcos_log_error("RaspiPort::add_callback(): unable to send buffer to output port");
+        }
+
+        return MMAL_SUCCESS;
+    }
+
+    MMAL_STATUS_T RaspiPort::unsubscribe(shared_ptr< RaspiCallback > callback, shared_ptr< RaspiFrameQueue > queue) {
+        std::lock_guard< std::mutex > guard(subscribers_lock);
+
+        shared_ptr< const vector< RASPIPORT_SUBSCRIBER_S > > current = std::atomic_load(&userdata.subscribers);
+        if (!current) {
+            return MMAL_EINVAL;
+        }
+        shared_ptr< vector< RASPIPORT_SUBSCRIBER_S > > subscribers( new vector< RASPIPORT_SUBSCRIBER_S >() );
+        for (const RASPIPORT_SUBSCRIBER_S &subscriber : *current) {
+            if ((callback && subscriber.callback == callback) || (queue && subscriber.queue == queue)) {
+                continue;
             }
+            subscribers->push_back(subscriber);
         }
+        if (subscribers->size() == current->size()) {
+            return MMAL_EINVAL;
+        }
+        std::atomic_store(&userdata.subscribers, shared_ptr< const vector< RASPIPORT_SUBSCRIBER_S > >(subscribers));
+        return MMAL_SUCCESS;
+    }
 
+    MMAL_STATUS_T RaspiPort::add_callback(shared_ptr< RaspiCallback > cb_instance, int priority) {
+        vcos_assert(cb_instance);
+        RASPIPORT_SUBSCRIBER_S subscriber;
+        subscriber.callback = cb_instance;
+        subscriber.priority = priority;
+
+        MMAL_STATUS_T status;
+
+        if ((status = subscribe(subscriber)) != MMAL_SUCCESS) {
+            vcos_log_error("RaspiPort::add_callback(): unable to setup callback on port");
+            return status;
+        }
+
+        return MMAL_SUCCESS;
+    }
+
+    MMAL_STATUS_T RaspiPort::remove_callback(shared_ptr< RaspiCallback > cb_instance) {
+        return unsubscribe(cb_instance, nullptr);
+    }
+
+    MMAL_STATUS_T RaspiPort::add_queue(shared_ptr< RaspiFrameQueue > queue, int priority) {
+        vcos_assert(queue);
+        RASPIPORT_SUBSCRIBER_S subscriber;
+        subscriber.queue = queue;
+        subscriber.priority = priority;
+
+        MMAL_STATUS_T status;
+
+        if ((status = subscribe(subscriber)) != MMAL_SUCCESS) {
+            vcos_log_error("RaspiPort::add_queue(): unable to setup frame queue on port");
+            return status;
+        }
 
         return MMAL_SUCCESS;
     }
+
+    MMAL_STATUS_T RaspiPort::remove_queue(shared_ptr< RaspiFrameQueue > queue) {
+        return unsubscribe(nullptr, queue);
+    }
 }
@@ -0,0 +1,186 @@
+#include <chrono>
+#include <math.h>
+
+#include "raspivid/RaspiPortMetrics.h"
+
+namespace raspivid {
+
+    RaspiPortMetrics::Histogram::Histogram() {
+        reset();
+    }
+
+    void RaspiPortMetrics::Histogram::record(uint64_t value_us) {
+        int bucket = value_us < 2 ? 0 : 63 - __builtin_clzll(value_us);
+        if (bucket >= RASPIPORT_HISTOGRAM_BUCKETS) {
+            bucket = RASPIPORT_HISTOGRAM_BUCKETS - 1;
+        }
+        buckets[bucket].fetch_add(1, std::memory_order_relaxed);
+        count.fetch_add(1, std::memory_order_relaxed);
+        sum_us.fetch_add(value_us, std::memory_order_relaxed);
+        uint64_t max = max_us.load(std::memory_order_relaxed);
+        while (value_us > max && !max_us.compare_exchange_weak(max, value_us, std::memory_order_relaxed)) {
+        }
+    }
+
+    void RaspiPortMetrics::Histogram::read(RASPIPORT_HISTOGRAM_S &result) {
+        for (int i = 0; i < RASPIPORT_HISTOGRAM_BUCKETS; i++) {
+            result.buckets[i] = buckets[i].load(std::memory_order_relaxed);
+        }
+        result.count = count.load(std::memory_order_relaxed);
+        result.sum_us = sum_us.load(std::memory_order_relaxed);
+        result.max_us = max_us.load(std::memory_order_relaxed);
+    }
+
+    void RaspiPortMetrics::Histogram::reset() {
+        for (int i = 0; i < RASPIPORT_HISTOGRAM_BUCKETS; i++) {
+            buckets[i].store(0, std::memory_order_relaxed);
+        }
+        count.store(0, std::memory_order_relaxed);
+        sum_us.store(0, std::memory_order_relaxed);
+        max_us.store(0, std::memory_order_relaxed);
+    }
+
+    RaspiPortMetrics::RaspiPortMetrics() : port_buffers(0), held(0), peak_held(0) {
+        reset();
+    }
+
+    int64_t RaspiPortMetrics::now_us() {
+        return std::chrono::duration_cast< std::chrono::microseconds >(std::chrono::steady_clock::now().time_since_epoch()).count();
+    }
+
+    void RaspiPortMetrics::set_pool(MMAL_POOL_T *pool) {
+        headers.clear();
+        received_us.reset();
+        if (!pool) {
+            return;
+        }
+        headers.assign(pool->header, pool->header + pool->headers_num);
+        received_us.reset(new std::atomic<int64_t>[pool->headers_num]);
+        for (uint32_t i = 0; i < pool->headers_num; i++) {
+            received_us[i].store(0, std::memory_order_relaxed);
+        }
+    }
+
+    int RaspiPortMetrics::find_buffer(MMAL_BUFFER_HEADER_T *buffer) {
+        // Pools hold a handful of buffers, so a scan is cheaper than anything keyed
+        for (size_t i = 0; i < headers.size(); i++) {
+            if (headers[i] == buffer) {
+                return (int)i;
+            }
+        }
+        return -1;
+    }
+
+    void RaspiPortMetrics::buffer_sent() {
+        port_buffers.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    void RaspiPortMetrics::buffer_send_failed() {
+        port_buffers.fetch_sub(1, std::memory_order_relaxed);
+    }
+
+    void RaspiPortMetrics::buffer_received(MMAL_PORT_T *port, MMAL_BUFFER_HEADER_T *buffer, int64_t now_us) {
+        if (port_buffers.fetch_sub(1, std::memory_order_relaxed) <= 1 && port->is_enabled) {
+            starved.fetch_add(1, std::memory_order_relaxed);
+        }
+        buffers.fetch_add(1, std::memory_order_relaxed);
+        bytes.fetch_add(buffer->length, std::memory_order_relaxed);
+        int index = find_buffer(buffer);
+        if (index >= 0) {
+            received_us[index].store(now_us, std::memory_order_relaxed);
+        }
+        int64_t now_held = held.fetch_add(1, std::memory_order_relaxed) + 1;
+        if (now_held > peak_held.load(std::memory_order_relaxed)) {
+            peak_held.store(now_held, std::memory_order_relaxed);
+        }
+        if (!(buffer->flags & MMAL_BUFFER_HEADER_FLAG_FRAME_END)) {
+            return;
+        }
+        frames.fetch_add(1, std::memory_order_relaxed);
+        if (!first_frame_us.load(std::memory_order_relaxed)) {
+            first_frame_us.store(now_us, std::memory_order_relaxed);
+        }
+        int64_t last = last_frame_us.exchange(now_us, std::memory_order_relaxed);
+        if (last && now_us > last) {
+            uint64_t interval = (uint64_t)(now_us - last);
+            frame_interval.record(interval);
+            interval_sum_squares.fetch_add(interval * interval, std::memory_order_relaxed);
+        }
+    }
+
+    void RaspiPortMetrics::buffer_returned(MMAL_BUFFER_HEADER_T *buffer, int64_t now_us) {
+        held.fetch_sub(1, std::memory_order_relaxed);
+        int index = find_buffer(buffer);
+        int64_t received = index >= 0 ? received_us[index].exchange(0, std::memory_order_relaxed) : 0;
+        if (received) {
+            hold_time.record(now_us > received ? (uint64_t)(now_us - received) : 0);
+        }
+    }
+
+    void RaspiPortMetrics::callback_done(int64_t start_us) {
+        int64_t duration = now_us() - start_us;
+        callback_duration.record(duration > 0 ? (uint64_t)duration : 0);
+    }
+
+    RASPIPORT_METRICS_S RaspiPortMetrics::snapshot() {
+        RASPIPORT_METRICS_S result;
+        result.buffers = buffers.load(std::memory_order_relaxed);
+        result.frames = frames.load(std::memory_order_relaxed);
+        result.bytes = bytes.load(std::memory_order_relaxed);
+        result.starved = starved.load(std::memory_order_relaxed);
+        frame_interval.read(result.frame_interval);
+        callback_duration.read(result.callback_duration);
+        hold_time.read(result.hold_time);
+        result.held = held.load(std::memory_order_relaxed);
+        result.peak_held = peak_held.load(std::memory_order_relaxed);
+        result.first_frame_us = first_frame_us.load(std::memory_order_relaxed);
+
+        result.fps = 0;
+        result.jitter_us = 0;
+        if (result.frame_interval.count && result.frame_interval.sum_us) {
+            double mean = (double)result.frame_interval.sum_us / result.frame_interval.count;
+            double variance = (double)interval_sum_squares.load(std::memory_order_relaxed) / result.frame_interval.count - mean * mean;
+            result.fps = 1000000.0 / mean;
+            result.jitter_us = variance > 0 ? sqrt(variance) : 0;
+        }
+        return result;
+    }
+
+    void RaspiPortMetrics::reset() {
+        buffers.store(0, std::memory_order_relaxed);
+        frames.store(0, std::memory_order_relaxed);
+        bytes.store(0, std::memory_order_relaxed);
+        starved.store(0, std::memory_order_relaxed);
+        first_frame_us.store(0, std::memory_order_relaxed);
+        last_frame_us.store(0, std::memory_order_relaxed);
+        interval_sum_squares.store(0, std::memory_order_relaxed);
+        frame_interval.reset();
+        callback_duration.reset();
+        hold_time.reset();
+        reset_peak_held();
+    }
+
+    void RaspiPortMetrics::reset_peak_held() {
+        peak_held.store(held.load(std::memory_order_relaxed), std::memory_order_relaxed);
+    }
+
+    uint64_t RaspiPortMetrics::percentile(const RASPIPORT_HISTOGRAM_S &histogram, double percentile) {
+        if (!histogram.count) {
+            return 0;
+        }
+        uint64_t target = (uint64_t)ceil(histogram.count * percentile / 100.0);
+        if (target < 1) {
+            target = 1;
+        }
+        uint64_t seen = 0;
+        for (int i = 0; i < RASPIPORT_HISTOGRAM_BUCKETS; i++) {
+            seen += histogram.buckets[i];
+            if (seen >= target) {
+                uint64_t upper = ((uint64_t)2 << i) - 1;
+                return upper < histogram.max_us ? upper : histogram.max_us;
+            }
+        }
+        return histogram.max_us;
+    }
+
+}
@@ -0,0 +1,626 @@
+#include <chrono>
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "raspivid/RaspiRecorder.h"
+
+#ifdef LIBRASPIVID_HAVE_IO_URING
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#if defined(__NR_io_uring_setup) && defined(__NR_io_uring_enter)
+#define RASPIRECORDER_URING 1
+#endif
+#endif
+
+#define RASPIRECORDER_ALIGNMENT     4096
+#define RASPIRECORDER_URING_DEPTH   8
+
+namespace raspivid {
+
+    /*
+     A minimal io_uring submission and completion ring, driven through the raw system calls so that no liburing is needed.
+     The I/O thread submits a batch of writes and waits for all of them to complete.
+     */
+    struct RASPIRECORDER_URING_S {
+#ifdef RASPIRECORDER_URING
+        int fd;
+        void *sq_ring;
+        size_t sq_ring_size;
+        void *cq_ring;
+        size_t cq_ring_size;
+        struct io_uring_sqe *sqes;
+        size_t sqes_size;
+        unsigned *sq_tail;
+        unsigned *sq_mask;
+        unsigned *sq_array;
+        unsigned *cq_head;
+        unsigned *cq_tail;
+        unsigned *cq_mask;
+        struct io_uring_cqe *cqes;
+#endif
+    };
+
+#ifdef RASPIRECORDER_URING
+    static void uring_destroy(RASPIRECORDER_URING_S *ring);
+
+    static RASPIRECORDER_URING_S* uring_create() {
+        struct io_uring_params params;
+        memset(&params, 0, sizeof(params));
+        int fd = syscall(__NR_io_uring_setup, RASPIRECORDER_URING_DEPTH, &params);
+        if (fd < 0) {
+            return NULL;
+        }
+        RASPIRECORDER_URING_S *ring = new RASPIRECORDER_URING_S();
+        ring->fd = fd;
+        ring->sq_ring_size = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+        ring->cq_ring_size = params.cq_off.cqes + params.cq_entries * sizeof(struct io_uring_cqe);
+        if (params.features & IORING_FEAT_SINGLE_MMAP) {
+            if (ring->cq_ring_size > ring->sq_ring_size) {
+                ring->sq_ring_size = ring->cq_ring_size;
+            }
+            ring->cq_ring_size = 0;
+        }
+        ring->sq_ring = mmap(NULL, ring->sq_ring_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQ_RING);
+        ring->cq_ring = ring->cq_ring_size ?
+            mmap(NULL, ring->cq_ring_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_CQ_RING) : ring->sq_ring;
+        ring->sqes_size = params.sq_entries * sizeof(struct io_uring_sqe);
+        ring->sqes = (struct io_uring_sqe *)mmap(NULL, ring->sqes_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQES);
+        if (ring->sq_ring == MAP_FAILED || ring->cq_ring == MAP_FAILED || ring->sqes == MAP_FAILED) {
+            uring_destroy(ring);
+            return NULL;
+        }
+        uint8_t *sq = (uint8_t *)ring->sq_ring;
+        uint8_t *cq = (uint8_t *)ring->cq_ring;
+        ring->sq_tail = (unsigned *)(sq + params.sq_off.tail);
+        ring->sq_mask = (unsigned *)(sq + params.sq_off.ring_mask);
+        ring->sq_array = (unsigned *)(sq + params.sq_off.array);
+        ring->cq_head = (unsigned *)(cq + params.cq_off.head);
+        ring->cq_tail = (unsigned *)(cq + params.cq_off.tail);
+        ring->cq_mask = (unsigned *)(cq + params.cq_off.ring_mask);
+        ring->cqes = (struct io_uring_cqe *)(cq + params.cq_off.cqes);
+        return ring;
+    }
+
+    static void uring_destroy(RASPIRECORDER_URING_S *ring) {
+        if (ring->sqes && ring->sqes != MAP_FAILED) {
+            munmap(ring->sqes, ring->sqes_size);
+        }
+        if (ring->cq_ring_size && ring->cq_ring && ring->cq_ring != MAP_FAILED) {
+            munmap(ring->cq_ring, ring->cq_ring_size);
+        }
+        if (ring->sq_ring && ring->sq_ring != MAP_FAILED) {
+            munmap(ring->sq_ring, ring->sq_ring_size);
+        }
+        close(ring->fd);
+        delete ring;
+    }
+
+    // Moves completions from the CQ ring to results. Returns how many were taken.
+    static unsigned uring_reap(RASPIRECORDER_URING_S *ring, int *results, unsigned count) {
+        unsigned reaped = 0;
+        unsigned head = *ring->cq_head;
+        while (head != __atomic_load_n(ring->cq_tail, __ATOMIC_ACQUIRE)) {
+            struct io_uring_cqe *cqe = &ring->cqes[head & *ring->cq_mask];
+            if (cqe->user_data < count) {
+                results[cqe->user_data] = cqe->res;
+            }
+            head++;
+            reaped++;
+        }
+        __atomic_store_n(ring->cq_head, head, __ATOMIC_RELEASE);
+        return reaped;
+    }
+
+    /*
+     Writes count buffers at their offsets, with all writes in flight at once. results receives each write's result. Returns
+     false if the writes could not all be submitted. Either way, no write is still in flight and no completion is left in the
+     ring on return, so the buffers may be reused.
+     */
+    static bool uring_write(RASPIRECORDER_URING_S *ring, int fd, uint8_t **data, uint32_t *length, uint64_t *offset, int *results, unsigned count) {
+        unsigned tail = *ring->sq_tail;
+        for (unsigned i = 0; i < count; i++, tail++) {
+            unsigned index = tail & *ring->sq_mask;
+            struct io_uring_sqe *sqe = &ring->sqes[index];
+            memset(sqe, 0, sizeof(*sqe));
+            sqe->opcode = IORING_OP_WRITE;
+            sqe->fd = fd;
+            sqe->addr = (uint64_t)(uintptr_t)data[i];
+            sqe->len = length[i];
+            sqe->off = offset[i];
+            sqe->user_data = i;
+            ring->sq_array[index] = index;
+            results[i] = -ECANCELED;
+        }
+        __atomic_store_n(ring->sq_tail, tail, __ATOMIC_RELEASE);
+
+        unsigned submitted = 0, completed = 0;
+        bool failed = false;
+        while (completed < submitted || (!failed && submitted < count)) {
+            unsigned to_submit = failed ? 0 : count - submitted;
+            int ret = syscall(__NR_io_uring_enter, ring->fd, to_submit, 1, IORING_ENTER_GETEVENTS, NULL, 0);
+            if (ret < 0 && errno != EINTR) {
+                if (to_submit) {
+                    // Take back the writes the kernel did not consume, then wait for the ones it did
+                    __atomic_store_n(ring->sq_tail, tail - to_submit, __ATOMIC_RELEASE);
+                    failed = true;
+                } else {
+                    // Completions still reach the CQ ring without io_uring_enter
+                    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+                }
+            } else if (ret > 0 && to_submit) {
+                submitted += ret;
+            }
+            completed += uring_reap(ring, results, count);
+        }
+        return !failed;
+    }
+#endif
+
+    RASPIRECORDER_OPTION_S RaspiRecorder::createDefaultRecorderOptions() {
+        RASPIRECORDER_OPTION_S options;
+        options.path = "segment-%04u.h264";
+        options.segment_ms = 60000;
+        options.segment_bytes = 0;
+        options.buffer_size = 1 << 20;
+        options.buffers = 8;
+        options.io = RASPIRECORDER_IO_AUTO;
+        options.direct = true;
+        return options;
+    }
+
+    shared_ptr< RaspiRecorder > RaspiRecorder::create(RASPIRECORDER_OPTION_S options) {
+        if (options.path.empty()) {
+            vcos_log_error("RaspiRecorder::create(): no segment path");
+            return nullptr;
+        }
+        if (options.buffers < 2) {
+            options.buffers = 2;
+        }
+        if (options.buffer_size < RASPIRECORDER_ALIGNMENT) {
+            options.buffer_size = RASPIRECORDER_ALIGNMENT;
+        }
+        options.buffer_size = (options.buffer_size + RASPIRECORDER_ALIGNMENT - 1) & ~(uint32_t)(RASPIRECORDER_ALIGNMENT - 1);
+        shared_ptr< RaspiRecorder > recorder = shared_ptr< RaspiRecorder >( new RaspiRecorder(options) );
+        if (!recorder->allocate()) {
+            vcos_log_error("RaspiRecorder::create(): unable to allocate %u buffers of %u bytes", options.buffers, options.buffer_size);
+            return nullptr;
+        }
+        recorder->worker = thread(&RaspiRecorder::run, recorder.get());
+        return recorder;
+    }
+
+    RaspiRecorder::RaspiRecorder(RASPIRECORDER_OPTION_S options) : options_(options), config_pending(false), frame_open(false),
+            frame_skipped(true), waiting_for_keyframe(false), segment_open(false), segment_started(false), segment(0),
+            segment_start_pts(MMAL_TIME_UNKNOWN), segment_bytes(0), current(-1), filled(0), frame_buffer(-1), frame_filled(0),
+            frame_segment_bytes(0), frame_config_pending(false), stopping(false), uring(NULL), fd(-1), fd_direct(false),
+            file_offset(0), file_size(0), io_(RASPIRECORDER_IO_PWRITE), stopped(false), segments_(0), frames_recorded_(0), frames_dropped_(0), bytes_written_(0),
+            errors_(0), max_write_us_(0) {
+        parser = RaspiH264Parser::create();
+        config.reserve(1024);
+#ifdef RASPIRECORDER_URING
+        if (options_.io != RASPIRECORDER_IO_PWRITE) {
+            uring = uring_create();
+        }
+        if (uring) {
+            io_.store(RASPIRECORDER_IO_URING, std::memory_order_relaxed);
+        }
+#endif
+    }
+
+    RaspiRecorder::~RaspiRecorder() {
+        stop();
+        close_segment();
+#ifdef RASPIRECORDER_URING
+        if (uring) {
+            uring_destroy(uring);
+        }
+#endif
+        for (size_t i = 0; i < buffers_.size(); i++) {
+            free(buffers_[i]);
+        }
+    }
+
+    bool RaspiRecorder::allocate() {
+        for (uint32_t i = 0; i < options_.buffers; i++) {
+            void *buffer = NULL;
+            if (posix_memalign(&buffer, RASPIRECORDER_ALIGNMENT, options_.buffer_size) != 0) {
+                return false;
+            }
+            buffers_.push_back((uint8_t *)buffer);
+            free_buffers.push_back(i);
+        }
+        return true;
+    }
+
+    RASPIRECORDER_IO_T RaspiRecorder::io_method() {
+        return io_.load(std::memory_order_relaxed);
+    }
+
+    void RaspiRecorder::callback(MMAL_PORT_T *port, MMAL_BUFFER_HEADER_T *buffer) {
+        if (!port->is_enabled || stopped || (buffer->flags & MMAL_BUFFER_HEADER_FLAG_CODECSIDEINFO)) {
+            return;
+        }
+        if (!buffer->length && !(buffer->flags & MMAL_BUFFER_HEADER_FLAG_FRAME_END)) {
+            return;
+        }
+        const uint8_t *data = buffer->data + buffer->offset;
+        uint32_t count = parser->parse(buffer);
+        const RASPIH264_NAL_S *nals = parser->nals();
+
+        if (buffer->flags & MMAL_BUFFER_HEADER_FLAG_CONFIG) {
+            // Written in front of the next frame, so a segment started at that frame gets it
+            if (buffer->length <= config.capacity()) {
+                config.assign(data, data + buffer->length);
+                config_pending = true;
+            }
+            return;
+        }
+
+        if (!frame_open) {
+            frame_open = true;
+            bool idr = false, sps = false;
+            for (uint32_t i = 0; i < count; i++) {
+                if (nals[i].flags & RASPIH264_NAL_FLAG_START) {
+                    idr = idr || nals[i].type == RASPIH264_NAL_IDR;
+                    sps = sps || nals[i].type == RASPIH264_NAL_SPS;
+                }
+            }
+            if (idr) {
+                waiting_for_keyframe = false;
+                bool elapsed = options_.segment_ms && segment_start_pts != MMAL_TIME_UNKNOWN && buffer->pts != MMAL_TIME_UNKNOWN &&
+                    buffer->pts - segment_start_pts >= (int64_t)options_.segment_ms * 1000;
+                bool full = options_.segment_bytes && segment_bytes >= options_.segment_bytes;
+                if (!segment_open || elapsed || full) {
+                    if (segment_open) {
+                        end_segment();
+                    }
+                    start_segment(buffer->pts);
+                    config_pending = config_pending || !sps;
+                }
+            }
+            frame_skipped = waiting_for_keyframe || !segment_open;
+            begin_frame();
+            if (!frame_skipped && config_pending && !config.empty()) {
+                if (put(config.data(), config.size())) {
+                    config_pending = false;
+                } else {
+                    rollback_frame();
+                    frame_skipped = true;
+                    waiting_for_keyframe = true;
+                }
+            }
+        }
+
+        if (!frame_skipped && !put(data, buffer->length)) {
+            // The I/O thread is too far behind. Drop what was stored of the frame and resume at the next keyframe, so
+            // the stream stays decodable.
+            rollback_frame();
+            frame_skipped = true;
+            waiting_for_keyframe = true;
+        }
+
+        if (buffer->flags & MMAL_BUFFER_HEADER_FLAG_FRAME_END) {
+            frame_open = false;
+            if (!frame_skipped) {
+                commit_frame();
+                frames_recorded_.fetch_add(1, std::memory_order_relaxed);
+            } else if (segment_open) {
+                frames_dropped_.fetch_add(1, std::memory_order_relaxed);
+            }
+        }
+    }
+
+    bool RaspiRecorder::put(const uint8_t *data, uint32_t length) {
+        while (length) {
+            if (current < 0) {
+                lock_guard< mutex > guard(lock);
+                if (free_buffers.empty()) {
+                    return false;
+                }
+                current = free_buffers.back();
+                free_buffers.pop_back();
+                filled = 0;
+            }
+            uint32_t n = options_.buffer_size - filled < length ? options_.buffer_size - filled : length;
+            memcpy(buffers_[current] + filled, data, n);
+            filled += n;
+            data += n;
+            length -= n;
+            segment_bytes += n;
+            if (filled == options_.buffer_size) {
+                // Held back until the frame is complete, so a frame that can't be stored whole leaves nothing behind
+                staged.push_back(current);
+                current = -1;
+                filled = 0;
+            }
+        }
+        return true;
+    }
+
+    void RaspiRecorder::begin_frame() {
+        frame_buffer = current;
+        frame_filled = filled;
+        frame_segment_bytes = segment_bytes;
+        frame_config_pending = config_pending;
+    }
+
+    void RaspiRecorder::commit_frame() {
+        for (int buffer : staged) {
+            push_job(buffer, options_.buffer_size, false);
+        }
+        staged.clear();
+    }
+
+    void RaspiRecorder::rollback_frame() {
+        {
+            lock_guard< mutex > guard(lock);
+            for (int buffer : staged) {
+                if (buffer != frame_buffer) {
+                    free_buffers.push_back(buffer);
+                }
+            }
+            if (current >= 0 && current != frame_buffer) {
+                free_buffers.push_back(current);
+            }
+        }
+        staged.clear();
+        current = frame_buffer;
+        filled = frame_filled;
+        segment_bytes = frame_segment_bytes;
+        config_pending = frame_config_pending;
+    }
+
+    void RaspiRecorder::submit(bool end) {
+        push_job(current, filled, end);
+        current = -1;
+        filled = 0;
+    }
+
+    void RaspiRecorder::push_job(int buffer, uint32_t length, bool end) {
+        JOB_S job;
+        job.buffer = buffer;
+        job.length = length;
+        job.segment = segment;
+        job.start = !segment_started;
+        job.end = end;
+        segment_started = true;
+        {
+            lock_guard< mutex > guard(lock);
+            jobs.push_back(job);
+        }
+        available.notify_one();
+    }
+
+    void RaspiRecorder::start_segment(int64_t pts) {
+        segment++;
+        segment_open = true;
+        segment_started = false;
+        segment_start_pts = pts;
+        segment_bytes = 0;
+    }
+
+    void RaspiRecorder::end_segment() {
+        submit(true);
+        segment_open = false;
+    }
+
+    MMAL_STATUS_T RaspiRecorder::stop() {
+        if (!stopped.exchange(true)) {
+            if (frame_open) {
+                // An incomplete frame is not written
+                rollback_frame();
+            }
+            if (segment_open) {
+                end_segment();
+            }
+            {
+                lock_guard< mutex > guard(lock);
+                stopping = true;
+            }
+            available.notify_all();
+        }
+        if (worker.joinable()) {
+            worker.join();
+        }
+        return errors_ ? MMAL_EIO : MMAL_SUCCESS;
+    }
+
+    void RaspiRecorder::run() {
+        vector< JOB_S > batch;
+        batch.reserve(RASPIRECORDER_URING_DEPTH);
+        unique_lock< mutex > guard(lock);
+        while (true) {
+            available.wait(guard, [this]{ return !jobs.empty() || stopping; });
+            if (jobs.empty()) {
+                break;
+            }
+            // A batch never spans two segments
+            batch.clear();
+            while (!jobs.empty() && batch.size() < RASPIRECORDER_URING_DEPTH) {
+                if (!batch.empty() && jobs.front().start) {
+                    break;
+                }
+                batch.push_back(jobs.front());
+                jobs.pop_front();
+                if (batch.back().end) {
+                    break;
+                }
+            }
+            guard.unlock();
+            process(batch);
+            guard.lock();
+            for (size_t i = 0; i < batch.size(); i++) {
+                if (batch[i].buffer >= 0) {
+                    free_buffers.push_back(batch[i].buffer);
+                }
+            }
+        }
+    }
+
+    void RaspiRecorder::process(vector< JOB_S > &batch) {
+        if (batch[0].start) {
+            close_segment();
+            open_segment(batch[0].segment);
+        }
+
+        uint8_t *data[RASPIRECORDER_URING_DEPTH];
+        uint32_t length[RASPIRECORDER_URING_DEPTH];
+        uint64_t offset[RASPIRECORDER_URING_DEPTH];
+        unsigned count = 0;
+        for (size_t i = 0; i < batch.size() && fd >= 0; i++) {
+            if (batch[i].buffer < 0 || !batch[i].length) {
+                continue;
+            }
+            data[count] = buffers_[batch[i].buffer];
+            length[count] = batch[i].length;
+            offset[count] = file_offset;
+            if (fd_direct && (length[count] & (RASPIRECORDER_ALIGNMENT - 1))) {
+                // O_DIRECT writes whole blocks. The padding is cut off again when the segment is closed.
+                uint32_t padded = (length[count] + RASPIRECORDER_ALIGNMENT - 1) & ~(uint32_t)(RASPIRECORDER_ALIGNMENT - 1);
+                memset(data[count] + length[count], 0, padded - length[count]);
+                length[count] = padded;
+            }
+            file_offset += length[count];
+            file_size += batch[i].length;
+            count++;
+        }
+
+        if (count) {
+            auto start = std::chrono::steady_clock::now();
+            int results[RASPIRECORDER_URING_DEPTH];
+            bool done = false;
+#ifdef RASPIRECORDER_URING
+            if (uring) {
+                done = uring_write(uring, fd, data, length, offset, results, count);
+                for (unsigned i = 0; done && i < count; i++) {
+                    if (results[i] == -EINVAL || results[i] == -EOPNOTSUPP) {
+                        // IORING_OP_WRITE needs Linux 5.6
+                        vcos_log_error("RaspiRecorder::process(): io_uring writes not supported, using pwrite");
+                        uring_destroy(uring);
+                        uring = NULL;
+                        io_.store(RASPIRECORDER_IO_PWRITE, std::memory_order_relaxed);
+                        done = false;
+                    }
+                }
+                for (unsigned i = 0; done && i < count; i++) {
+                    if (results[i] < 0) {
+                        vcos_log_error("RaspiRecorder::process(): write failed: %s", strerror(-results[i]));
+                        note_error();
+                        continue;
+                    }
+                    bytes_written_.fetch_add(results[i], std::memory_order_relaxed);
+                    if ((uint32_t)results[i] < length[i]) {
+                        write_pwrite(data[i] + results[i], length[i] - results[i], offset[i] + results[i]);
+                    }
+                }
+            }
+#endif
+            for (unsigned i = 0; !done && i < count; i++) {
+                write_pwrite(data[i], length[i], offset[i]);
+            }
+            uint64_t elapsed = std::chrono::duration_cast< std::chrono::microseconds >(std::chrono::steady_clock::now() - start).count();
+            if (elapsed > max_write_us_.load(std::memory_order_relaxed)) {
+                max_write_us_.store(elapsed, std::memory_order_relaxed);
+            }
+        }
+
+        if (batch.back().end) {
+            close_segment();
+        }
+    }
+
+    bool RaspiRecorder::write_pwrite(const uint8_t *data, uint32_t length, uint64_t offset) {
+        while (length) {
+            ssize_t written = pwrite(fd, data, length, offset);
+            if (written < 0) {
+                if (errno == EINTR) {
+                    continue;
+                }
+                vcos_log_error("RaspiRecorder::write_pwrite(): write failed: %s", strerror(errno));
+                note_error();
+                return false;
+            }
+            bytes_written_.fetch_add(written, std::memory_order_relaxed);
+            data += written;
+            length -= written;
+            offset += written;
+        }
+        return true;
+    }
+
+    bool RaspiRecorder::open_segment(uint32_t number) {
+        char path[PATH_MAX];
+        snprintf(path, sizeof(path), options_.path.c_str(), number);
+        fd_direct = false;
+        fd = -1;
+#ifdef O_DIRECT
+        if (options_.direct) {
+            fd = open(path, O_WRONLY | O_CREAT | O_TRUNC | O_DIRECT, 0644);
+            fd_direct = fd >= 0;
+        }
+#endif
+        if (fd < 0) {
+            // Some file systems, tmpfs for one, refuse O_DIRECT
+            fd = open(path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+        }
+        if (fd < 0) {
+            vcos_log_error("RaspiRecorder::open_segment(): unable to create %s: %s", path, strerror(errno));
+            note_error();
+            return false;
+        }
+        file_offset = 0;
+        file_size = 0;
+        return true;
+    }
+
+    void RaspiRecorder::close_segment() {
+        if (fd < 0) {
+            return;
+        }
+        if (fd_direct && file_size != file_offset && ftruncate(fd, file_size) != 0) {
+            vcos_log_error("RaspiRecorder::close_segment(): unable to truncate segment: %s", strerror(errno));
+            note_error();
+        }
+        if (close(fd) != 0) {
+            vcos_log_error("RaspiRecorder::close_segment(): close failed: %s", strerror(errno));
+            note_error();
+        }
+        fd = -1;
+        segments_.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    void RaspiRecorder::note_error() {
+        errors_.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    uint32_t RaspiRecorder::segments() {
+        return segments_.load(std::memory_order_relaxed);
+    }
+
+    uint64_t RaspiRecorder::frames_recorded() {
+        return frames_recorded_.load(std::memory_order_relaxed);
+    }
+
+    uint64_t RaspiRecorder::frames_dropped() {
+        return frames_dropped_.load(std::memory_order_relaxed);
+    }
+
+    uint64_t RaspiRecorder::bytes_written() {
+        return bytes_written_.load(std::memory_order_relaxed);
+    }
+
+    uint64_t RaspiRecorder::errors() {
+        return errors_.load(std::memory_order_relaxed);
+    }
+
+    uint64_t RaspiRecorder::max_write_us() {
+        return max_write_us_.load(std::memory_order_relaxed);
+    }
+
+}
@@ -0,0 +1,402 @@
+#include <string.h>
+
+#include "raspivid/RaspiTextRasterizer.h"
+#include "RaspiOverlayPixels.h"
+
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+#include <arm_neon.h>
+#define RASPITEXT_NEON 1
+#endif
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#define RASPITEXT_SSE2 1
+#endif
+
+#define RASPITEXT_FIRST_GLYPH 32
+#define RASPITEXT_GLYPHS 95
+
+namespace raspivid {
+
+    /*
+     The classic 5x7 LCD font for ' ' to '~'. Each glyph is five columns, bit 0 being the top row.
+     */
+    static const uint8_t FONT[RASPITEXT_GLYPHS][5] = {
+        { 0x00, 0x00, 0x00, 0x00, 0x00 }, { 0x00, 0x00, 0x5f, 0x00, 0x00 }, { 0x00, 0x07, 0x00, 0x07, 0x00 },
+        { 0x14, 0x7f, 0x14, 0x7f, 0x14 }, { 0x24, 0x2a, 0x7f, 0x2a, 0x12 }, { 0x23, 0x13, 0x08, 0x64, 0x62 },
+        { 0x36, 0x49, 0x55, 0x22, 0x50 }, { 0x00, 0x05, 0x03, 0x00, 0x00 }, { 0x00, 0x1c, 0x22, 0x41, 0x00 },
+        { 0x00, 0x41, 0x22, 0x1c, 0x00 }, { 0x08, 0x2a, 0x1c, 0x2a, 0x08 }, { 0x08, 0x08, 0x3e, 0x08, 0x08 },
+        { 0x00, 0x50, 0x30, 0x00, 0x00 }, { 0x08, 0x08, 0x08, 0x08, 0x08 }, { 0x00, 0x60, 0x60, 0x00, 0x00 },
+        { 0x20, 0x10, 0x08, 0x04, 0x02 }, { 0x3e, 0x51, 0x49, 0x45, 0x3e }, { 0x00, 0x42, 0x7f, 0x40, 0x00 },
+        { 0x42, 0x61, 0x51, 0x49, 0x46 }, { 0x21, 0x41, 0x45, 0x4b, 0x31 }, { 0x18, 0x14, 0x12, 0x7f, 0x10 },
+        { 0x27, 0x45, 0x45, 0x45, 0x39 }, { 0x3c, 0x4a, 0x49, 0x49, 0x30 }, { 0x01, 0x71, 0x09, 0x05, 0x03 },
+        { 0x36, 0x49, 0x49, 0x49, 0x36 }, { 0x06, 0x49, 0x49, 0x29, 0x1e }, { 0x00, 0x36, 0x36, 0x00, 0x00 },
+        { 0x00, 0x56, 0x36, 0x00, 0x00 }, { 0x08, 0x14, 0x22, 0x41, 0x00 }, { 0x14, 0x14, 0x14, 0x14, 0x14 },
+        { 0x00, 0x41, 0x22, 0x14, 0x08 }, { 0x02, 0x01, 0x51, 0x09, 0x06 }, { 0x32, 0x49, 0x79, 0x41, 0x3e },
+        { 0x7e, 0x11, 0x11, 0x11, 0x7e }, { 0x7f, 0x49, 0x49, 0x49, 0x36 }, { 0x3e, 0x41, 0x41, 0x41, 0x22 },
+        { 0x7f, 0x41, 0x41, 0x22, 0x1c }, { 0x7f, 0x49, 0x49, 0x49, 0x41 }, { 0x7f, 0x09, 0x09, 0x01, 0x01 },
+        { 0x3e, 0x41, 0x41, 0x51, 0x32 }, { 0x7f, 0x08, 0x08, 0x08, 0x7f }, { 0x00, 0x41, 0x7f, 0x41, 0x00 },
+        { 0x20, 0x40, 0x41, 0x3f, 0x01 }, { 0x7f, 0x08, 0x14, 0x22, 0x41 }, { 0x7f, 0x40, 0x40, 0x40, 0x40 },
+        { 0x7f, 0x02, 0x04, 0x02, 0x7f }, { 0x7f, 0x04, 0x08, 0x10, 0x7f }, { 0x3e, 0x41, 0x41, 0x41, 0x3e },
+        { 0x7f, 0x09, 0x09, 0x09, 0x06 }, { 0x3e, 0x41, 0x51, 0x21, 0x5e }, { 0x7f, 0x09, 0x19, 0x29, 0x46 },
+        { 0x46, 0x49, 0x49, 0x49, 0x31 }, { 0x01, 0x01, 0x7f, 0x01, 0x01 }, { 0x3f, 0x40, 0x40, 0x40, 0x3f },
+        { 0x1f, 0x20, 0x40, 0x20, 0x1f }, { 0x7f, 0x20, 0x18, 0x20, 0x7f }, { 0x63, 0x14, 0x08, 0x14, 0x63 },
+        { 0x03, 0x04, 0x78, 0x04, 0x03 }, { 0x61, 0x51, 0x49, 0x45, 0x43 }, { 0x00, 0x7f, 0x41, 0x41, 0x00 },
+        { 0x02, 0x04, 0x08, 0x10, 0x20 }, { 0x00, 0x41, 0x41, 0x7f, 0x00 }, { 0x04, 0x02, 0x01, 0x02, 0x04 },
+        { 0x40, 0x40, 0x40, 0x40, 0x40 }, { 0x00, 0x01, 0x02, 0x04, 0x00 }, { 0x20, 0x54, 0x54, 0x54, 0x78 },
+        { 0x7f, 0x48, 0x44, 0x44, 0x38 }, { 0x38, 0x44, 0x44, 0x44, 0x20 }, { 0x38, 0x44, 0x44, 0x48, 0x7f },
+        { 0x38, 0x54, 0x54, 0x54, 0x18 }, { 0x08, 0x7e, 0x09, 0x01, 0x02 }, { 0x08, 0x14, 0x54, 0x54, 0x3c },
+        { 0x7f, 0x08, 0x04, 0x04, 0x78 }, { 0x00, 0x44, 0x7d, 0x40, 0x00 }, { 0x20, 0x40, 0x44, 0x3d, 0x00 },
+        { 0x00, 0x7f, 0x10, 0x28, 0x44 }, { 0x00, 0x41, 0x7f, 0x40, 0x00 }, { 0x7c, 0x04, 0x18, 0x04, 0x78 },
+        { 0x7c, 0x08, 0x04, 0x04, 0x78 }, { 0x38, 0x44, 0x44, 0x44, 0x38 }, { 0x7c, 0x14, 0x14, 0x14, 0x08 },
+        { 0x08, 0x14, 0x14, 0x18, 0x7c }, { 0x7c, 0x08, 0x04, 0x04, 0x08 }, { 0x48, 0x54, 0x54, 0x54, 0x20 },
+        { 0x04, 0x3f, 0x44, 0x40, 0x20 }, { 0x3c, 0x40, 0x40, 0x20, 0x7c }, { 0x1c, 0x20, 0x40, 0x20, 0x1c },
+        { 0x3c, 0x40, 0x30, 0x40, 0x3c }, { 0x44, 0x28, 0x10, 0x28, 0x44 }, { 0x0c, 0x50, 0x50, 0x50, 0x3c },
+        { 0x44, 0x64, 0x54, 0x4c, 0x44 }, { 0x00, 0x08, 0x36, 0x41, 0x00 }, { 0x00, 0x00, 0x7f, 0x00, 0x00 },
+        { 0x00, 0x41, 0x36, 0x08, 0x00 }, { 0x08, 0x04, 0x08, 0x10, 0x08 }
+    };
+
+    // x / 255 rounded to nearest, exact for x up to 255 * 255
+    static inline uint32_t div255(uint32_t x) {
+        x += 128;
+        return (x + (x >> 8)) >> 8;
+    }
+
+    /*
+     Scalar reference kernel: dst = (dst * (255 - alpha) + colour * alpha) / 255, rounded. Every other path must produce
+     exactly the same output.
+     */
+    static void blend_scalar(uint8_t *dst, const uint8_t *colour, const uint8_t *alpha, uint32_t bytes) {
+        for (uint32_t i = 0; i < bytes; i++) {
+            if (alpha[i]) {
+                dst[i] = div255(dst[i] * (255 - alpha[i]) + colour[i] * alpha[i]);
+            }
+        }
+    }
+
+#ifdef RASPITEXT_SSE2
+    static inline __m128i blend8_sse2(__m128i d, __m128i c, __m128i a) {
+        // Both products fit in 16 bits: d * (255 - a) + c * a <= 255 * 255
+        __m128i t = _mm_add_epi16(_mm_mullo_epi16(d, _mm_sub_epi16(_mm_set1_epi16(255), a)), _mm_mullo_epi16(c, a));
+        t = _mm_add_epi16(t, _mm_set1_epi16(128));
+        return _mm_srli_epi16(_mm_add_epi16(t, _mm_srli_epi16(t, 8)), 8);
+    }
+
+    static void blend_sse2(uint8_t *dst, const uint8_t *colour, const uint8_t *alpha, uint32_t bytes) {
+        const __m128i zero = _mm_setzero_si128();
+        uint32_t i = 0;
+        for (; i + 16 <= bytes; i += 16) {
+            __m128i a = _mm_loadu_si128((const __m128i *)(alpha + i));
+            // Gaps between glyphs are common and need no work
+            if (_mm_movemask_epi8(_mm_cmpeq_epi8(a, zero)) == 0xffff) {
+                continue;
+            }
+            __m128i d = _mm_loadu_si128((const __m128i *)(dst + i));
+            __m128i c = _mm_loadu_si128((const __m128i *)(colour + i));
+            __m128i low = blend8_sse2(_mm_unpacklo_epi8(d, zero), _mm_unpacklo_epi8(c, zero), _mm_unpacklo_epi8(a, zero));
+            __m128i high = blend8_sse2(_mm_unpackhi_epi8(d, zero), _mm_unpackhi_epi8(c, zero), _mm_unpackhi_epi8(a, zero));
+            _mm_storeu_si128((__m128i *)(dst + i), _mm_packus_epi16(low, high));
+        }
+        blend_scalar(dst + i, colour + i, alpha + i, bytes - i);
+    }
+#endif
+
+#ifdef RASPITEXT_NEON
+    static inline uint8x8_t blend8_neon(uint8x8_t d, uint8x8_t c, uint8x8_t a) {
+        uint16x8_t t = vmlal_u8(vmull_u8(d, vmvn_u8(a)), c, a);
+        t = vaddq_u16(t, vdupq_n_u16(128));
+        return vshrn_n_u16(vsraq_n_u16(t, t, 8), 8);
+    }
+
+    static void blend_neon(uint8_t *dst, const uint8_t *colour, const uint8_t *alpha, uint32_t bytes) {
+        uint32_t i = 0;
+        for (; i + 16 <= bytes; i += 16) {
+            uint8x16_t a = vld1q_u8(alpha + i);
+            if (!(vget_lane_u64(vreinterpret_u64_u8(vorr_u8(vget_low_u8(a), vget_high_u8(a))), 0))) {
+                continue;
+            }
+            uint8x16_t d = vld1q_u8(dst + i);
+            uint8x16_t c = vld1q_u8(colour + i);
+            vst1q_u8(dst + i, vcombine_u8(blend8_neon(vget_low_u8(d), vget_low_u8(c), vget_low_u8(a)),
+                blend8_neon(vget_high_u8(d), vget_high_u8(c), vget_high_u8(a))));
+        }
+        blend_scalar(dst + i, colour + i, alpha + i, bytes - i);
+    }
+#endif
+
+    // Columns and lines of a text, in glyph cells
+    static void text_cells(const string &text, uint32_t &columns, uint32_t &lines) {
+        columns = 0;
+        lines = text.empty() ? 0 : 1;
+        uint32_t column = 0;
+        for (char c : text) {
+            if (c == '\n') {
+                lines++;
+                column = 0;
+            } else {
+                columns = vcos_max(columns, ++column);
+            }
+        }
+    }
+
+    shared_ptr< RaspiTextRasterizer > RaspiTextRasterizer::create(unsigned int scale, RASPITEXT_PATH_T path, unsigned int cache_entries) {
+        if (scale < 1 || scale > 16) {
+            vcos_log_error("RaspiTextRasterizer::create(): scale %u is not between 1 and 16", scale);
+            return nullptr;
+        }
+        if (path == RASPITEXT_PATH_AUTO) {
+#if defined(RASPITEXT_NEON)
+            path = RASPITEXT_PATH_NEON;
+#elif defined(RASPITEXT_SSE2)
+            path = RASPITEXT_PATH_SSE2;
+#else
+            path = RASPITEXT_PATH_SCALAR;
+#endif
+        }
+        switch (path) {
+            case RASPITEXT_PATH_SCALAR:
+                break;
+#ifdef RASPITEXT_SSE2
+            case RASPITEXT_PATH_SSE2:
+                break;
+#endif
+#ifdef RASPITEXT_NEON
+            case RASPITEXT_PATH_NEON:
+                break;
+#endif
+            default:
+                return nullptr;
+        }
+        return shared_ptr< RaspiTextRasterizer >( new RaspiTextRasterizer(scale, path, cache_entries) );
+    }
+
+    RaspiTextRasterizer::RaspiTextRasterizer(unsigned int scale, RASPITEXT_PATH_T path, unsigned int cache_entries) : scale_(scale),
+            cell_width(6 * scale), cell_height(8 * scale), path_(path), blend(blend_scalar), cache_entries_(cache_entries) {
+#ifdef RASPITEXT_SSE2
+        if (path_ == RASPITEXT_PATH_SSE2) {
+            blend = blend_sse2;
+        }
+#endif
+#ifdef RASPITEXT_NEON
+        if (path_ == RASPITEXT_PATH_NEON) {
+            blend = blend_neon;
+        }
+#endif
+        // The last column and row of each cell stay empty and space the glyphs out
+        uint32_t atlas_stride = cell_width * RASPITEXT_GLYPHS;
+        atlas.assign((size_t)atlas_stride * cell_height, 0);
+        for (uint32_t glyph = 0; glyph < RASPITEXT_GLYPHS; glyph++) {
+            for (uint32_t y = 0; y < cell_height; y++) {
+                uint8_t *row = atlas.data() + (size_t)y * atlas_stride + glyph * cell_width;
+                for (uint32_t x = 0; x < 5 * scale_; x++) {
+                    if (FONT[glyph][x / scale_] & (1 << (y / scale_))) {
+                        row[x] = 255;
+                    }
+                }
+            }
+        }
+        memset(&stats, 0, sizeof(stats));
+    }
+
+    RASPITEXT_TARGET_S RaspiTextRasterizer::target(uint8_t *data, const RASPIOVERLAYRENDERER_FORMAT_S &format) {
+        RASPITEXT_TARGET_S result;
+        result.data = data;
+        result.stride = overlay_stride(format.encoding, format.width);
+        result.width = format.width;
+        result.height = format.height;
+        result.encoding = format.encoding;
+        return result;
+    }
+
+    MMAL_RECT_T RaspiTextRasterizer::measure(const string &text) {
+        uint32_t columns, lines;
+        text_cells(text, columns, lines);
+        MMAL_RECT_T result = { 0, 0, (int32_t)(columns * cell_width), (int32_t)(lines * cell_height) };
+        return result;
+    }
+
+    void RaspiTextRasterizer::lay_out(const string &text, LAYOUT_S &result) {
+        uint32_t columns, lines;
+        text_cells(text, columns, lines);
+        result.width = columns * cell_width;
+        result.height = lines * cell_height;
+        uint32_t stride = result.width * result.bpp;
+        result.alpha.assign((size_t)stride * result.height, 0);
+        result.spans.assign(2 * result.height, 0);
+
+        uint32_t atlas_stride = cell_width * RASPITEXT_GLYPHS;
+        uint32_t line = 0, column = 0;
+        for (char c : text) {
+            if (c == '\n') {
+                line++;
+                column = 0;
+                continue;
+            }
+            uint32_t glyph = (uint8_t)c - RASPITEXT_FIRST_GLYPH;
+            if (glyph >= RASPITEXT_GLYPHS) {
+                glyph = '?' - RASPITEXT_FIRST_GLYPH;
+            }
+            for (uint32_t y = 0; y < cell_height; y++) {
+                const uint8_t *in = atlas.data() + (size_t)y * atlas_stride + glyph * cell_width;
+                uint32_t row = line * cell_height + y;
+                uint8_t *out = result.alpha.data() + (size_t)row * stride + (size_t)column * cell_width * result.bpp;
+                uint32_t *span = &result.spans[2 * row];
+                for (uint32_t x = 0; x < cell_width; x++, out += result.bpp) {
+                    if (!in[x]) {
+                        continue;
+                    }
+                    memset(out, in[x], result.bpp);
+                    uint32_t px = column * cell_width + x;
+                    if (span[1] == 0) {
+                        span[0] = px;
+                    }
+                    span[0] = vcos_min(span[0], px);
+                    span[1] = vcos_max(span[1], px + 1);
+                }
+            }
+            column++;
+            stats.glyphs++;
+        }
+    }
+
+    const RaspiTextRasterizer::LAYOUT_S& RaspiTextRasterizer::layout(const string &text, uint32_t bpp) {
+        if (!cache_entries_) {
+            stats.layout_misses++;
+            scratch.bpp = bpp;
+            lay_out(text, scratch);
+            return scratch;
+        }
+        pair< uint32_t, string > key(bpp, text);
+        map< pair< uint32_t, string >, LAYOUT_S >::iterator found = layouts.find(key);
+        if (found != layouts.end()) {
+            stats.layout_hits++;
+            found->second.used = stats.draws;
+            return found->second;
+        }
+        stats.layout_misses++;
+        if (layouts.size() >= cache_entries_) {
+            map< pair< uint32_t, string >, LAYOUT_S >::iterator oldest = layouts.begin();
+            for (map< pair< uint32_t, string >, LAYOUT_S >::iterator i = layouts.begin(); i != layouts.end(); ++i) {
+                if (i->second.used < oldest->second.used) {
+                    oldest = i;
+                }
+            }
+            layouts.erase(oldest);
+        }
+        LAYOUT_S &result = layouts[key];
+        result.bpp = bpp;
+        result.used = stats.draws;
+        lay_out(text, result);
+        return result;
+    }
+
+    void RaspiTextRasterizer::fill_row(vector< uint8_t > &row, uint32_t colour, uint32_t encoding, uint32_t pixels) {
+        uint32_t bpp = overlay_bytes_per_pixel(encoding);
+        uint8_t r = colour >> 16, g = colour >> 8, b = colour;
+        bool bgr = encoding == MMAL_ENCODING_BGR24 || encoding == MMAL_ENCODING_BGRA;
+        row.resize((size_t)pixels * bpp);
+        for (uint32_t x = 0; x < pixels; x++) {
+            uint8_t *out = row.data() + x * bpp;
+            out[0] = bgr ? b : r;
+            out[1] = g;
+            out[2] = bgr ? r : b;
+            if (bpp == 4) {
+                // Blended with the coverage as alpha, this composites the text over what is below
+                out[3] = 255;
+            }
+        }
+    }
+
+    MMAL_RECT_T RaspiTextRasterizer::draw(const RASPITEXT_TARGET_S &target, int32_t x, int32_t y, const string &text, uint32_t colour, uint32_t background) {
+        MMAL_RECT_T none = { 0, 0, 0, 0 };
+        stats.draws++;
+        uint32_t bpp = overlay_bytes_per_pixel(target.encoding);
+        if (!bpp || !target.data) {
+            vcos_log_error("RaspiTextRasterizer::draw(): unsupported target encoding %4.4s", (const char *)&target.encoding);
+            return none;
+        }
+        const LAYOUT_S &text_layout = layout(text, bpp);
+        MMAL_RECT_T box = { x, y, (int32_t)text_layout.width, (int32_t)text_layout.height };
+        if (!overlay_clip(target.width, target.height, box)) {
+            return none;
+        }
+        int32_t left = box.x - x, right = left + box.width;
+
+        uint8_t background_alpha = background >> 24;
+        if (background_alpha) {
+            fill_row(background_row, background, target.encoding, box.width);
+            alpha_row.assign(background_row.size(), background_alpha);
+            uint8_t *row = target.data + (size_t)box.y * target.stride + (size_t)box.x * bpp;
+            for (int32_t i = 0; i < box.height; i++, row += target.stride) {
+                blend(row, background_row.data(), alpha_row.data(), box.width * bpp);
+            }
+            stats.bytes += (uint64_t)box.width * box.height * bpp;
+        }
+
+        uint8_t colour_alpha = colour >> 24;
+        if (!colour_alpha) {
+            return box;
+        }
+        fill_row(colour_row, colour, target.encoding, text_layout.width);
+        uint32_t layout_stride = text_layout.width * bpp;
+        for (int32_t i = 0; i < box.height; i++) {
+            int32_t line = box.y - y + i;
+            int32_t first = vcos_max((int32_t)text_layout.spans[2 * line], left);
+            int32_t last = vcos_min((int32_t)text_layout.spans[2 * line + 1], right);
+            if (first >= last) {
+                continue;
+            }
+            uint32_t bytes = (last - first) * bpp;
+            const uint8_t *alpha = text_layout.alpha.data() + (size_t)line * layout_stride + (size_t)first * bpp;
+            if (colour_alpha < 255) {
+                alpha_row.resize(bytes);
+                for (uint32_t b = 0; b < bytes; b++) {
+                    alpha_row[b] = div255(alpha[b] * colour_alpha);
+                }
+                alpha = alpha_row.data();
+            }
+            blend(target.data + (size_t)(box.y + i) * target.stride + (size_t)(x + first) * bpp, colour_row.data(), alpha, bytes);
+            stats.bytes += bytes;
+        }
+        return box;
+    }
+
+    MMAL_RECT_T RaspiTextRasterizer::draw(shared_ptr< RaspiOverlaySurface > surface, int32_t x, int32_t y, const string &text, uint32_t colour, uint32_t background) {
+        MMAL_RECT_T none = { 0, 0, 0, 0 };
+        if (!surface || surface->get_bytes_per_pixel() == 1) {
+            vcos_log_error("RaspiTextRasterizer::draw(): text needs a surface in direct mode");
+            return none;
+        }
+        RASPITEXT_TARGET_S canvas;
+        canvas.data = surface->get_canvas();
+        canvas.stride = surface->get_stride();
+        canvas.width = surface->get_width();
+        canvas.height = surface->get_height();
+        canvas.encoding = surface->get_encoding();
+        MMAL_RECT_T changed = draw(canvas, x, y, text, colour, background);
+        if (changed.width) {
+            surface->invalidate(changed);
+        }
+        return changed;
+    }
+
+    RASPITEXT_PATH_T RaspiTextRasterizer::path() {
+        return path_;
+    }
+
+    const char* RaspiTextRasterizer::name() {
+        switch (path_) {
+            case RASPITEXT_PATH_SSE2:
+                return "sse2";
+            case RASPITEXT_PATH_NEON:
+                return "neon";
+            default:
+                return "scalar";
+        }
+    }
+
+    RASPITEXT_STATS_S RaspiTextRasterizer::get_stats() {
+        return stats;
+    }
+
+}
@@ -36,6 +36,8 @@ namespace raspivid {
         options.framerate = 0;
         options.cameraNum = 0;
         options.sensor_mode = 0;
+        options.telemetry_records = 256;
+        options.annotator = false;
         options.settings_callback = nullptr;
         options.verbose = true;
         raspicamcontrol_set_defaults(&options.camera_parameters);
@@ -55,6 +57,16 @@ namespace raspivid {
         return create(RaspiCamera::createDefaultCameraOptions());
     }
 
+    RaspiCamera::~RaspiCamera() {
+        // The component outlives these members, so its control port would otherwise keep calling into them
+        if (component && component->control->is_enabled) {
+            mmal_port_disable(component->control);
+        }
+        if (annotator) {
+            annotator->stop();
+        }
+    }
+
     MMAL_STATUS_T RaspiCamera::init() {
         MMAL_STATUS_T status;
 
@@ -85,44 +97,36 @@ namespace raspivid {
             vcos_log_error("RaspiCamera::init(): unable to set sensor mode (%u)", status);
         }
 
-        if ((status = mmal_component_enable(component)) != MMAL_SUCCESS) {
+        if ((status = enable()) != MMAL_SUCCESS) {
             vcos_log_error("RaspiCamera::init(): unable to enable camera component (%u)", status);
             return status;
         }
 
-        if (options_.settings_callback) {
-            MMAL_PARAMETER_CHANGE_EVENT_REQUEST_T change_event_request =
-                {{MMAL_PARAMETER_CHANGE_EVENT_REQUEST, sizeof(MMAL_PARAMETER_CHANGE_EVENT_REQUEST_T)},
-                MMAL_PARAMETER_CAMERA_SETTINGS, 1};
+        // Settings events are always requested, they keep the control's cache current
+        control = RaspiCameraControl::create(component);
+        telemetry = RaspiCameraTelemetry::create(options_.telemetry_records);
+        ptz = RaspiPTZ::create(control, options_.camera_parameters.roi);
+        if (options_.annotator) {
+            annotator = RaspiAnnotator::create(component);
+        }
+        MMAL_PARAMETER_CHANGE_EVENT_REQUEST_T change_event_request =
+            {{MMAL_PARAMETER_CHANGE_EVENT_REQUEST, sizeof(MMAL_PARAMETER_CHANGE_EVENT_REQUEST_T)},
+            MMAL_PARAMETER_CAMERA_SETTINGS, 1};
 
-            status = mmal_port_parameter_set(component->control, &change_event_request.hdr);
-            if ( status != MMAL_SUCCESS ) {
-                vcos_log_error("RaspiCamera::init(): unable to request settings events");
-            }
-            component->control->userdata = (struct MMAL_PORT_USERDATA_T *)&userdata;
-            userdata.cb_instance = options_.settings_callback;
-            if ((status = mmal_port_enable(component->control, callback_wrapper)) != MMAL_SUCCESS) {
-                vcos_log_error("RaspiCamera::init(): unable to add settings callback");
-            }
+        status = mmal_port_parameter_set(component->control, &change_event_request.hdr);
+        if ( status != MMAL_SUCCESS ) {
+            vcos_log_error("RaspiCamera::init(): unable to request settings events");
+        }
+        component->control->userdata = (struct MMAL_PORT_USERDATA_T *)&userdata;
+        userdata.cb_instance = options_.settings_callback;
+        userdata.control = control;
+        userdata.telemetry = telemetry;
+        if ((status = mmal_port_enable(component->control, callback_wrapper)) != MMAL_SUCCESS) {
+            vcos_log_error("RaspiCamera::init(): unable to add settings callback");
         }
 
         //  set up the camera configuration
-        {
-            MMAL_PARAMETER_CAMERA_CONFIG_T cam_config = {
-                { MMAL_PARAMETER_CAMERA_CONFIG, sizeof(cam_config) },
-                .max_stills_w = options_.width,
-                .max_stills_h = options_.height,
-                .stills_yuv422 = 0,
-                .one_shot_stills = 0,
-                .max_preview_video_w = options_.width,
-                .max_preview_video_h = options_.height,
-                .num_preview_video_frames = 3 + vcos_max(0, (options_.framerate-30)/10),
-                .stills_capture_circular_buffer_height = 0,
-                .fast_preview_resume = 0,
-                .use_stc_timestamp = MMAL_PARAM_TIMESTAMP_MODE_RAW_STC
-            };
-            mmal_port_parameter_set(component->control, &cam_config.hdr);
-        }
+        set_camera_config();
         // Now set up the port formats
 
         // Set the encode format on the Preview port
@@ -238,12 +242,12 @@ namespace raspivid {
         if (still_port->buffer_num < VIDEO_OUTPUT_BUFFERS_NUM)
           still_port->buffer_num = VIDEO_OUTPUT_BUFFERS_NUM;
 
-        if ((status = mmal_component_enable(component)) != MMAL_SUCCESS) {
+        if ((status = enable()) != MMAL_SUCCESS) {
             vcos_log_error("RaspiCamera::init(): unable to enable camera component");
             return status;
         }
 
-        raspicamcontrol_set_all_parameters(component, &options_.camera_parameters);
+        control->apply(options_.camera_parameters);
 
         vcos_log_error("RaspiCamera::init(): success!");
 
@@ -251,10 +255,64 @@ namespace raspivid {
     }
 
 
+    MMAL_STATUS_T RaspiCamera::set_camera_config() {
+        MMAL_PARAMETER_CAMERA_CONFIG_T cam_config = {
+            { MMAL_PARAMETER_CAMERA_CONFIG, sizeof(cam_config) },
+            .max_stills_w = options_.width,
+            .max_stills_h = options_.height,
+            .stills_yuv422 = 0,
+            .one_shot_stills = 0,
+            .max_preview_video_w = options_.width,
+            .max_preview_video_h = options_.height,
+            .num_preview_video_frames = 3 + vcos_max(0, (options_.framerate-30)/10),
+            .stills_capture_circular_buffer_height = 0,
+            .fast_preview_resume = 0,
+            .use_stc_timestamp = MMAL_PARAM_TIMESTAMP_MODE_RAW_STC
+        };
+        return mmal_port_parameter_set(component->control, &cam_config.hdr);
+    }
+
+    MMAL_STATUS_T RaspiCamera::set_resolution(uint32_t width, uint32_t height, uint32_t framerate) {
+        if (component->output[MMAL_CAMERA_PREVIEW_PORT]->is_enabled || component->output[MMAL_CAMERA_VIDEO_PORT]->is_enabled
+                || component->output[MMAL_CAMERA_CAPTURE_PORT]->is_enabled) {
+            vcos_log_error("RaspiCamera::set_resolution(): all camera ports must be disabled");
+            return MMAL_EINVAL;
+        }
+
+        options_.width = width;
+        options_.height = height;
+        options_.framerate = framerate;
+
+        // The firmware only takes a new sensor configuration while the component is disabled
+        MMAL_STATUS_T status;
+        if ((status = mmal_component_disable(component)) != MMAL_SUCCESS) {
+            vcos_log_error("RaspiCamera::set_resolution(): unable to disable camera component (%u)", status);
+            return status;
+        }
+        if ((status = set_camera_config()) != MMAL_SUCCESS) {
+            vcos_log_error("RaspiCamera::set_resolution(): unable to configure camera for %ux%u (%u)", width, height, status);
+        }
+        MMAL_STATUS_T enabled;
+        if ((enabled = mmal_component_enable(component)) != MMAL_SUCCESS) {
+            vcos_log_error("RaspiCamera::set_resolution(): unable to enable camera component (%u)", enabled);
+            return enabled;
+        }
+        return status;
+    }
+
     void RaspiCamera::callback_wrapper(MMAL_PORT_T *port, MMAL_BUFFER_HEADER_T *buffer) {
         RASPICAMERA_USERDATA_S *userdata = (RASPICAMERA_USERDATA_S *)port->userdata;
         vcos_assert(userdata);
-        userdata->cb_instance->callback(port, buffer);
+        if (buffer->cmd == MMAL_EVENT_PARAMETER_CHANGED) {
+            MMAL_EVENT_PARAMETER_CHANGED_T *param = (MMAL_EVENT_PARAMETER_CHANGED_T *)buffer->data;
+            userdata->control->parameter_changed(&param->hdr);
+            if (param->hdr.id == MMAL_PARAMETER_CAMERA_SETTINGS && param->hdr.size >= sizeof(MMAL_PARAMETER_CAMERA_SETTINGS_T)) {
+                userdata->telemetry->push(*(MMAL_PARAMETER_CAMERA_SETTINGS_T *)param, buffer->pts);
+            }
+        }
+        if (userdata->cb_instance) {
+            userdata->cb_instance->callback(port, buffer);
+        }
         mmal_buffer_header_release(buffer);
     }
 
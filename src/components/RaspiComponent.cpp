@@ -5,7 +5,10 @@ namespace raspivid {
     MMAL_STATUS_T RaspiComponent::init() {
         MMAL_STATUS_T status;
         
-        if ((status = mmal_component_create(component_name(), &component)) != MMAL_SUCCESS) {
+        timing.create_us = RaspiPortMetrics::now_us();
+        status = mmal_component_create(component_name(), &component);
+        timing.created_us = RaspiPortMetrics::now_us();
+        if (status != MMAL_SUCCESS) {
             vcos_log_error("RaspiComponent::init(): unable to create component %s", component_name());
             return status;
         }
@@ -13,6 +16,19 @@ namespace raspivid {
         return MMAL_SUCCESS;
     }
 
+    MMAL_STATUS_T RaspiComponent::enable() {
+        if (!timing.enable_us) {
+            timing.enable_us = RaspiPortMetrics::now_us();
+        }
+        MMAL_STATUS_T status = mmal_component_enable(component);
+        timing.enabled_us = RaspiPortMetrics::now_us();
+        return status;
+    }
+
+    RASPICOMPONENT_TIMING_S RaspiComponent::get_timing() {
+        return timing;
+    }
+
     MMAL_STATUS_T RaspiComponent::connect( shared_ptr< RaspiComponent > source_component ) {
         if ( default_input && source_component->default_output ) {
             return connect( source_component->default_output );
@@ -36,6 +52,13 @@ namespace raspivid {
     }
 
     void RaspiComponent::destroy() {
+        // Default ports outlive the derived class members, so release them while the component still exists
+        if (default_input) {
+            default_input->destroy();
+        }
+        if (default_output) {
+            default_output->destroy();
+        }
         if (component) {
             mmal_component_disable(component);
             mmal_component_destroy(component);
@@ -43,7 +66,8 @@ namespace raspivid {
         }
     }
 
-    RaspiComponent::RaspiComponent() {
+    RaspiComponent::RaspiComponent() : component(NULL) {
+        memset(&timing, 0, sizeof(timing));
     }
 
     RaspiComponent::~RaspiComponent() {
@@ -202,7 +202,7 @@ namespace raspivid {
             }
         }
  
-        if ((status = mmal_component_enable(component)) != MMAL_SUCCESS) {
+        if ((status = enable()) != MMAL_SUCCESS) {
             vcos_log_error("RaspiEncoder::init(): unable to enable encoder component (%u)", status);
             return status;
         }
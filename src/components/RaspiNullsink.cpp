@@ -21,7 +21,7 @@ namespace raspivid {
         }
 
         assert_ports(1, 0);
-        if ((status = mmal_component_enable(component)) != MMAL_SUCCESS) {
+        if ((status = enable()) != MMAL_SUCCESS) {
             vcos_log_error("RaspiNullsink::init(): unable to enable nullsink component (%u)", status);
             return status;
         }
@@ -23,8 +23,12 @@ namespace raspivid {
         return input->get_buffer();
     }
 
-    void RaspiOverlayRenderer::send_buffer(MMAL_BUFFER_HEADER_T *buffer) {
-        input->send_buffer(buffer);
+    MMAL_STATUS_T RaspiOverlayRenderer::send_buffer(MMAL_BUFFER_HEADER_T *buffer) {
+        return input->send_buffer(buffer);
+    }
+
+    RASPIOVERLAYRENDERER_FORMAT_S RaspiOverlayRenderer::get_format() {
+        return format_;
     }
 
     shared_ptr< RaspiOverlayRenderer > RaspiOverlayRenderer::create() {
@@ -63,7 +67,7 @@ namespace raspivid {
             return status;
         }
 
-        if ((status = mmal_component_enable(component)) != MMAL_SUCCESS) {
+        if ((status = enable()) != MMAL_SUCCESS) {
             vcos_log_error("RaspiOverlayRenderer::init(): could not enable component");
             return status;
         }
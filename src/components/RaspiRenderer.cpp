@@ -61,7 +61,7 @@ namespace raspivid {
         }
 
         /* Enable component */
-        if ((status = mmal_component_enable(component)) != MMAL_SUCCESS) {
+        if ((status = enable()) != MMAL_SUCCESS) {
             vcos_log_error("RaspiRenderer::init(): unable to enable renderer component (%u)", status);
             return status;
         }
@@ -63,4 +63,9 @@ namespace raspivid {
         return MMAL_SUCCESS;
     }
 
+    void RaspiResize::set_size(int width, int height) {
+        width_ = width;
+        height_ = height;
+    }
+
 }